@@ -27,6 +27,9 @@ function(halide_use_image_io TARGET)
       target_compile_definitions(${TARGET} PRIVATE -DHALIDE_NO_${PKG})
     endif()
   endforeach()
+  # halide_image_io.h converts images using several threads.
+  find_package(Threads QUIET)
+  target_link_libraries(${TARGET} PRIVATE ${CMAKE_THREAD_LIBS_INIT})
 endfunction()
 
 # Make a build target for a Generator.
@@ -502,6 +505,13 @@ function(_halide_runtime_target_name HALIDE_TARGET OUTVAR)
         strict_float
         legacy_buffer_wrappers
         tsan
+        plan_memory
+        profile_counters
+        profile_timeline
+        avx512_cascadelake
+        arm_dot_prod
+        fast_transcendentals
+        fast_compile
       )
     # Synthesize a one-or-two-char abbreviation based on the feature's position
     # in the KNOWN_FEATURES list.
@@ -136,6 +136,13 @@ void define_enums(py::module &m) {
         .value("LegacyBufferWrappers", Target::Feature::LegacyBufferWrappers)
         .value("TSAN", Target::Feature::TSAN)
         .value("ASAN", Target::Feature::ASAN)
+        .value("PlanMemory", Target::Feature::PlanMemory)
+        .value("ProfileCounters", Target::Feature::ProfileCounters)
+        .value("ProfileTimeline", Target::Feature::ProfileTimeline)
+        .value("AVX512_Cascadelake", Target::Feature::AVX512_Cascadelake)
+        .value("ARMDotProd", Target::Feature::ARMDotProd)
+        .value("FastTranscendentals", Target::Feature::FastTranscendentals)
+        .value("FastCompile", Target::Feature::FastCompile)
         .value("FeatureEnd", Target::Feature::FeatureEnd);
 
     py::enum_<halide_type_code_t>(m, "TypeCode")
@@ -150,6 +150,8 @@ void define_func(py::module &m) {
             py::arg("loop_level"))
 
         .def("memoize", &Func::memoize)
+        // async is a reserved word in Python 3.7
+        .def("async_", &Func::async)
         .def("compute_inline", &Func::compute_inline)
         .def("compute_root", &Func::compute_root)
         .def("store_root", &Func::store_root)
@@ -82,6 +82,9 @@ void define_pipeline(py::module &m) {
         .def("compile_jit", [](Pipeline &p, const Target &target) -> void {
             (void) p.compile_jit();
         }, py::arg("target") = get_jit_target_from_environment())
+        .def("set_tiered_jit", &Pipeline::set_tiered_jit, py::arg("tiered"))
+        .def("tiered_jit", &Pipeline::tiered_jit)
+        .def("wait_for_optimized_jit", &Pipeline::wait_for_optimized_jit)
 
 
         .def("realize", [](Pipeline &p, Buffer<> buffer, const Target &target, const ParamMap &param_map) -> void {
@@ -15,6 +15,8 @@ void define_stage(py::module &m) {
         .def("rfactor", (Func (Stage::*)(RVar, Var)) &Stage::rfactor,
             py::arg("r"), py::arg("v"))
 
+        .def("atomic", &Stage::atomic, py::arg("override_associativity_test") = false)
+
         // These two variants of compute_with are specific to Stage
         .def("compute_with", (Stage &(Stage::*)(LoopLevel, const std::vector<std::pair<VarOrRVar, LoopAlignStrategy>> &)) &Stage::compute_with,
             py::arg("loop_level"), py::arg("align"))
@@ -1,3 +1,5 @@
+#include <mutex>
+
 #include "AssociativeOpsTable.h"
 #include "IRPrinter.h"
 
@@ -111,7 +113,11 @@ struct TableKey {
     }
 };
 
+// The tables are populated lazily, possibly from several threads
+// lowering at once. Entries are never removed, so references to them
+// remain valid after the lock is released.
 static map<TableKey, vector<AssociativePattern>> pattern_tables;
+static std::mutex pattern_tables_mutex;
 
 #define declare_vars(t, index)                  \
     Expr x##index = Variable::make(t, "x" + std::to_string(index)); \
@@ -275,6 +281,7 @@ const vector<AssociativePattern> &get_ops_table_helper(const vector<Type> &types
     TableKey gen_key(ValType::All, root, dim);
     TableKey key(convert_halide_types_to_val_types(types), root, dim);
 
+    std::lock_guard<std::mutex> lock(pattern_tables_mutex);
     const auto &table_it = pattern_tables.find(key);
     if (table_it == pattern_tables.end()) { // Populate the table if we haven't done so previously
         vector<AssociativePattern> &table = pattern_tables[key];
@@ -0,0 +1,245 @@
+#include "AsyncProducers.h"
+#include "Debug.h"
+#include "Function.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "IRPrinter.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+
+namespace {
+
+// Find the Funcs called by the produce node of a func, and the Funcs
+// produced anywhere else in a statement.
+class FindProducerDependencies : public IRVisitor {
+    const string &func;
+    bool in_producer = false;
+
+    using IRVisitor::visit;
+
+    void visit(const ProducerConsumer *op) {
+        if (op->is_producer && op->name == func) {
+            ScopedValue<bool> old_in_producer(in_producer, true);
+            IRVisitor::visit(op);
+        } else {
+            if (op->is_producer && !in_producer) {
+                produced_elsewhere.insert(op->name);
+            }
+            IRVisitor::visit(op);
+        }
+    }
+
+    void visit(const Call *op) {
+        IRVisitor::visit(op);
+        if (in_producer && op->call_type == Call::Halide) {
+            called.insert(op->name);
+        }
+    }
+
+public:
+    set<string> called, produced_elsewhere;
+    FindProducerDependencies(const string &f) : func(f) {}
+};
+
+// Strip everything from a statement except the produce nodes for a
+// func and the loops and lets surrounding them. Signal the
+// semaphore at the end of each produce node.
+class GenerateProducerBody : public IRMutator2 {
+    const string &func;
+    Expr sema;
+
+    using IRMutator2::visit;
+
+    Stmt visit(const ProducerConsumer *op) override {
+        if (op->is_producer && op->name == func) {
+            Expr release = Call::make(Int(32), "halide_semaphore_release",
+                                      {sema, 1}, Call::Extern);
+            return ProducerConsumer::make(op->name, op->is_producer,
+                                          Block::make(op->body, Evaluate::make(release)));
+        }
+        Stmt body = mutate(op->body);
+        if (is_no_op(body)) {
+            return body;
+        } else if (body.same_as(op->body)) {
+            return op;
+        } else {
+            return ProducerConsumer::make(op->name, op->is_producer, body);
+        }
+    }
+
+    Stmt visit(const Provide *op) override {
+        return Evaluate::make(0);
+    }
+
+    Stmt visit(const Store *op) override {
+        return Evaluate::make(0);
+    }
+
+    Stmt visit(const Evaluate *op) override {
+        return Evaluate::make(0);
+    }
+
+    Stmt visit(const Realize *op) override {
+        // The storage for other Funcs realized here is only used by
+        // the consumer.
+        return mutate(op->body);
+    }
+
+    Stmt visit(const For *op) override {
+        Stmt body = mutate(op->body);
+        if (is_no_op(body)) {
+            return body;
+        } else if (body.same_as(op->body)) {
+            return op;
+        } else {
+            return For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+        }
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        Stmt body = mutate(op->body);
+        if (is_no_op(body)) {
+            return body;
+        } else if (body.same_as(op->body)) {
+            return op;
+        } else {
+            return LetStmt::make(op->name, op->value, body);
+        }
+    }
+
+    Stmt visit(const Allocate *op) override {
+        Stmt body = mutate(op->body);
+        if (is_no_op(body)) {
+            return body;
+        } else if (body.same_as(op->body)) {
+            return op;
+        } else {
+            return Allocate::make(op->name, op->type, op->memory_type, op->extents,
+                                  op->condition, body, op->new_expr, op->free_function);
+        }
+    }
+
+    Stmt visit(const Block *op) override {
+        Stmt first = mutate(op->first);
+        Stmt rest = mutate(op->rest);
+        if (is_no_op(first)) {
+            return rest;
+        } else if (is_no_op(rest)) {
+            return first;
+        } else if (first.same_as(op->first) && rest.same_as(op->rest)) {
+            return op;
+        } else {
+            return Block::make(first, rest);
+        }
+    }
+
+    Stmt visit(const IfThenElse *op) override {
+        Stmt then_case = mutate(op->then_case);
+        Stmt else_case = op->else_case.defined() ? mutate(op->else_case) : Stmt();
+        bool else_is_no_op = !else_case.defined() || is_no_op(else_case);
+        if (is_no_op(then_case) && else_is_no_op) {
+            return then_case;
+        } else if (then_case.same_as(op->then_case) && else_case.same_as(op->else_case)) {
+            return op;
+        } else {
+            return IfThenElse::make(op->condition, then_case, else_is_no_op ? Stmt() : else_case);
+        }
+    }
+
+public:
+    GenerateProducerBody(const string &f, Expr s) : func(f), sema(s) {}
+};
+
+// Replace each produce node for a func with a wait on the semaphore
+// its producer signals.
+class GenerateConsumerBody : public IRMutator2 {
+    const string &func;
+    Expr sema;
+
+    using IRMutator2::visit;
+
+    Stmt visit(const ProducerConsumer *op) override {
+        if (op->is_producer && op->name == func) {
+            Expr acquire = Call::make(Int(32), "halide_semaphore_acquire",
+                                      {sema, 1}, Call::Extern);
+            return Evaluate::make(acquire);
+        } else {
+            return IRMutator2::visit(op);
+        }
+    }
+
+public:
+    GenerateConsumerBody(const string &f, Expr s) : func(f), sema(s) {}
+};
+
+class ForkAsyncProducers : public IRMutator2 {
+    const map<string, Function> &env;
+
+    using IRMutator2::visit;
+
+    Stmt visit(const Realize *op) override {
+        Stmt body = mutate(op->body);
+
+        auto it = env.find(op->name);
+        if (it == env.end() || !it->second.schedule().async()) {
+            if (body.same_as(op->body)) {
+                return op;
+            } else {
+                return Realize::make(op->name, op->types, op->memory_type,
+                                     op->bounds, op->condition, body);
+            }
+        }
+
+        // The producer can't depend on anything the consumer computes.
+        FindProducerDependencies deps(op->name);
+        body.accept(&deps);
+        for (const string &g : deps.called) {
+            user_assert(!deps.produced_elsewhere.count(g))
+                << "Func " << op->name << " is scheduled async, but depends on Func "
+                << g << ", which is computed within the loop nest of its consumer. "
+                << "Compute " << g << " at a loop level outside of the storage of "
+                << op->name << ", or within " << op->name << " itself.\n";
+        }
+
+        string sema_name = op->name + ".semaphore";
+        Expr sema = Variable::make(type_of<halide_semaphore_t *>(), sema_name);
+
+        Stmt producer = GenerateProducerBody(op->name, sema).mutate(body);
+        if (!is_no_op(producer)) {
+            debug(3) << "Forking async producer " << op->name << "\n";
+            Stmt consumer = GenerateConsumerBody(op->name, sema).mutate(body);
+
+            // Run the producer and consumer as two parallel tasks.
+            string fork_name = op->name + ".fork";
+            Expr fork_var = Variable::make(Int(32), fork_name);
+            Stmt fork = For::make(fork_name, 0, 2, ForType::Parallel, DeviceAPI::None,
+                                  IfThenElse::make(fork_var == 0, producer, consumer));
+
+            Expr init = Call::make(Int(32), "halide_semaphore_init", {sema, 0}, Call::Extern);
+            body = Block::make(Evaluate::make(init), fork);
+            body = Allocate::make(sema_name, UInt(64), MemoryType::Stack,
+                                  {(int)(sizeof(halide_semaphore_t) / sizeof(uint64_t))},
+                                  const_true(), body);
+        }
+
+        return Realize::make(op->name, op->types, op->memory_type,
+                             op->bounds, op->condition, body);
+    }
+
+public:
+    ForkAsyncProducers(const map<string, Function> &e) : env(e) {}
+};
+
+}  // namespace
+
+Stmt fork_async_producers(Stmt s, const map<string, Function> &env) {
+    return ForkAsyncProducers(env).mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
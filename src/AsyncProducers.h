@@ -0,0 +1,31 @@
+#ifndef HALIDE_ASYNC_PRODUCERS_H
+#define HALIDE_ASYNC_PRODUCERS_H
+
+/** \file
+ * Defines the lowering pass that splits async producers out of the
+ * loop nests of their consumers.
+ */
+
+#include <map>
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+class Function;
+
+/** For each Func scheduled async, split its realization into two
+ * tasks that run concurrently: a producer task that runs only the
+ * loops required to compute the Func, and a consumer task that runs
+ * everything else. The producer signals the consumer through a
+ * semaphore each time it finishes a produce node, and the consumer
+ * waits on it in place of each produce node. Must run after storage
+ * folding, which turns folded buffers of async Funcs into ring
+ * buffers. */
+Stmt fork_async_producers(Stmt s, const std::map<std::string, Function> &env);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -1,14 +1,23 @@
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <mutex>
 #include <regex>
 
 #include "AutoSchedule.h"
+#include "AutoScheduleCostModel.h"
 #include "AutoScheduleUtils.h"
 #include "ExprUsesVar.h"
 #include "FindCalls.h"
 #include "Func.h"
 #include "IREquality.h"
+#include "InferArguments.h"
 #include "Inline.h"
 #include "ParallelRVar.h"
+#include "Pipeline.h"
 #include "RealizationOrder.h"
 #include "RegionCosts.h"
 #include "Scope.h"
@@ -44,6 +53,24 @@ void substitute_estimates_region(map<string, Box> &region) {
     }
 }
 
+// Get the value of an Expr that simplifies to a numeric constant.
+bool get_numeric(const Expr &e, double *value) {
+    if (!e.defined()) {
+        return false;
+    }
+    Expr s = simplify(e);
+    if (const int64_t *i = as_const_int(s)) {
+        *value = (double)*i;
+    } else if (const uint64_t *u = as_const_uint(s)) {
+        *value = (double)*u;
+    } else if (const double *f = as_const_float(s)) {
+        *value = *f;
+    } else {
+        return false;
+    }
+    return true;
+}
+
 // Return true if any of the box dimension is unbounded.
 bool is_box_unbounded(const Box &b) {
     for (size_t i = 0; i < b.size(); i++) {
@@ -988,6 +1015,10 @@ struct Partitioner {
         // Estimate of the parallelism that can be exploited while computing
         // the group.
         Expr parallelism;
+        // Features of the group, for the cost model. Only computed when
+        // 'has_features' is set.
+        GroupFeatures features;
+        bool has_features = false;
 
         GroupAnalysis() : cost(Cost()) , parallelism(Expr()) {}
         GroupAnalysis(const Cost &c, Expr p) : cost(c), parallelism(std::move(p)) {}
@@ -1061,12 +1092,29 @@ struct Partitioner {
     RegionCosts &costs;
     // Output functions of the pipeline.
     const vector<Function> &outputs;
+    // The cost model used to compare groupings, or null to use the
+    // hand-written model in analyze_group.
+    AutoScheduleCostModel *cost_model;
+    // Compute the features of each group even when using the hand-written
+    // model, so that they can be recorded to train other cost models.
+    bool collect_features;
+
+    // The decisions taken by 'group' so far, one per merge, as indices into
+    // the alternatives returned by 'rank_candidate_groupings' (0 is the greedy
+    // choice). Replaying them through 'forced_decisions' on a copy of the same
+    // pipeline reproduces the same grouping.
+    vector<int> decisions;
+    // Decisions for 'group' to take instead of the greedy ones, in order.
+    // Merges past the end of it take the greedy choice.
+    vector<int> forced_decisions;
 
     Partitioner(const map<string, Box> &_pipeline_bounds,
                 const MachineParams &_arch_params,
                 const vector<Function> &_outputs,
                 DependenceAnalysis &_dep_analysis,
-                RegionCosts &_costs);
+                RegionCosts &_costs,
+                AutoScheduleCostModel *_cost_model = nullptr,
+                bool _collect_features = false);
 
     void initialize_groups();
 
@@ -1096,6 +1144,20 @@ struct Partitioner {
     // reached.
     void group(Partitioner::Level level);
 
+    // Return the pairs of producer and consumer functions that are candidates
+    // for grouping at 'level' given the current grouping.
+    vector<pair<string, string>> grouping_candidates(Partitioner::Level level);
+
+    // Merge the producer of a grouping choice returned by
+    // 'choose_candidate_grouping' into its consumers, and update the
+    // children of the affected groups.
+    void apply_grouping(const vector<pair<GroupingChoice, GroupConfig>> &grouping,
+                        Partitioner::Level level);
+
+    // Return the group formed by merging all stages of the producer of
+    // 'choice' into its consumer stage.
+    Group choice_group(const GroupingChoice &choice);
+
     // Given a grouping choice, return a configuration for the group that gives
     // the highest estimated benefits.
     GroupConfig evaluate_choice(const GroupingChoice &group, Partitioner::Level level);
@@ -1107,6 +1169,19 @@ struct Partitioner {
     choose_candidate_grouping(const vector<pair<string, string>> &cands,
                               Partitioner::Level level);
 
+    // Return the grouping of the producer 'prod' into all of its consumers,
+    // with the best configuration for each consumer.
+    vector<pair<GroupingChoice, GroupConfig>>
+    candidate_grouping(const string &prod, Partitioner::Level level);
+
+    // Return up to 'max_alternatives' beneficial grouping choices, starting
+    // with the one 'choose_candidate_grouping' picks and followed by the rest
+    // in order of decreasing estimated benefit. When grouping for fast memory,
+    // groupings with the next best tile sizes are alternatives too.
+    vector<vector<pair<GroupingChoice, GroupConfig>>>
+    rank_candidate_groupings(const vector<pair<string, string>> &cands,
+                             Partitioner::Level level, size_t max_alternatives);
+
     // Return the bounds required to produce a function stage.
     DimBounds get_bounds(const FStage &stg);
 
@@ -1126,6 +1201,12 @@ struct Partitioner {
     // estimated benefit and the estimated benefit.
     pair<map<string, Expr>, GroupAnalysis> find_best_tile_config(const Group &g);
 
+    // Return the beneficial tile configurations other than 'exclude' for the
+    // group formed by 'choice', in order of decreasing estimated benefit over
+    // not tiling.
+    vector<GroupConfig> alternative_tile_configs(const GroupingChoice &choice,
+                                                 const map<string, Expr> &exclude);
+
     // Estimate the benefit (arithmetic + memory) of 'new_grouping' over 'old_grouping'.
     // Positive values indicates that 'new_grouping' may be preferrable over 'old_grouping'.
     // When 'ensure_parallelism' is set to true, this will return an undefined cost
@@ -1145,6 +1226,10 @@ struct Partitioner {
     // groups within the pipeline.
     Cost get_pipeline_cost();
 
+    // Return the sum of the features of all groups within the pipeline. Only
+    // valid if the features were computed (see 'collect_features').
+    GroupFeatures get_pipeline_features();
+
     // Return the maximum access stride to allocation of 'func_acc' along any
     // loop variable specified in 'vars'. Access expressions along each dimension
     // of the allocation are specified by 'acc_exprs'. The dimension bounds of the
@@ -1265,6 +1350,16 @@ Cost Partitioner::get_pipeline_cost() {
     return total_cost;
 }
 
+GroupFeatures Partitioner::get_pipeline_features() {
+    GroupFeatures total;
+    for (const pair<const FStage, Group> &g : groups) {
+        const GroupAnalysis &analysis = get_element(group_costs, g.first);
+        internal_assert(analysis.has_features);
+        total.accumulate(analysis.features);
+    }
+    return total;
+}
+
 void Partitioner::disp_pipeline_costs() {
     internal_assert(!group_costs.empty());
     Cost total_cost(0, 0);
@@ -1306,9 +1401,12 @@ Partitioner::Partitioner(const map<string, Box> &_pipeline_bounds,
                          const MachineParams &_arch_params,
                          const vector<Function> &_outputs,
                          DependenceAnalysis &_dep_analysis,
-                         RegionCosts &_costs)
+                         RegionCosts &_costs,
+                         AutoScheduleCostModel *_cost_model,
+                         bool _collect_features)
         : pipeline_bounds(_pipeline_bounds), arch_params(_arch_params),
-          dep_analysis(_dep_analysis), costs(_costs), outputs(_outputs) {
+          dep_analysis(_dep_analysis), costs(_costs), outputs(_outputs),
+          cost_model(_cost_model), collect_features(_collect_features || _cost_model) {
     // Place each stage of a function in its own group. Each stage is
     // a node in the pipeline graph.
     for (const auto &f : dep_analysis.env) {
@@ -1405,6 +1503,35 @@ map<string, Expr> Partitioner::evaluate_reuse(const FStage &stg,
     return reuse;
 }
 
+vector<pair<Partitioner::GroupingChoice, Partitioner::GroupConfig>>
+Partitioner::candidate_grouping(const string &prod_name, Partitioner::Level level) {
+    vector<pair<GroupingChoice, GroupConfig>> grouping;
+
+    const Function &prod_f = get_element(dep_analysis.env, prod_name);
+    int final_stage = prod_f.updates().size();
+
+    FStage prod(prod_f, final_stage);
+
+    for (const FStage &c : get_element(children, prod)) {
+        GroupConfig best_config;
+        GroupingChoice cand_choice(prod_f.name(), c);
+
+        // Check if the candidate has been evaluated for grouping before
+        const auto &iter = grouping_cache.find(cand_choice);
+        if (iter != grouping_cache.end()) {
+            best_config = iter->second;
+        } else {
+            best_config = evaluate_choice(cand_choice, level);
+            // Cache the result of the evaluation for the pair
+            grouping_cache.emplace(cand_choice, best_config);
+        }
+
+        grouping.push_back(make_pair(cand_choice, best_config));
+    }
+
+    return grouping;
+}
+
 vector<pair<Partitioner::GroupingChoice, Partitioner::GroupConfig>>
 Partitioner::choose_candidate_grouping(const vector<pair<string, string>> &cands,
                                        Partitioner::Level level) {
@@ -1412,29 +1539,8 @@ Partitioner::choose_candidate_grouping(const vector<pair<string, string>> &cands
     Expr best_benefit = make_zero(Int(64));
     for (const auto &p : cands) {
         // Compute the aggregate benefit of inlining into all the children.
-        vector<pair<GroupingChoice, GroupConfig>> grouping;
-
-        const Function &prod_f = get_element(dep_analysis.env, p.first);
-        int final_stage = prod_f.updates().size();
-
-        FStage prod(prod_f, final_stage);
-
-        for (const FStage &c : get_element(children, prod)) {
-            GroupConfig best_config;
-            GroupingChoice cand_choice(prod_f.name(), c);
-
-            // Check if the candidate has been evaluated for grouping before
-            const auto &iter = grouping_cache.find(cand_choice);
-            if (iter != grouping_cache.end()) {
-                best_config = iter->second;
-            } else {
-                best_config = evaluate_choice(cand_choice, level);
-                // Cache the result of the evaluation for the pair
-                grouping_cache.emplace(cand_choice, best_config);
-            }
-
-            grouping.push_back(make_pair(cand_choice, best_config));
-        }
+        vector<pair<GroupingChoice, GroupConfig>> grouping =
+            candidate_grouping(p.first, level);
 
         bool no_redundant_work = false;
         Expr overall_benefit = estimate_benefit(grouping, no_redundant_work, true);
@@ -1621,124 +1727,250 @@ Partitioner::find_best_tile_config(const Group &g) {
     return make_pair(best_config, best_analysis);
 }
 
-void Partitioner::group(Partitioner::Level level) {
-    bool fixpoint = false;
-    while (!fixpoint) {
-        Cost pre_merge = get_pipeline_cost();
+vector<Partitioner::GroupConfig>
+Partitioner::alternative_tile_configs(const GroupingChoice &choice,
+                                      const map<string, Expr> &exclude) {
+    Group g = choice_group(choice);
+    Group no_tile = g;
+    no_tile.tile_sizes = map<string, Expr>();
+    GroupAnalysis no_tile_analysis = analyze_group(no_tile, false);
+    if (!no_tile_analysis.cost.defined()) {
+        return {};
+    }
 
-        fixpoint = true;
-        vector<pair<string, string>> cand;
-        for (const pair<FStage, Group> &g : groups) {
-            bool is_output = false;
-            for (const Function &f : outputs) {
-                if (g.first.func.name() == f.name()) {
-                    is_output = true;
-                    break;
-                }
-            }
+    vector<pair<double, GroupConfig>> configs;
+    for (const auto &config : generate_tile_configs(g.output)) {
+        if (config == exclude) {
+            continue;
+        }
+        Group new_group = g;
+        new_group.tile_sizes = config;
+        GroupAnalysis new_analysis = analyze_group(new_group, false);
 
-            // All stages of a function are computed at a single location.
-            // The last stage of the function represents the candidate choice
-            // of grouping the function into a consumer.
+        bool no_redundant_work = false;
+        Expr benefit = estimate_benefit(no_tile_analysis, new_analysis,
+                                        no_redundant_work, true);
+        double value;
+        if (get_numeric(benefit, &value) && value > 0) {
+            configs.push_back(make_pair(value, GroupConfig(config, new_analysis)));
+        }
+    }
 
-            const Function &prod_f = get_element(dep_analysis.env, g.first.func.name());
-            bool is_final_stage = (g.first.stage_num == prod_f.updates().size());
+    std::stable_sort(configs.begin(), configs.end(),
+                     [](const pair<double, GroupConfig> &a, const pair<double, GroupConfig> &b) {
+                         return a.first > b.first;
+                     });
+    vector<GroupConfig> result;
+    for (const auto &config : configs) {
+        result.push_back(config.second);
+    }
+    return result;
+}
 
-            if (is_output || !is_final_stage) {
-                continue;
+vector<vector<pair<Partitioner::GroupingChoice, Partitioner::GroupConfig>>>
+Partitioner::rank_candidate_groupings(const vector<pair<string, string>> &cands,
+                                      Partitioner::Level level, size_t max_alternatives) {
+    vector<vector<pair<GroupingChoice, GroupConfig>>> ranked;
+    vector<pair<GroupingChoice, GroupConfig>> best = choose_candidate_grouping(cands, level);
+    if (best.empty() || max_alternatives == 0) {
+        return ranked;
+    }
+    ranked.push_back(best);
+
+    auto same_grouping = [](const vector<pair<GroupingChoice, GroupConfig>> &a,
+                            const vector<pair<GroupingChoice, GroupConfig>> &b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); i++) {
+            if (!(a[i].first == b[i].first) ||
+                !(a[i].second.tile_sizes == b[i].second.tile_sizes)) {
+                return false;
             }
+        }
+        return true;
+    };
 
-            const auto &iter = children.find(g.first);
-            if (iter != children.end()) {
-                // All the stages belonging to a function are considered to be a
-                // single child.
-                set<string> child_groups;
-                for (const FStage &s : iter->second) {
-                    child_groups.insert(s.func.name());
-                }
+    vector<pair<double, vector<pair<GroupingChoice, GroupConfig>>>> others;
+    for (const auto &p : cands) {
+        vector<vector<pair<GroupingChoice, GroupConfig>>> variants;
+        variants.push_back(candidate_grouping(p.first, level));
+
+        // Only groupings of a producer into a single consumer stage have
+        // their tile sizes varied, as the tile sizes of groupings into
+        // several stages have to be chosen together.
+        const auto &grouping = variants[0];
+        if ((level == Partitioner::Level::FastMem) && (grouping.size() == 1)) {
+            for (const GroupConfig &config :
+                     alternative_tile_configs(grouping[0].first, grouping[0].second.tile_sizes)) {
+                variants.push_back({make_pair(grouping[0].first, config)});
+            }
+        }
 
-                int num_children = child_groups.size();
-                // Only groups with a single child are considered for grouping
-                // when grouping for computing in tiles.
-                // TODO: The current scheduling model does not allow functions
-                // to be computed at different points.
-                if ((num_children == 1) && (level == Partitioner::Level::FastMem)) {
-                    const string &prod_name = prod_f.name();
-                    const string &cons_name = (*child_groups.begin());
-                    cand.push_back(make_pair(prod_name, cons_name));
-                } else if((level == Partitioner::Level::Inline) && prod_f.is_pure()) {
-                    const string &prod_name = prod_f.name();
-                    cand.push_back(make_pair(prod_name, ""));
-                }
+        for (const auto &v : variants) {
+            if (same_grouping(v, best)) {
+                continue;
+            }
+            bool no_redundant_work = false;
+            Expr benefit = estimate_benefit(v, no_redundant_work, true);
+            double value;
+            if (get_numeric(benefit, &value) && value > 0) {
+                others.push_back(make_pair(value, v));
             }
         }
+    }
 
-        debug(3) << "\n============================" << '\n';
-        debug(3) << "Current grouping candidates:" << '\n';
-        debug(3) << "============================" << '\n';
-        for (size_t i = 0; i < cand.size(); ++i) {
-            debug(3) << "{" << cand[i].first << ", " << cand[i].second << "}" << '\n';
+    std::stable_sort(others.begin(), others.end(),
+                     [](const pair<double, vector<pair<GroupingChoice, GroupConfig>>> &a,
+                        const pair<double, vector<pair<GroupingChoice, GroupConfig>>> &b) {
+                         return a.first > b.first;
+                     });
+    for (size_t i = 0; i < others.size() && ranked.size() < max_alternatives; i++) {
+        ranked.push_back(others[i].second);
+    }
+    return ranked;
+}
+
+vector<pair<string, string>> Partitioner::grouping_candidates(Partitioner::Level level) {
+    vector<pair<string, string>> cand;
+    for (const pair<FStage, Group> &g : groups) {
+        bool is_output = false;
+        for (const Function &f : outputs) {
+            if (g.first.func.name() == f.name()) {
+                is_output = true;
+                break;
+            }
         }
 
-        vector<pair<GroupingChoice, GroupConfig>> best = choose_candidate_grouping(cand, level);
-        if (best.empty()) {
+        // All stages of a function are computed at a single location.
+        // The last stage of the function represents the candidate choice
+        // of grouping the function into a consumer.
+
+        const Function &prod_f = get_element(dep_analysis.env, g.first.func.name());
+        bool is_final_stage = (g.first.stage_num == prod_f.updates().size());
+
+        if (is_output || !is_final_stage) {
             continue;
-        } else {
-            fixpoint = false;
         }
 
-        // The following code makes the assumption that all the stages of a function
-        // will be in the same group. 'choose_candidate_grouping' ensures that the
-        // grouping choice being returned adheres to this constraint.
-        const string &prod = best[0].first.prod;
+        const auto &iter = children.find(g.first);
+        if (iter != children.end()) {
+            // All the stages belonging to a function are considered to be a
+            // single child.
+            set<string> child_groups;
+            for (const FStage &s : iter->second) {
+                child_groups.insert(s.func.name());
+            }
+
+            int num_children = child_groups.size();
+            // Only groups with a single child are considered for grouping
+            // when grouping for computing in tiles.
+            // TODO: The current scheduling model does not allow functions
+            // to be computed at different points.
+            if ((num_children == 1) && (level == Partitioner::Level::FastMem)) {
+                const string &prod_name = prod_f.name();
+                const string &cons_name = (*child_groups.begin());
+                cand.push_back(make_pair(prod_name, cons_name));
+            } else if((level == Partitioner::Level::Inline) && prod_f.is_pure()) {
+                const string &prod_name = prod_f.name();
+                cand.push_back(make_pair(prod_name, ""));
+            }
+        }
+    }
 
-        const Function &prod_f = get_element(dep_analysis.env, prod);
-        size_t num_stages = prod_f.updates().size() + 1;
+    return cand;
+}
 
-        FStage final_stage(prod_f, num_stages - 1);
-        set<FStage> prod_group_children = get_element(children, final_stage);
+void Partitioner::apply_grouping(const vector<pair<GroupingChoice, GroupConfig>> &best,
+                                 Partitioner::Level level) {
+    // The following code makes the assumption that all the stages of a function
+    // will be in the same group. 'choose_candidate_grouping' ensures that the
+    // grouping choice being returned adheres to this constraint.
+    const string &prod = best[0].first.prod;
 
-        // Invalidate entries of the grouping cache
-        set<GroupingChoice> invalid_keys;
-        for (const auto &c : prod_group_children) {
-            for (const auto &entry : grouping_cache) {
-                if ((entry.first.prod == c.func.name()) || (entry.first.cons == c)) {
-                    invalid_keys.insert(entry.first);
-                }
+    const Function &prod_f = get_element(dep_analysis.env, prod);
+    size_t num_stages = prod_f.updates().size() + 1;
+
+    FStage final_stage(prod_f, num_stages - 1);
+    set<FStage> prod_group_children = get_element(children, final_stage);
+
+    // Invalidate entries of the grouping cache
+    set<GroupingChoice> invalid_keys;
+    for (const auto &c : prod_group_children) {
+        for (const auto &entry : grouping_cache) {
+            if ((entry.first.prod == c.func.name()) || (entry.first.cons == c)) {
+                invalid_keys.insert(entry.first);
             }
         }
-        for (const auto &key : invalid_keys) {
-            grouping_cache.erase(key);
-        }
+    }
+    for (const auto &key : invalid_keys) {
+        grouping_cache.erase(key);
+    }
 
-        for (const auto &group : best) {
-            internal_assert(group.first.prod == prod);
-            merge_groups(group.first, group.second, level);
+    for (const auto &group : best) {
+        internal_assert(group.first.prod == prod);
+        merge_groups(group.first, group.second, level);
+    }
+
+    for (size_t s = 0; s < num_stages; s++) {
+        FStage prod_group(prod_f, s);
+        groups.erase(prod_group);
+        group_costs.erase(prod_group);
+
+        // Update the children mapping
+        children.erase(prod_group);
+        for (auto &f : children) {
+            set<FStage> &cons = f.second;
+            auto iter = cons.find(prod_group);
+            if (iter != cons.end()) {
+                cons.erase(iter);
+                // For a function with multiple stages, all the stages will
+                // be in the same group and the consumers of the function
+                // only depend on the last stage. Therefore, when the
+                // producer group has multiple stages, parents of the
+                // producers should point to the consumers of the last
+                // stage of the producer.
+                cons.insert(prod_group_children.begin(), prod_group_children.end());
+            }
         }
+    }
+}
 
-        for (size_t s = 0; s < num_stages; s++) {
-            FStage prod_group(prod_f, s);
-            groups.erase(prod_group);
-            group_costs.erase(prod_group);
+void Partitioner::group(Partitioner::Level level) {
+    bool fixpoint = false;
+    while (!fixpoint) {
+        fixpoint = true;
+        vector<pair<string, string>> cand = grouping_candidates(level);
 
-            // Update the children mapping
-            children.erase(prod_group);
-            for (auto &f : children) {
-                set<FStage> &cons = f.second;
-                auto iter = cons.find(prod_group);
-                if (iter != cons.end()) {
-                    cons.erase(iter);
-                    // For a function with multiple stages, all the stages will
-                    // be in the same group and the consumers of the function
-                    // only depend on the last stage. Therefore, when the
-                    // producer group has multiple stages, parents of the
-                    // producers should point to the consumers of the last
-                    // stage of the producer.
-                    cons.insert(prod_group_children.begin(), prod_group_children.end());
-                }
+        debug(3) << "\n============================" << '\n';
+        debug(3) << "Current grouping candidates:" << '\n';
+        debug(3) << "============================" << '\n';
+        for (size_t i = 0; i < cand.size(); ++i) {
+            debug(3) << "{" << cand[i].first << ", " << cand[i].second << "}" << '\n';
+        }
+
+        vector<pair<GroupingChoice, GroupConfig>> best;
+        int decision = 0;
+        size_t step = decisions.size();
+        if (step < forced_decisions.size() && forced_decisions[step] > 0) {
+            vector<vector<pair<GroupingChoice, GroupConfig>>> alternatives =
+                rank_candidate_groupings(cand, level, forced_decisions[step] + 1);
+            if (!alternatives.empty()) {
+                decision = std::min(forced_decisions[step], (int)alternatives.size() - 1);
+                best = alternatives[decision];
             }
+        } else {
+            best = choose_candidate_grouping(cand, level);
+        }
+        if (best.empty()) {
+            continue;
+        } else {
+            fixpoint = false;
         }
 
+        decisions.push_back(decision);
+        apply_grouping(best, level);
+
         Cost post_merge = get_pipeline_cost();
         if (debug::debug_level() >= 3) {
             disp_pipeline_costs();
@@ -1950,6 +2182,9 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
 
     // Linear dropoff
     Expr load_slope = cast<float>(arch_params.balance) / arch_params.last_level_cache_size;
+    // Loads weighted by the fraction of the last level cache their
+    // footprint covers, for the cost model features.
+    Expr footprint_weighted_loads = make_zero(Float(32));
     for (const auto &f_load : group_load_costs) {
         internal_assert(g.inlined.find(f_load.first) == g.inlined.end())
             << "Intermediates of inlined pure fuction \"" << f_load.first
@@ -2005,6 +2240,11 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
 
         Expr cost_factor = cast<int64_t>(min(1 + footprint * load_slope, arch_params.balance));
         per_tile_cost.memory += cost_factor * f_load.second;
+
+        if (collect_features) {
+            Expr llc_fraction = min(cast<float>(footprint) / arch_params.last_level_cache_size, 1.0f);
+            footprint_weighted_loads += cast<float>(f_load.second) * llc_fraction;
+        }
     }
 
     if (show_analysis) {
@@ -2023,6 +2263,68 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
         parallelism);
     g_analysis.simplify();
 
+    if (!collect_features) {
+        return g_analysis;
+    }
+
+    // Compute the features of the group. They must all be known
+    // numbers, which is the case as long as the estimates are.
+    vector<Expr> ops = costs.region_op_histogram(group_reg, g.inlined);
+    vector<Expr> out_ops = costs.stage_region_op_histogram(g.output.func.name(),
+                                                           g.output.stage_num,
+                                                           tile_bounds, g.inlined);
+    Expr bytes_loaded = make_zero(Int(64));
+    for (const auto &f_load : group_load_costs) {
+        bytes_loaded += f_load.second;
+    }
+    Expr intermediate_bytes = make_zero(Int(64));
+    for (const auto &reg : alloc_regions) {
+        if ((group_members.find(reg.first) != group_members.end()) &&
+            (reg.first != g.output.func.name()) &&
+            (g.inlined.find(reg.first) == g.inlined.end())) {
+            intermediate_bytes += costs.region_size(reg.first, reg.second);
+        }
+    }
+
+    GroupFeatures &features = g_analysis.features;
+    bool known = (get_numeric(estimate_tiles, &features[GroupFeatures::Tiles]) &&
+                  !ops.empty() && !out_ops.empty());
+    double tiles = features[GroupFeatures::Tiles];
+    double total_ops = 0;
+    for (int i = 0; known && i < num_op_kinds; i++) {
+        double count;
+        known = get_numeric(ops[i] + out_ops[i], &count);
+        features[GroupFeatures::Ops + i] = count * tiles;
+        total_ops += count * tiles;
+    }
+    double parallel_tiles, max_parallelism;
+    known = (known &&
+             get_numeric(bytes_loaded, &features[GroupFeatures::BytesLoaded]) &&
+             get_numeric(footprint_weighted_loads, &features[GroupFeatures::FootprintWeightedBytesLoaded]) &&
+             get_numeric(intermediate_bytes, &features[GroupFeatures::IntermediateBytes]) &&
+             get_numeric(g_analysis.parallelism, &parallel_tiles) &&
+             get_numeric(arch_params.parallelism, &max_parallelism) &&
+             get_numeric(g_analysis.cost.arith, &features[GroupFeatures::AnalyticalArith]) &&
+             get_numeric(g_analysis.cost.memory, &features[GroupFeatures::AnalyticalMemory]));
+    if (!known) {
+        // The hand-written model can still compare symbolic costs, but
+        // other cost models can't.
+        return cost_model ? GroupAnalysis() : g_analysis;
+    }
+    features[GroupFeatures::BytesLoaded] *= tiles;
+    features[GroupFeatures::FootprintWeightedBytesLoaded] *= tiles;
+    features[GroupFeatures::IntermediateBytes] *= tiles;
+    features[GroupFeatures::OpsPerCore] =
+        total_ops / std::max(1.0, std::min(parallel_tiles, max_parallelism));
+    g_analysis.has_features = true;
+
+    if (cost_model) {
+        g_analysis.cost = cost_model->group_cost(features, g_analysis.cost);
+        if (show_analysis) {
+            debug(0) << "Cost model cost:" << g_analysis.cost << '\n';
+        }
+    }
+
     return g_analysis;
 }
 
@@ -2082,6 +2384,18 @@ void Partitioner::merge_groups(const GroupingChoice &choice, const GroupConfig &
     group_costs[child] = eval.analysis;
 }
 
+Partitioner::Group Partitioner::choice_group(const GroupingChoice &choice) {
+    const Function &prod_f = get_element(dep_analysis.env, choice.prod);
+    int num_prod_stages = prod_f.updates().size() + 1;
+
+    Group group = get_element(groups, choice.cons);
+    for (int s = 0; s < num_prod_stages; s++) {
+        FStage prod_s(prod_f, s);
+        group = merge_groups(get_element(groups, prod_s), group);
+    }
+    return group;
+}
+
 Partitioner::GroupConfig Partitioner::evaluate_choice(const GroupingChoice &choice,
                                                       Partitioner::Level level) {
     // Create a group that reflects the grouping choice and evaluate the cost
@@ -2096,10 +2410,7 @@ Partitioner::GroupConfig Partitioner::evaluate_choice(const GroupingChoice &choi
     }
 
     Group cons = get_element(groups, choice.cons);
-    Group group = cons;
-    for (const auto &prod_g : prod_groups) {
-        group = merge_groups(prod_g, group);
-    }
+    Group group = choice_group(choice);
 
     GroupAnalysis group_analysis;
     map<string, Expr> best_tile_config;
@@ -3323,44 +3634,133 @@ bool inline_unbounded(const vector<Function> &outputs,
     return inlined;
 }
 
-}  // anonymous namespace
-
-// Generate schedules for all functions in the pipeline required to compute the
-// outputs. This applies the schedules and returns a string representation of
-// the schedules. The target architecture is specified by 'target'.
-string generate_schedules(const vector<Function> &outputs, const Target &target,
-                          const MachineParams &arch_params) {
-    // Make an environment map which is used throughout the auto scheduling process.
-    map<string, Function> env;
-    for (Function f : outputs) {
-        map<string, Function> more_funcs = find_transitive_calls(f);
-        env.insert(more_funcs.begin(), more_funcs.end());
+// Return the estimated cost of the current grouping of 'part' as a single
+// number, or infinity if it can't be estimated.
+double grouping_cost(Partitioner &part) {
+    Cost cost = part.get_pipeline_cost();
+    double arith, memory;
+    if (!get_numeric(cost.arith, &arith) || !get_numeric(cost.memory, &memory)) {
+        return std::numeric_limits<double>::infinity();
     }
+    return arith + memory;
+}
 
-    // Finalize all the LoopLevels
-    for (auto &iter : env) {
-        iter.second.lock_loop_levels();
-    }
+// Beam search for the groupings of a pipeline with the lowest estimated
+// costs, starting from the initial grouping in 'initial'. At each step,
+// every grouping in the beam is extended by each of its 'beam_width' best
+// merges, and the 'beam_width' cheapest of the results are kept. Returns
+// the decisions that lead to each of the final groupings, cheapest first,
+// without trailing greedy decisions (so the greedy grouping is the empty
+// sequence).
+vector<vector<int>> beam_search_groupings(const Partitioner &initial, size_t beam_width) {
+    struct State {
+        Partitioner part;
+        Partitioner::Level level;
+        bool done;
+        double cost;
+    };
 
-    // Compute the topological order, before any trivial inlining (i.e. before
-    // we remove any functions from 'env'). We need the full topological
-    // order to pass to get_func() when generating the string representation
-    // of the schedule.
-    debug(2) << "Computing topological order...\n";
-    vector<string> top_order = topological_order(outputs, env);
+    vector<State> beam;
+    beam.push_back(State{initial, Partitioner::Level::Inline, false, 0});
+    beam[0].cost = grouping_cost(beam[0].part);
+
+    bool expanded = true;
+    while (expanded) {
+        expanded = false;
+        vector<State> next;
+        for (State &state : beam) {
+            if (state.done) {
+                next.push_back(std::move(state));
+                continue;
+            }
+            expanded = true;
+
+            vector<pair<string, string>> cand = state.part.grouping_candidates(state.level);
+            vector<vector<pair<Partitioner::GroupingChoice, Partitioner::GroupConfig>>> alternatives =
+                state.part.rank_candidate_groupings(cand, state.level, beam_width);
+            if (alternatives.empty()) {
+                // This level has reached a fixpoint; move on to the next.
+                State child = state;
+                if (state.level == Partitioner::Level::Inline) {
+                    child.level = Partitioner::Level::FastMem;
+                    child.part.grouping_cache.clear();
+                } else {
+                    child.done = true;
+                }
+                next.push_back(std::move(child));
+                continue;
+            }
+            for (size_t i = 0; i < alternatives.size(); i++) {
+                State child = state;
+                child.part.apply_grouping(alternatives[i], state.level);
+                child.part.decisions.push_back((int)i);
+                child.cost = grouping_cost(child.part);
+                next.push_back(std::move(child));
+            }
+        }
 
-    // Validate that none of the functions in the pipeline have partial schedules.
-    debug(2) << "Validating no partial schedules...\n";
-    for (const auto &iter : env) {
-        validate_no_partial_schedules(iter.second);
+        // Keep the cheapest states, dropping those that reach the same
+        // grouping as a cheaper one by merging in a different order.
+        vector<size_t> order(next.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return next[a].cost < next[b].cost;
+        });
+        set<string> seen;
+        beam.clear();
+        for (size_t i : order) {
+            if (beam.size() >= beam_width) {
+                break;
+            }
+            std::ostringstream key;
+            key << (int)next[i].level << ' ' << next[i].done << '\n';
+            for (const auto &g : next[i].part.groups) {
+                key << g.second;
+            }
+            if (seen.insert(key.str()).second) {
+                beam.push_back(std::move(next[i]));
+            }
+        }
     }
 
-    // The auto scheduling algorithm requires estimates on the outputs of the
-    // pipeline to get quantitative estimates of costs for computing functions
-    // in the pipeline.
-    debug(2) << "Checking estimates on outputs...\n";
-    check_estimates_on_outputs(outputs);
+    vector<vector<int>> result;
+    for (const State &state : beam) {
+        vector<int> decisions = state.part.decisions;
+        while (!decisions.empty() && decisions.back() == 0) {
+            decisions.pop_back();
+        }
+        if (std::find(result.begin(), result.end(), decisions) == result.end()) {
+            result.push_back(decisions);
+        }
+    }
+    return result;
+}
+
+// How schedule_pipeline chooses the grouping of a pipeline.
+struct ScheduleOptions {
+    // The cost model used to compare groupings, or null to use the
+    // hand-written model.
+    AutoScheduleCostModel *cost_model = nullptr;
+    // If non-null, set to the sum of the features of the final groups.
+    GroupFeatures *features = nullptr;
+    // Grouping decisions to take instead of the greedy ones (see
+    // Partitioner::forced_decisions).
+    vector<int> decisions;
+    // If non-null, no schedules are applied. Instead, the decisions leading
+    // to the best groupings found by a beam search of width 'beam_width'
+    // are stored here.
+    vector<vector<int>> *candidates = nullptr;
+    size_t beam_width = 1;
+};
 
+// Group the Funcs of a pipeline and apply the resulting schedules to
+// them. Returns a string representation of the schedules.
+string schedule_pipeline(const vector<Function> &outputs, map<string, Function> env,
+                         const vector<string> &top_order, const Target &target,
+                         const MachineParams &arch_params,
+                         const ScheduleOptions &options) {
     // Run a pre-pass that inline all trivial Funcs (i.e. if the cost of
     // computing a Func is about the same as calling that Func, we should
     // just inline it).
@@ -3463,7 +3863,9 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
     }
 
     debug(2) << "Initializing partitioner...\n";
-    Partitioner part(pipeline_bounds, arch_params, outputs, dep_analysis, costs);
+    Partitioner part(pipeline_bounds, arch_params, outputs, dep_analysis, costs,
+                     options.cost_model, options.features != nullptr);
+    part.forced_decisions = options.decisions;
 
     // Compute and display reuse
     /* TODO: Use the reuse estimates to reorder loops
@@ -3495,6 +3897,12 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
         part.disp_pipeline_costs();
     }
 
+    if (options.candidates) {
+        debug(2) << "Partitioner searching for groupings...\n";
+        *options.candidates = beam_search_groupings(part, options.beam_width);
+        return "";
+    }
+
     debug(2) << "Partitioner computing inline group...\n";
     part.group(Partitioner::Level::Inline);
     if (debug::debug_level() >= 3) {
@@ -3510,6 +3918,10 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
         part.disp_pipeline_graph();
     }
 
+    if (options.features) {
+        *options.features = part.get_pipeline_features();
+    }
+
     debug(2) << "Initializing AutoSchedule...\n";
     AutoSchedule sched(env, top_order);
     debug(2) << "Generating CPU schedule...\n";
@@ -3532,6 +3944,464 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
     return sched_string;
 }
 
+// Wraps another cost model (or the hand-written one), scaling the cost
+// of each group by a pseudo-random factor that depends only on the
+// group's features and a seed. Used to explore schedules near the ones
+// the wrapped model would pick when collecting training data.
+class PerturbedCostModel : public AutoScheduleCostModel {
+    AutoScheduleCostModel *base;
+    uint64_t seed;
+
+    double factor(const GroupFeatures &features, uint64_t salt) {
+        uint64_t h = seed * 0x9E3779B97F4A7C15ULL + salt;
+        for (double v : features.values) {
+            uint64_t bits;
+            memcpy(&bits, &v, sizeof(bits));
+            h = (h ^ bits) * 0x100000001B3ULL;
+            h ^= h >> 29;
+        }
+        // Between 1/2 and 2.
+        double u = (double)(h >> 11) / (double)(1ULL << 53);
+        return std::exp2(2 * u - 1);
+    }
+
+public:
+    PerturbedCostModel(AutoScheduleCostModel *base, uint64_t seed) : base(base), seed(seed) {}
+
+    Cost group_cost(const GroupFeatures &features, const Cost &analytical) override {
+        Cost cost = base ? base->group_cost(features, analytical) : analytical;
+        if (!cost.defined() || seed == 0) {
+            return cost;
+        }
+        Cost result(cast<int64_t>(cast<double>(cost.arith) * make_const(Float(64), factor(features, 0))),
+                    cast<int64_t>(cast<double>(cost.memory) * make_const(Float(64), factor(features, 1))));
+        result.simplify();
+        return result;
+    }
+};
+
+// Get the constant value of an estimate as an int, if it has one.
+bool get_int_estimate(const Expr &e, int *value) {
+    double v;
+    if (!get_numeric(e, &v)) {
+        return false;
+    }
+    *value = (int)v;
+    return true;
+}
+
+// Convert a number to a scalar value of the given type.
+halide_scalar_value_t make_scalar_value(Type t, double v) {
+    halide_scalar_value_t s;
+    memset(&s, 0, sizeof(s));
+    if (t.is_float()) {
+        if (t.bits() == 32) {
+            s.u.f32 = (float)v;
+        } else {
+            s.u.f64 = v;
+        }
+    } else if (t.is_bool()) {
+        s.u.b = (v != 0);
+    } else if (t.is_int()) {
+        switch (t.bits()) {
+        case 8: s.u.i8 = (int8_t)v; break;
+        case 16: s.u.i16 = (int16_t)v; break;
+        case 32: s.u.i32 = (int32_t)v; break;
+        default: s.u.i64 = (int64_t)v; break;
+        }
+    } else if (t.is_uint()) {
+        switch (t.bits()) {
+        case 8: s.u.u8 = (uint8_t)v; break;
+        case 16: s.u.u16 = (uint16_t)v; break;
+        case 32: s.u.u32 = (uint32_t)v; break;
+        default: s.u.u64 = (uint64_t)v; break;
+        }
+    }
+    return s;
+}
+
+// Time the pipeline computing 'outputs' over their estimated regions,
+// in nanoseconds. Returns a negative number if the estimates are not
+// all known.
+double benchmark_pipeline(const vector<Function> &outputs, const Target &target) {
+    vector<Buffer<>> buffers;
+    for (const Function &f : outputs) {
+        vector<int> mins, extents;
+        for (const string &arg : f.args()) {
+            int min = 0, extent = 0;
+            for (const Bound &b : f.schedule().estimates()) {
+                if (b.var == arg &&
+                    get_int_estimate(b.min, &min) &&
+                    get_int_estimate(b.extent, &extent)) {
+                    break;
+                }
+            }
+            if (extent <= 0) {
+                return -1;
+            }
+            mins.push_back(min);
+            extents.push_back(extent);
+        }
+        for (const Type &t : f.output_types()) {
+            Buffer<> b(t, extents);
+            b.set_min(mins);
+            buffers.push_back(b);
+        }
+    }
+
+    vector<Func> funcs(outputs.begin(), outputs.end());
+    Pipeline p(funcs);
+    p.compile_jit(target);
+
+    Realization r(buffers);
+    p.realize(r, target);
+
+    // Take the best of several batches of runs, doubling the batch size
+    // until a batch takes long enough to time accurately, and stopping
+    // after about half a second.
+    typedef std::chrono::high_resolution_clock clock;
+    const auto deadline = clock::now() + std::chrono::milliseconds(500);
+    double best = std::numeric_limits<double>::infinity();
+    int iterations = 1;
+    int samples = 0;
+    while (samples < 10) {
+        auto start = clock::now();
+        for (int i = 0; i < iterations; i++) {
+            p.realize(r, target);
+        }
+        auto end = clock::now();
+        double ns = std::chrono::duration<double, std::nano>(end - start).count();
+        bool timed_out = end > deadline;
+        if (ns < 5e6 && !timed_out) {
+            iterations *= 2;
+            continue;
+        }
+        best = std::min(best, ns / iterations);
+        samples++;
+        if (timed_out) {
+            break;
+        }
+    }
+    return best;
+}
+
+// Return true if pipelines compiled for 'target' can be benchmarked on the
+// host. Otherwise warn that we can't do 'what' and return false.
+bool can_benchmark(const Target &target, const string &what) {
+    Target host = get_host_target();
+    if (target.os != host.os || target.arch != host.arch || target.bits != host.bits) {
+        user_warning << "Can't " << what << " for target "
+                     << target.to_string() << " on host " << host.to_string() << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Binds the input buffers of a pipeline to zero-filled buffers of their
+// estimated sizes, and its scalar parameters to their estimates, so that
+// it can be benchmarked. The original values are restored on destruction.
+class EstimatedInputs {
+    struct SavedParameter {
+        Parameter param;
+        Buffer<> buffer;
+        halide_scalar_value_t scalar;
+    };
+    vector<SavedParameter> saved;
+    bool ok = true;
+
+    void restore() {
+        for (SavedParameter &s : saved) {
+            if (s.param.is_buffer()) {
+                s.param.set_buffer(s.buffer);
+            } else {
+                s.param.set_scalar(s.param.type(), s.scalar);
+            }
+        }
+        saved.clear();
+    }
+
+public:
+    // If some input buffer has no estimate of its size, warn that we can't
+    // do 'what', and leave all inputs unchanged.
+    EstimatedInputs(const vector<Function> &outputs, const string &what) {
+        for (const InferredArgument &arg : infer_arguments(Stmt(), outputs)) {
+            Parameter p = arg.param;
+            if (!p.defined() || p.name() == "__user_context") {
+                continue;
+            }
+            SavedParameter s;
+            s.param = p;
+            if (p.is_buffer()) {
+                s.buffer = p.buffer();
+                vector<int> mins, extents;
+                for (int i = 0; i < p.dimensions(); i++) {
+                    int min = 0, extent = 0;
+                    get_int_estimate(p.min_constraint_estimate(i), &min);
+                    if (!get_int_estimate(p.extent_constraint_estimate(i), &extent) || extent <= 0) {
+                        user_warning << "Can't " << what << " without an estimate of the "
+                                     << "extent of dimension " << i << " of " << p.name() << "\n";
+                        restore();
+                        ok = false;
+                        return;
+                    }
+                    mins.push_back(min);
+                    extents.push_back(extent);
+                }
+                Buffer<> b(p.type(), extents);
+                b.set_min(mins);
+                memset(b.data(), 0, b.size_in_bytes());
+                p.set_buffer(b);
+            } else {
+                memcpy(&s.scalar, p.scalar_address(), sizeof(s.scalar));
+                double v;
+                if (get_numeric(p.estimate(), &v)) {
+                    p.set_scalar(p.type(), make_scalar_value(p.type(), v));
+                }
+            }
+            saved.push_back(s);
+        }
+    }
+
+    ~EstimatedInputs() {
+        restore();
+    }
+
+    bool valid() const {
+        return ok;
+    }
+};
+
+// A copy of a pipeline that can be scheduled without affecting the
+// original.
+struct PipelineCopy {
+    vector<Function> outputs;
+    map<string, Function> env;
+    vector<string> top_order;
+
+    PipelineCopy(const vector<Function> &orig_outputs, const map<string, Function> &orig_env) {
+        std::tie(outputs, env) = deep_copy(orig_outputs, orig_env);
+        for (auto &iter : env) {
+            iter.second.lock_loop_levels();
+        }
+        top_order = topological_order(outputs, env);
+    }
+};
+
+// Benchmark schedules near the one the auto-scheduler would pick for a
+// pipeline, and append the runtime and features of each to a file, one
+// sample per line. The inputs of the pipeline are bound to zero-filled
+// buffers of their estimated sizes, and scalar parameters are set to
+// their estimates, for the duration of the benchmarks.
+void collect_cost_model_samples(const vector<Function> &outputs,
+                                const map<string, Function> &env,
+                                const Target &target,
+                                const MachineParams &arch_params,
+                                const string &filename) {
+    const string what = "collect auto-scheduler cost model samples";
+    if (!can_benchmark(target, what)) {
+        return;
+    }
+
+    int num_samples = 16;
+    string samples_str = get_env_variable("HL_AUTO_SCHEDULE_COLLECT_SAMPLES");
+    if (!samples_str.empty()) {
+        num_samples = string_to_int(samples_str);
+    }
+
+    EstimatedInputs inputs(outputs, what);
+    if (!inputs.valid()) {
+        return;
+    }
+
+    std::ofstream out(filename, std::ios::app);
+    user_assert(out) << "Can't open " << filename << " to write auto-scheduler cost model samples\n";
+    out << "# runtime_ns";
+    for (int i = 0; i < GroupFeatures::NumFeatures; i++) {
+        out << ' ' << GroupFeatures::name(i);
+    }
+    out << '\n';
+
+    std::shared_ptr<AutoScheduleCostModel> base = get_auto_schedule_cost_model();
+    for (int i = 0; i < num_samples; i++) {
+        // Schedule a copy of the pipeline, so that the original remains
+        // unscheduled.
+        PipelineCopy copy(outputs, env);
+
+        PerturbedCostModel model(base.get(), i);
+        GroupFeatures features;
+        ScheduleOptions options;
+        options.cost_model = &model;
+        options.features = &features;
+        schedule_pipeline(copy.outputs, copy.env, copy.top_order, target, arch_params, options);
+
+        double ns = benchmark_pipeline(copy.outputs, target);
+        if (ns < 0) {
+            user_warning << "Can't " << what << " without constant estimates on all outputs\n";
+            break;
+        }
+        debug(1) << "Auto-scheduler cost model sample " << i << ": " << ns << " ns\n";
+        out << ns;
+        for (double v : features.values) {
+            out << ' ' << v;
+        }
+        out << '\n';
+    }
+}
+
+// Beam search for the groupings of a pipeline with the lowest estimated
+// costs, benchmark the schedules they lead to along with the greedy one,
+// and apply the fastest. Returns the string representation of its
+// schedule, or an empty string if the pipeline can't be benchmarked.
+string autotune_pipeline(const vector<Function> &outputs,
+                         const map<string, Function> &env,
+                         const vector<string> &top_order,
+                         const Target &target,
+                         const MachineParams &arch_params,
+                         AutoScheduleCostModel *cost_model,
+                         int beam_width) {
+    const string what = "autotune the auto-scheduler";
+    if (!can_benchmark(target, what)) {
+        return "";
+    }
+
+    vector<vector<int>> candidates;
+    {
+        PipelineCopy copy(outputs, env);
+        ScheduleOptions options;
+        options.cost_model = cost_model;
+        options.candidates = &candidates;
+        options.beam_width = beam_width;
+        schedule_pipeline(copy.outputs, copy.env, copy.top_order, target, arch_params, options);
+    }
+    // Always include the greedy grouping, so that autotuning never picks
+    // anything slower.
+    if (std::find(candidates.begin(), candidates.end(), vector<int>()) == candidates.end()) {
+        candidates.insert(candidates.begin(), vector<int>());
+    }
+
+    double best_ns = 0;
+    size_t best = 0;
+    {
+        EstimatedInputs inputs(outputs, what);
+        if (!inputs.valid()) {
+            return "";
+        }
+        for (size_t i = 0; i < candidates.size(); i++) {
+            PipelineCopy copy(outputs, env);
+            ScheduleOptions options;
+            options.cost_model = cost_model;
+            options.decisions = candidates[i];
+            schedule_pipeline(copy.outputs, copy.env, copy.top_order, target, arch_params, options);
+
+            double ns = benchmark_pipeline(copy.outputs, target);
+            if (ns < 0) {
+                user_warning << "Can't " << what << " without constant estimates on all outputs\n";
+                return "";
+            }
+            debug(1) << "Auto-scheduler candidate " << i << " of " << candidates.size()
+                     << ": " << ns << " ns\n";
+            if (i == 0 || ns < best_ns) {
+                best_ns = ns;
+                best = i;
+            }
+        }
+    }
+
+    ScheduleOptions options;
+    options.cost_model = cost_model;
+    options.decisions = candidates[best];
+    string sched = schedule_pipeline(outputs, env, top_order, target, arch_params, options);
+
+    std::ostringstream oss;
+    oss << "// Autotuned: the fastest of " << candidates.size()
+        << " candidate schedules, at " << best_ns / 1e6 << " ms\n";
+    oss << sched;
+    return oss.str();
+}
+
+std::mutex autotune_width_mutex;
+int autotune_width = -1;
+
+}  // anonymous namespace
+
+// Generate schedules for all functions in the pipeline required to compute the
+// outputs. This applies the schedules and returns a string representation of
+// the schedules. The target architecture is specified by 'target'.
+string generate_schedules(const vector<Function> &outputs, const Target &target,
+                          const MachineParams &arch_params) {
+    // The auto-scheduler queries the bounds of the same expressions
+    // many times over, for each grouping it considers.
+    ScopedBoundsCache bounds_cache;
+
+    // Make an environment map which is used throughout the auto scheduling process.
+    map<string, Function> env;
+    for (Function f : outputs) {
+        map<string, Function> more_funcs = find_transitive_calls(f);
+        env.insert(more_funcs.begin(), more_funcs.end());
+    }
+
+    // Finalize all the LoopLevels
+    for (auto &iter : env) {
+        iter.second.lock_loop_levels();
+    }
+
+    // Compute the topological order, before any trivial inlining (i.e. before
+    // we remove any functions from 'env'). We need the full topological
+    // order to pass to get_func() when generating the string representation
+    // of the schedule.
+    debug(2) << "Computing topological order...\n";
+    vector<string> top_order = topological_order(outputs, env);
+
+    // Validate that none of the functions in the pipeline have partial schedules.
+    debug(2) << "Validating no partial schedules...\n";
+    for (const auto &iter : env) {
+        validate_no_partial_schedules(iter.second);
+    }
+
+    // The auto scheduling algorithm requires estimates on the outputs of the
+    // pipeline to get quantitative estimates of costs for computing functions
+    // in the pipeline.
+    debug(2) << "Checking estimates on outputs...\n";
+    check_estimates_on_outputs(outputs);
+
+
+    // In data collection mode, benchmark some candidate schedules first.
+    string collect_file = get_env_variable("HL_AUTO_SCHEDULE_COLLECT");
+    if (!collect_file.empty()) {
+        collect_cost_model_samples(outputs, env, target, arch_params, collect_file);
+    }
+
+    std::shared_ptr<AutoScheduleCostModel> cost_model = get_auto_schedule_cost_model();
+
+    int beam_width = auto_schedule_autotune_width();
+    if (beam_width > 0) {
+        string sched = autotune_pipeline(outputs, env, top_order, target, arch_params,
+                                         cost_model.get(), beam_width);
+        if (!sched.empty()) {
+            return sched;
+        }
+    }
+
+    ScheduleOptions options;
+    options.cost_model = cost_model.get();
+    return schedule_pipeline(outputs, env, top_order, target, arch_params, options);
+}
+
+void set_auto_schedule_autotune_width(int beam_width) {
+    user_assert(beam_width >= 0) << "Auto-scheduler autotuning beam width must be non-negative\n";
+    std::lock_guard<std::mutex> lock(autotune_width_mutex);
+    autotune_width = beam_width;
+}
+
+int auto_schedule_autotune_width() {
+    std::lock_guard<std::mutex> lock(autotune_width_mutex);
+    if (autotune_width < 0) {
+        string width = get_env_variable("HL_AUTO_SCHEDULE_AUTOTUNE");
+        autotune_width = width.empty() ? 0 : std::max(0, string_to_int(width));
+    }
+    return autotune_width;
+}
+
 }  // namespace Internal
 
 MachineParams MachineParams::generic() {
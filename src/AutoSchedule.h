@@ -46,6 +46,18 @@ std::string generate_schedules(const std::vector<Function> &outputs,
                                const Target &target,
                                const MachineParams &arch_params);
 
+/** Set the width of the beam search that the auto-scheduler uses in
+ * autotuning mode. In this mode, generate_schedules keeps the
+ * 'beam_width' groupings with the lowest estimated cost at each step
+ * instead of only the best one, compiles and benchmarks the schedules
+ * of the final groupings on buffers of the estimated sizes, and applies
+ * the fastest. This requires estimates on all inputs, and a target that
+ * can run on the host. A width of zero (the default, unless the
+ * environment variable HL_AUTO_SCHEDULE_AUTOTUNE is set) disables
+ * autotuning. */
+void set_auto_schedule_autotune_width(int beam_width);
+int auto_schedule_autotune_width();
+
 }  // namespace Internal
 }  // namespace Halide
 
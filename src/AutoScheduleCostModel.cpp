@@ -0,0 +1,168 @@
+#include <cmath>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+#include "AutoScheduleCostModel.h"
+#include "IROperator.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+using std::vector;
+
+void GroupFeatures::accumulate(const GroupFeatures &other) {
+    for (int i = 0; i < NumFeatures; i++) {
+        values[i] += other.values[i];
+    }
+}
+
+string GroupFeatures::name(int feature) {
+    internal_assert(feature >= 0 && feature < NumFeatures);
+    if (feature >= Ops && feature < Ops + num_op_kinds) {
+        return string("ops_") + op_kind_name((OpKind)(feature - Ops));
+    }
+    switch (feature) {
+    case Tiles:
+        return "tiles";
+    case BytesLoaded:
+        return "bytes_loaded";
+    case FootprintWeightedBytesLoaded:
+        return "footprint_weighted_bytes_loaded";
+    case IntermediateBytes:
+        return "intermediate_bytes";
+    case OpsPerCore:
+        return "ops_per_core";
+    case AnalyticalArith:
+        return "analytical_arith";
+    case AnalyticalMemory:
+        return "analytical_memory";
+    default:
+        internal_error << "Unknown auto-scheduler feature " << feature << "\n";
+        return "";
+    }
+}
+
+bool GroupFeatures::is_memory_feature(int feature) {
+    return (feature == BytesLoaded ||
+            feature == FootprintWeightedBytesLoaded ||
+            feature == IntermediateBytes ||
+            feature == AnalyticalMemory ||
+            feature == Ops + (int)OpKind::Load ||
+            feature == Ops + (int)OpKind::Store);
+}
+
+Cost LinearCostModel::group_cost(const GroupFeatures &features, const Cost &analytical) {
+    double arith = 0, memory = 0;
+    for (int i = 0; i < GroupFeatures::NumFeatures; i++) {
+        double term = weights[i] * features[i];
+        if (GroupFeatures::is_memory_feature(i)) {
+            memory += term;
+        } else {
+            arith += term;
+        }
+    }
+    // Weights are in nanoseconds; use picoseconds for the integer costs
+    // so that small groups don't all round to zero.
+    return Cost((int64_t)std::llround(arith * 1000), (int64_t)std::llround(memory * 1000));
+}
+
+std::shared_ptr<LinearCostModel> LinearCostModel::load(const string &filename) {
+    std::ifstream in(filename);
+    user_assert(in) << "Can't open auto-scheduler cost model " << filename << "\n";
+
+    auto model = std::make_shared<LinearCostModel>();
+    string line;
+    int line_number = 0;
+    while (std::getline(in, line)) {
+        line_number++;
+        size_t comment = line.find('#');
+        if (comment != string::npos) {
+            line = line.substr(0, comment);
+        }
+        std::istringstream tokens(line);
+        string feature;
+        double weight;
+        if (!(tokens >> feature)) {
+            continue;
+        }
+        user_assert(tokens >> weight)
+            << filename << ":" << line_number << ": Expected a weight after feature " << feature << "\n";
+        bool found = false;
+        for (int i = 0; i < GroupFeatures::NumFeatures; i++) {
+            if (GroupFeatures::name(i) == feature) {
+                model->weights[i] = weight;
+                found = true;
+            }
+        }
+        user_assert(found)
+            << filename << ":" << line_number << ": Unknown auto-scheduler feature " << feature << "\n";
+    }
+    return model;
+}
+
+std::shared_ptr<LinearCostModel> LinearCostModel::avx2_estimate() {
+    // Nanoseconds per scalar operation at 3GHz, assuming the loops are
+    // vectorized 8-wide for 32-bit types, from the reciprocal
+    // throughputs of the corresponding AVX2 instructions. The work of
+    // a group is split between the Ops terms, which assume it is shared
+    // by a nominal four cores, and OpsPerCore, which charges the mean
+    // op cost again for the work left on each core. A group that can't
+    // be parallelized then costs about 2.5 times as much as one that
+    // can, instead of the same.
+    auto model = std::make_shared<LinearCostModel>();
+    vector<double> &w = model->weights;
+    w[GroupFeatures::Ops + (int)OpKind::AddSub] = 0.005;
+    w[GroupFeatures::Ops + (int)OpKind::Mul] = 0.005;
+    w[GroupFeatures::Ops + (int)OpKind::DivMod] = 0.0625;
+    w[GroupFeatures::Ops + (int)OpKind::MinMax] = 0.005;
+    w[GroupFeatures::Ops + (int)OpKind::Compare] = 0.005;
+    w[GroupFeatures::Ops + (int)OpKind::Select] = 0.01;
+    w[GroupFeatures::Ops + (int)OpKind::Cast] = 0.0125;
+    w[GroupFeatures::Ops + (int)OpKind::Bitwise] = 0.005;
+    w[GroupFeatures::Ops + (int)OpKind::Math] = 0.125;
+    w[GroupFeatures::Ops + (int)OpKind::Load] = 0.005;
+    w[GroupFeatures::Ops + (int)OpKind::Store] = 0.01;
+    w[GroupFeatures::OpsPerCore] = 0.03;
+    // Loop and allocation overhead of each tile.
+    w[GroupFeatures::Tiles] = 20;
+    // Roughly the per-core DRAM bandwidth, for loads from footprints
+    // that don't fit in the last level cache.
+    w[GroupFeatures::FootprintWeightedBytesLoaded] = 0.05;
+    // Writing intermediates that stay in cache.
+    w[GroupFeatures::IntermediateBytes] = 0.005;
+    return model;
+}
+
+namespace {
+
+std::mutex cost_model_mutex;
+bool cost_model_initialized = false;
+std::shared_ptr<AutoScheduleCostModel> cost_model;
+
+}  // namespace
+
+void set_auto_schedule_cost_model(std::shared_ptr<AutoScheduleCostModel> model) {
+    std::lock_guard<std::mutex> lock(cost_model_mutex);
+    cost_model = std::move(model);
+    cost_model_initialized = true;
+}
+
+std::shared_ptr<AutoScheduleCostModel> get_auto_schedule_cost_model() {
+    std::lock_guard<std::mutex> lock(cost_model_mutex);
+    if (!cost_model_initialized) {
+        cost_model_initialized = true;
+        string name = get_env_variable("HL_AUTO_SCHEDULE_COST_MODEL");
+        if (name == "avx2_estimate") {
+            cost_model = LinearCostModel::avx2_estimate();
+        } else if (!name.empty()) {
+            cost_model = LinearCostModel::load(name);
+        }
+    }
+    return cost_model;
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,118 @@
+#ifndef HALIDE_INTERNAL_AUTO_SCHEDULE_COST_MODEL_H
+#define HALIDE_INTERNAL_AUTO_SCHEDULE_COST_MODEL_H
+
+/** \file
+ *
+ * Defines the interface to the cost model used by the auto-scheduler to
+ * compare groupings and tile sizes, and the models that ship with Halide.
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "RegionCosts.h"
+
+namespace Halide {
+namespace Internal {
+
+/** The features of one group of Funcs computed together in tiles,
+ * summed over all tiles of the group's output. */
+struct GroupFeatures {
+    enum Feature {
+        // The number of tiles of the group output.
+        Tiles = 0,
+        // The number of operations of each OpKind; there are
+        // num_op_kinds of these, starting at Ops.
+        Ops,
+        // Bytes loaded from Funcs and input images.
+        BytesLoaded = Ops + num_op_kinds,
+        // Bytes loaded, weighted by how much of the last level cache
+        // the footprint of each Func or image loaded from covers.
+        FootprintWeightedBytesLoaded,
+        // The bytes of storage of the group intermediates, per tile.
+        IntermediateBytes,
+        // The number of operations divided by the parallelism the
+        // group can exploit (clamped to that of the machine).
+        OpsPerCore,
+        // The estimates of the hand-written cost model.
+        AnalyticalArith,
+        AnalyticalMemory,
+        NumFeatures
+    };
+
+    std::vector<double> values;
+
+    GroupFeatures() : values(NumFeatures, 0.0) {}
+
+    double &operator[](int i) {
+        return values[i];
+    }
+    double operator[](int i) const {
+        return values[i];
+    }
+
+    /** Add the features of another group to these. */
+    void accumulate(const GroupFeatures &other);
+
+    /** Return the name of a feature, as used in cost model weight files. */
+    static std::string name(int feature);
+
+    /** Return true if a feature measures memory traffic rather than
+     * computation. Learned models put these in Cost::memory. */
+    static bool is_memory_feature(int feature);
+};
+
+/** A cost model for the auto-scheduler. The partitioner asks it for
+ * the cost of each candidate grouping and tiling, and picks the
+ * cheapest. */
+class AutoScheduleCostModel {
+public:
+    virtual ~AutoScheduleCostModel() {}
+
+    /** Return the cost of computing a group given its features and the
+     * estimate of the hand-written model. Return an undefined Cost if it
+     * can't be estimated. The same group must always get the same cost. */
+    virtual Cost group_cost(const GroupFeatures &features, const Cost &analytical) = 0;
+};
+
+/** A cost model linear in the group features. Each feature adds
+ * 'weight * value' picoseconds to the arithmetic or memory term of the
+ * Cost, depending on GroupFeatures::is_memory_feature. */
+class LinearCostModel : public AutoScheduleCostModel {
+public:
+    std::vector<double> weights;
+
+    LinearCostModel() : weights(GroupFeatures::NumFeatures, 0.0) {}
+
+    Cost group_cost(const GroupFeatures &features, const Cost &analytical) override;
+
+    /** Load weights from a file. Each line holds a feature name and its
+     * weight in nanoseconds; '#' starts a comment. Features not listed
+     * get a weight of zero. */
+    static std::shared_ptr<LinearCostModel> load(const std::string &filename);
+
+    /** Hand-estimated weights for x86 processors with AVX2, derived
+     * from instruction throughputs and cache bandwidths. These are not
+     * fitted to measurements; to get a trained model, collect data with
+     * HL_AUTO_SCHEDULE_COLLECT, fit it with
+     * tools/train_auto_schedule_cost_model, and load the result. */
+    static std::shared_ptr<LinearCostModel> avx2_estimate();
+};
+
+/** Set the cost model used by the auto-scheduler. A null model (the
+ * default) selects the hand-written model built into the partitioner.
+ * If no model has been set, the environment variable
+ * HL_AUTO_SCHEDULE_COST_MODEL selects one: "avx2_estimate" selects
+ * LinearCostModel::avx2_estimate(), and anything else is read as a weights file
+ * by LinearCostModel::load. */
+void set_auto_schedule_cost_model(std::shared_ptr<AutoScheduleCostModel> model);
+
+/** Get the cost model used by the auto-scheduler, or null for the
+ * hand-written model. */
+std::shared_ptr<AutoScheduleCostModel> get_auto_schedule_cost_model();
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
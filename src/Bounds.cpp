@@ -1,9 +1,13 @@
+#include <chrono>
+#include <functional>
 #include <iostream>
+#include <unordered_map>
 
 #include "Bounds.h"
 #include "CSE.h"
 #include "Debug.h"
 #include "Deinterleave.h"
+#include "ExprInterner.h"
 #include "ExprUsesVar.h"
 #include "IR.h"
 #include "IREquality.h"
@@ -975,6 +979,40 @@ private:
         interval = result;
     }
 
+    void visit(const VectorReduce *op) {
+        op->value.accept(this);
+        int factor = op->value.type().lanes() / op->type.lanes();
+        switch (op->op) {
+        case VectorReduce::Add:
+            if (interval.has_upper_bound()) {
+                interval.max *= factor;
+            }
+            if (interval.has_lower_bound()) {
+                interval.min *= factor;
+            }
+            // Assume no overflow for float, int32, and int64
+            if (!op->type.is_float() && (!op->type.is_int() || op->type.bits() < 32)) {
+                bounds_of_type(op->type);
+            }
+            break;
+        case VectorReduce::Mul:
+            // Technically there are some things we could say
+            // here. E.g. if all the lanes are positive then we're
+            // bounded by the upper bound raised to the factor
+            // power. However it's extremely unlikely that
+            // VectorReduce::Mul will be used in practice.
+            bounds_of_type(op->type);
+            break;
+        case VectorReduce::Min:
+        case VectorReduce::Max:
+        case VectorReduce::And:
+        case VectorReduce::Or:
+            // The result is one of the lanes, so the bounds of the
+            // lanes apply.
+            break;
+        }
+    }
+
     void visit(const LetStmt *) {
         internal_error << "Bounds of statement\n";
     }
@@ -1012,7 +1050,215 @@ private:
     }
 };
 
-Interval bounds_of_expr_in_scope(Expr expr, const Scope<Interval> &scope, const FuncValueBounds &fb, bool const_bound) {
+namespace {
+
+thread_local BoundsInferenceStats current_bounds_stats;
+thread_local BoundsCache *current_bounds_cache = nullptr;
+thread_local int bounds_timer_depth = 0;
+
+bool bounds_caching_default() {
+    static bool enabled = get_env_variable("HL_BOUNDS_CACHE") != "0";
+    return enabled;
+}
+
+bool bounds_caching_override_set = false;
+bool bounds_caching_override = false;
+
+// Adds the time until it is destroyed to the current thread's stats,
+// unless it is nested inside another BoundsTimer.
+class BoundsTimer {
+    std::chrono::high_resolution_clock::time_point start;
+public:
+    BoundsTimer() {
+        if (bounds_timer_depth++ == 0) {
+            start = std::chrono::high_resolution_clock::now();
+        }
+    }
+    ~BoundsTimer() {
+        if (--bounds_timer_depth == 0) {
+            auto end = std::chrono::high_resolution_clock::now();
+            current_bounds_stats.seconds += std::chrono::duration<double>(end - start).count();
+        }
+    }
+};
+
+// Find everything outside of an Expr that its bounds may depend on.
+class FindBoundsDependencies : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Variable *op) override {
+        vars.insert(op->name);
+    }
+
+    void visit(const Call *op) override {
+        IRGraphVisitor::visit(op);
+        funcs.insert({op->name, op->value_index});
+    }
+
+    void visit(const Let *op) override {
+        IRGraphVisitor::visit(op);
+        has_let = true;
+    }
+
+public:
+    set<string> vars;
+    set<pair<string, int>> funcs;
+    bool has_let = false;
+};
+
+}  // namespace
+
+class BoundsCache {
+    // The interner that makes the keys. Equal Exprs intern to the
+    // same node, so keys can be compared by identity.
+    std::unique_ptr<ExprInterner> own_interner;
+    ExprInterner *interner;
+
+    struct Dependencies {
+        Expr expr;
+        vector<string> vars;
+        vector<pair<string, int>> funcs;
+    };
+    // The dependencies of each canonical Expr queried so far.
+    std::unordered_map<const IRNode *, Dependencies> dependencies;
+
+    struct Entry {
+        vector<Expr> key;
+        bool const_bound;
+        Interval result;
+    };
+    std::unordered_multimap<uint64_t, Entry> entries;
+
+    const Dependencies &dependencies_of(const Expr &e) {
+        auto it = dependencies.find(e.get());
+        if (it != dependencies.end()) {
+            return it->second;
+        }
+        FindBoundsDependencies finder;
+        e.accept(&finder);
+        Dependencies &d = dependencies[e.get()];
+        d.expr = e;
+        d.vars.assign(finder.vars.begin(), finder.vars.end());
+        d.funcs.assign(finder.funcs.begin(), finder.funcs.end());
+        return d;
+    }
+
+    void add_to_key(const Expr &e, vector<Expr> *key, uint64_t *hash) {
+        Expr c = e.defined() ? interner->intern(e) : Expr();
+        uint64_t h = c.defined() ? interner->hash(c) : 0;
+        *hash = (*hash ^ h) * 0x100000001b3ULL;
+        key->push_back(c);
+    }
+
+    void make_key(const Expr &expr, const Scope<Interval> &scope,
+                  const FuncValueBounds &fb, vector<Expr> *key, uint64_t *hash) {
+        *hash = 0xcbf29ce484222325ULL;
+        add_to_key(expr, key, hash);
+        const Dependencies &d = dependencies_of(key->back());
+        for (const string &v : d.vars) {
+            if (scope.contains(v)) {
+                const Interval &i = scope.get(v);
+                add_to_key(i.min, key, hash);
+                add_to_key(i.max, key, hash);
+            } else {
+                key->push_back(Expr());
+                key->push_back(Expr());
+            }
+        }
+        for (const pair<string, int> &f : d.funcs) {
+            auto it = fb.find(f);
+            if (it != fb.end()) {
+                add_to_key(it->second.min, key, hash);
+                add_to_key(it->second.max, key, hash);
+            } else {
+                key->push_back(Expr());
+                key->push_back(Expr());
+            }
+        }
+    }
+
+    static bool same_key(const vector<Expr> &a, const vector<Expr> &b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); i++) {
+            if (!a[i].same_as(b[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+public:
+    BoundsCache() : interner(active_expr_interner()) {
+        if (!interner) {
+            own_interner.reset(new ExprInterner);
+            interner = own_interner.get();
+        }
+    }
+
+    Interval bounds_of(const Expr &expr, const Scope<Interval> &scope,
+                       const FuncValueBounds &fb, bool const_bound,
+                       const std::function<Interval()> &compute) {
+        vector<Expr> key;
+        uint64_t hash;
+        make_key(expr, scope, fb, &key, &hash);
+        hash ^= const_bound ? 1 : 0;
+
+        auto range = entries.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second.const_bound == const_bound &&
+                same_key(it->second.key, key)) {
+                current_bounds_stats.hits++;
+                return it->second.result;
+            }
+        }
+
+        Interval result = compute();
+
+        // Bounds can introduce lets with fresh names. Don't reuse
+        // those, so that the names stay unique.
+        FindBoundsDependencies finder;
+        if (result.min.defined()) {
+            result.min.accept(&finder);
+        }
+        if (result.max.defined()) {
+            result.max.accept(&finder);
+        }
+        if (!finder.has_let) {
+            entries.emplace(hash, Entry{std::move(key), const_bound, result});
+        }
+        return result;
+    }
+};
+
+ScopedBoundsCache::ScopedBoundsCache() : old_cache(current_bounds_cache) {
+    if (bounds_caching_enabled()) {
+        cache.reset(new BoundsCache);
+        current_bounds_cache = cache.get();
+    }
+}
+
+ScopedBoundsCache::~ScopedBoundsCache() {
+    current_bounds_cache = old_cache;
+}
+
+void set_bounds_caching(bool enabled) {
+    bounds_caching_override_set = true;
+    bounds_caching_override = enabled;
+}
+
+bool bounds_caching_enabled() {
+    return bounds_caching_override_set ? bounds_caching_override : bounds_caching_default();
+}
+
+BoundsInferenceStats bounds_inference_stats() {
+    return current_bounds_stats;
+}
+
+namespace {
+
+Interval compute_bounds_of_expr_in_scope(Expr expr, const Scope<Interval> &scope, const FuncValueBounds &fb, bool const_bound) {
     //debug(3) << "computing bounds_of_expr_in_scope " << expr << "\n";
     Bounds b(&scope, fb, const_bound);
     expr.accept(&b);
@@ -1030,9 +1276,28 @@ Interval bounds_of_expr_in_scope(Expr expr, const Scope<Interval> &scope, const
             << " should have been a scalar of type " << expected
             << ": " << b.interval.max << "\n";
     }
+    // Share the bounds of equal expressions, so that
+    // e.g. Interval::is_single_point can check them by identity.
+    if (ExprInterner *interner = active_expr_interner()) {
+        b.interval.min = interner->intern(b.interval.min);
+        b.interval.max = interner->intern(b.interval.max);
+    }
     return b.interval;
 }
 
+}  // namespace
+
+Interval bounds_of_expr_in_scope(Expr expr, const Scope<Interval> &scope, const FuncValueBounds &fb, bool const_bound) {
+    BoundsTimer timer;
+    current_bounds_stats.queries++;
+    if (current_bounds_cache) {
+        return current_bounds_cache->bounds_of(expr, scope, fb, const_bound, [&]() {
+            return compute_bounds_of_expr_in_scope(expr, scope, fb, const_bound);
+        });
+    }
+    return compute_bounds_of_expr_in_scope(expr, scope, fb, const_bound);
+}
+
 Region region_union(const Region &a, const Region &b) {
     internal_assert(a.size() == b.size()) << "Mismatched dimensionality in region union\n";
     Region result;
@@ -1812,6 +2077,8 @@ private:
 
 map<string, Box> boxes_touched(Expr e, Stmt s, bool consider_calls, bool consider_provides,
                                string fn, const Scope<Interval> &scope, const FuncValueBounds &fb) {
+    BoundsTimer timer;
+
     // Move the innermost vars in an IfThenElse's condition as far to the left
     // as possible, so that BoxesTouched can prune the variable scope tighter
     // when encountering the IfThenElse.
@@ -2096,6 +2363,47 @@ void boxes_touched_test() {
     }
 }
 
+void bounds_cache_test() {
+    bool was_enabled = bounds_caching_enabled();
+    set_bounds_caching(true);
+    {
+        ScopedBoundsCache cache;
+        Var x("x"), y("y");
+        Expr e = x * 2 + y;
+        Scope<Interval> scope;
+        scope.push("x", Interval(0, 10));
+        scope.push("y", Interval(3, 4));
+
+        BoundsInferenceStats before = bounds_inference_stats();
+        Interval a = bounds_of_expr_in_scope(e, scope);
+        // An equal Expr in an equal scope hits.
+        Interval b = bounds_of_expr_in_scope(x * 2 + y, scope);
+        BoundsInferenceStats after = bounds_inference_stats();
+        internal_assert(after.queries - before.queries == 2 &&
+                        after.hits - before.hits == 1);
+        internal_assert(a.min.same_as(b.min) && a.max.same_as(b.max));
+
+        // Changing the bounds of a variable it uses misses.
+        scope.pop("y");
+        scope.push("y", Interval(5, 6));
+        b = bounds_of_expr_in_scope(e, scope);
+        internal_assert(bounds_inference_stats().hits == after.hits);
+        internal_assert(equal(simplify(b.min), 5) && equal(simplify(b.max), 26));
+
+        // Changing the bounds of a variable it doesn't use hits.
+        scope.push("z", Interval(0, 1));
+        bounds_of_expr_in_scope(e, scope);
+        internal_assert(bounds_inference_stats().hits == after.hits + 1);
+
+        // So does a query with func bounds for a Func it doesn't call.
+        FuncValueBounds fb;
+        fb[{"f", 0}] = Interval(0, 1);
+        bounds_of_expr_in_scope(e, scope, fb);
+        internal_assert(bounds_inference_stats().hits == after.hits + 2);
+    }
+    set_bounds_caching(was_enabled);
+}
+
 } // anonymous namespace
 
 void bounds_test() {
@@ -2221,6 +2529,7 @@ void bounds_test() {
     internal_assert(equal(simplify(r2[0].max), 19));
 
     boxes_touched_test();
+    bounds_cache_test();
 
     std::cout << "Bounds test passed" << std::endl;
 }
@@ -6,6 +6,8 @@
  * and the regions of a function read or written by a statement.
  */
 
+#include <memory>
+
 #include "IROperator.h"
 #include "Interval.h"
 #include "Scope.h"
@@ -32,6 +34,46 @@ Interval bounds_of_expr_in_scope(Expr expr,
                                  const FuncValueBounds &func_bounds = FuncValueBounds(),
                                  bool const_bound = false);
 
+/** Counts of the bounds queries made on the current thread, since
+ * it started. Lowering reports the change in these over each pass. */
+struct BoundsInferenceStats {
+    /** Calls to bounds_of_expr_in_scope. */
+    uint64_t queries = 0;
+    /** How many of the queries were answered by a ScopedBoundsCache. */
+    uint64_t hits = 0;
+    /** Time spent in bounds_of_expr_in_scope and the box_* and
+     * boxes_* functions below. Nested calls are only counted once. */
+    double seconds = 0;
+};
+
+BoundsInferenceStats bounds_inference_stats();
+
+class BoundsCache;
+
+/** Memoize bounds_of_expr_in_scope on the current thread for the
+ * lifetime of this object, if bounds caching is enabled (see
+ * set_bounds_caching). A query is answered from the cache if an
+ * equal Expr was queried before with the same const_bound flag, and
+ * with equal bounds in the scope and the FuncValueBounds for every
+ * variable and function it refers to. Both lower() and the
+ * auto-scheduler use one, as the Params and Funcs the Exprs refer to
+ * can't change while they run. */
+class ScopedBoundsCache {
+    std::unique_ptr<BoundsCache> cache;
+    BoundsCache *old_cache;
+public:
+    ScopedBoundsCache();
+    ~ScopedBoundsCache();
+};
+
+/** Enable or disable the cache installed by ScopedBoundsCache. On by
+ * default, unless the environment variable HL_BOUNDS_CACHE is set to
+ * 0. */
+// @{
+void set_bounds_caching(bool enabled);
+bool bounds_caching_enabled();
+// @}
+
 /** Given a varying expression, try to find a constant that is either:
  * An upper bound (always greater than or equal to the expression), or
  * A lower bound (always less than or equal to the expression)
@@ -1,6 +1,8 @@
 #include <map>
+#include <unordered_map>
 
 #include "CSE.h"
+#include "ExprInterner.h"
 #include "IREquality.h"
 #include "IRMutator.h"
 #include "IROperator.h"
@@ -88,27 +90,23 @@ public:
     };
     vector<Entry> entries;
 
-    typedef map<ExprWithCompareCache, int> CacheType;
-    CacheType numbering;
+    // Structurally equal Exprs intern to the same node, so they can
+    // be numbered by identity, without deep comparisons.
+    ExprInterner interner;
+    std::unordered_map<const IRNode *, int> numbering;
 
     map<Expr, int, ExprCompare> shallow_numbering;
 
     Scope<int> let_substitutions;
     int number;
 
-    IRCompareCache cache;
-
-    GVN() : number(0), cache(8) {}
+    GVN() : number(0) {}
 
     Stmt mutate(const Stmt &s) override {
         internal_error << "Can't call GVN on a Stmt: " << s << "\n";
         return Stmt();
     }
 
-    ExprWithCompareCache with_cache(Expr e) {
-        return ExprWithCompareCache(e, &cache);
-    }
-
     Expr mutate(const Expr &e) override {
         // Early out if we've already seen this exact Expr.
         {
@@ -129,22 +127,15 @@ public:
             }
         }
 
-        // If e already has an entry, return that.
-        CacheType::iterator iter = numbering.find(with_cache(e));
-        if (iter != numbering.end()) {
-            number = iter->second;
-            shallow_numbering[e] = number;
-            internal_assert(entries[number].expr.type() == e.type());
-            return entries[number].expr;
-        }
-
-        // Rebuild using things already in the numbering.
+        // Rebuild using things already in the numbering. The
+        // children of the result are all entries, which are
+        // canonical, so interning it only has to look at the top
+        // node.
         Expr old_e = e;
-        Expr new_e = IRMutator2::mutate(e);
+        Expr new_e = interner.intern(IRMutator2::mutate(e));
 
-        // See if it's there in another form after being rebuilt
-        // (e.g. because it was a let variable).
-        iter = numbering.find(with_cache(new_e));
+        // If it's equal to an existing entry, return that.
+        auto iter = numbering.find(new_e.get());
         if (iter != numbering.end()) {
             number = iter->second;
             shallow_numbering[old_e] = number;
@@ -155,7 +146,8 @@ public:
         // Add it to the numbering.
         Entry entry = {new_e, 0};
         number = (int)entries.size();
-        numbering[with_cache(new_e)] = number;
+        numbering[new_e.get()] = number;
+        shallow_numbering[old_e] = number;
         shallow_numbering[new_e] = number;
         entries.push_back(entry);
         internal_assert(new_e.type() == old_e.type());
@@ -992,6 +992,79 @@ void CodeGen_ARM::visit(const Call *op) {
     CodeGen_Posix::visit(op);
 }
 
+void CodeGen_ARM::codegen_vector_reduce(const VectorReduce *op) {
+    const int input_lanes = op->value.type().lanes();
+    const int output_lanes = op->type.lanes();
+    const int factor = input_lanes / output_lanes;
+
+    if (op->op != VectorReduce::Add || op->type.is_float() ||
+        neon_intrinsics_disabled()) {
+        CodeGen_Posix::codegen_vector_reduce(op);
+        return;
+    }
+
+    string prefix = target.bits == 32 ? "llvm.arm.neon." : "llvm.aarch64.neon.";
+
+    #if LLVM_VERSION >= 70
+    // udot and sdot sum groups of four products of bytes into
+    // 32-bit lanes.
+    const Mul *mul = op->value.as<Mul>();
+    if (mul && op->type.bits() == 32 && factor % 4 == 0 && input_lanes >= 8 &&
+        target.has_feature(Target::ARMDotProd)) {
+        Expr a, b;
+        string intrin;
+        for (Type narrow : {UInt(8, input_lanes), Int(8, input_lanes)}) {
+            a = lossless_cast(narrow, mul->a);
+            b = lossless_cast(narrow, mul->b);
+            if (a.defined() && b.defined()) {
+                intrin = narrow.is_int() ? "sdot" : "udot";
+                break;
+            }
+        }
+        if (!intrin.empty()) {
+            if (factor > 4) {
+                // Do the dot products first, then reduce the rest.
+                Expr groups = VectorReduce::make(op->op, op->value, input_lanes / 4);
+                Expr rest = VectorReduce::make(op->op, groups, output_lanes);
+                codegen_vector_reduce(rest.as<VectorReduce>());
+                return;
+            }
+            int intrin_lanes = output_lanes >= 4 ? 4 : 2;
+            string name = (prefix + intrin +
+                           ".v" + std::to_string(intrin_lanes) + "i32" +
+                           ".v" + std::to_string(intrin_lanes * 4) + "i8");
+            llvm::Type *t = llvm_type_of(op->type);
+            Value *acc = Constant::getNullValue(t);
+            value = call_intrin(t, intrin_lanes, name, {acc, codegen(a), codegen(b)});
+            return;
+        }
+    }
+    #endif
+
+    // Widening sums of pairs (vpaddl on 32-bit arm, saddlp and
+    // uaddlp on 64-bit arm). Larger widening sums are split into
+    // pairs by the base class.
+    const Cast *cast = op->value.as<Cast>();
+    if (cast && factor == 2 && output_lanes >= 2) {
+        Type narrow = cast->value.type();
+        if ((narrow.is_int() || narrow.is_uint()) &&
+            narrow.bits() <= 32 &&
+            narrow.bits() * 2 == op->type.bits()) {
+            int intrin_lanes = 64 / narrow.bits();
+            string sign = narrow.is_int() ? "s" : "u";
+            string name = (target.bits == 32 ?
+                           prefix + "vpaddl" + sign :
+                           prefix + sign + "addlp");
+            name += (".v" + std::to_string(intrin_lanes) + "i" + std::to_string(op->type.bits()) +
+                     ".v" + std::to_string(intrin_lanes * 2) + "i" + std::to_string(narrow.bits()));
+            value = call_intrin(op->type, intrin_lanes, name, {cast->value});
+            return;
+        }
+    }
+
+    CodeGen_Posix::codegen_vector_reduce(op);
+}
+
 string CodeGen_ARM::mcpu() const {
     if (target.bits == 32) {
         if (target.has_feature(Target::ARMv7s)) {
@@ -1009,17 +1082,20 @@ string CodeGen_ARM::mcpu() const {
 }
 
 string CodeGen_ARM::mattrs() const {
+    string dot_prod = target.has_feature(Target::ARMDotProd) ? ",+dotprod" : "";
     if (target.bits == 32) {
         if (target.has_feature(Target::ARMv7s)) {
-            return "+neon";
+            return "+neon" + dot_prod;
         } if (!target.has_feature(Target::NoNEON)) {
-            return "+neon";
+            return "+neon" + dot_prod;
         } else {
             return "-neon";
         }
     } else {
         if (target.os == Target::IOS || target.os == Target::OSX) {
-            return "+reserve-x18";
+            return "+reserve-x18" + dot_prod;
+        } else if (!dot_prod.empty()) {
+            return dot_prod.substr(1);
         } else {
             return "";
         }
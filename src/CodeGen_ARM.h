@@ -36,6 +36,10 @@ protected:
     void visit(const Call *);
     // @}
 
+    /** Use udot, sdot and widening pairwise adds for horizontal sums
+     * of the right shape. */
+    void codegen_vector_reduce(const VectorReduce *);
+
     /** Various patterns to peephole match against */
     struct Pattern {
         std::string intrin32; ///< Name of the intrinsic for 32-bit arm
@@ -50,6 +50,7 @@ const string globals = R"INLINE_CODE(
 extern "C" {
 int64_t halide_current_time_ns(void *ctx);
 void halide_profiler_pipeline_end(void *, void *);
+void halide_profiler_timeline_pipeline_end(void *, void *);
 }
 
 #ifdef _WIN32
@@ -2584,6 +2585,16 @@ void CodeGen_C::visit(const Prefetch *op) {
     internal_error << "Cannot emit prefetch statements to C\n";
 }
 
+void CodeGen_C::visit(const Atomic *op) {
+    // Parallel loops are emitted as OpenMP loops, so the updates are
+    // made atomic with an OpenMP critical section.
+    do_indent();
+    stream << "#pragma omp critical\n";
+    open_scope();
+    print_stmt(op->body);
+    close_scope("atomic " + print_name(op->producer_name));
+}
+
 void CodeGen_C::visit(const IfThenElse *op) {
     string cond_id = print_expr(op->condition);
 
@@ -2647,6 +2658,44 @@ void CodeGen_C::visit(const Shuffle *op) {
     print_assignment(op->type, rhs.str());
 }
 
+void CodeGen_C::visit(const VectorReduce *op) {
+    // Combine the strided slices of the input that hold the first,
+    // second, third, ... lane of each group.
+    const int lanes = op->type.lanes();
+    const int factor = op->value.type().lanes() / lanes;
+    Expr result;
+    for (int i = 0; i < factor; i++) {
+        Expr v = Shuffle::make_slice(op->value, i, factor, lanes);
+        if (!result.defined()) {
+            result = v;
+            continue;
+        }
+        switch (op->op) {
+        case VectorReduce::Add:
+            result = Add::make(result, v);
+            break;
+        case VectorReduce::Mul:
+            result = Mul::make(result, v);
+            break;
+        case VectorReduce::Min:
+            result = Min::make(result, v);
+            break;
+        case VectorReduce::Max:
+            result = Max::make(result, v);
+            break;
+        case VectorReduce::And:
+            result = op->type.is_bool() ? And::make(result, v) :
+                Call::make(op->type, Call::bitwise_and, {result, v}, Call::PureIntrinsic);
+            break;
+        case VectorReduce::Or:
+            result = op->type.is_bool() ? Or::make(result, v) :
+                Call::make(op->type, Call::bitwise_or, {result, v}, Call::PureIntrinsic);
+            break;
+        }
+    }
+    print_expr(result);
+}
+
 void CodeGen_C::test() {
     LoweredArgument buffer_arg("buf", Argument::OutputBuffer, Int(32), 3);
     LoweredArgument float_arg("alpha", Argument::InputScalar, Float(32), 0);
@@ -36,8 +36,9 @@ public:
     Expr num_threads[4];
     Expr num_blocks[4];
     Expr shared_mem_size;
+    bool found_atomic;
 
-    ExtractBounds() : shared_mem_size(0), found_shared(false) {
+    ExtractBounds() : shared_mem_size(0), found_atomic(false), found_shared(false) {
         for (int i = 0; i < 4; i++) {
             num_threads[i] = num_blocks[i] = 1;
         }
@@ -93,6 +94,11 @@ private:
         }
         allocate->body.accept(this);
     }
+
+    void visit(const Atomic *op) {
+        found_atomic = true;
+        op->body.accept(this);
+    }
 };
 
 template<typename CodeGen_CPU>
@@ -175,21 +181,30 @@ void CodeGen_GPU_Host<CodeGen_CPU>::compile_func(const LoweredFunc &f,
     // Fill out the init kernels block
     builder->SetInsertPoint(init_kernels_bb);
 
+    // If the module state for an API/function did not get created, there were
+    // no kernels using that API.
+    std::vector<CodeGen_GPU_Dev *> used_cgdev;
     for (pair<const DeviceAPI, CodeGen_GPU_Dev *> &i : cgdev) {
+        if (get_module_state(i.second->api_unique_name(), false)) {
+            used_cgdev.push_back(i.second);
+        }
+    }
 
-        CodeGen_GPU_Dev *gpu_codegen = i.second;
-        std::string api_unique_name = gpu_codegen->api_unique_name();
+    // Each device API has its own codegen (and LLVM context, if it
+    // uses one), so compile their kernels in parallel.
+    std::vector<std::vector<char>> kernel_srcs(used_cgdev.size());
+    run_compile_tasks(used_cgdev.size(), [&](size_t i) {
+        kernel_srcs[i] = used_cgdev[i]->compile_to_src();
+    });
 
-        // If the module state for this API/function did not get created, there were
-        // no kernels using this API.
+    for (size_t i = 0; i < used_cgdev.size(); i++) {
+        CodeGen_GPU_Dev *gpu_codegen = used_cgdev[i];
+        std::string api_unique_name = gpu_codegen->api_unique_name();
         llvm::Value *module_state = get_module_state(api_unique_name, false);
-        if (!module_state) {
-            continue;
-        }
 
         debug(2) << "Generating init_kernels for " << api_unique_name << "\n";
 
-        std::vector<char> kernel_src = gpu_codegen->compile_to_src();
+        const std::vector<char> &kernel_src = kernel_srcs[i];
 
         Value *kernel_src_ptr =
             CodeGen_CPU::create_binary_blob(kernel_src,
@@ -231,6 +246,9 @@ void CodeGen_GPU_Host<CodeGen_CPU>::visit(const For *loop) {
 
         ExtractBounds bounds;
         loop->accept(&bounds);
+        user_assert(!bounds.found_atomic)
+            << "Kernel " << loop->name << " contains an update scheduled with atomic(), "
+            << "which is not supported inside GPU kernels.\n";
 
         debug(2) << "Kernel bounds: ("
                  << bounds.num_threads[0] << ", "
@@ -15,6 +15,8 @@
 #include "CodeGen_X86.h"
 #include "Debug.h"
 #include "Deinterleave.h"
+#include "ExprUsesVar.h"
+#include "IRMutator.h"
 #include "IROperator.h"
 #include "IRPrinter.h"
 #include "IntegerDivisionTable.h"
@@ -24,6 +26,7 @@
 #include "Lerp.h"
 #include "MatlabWrapper.h"
 #include "Simplify.h"
+#include "Substitute.h"
 #include "Util.h"
 
 #if !(__cplusplus > 199711L || _MSC_VER >= 1800)
@@ -259,7 +262,8 @@ CodeGen_LLVM::CodeGen_LLVM(Target t) :
     min_f64(Float(64).min()),
     max_f64(Float(64).max()),
     destructor_block(nullptr),
-    strict_float(t.has_feature(Target::StrictFloat)) {
+    strict_float(t.has_feature(Target::StrictFloat)),
+    emit_atomic_stores(false) {
     initialize_llvm();
 }
 
@@ -522,6 +526,7 @@ std::unique_ptr<llvm::Module> CodeGen_LLVM::compile(const Module &input) {
     module->addModuleFlag(llvm::Module::Warning, "halide_mcpu", MDString::get(*context, mcpu()));
     module->addModuleFlag(llvm::Module::Warning, "halide_mattrs", MDString::get(*context, mattrs()));
     module->addModuleFlag(llvm::Module::Warning, "halide_per_instruction_fast_math_flags", input.any_strict_float());
+    module->addModuleFlag(llvm::Module::Warning, "halide_fast_compile", target.has_feature(Target::FastCompile));
 
     internal_assert(module && context && builder)
         << "The CodeGen_LLVM subclass should have made an initial module before calling CodeGen_LLVM::compile\n";
@@ -1057,14 +1062,30 @@ void CodeGen_LLVM::optimize_module() {
     function_pass_manager.add(createTargetTransformInfoWrapperPass(TM ? TM->getTargetIRAnalysis() : TargetIRAnalysis()));
 
     PassManagerBuilder b;
-    b.OptLevel = 3;
+    if (get_target().has_feature(Target::FastCompile)) {
+        // Only inline what must be inlined, and do just enough
+        // cleanup that the backend isn't handed values through the
+        // stack and trivially redundant code. There's no loop
+        // optimization or vectorization beyond what the Halide
+        // schedule already did.
+        b.OptLevel = 0;
+        b.Inliner = createAlwaysInlinerLegacyPass();
+        b.addExtension(PassManagerBuilder::EP_EnabledOnOptLevel0,
+                       [](const PassManagerBuilder &, legacy::PassManagerBase &pm) {
+                           pm.add(createSROAPass());
+                           pm.add(createEarlyCSEPass());
+                           pm.add(createCFGSimplificationPass());
+                       });
+    } else {
+        b.OptLevel = 3;
 #if LLVM_VERSION >= 50
-    b.Inliner = createFunctionInliningPass(b.OptLevel, 0, false);
+        b.Inliner = createFunctionInliningPass(b.OptLevel, 0, false);
 #else
-    b.Inliner = createFunctionInliningPass(b.OptLevel, 0);
+        b.Inliner = createFunctionInliningPass(b.OptLevel, 0);
 #endif
-    b.LoopVectorize = true;
-    b.SLPVectorize = true;
+        b.LoopVectorize = true;
+        b.SLPVectorize = true;
+    }
 
 #if LLVM_VERSION >= 50
     if (TM) {
@@ -1632,6 +1653,8 @@ int next_power_of_two(int x) {
 
 void CodeGen_LLVM::add_tbaa_metadata(llvm::Instruction *inst, string buffer, Expr index) {
 
+    bool suballocation = is_suballocation(buffer);
+
     // Get the unique name for the block of memory this allocate node
     // is using.
     buffer = get_allocation_name(buffer);
@@ -1642,7 +1665,7 @@ void CodeGen_LLVM::add_tbaa_metadata(llvm::Instruction *inst, string buffer, Exp
     int64_t base = 0;
     int64_t width = 1;
 
-    if (index.defined()) {
+    if (index.defined() && !suballocation) {
         if (const Ramp *ramp = index.as<Ramp>()) {
             const int64_t *pstride = as_const_int(ramp->stride);
             const int64_t *pbase = as_const_int(ramp->base);
@@ -2737,18 +2760,75 @@ void CodeGen_LLVM::visit(const Call *op) {
         internal_error << "Unknown intrinsic: " << op->name << "\n";
     } else if (op->call_type == Call::PureExtern && op->name == "pow_f32") {
         internal_assert(op->args.size() == 2);
+        bool fast = get_target().has_feature(Target::FastTranscendentals);
         Expr x = op->args[0];
         Expr y = op->args[1];
-        Expr e = Internal::halide_exp(Internal::halide_log(x) * y);
+        Expr e = Internal::halide_exp(Internal::halide_log(x, fast) * y, fast);
         e.accept(this);
     } else if (op->call_type == Call::PureExtern && op->name == "log_f32") {
         internal_assert(op->args.size() == 1);
-        Expr e = Internal::halide_log(op->args[0]);
+        bool fast = get_target().has_feature(Target::FastTranscendentals);
+        Expr e = Internal::halide_log(op->args[0], fast);
         e.accept(this);
     } else if (op->call_type == Call::PureExtern && op->name == "exp_f32") {
         internal_assert(op->args.size() == 1);
-        Expr e = Internal::halide_exp(op->args[0]);
+        bool fast = get_target().has_feature(Target::FastTranscendentals);
+        Expr e = Internal::halide_exp(op->args[0], fast);
         e.accept(this);
+    } else if (op->call_type == Call::PureExtern &&
+               op->type.is_vector() &&
+               (op->name == "sin_f32" || op->name == "cos_f32" || op->name == "atan2_f32") &&
+               !find_vector_runtime_function(op->name, op->type.lanes()).first) {
+        // The math library versions of these would be scalarized,
+        // so use a polynomial approximation instead. Scalar calls
+        // still go to the math library.
+        bool fast = get_target().has_feature(Target::FastTranscendentals);
+        if (op->name == "atan2_f32") {
+            internal_assert(op->args.size() == 2);
+            Expr e = Internal::halide_atan2(op->args[0], op->args[1], fast);
+            e.accept(this);
+        } else {
+            internal_assert(op->args.size() == 1);
+            string x_name = unique_name('x');
+            Expr x = Variable::make(op->args[0].type(), x_name);
+            Value *x_value = codegen(op->args[0]);
+            sym_push(x_name, x_value);
+            Expr e = (op->name == "sin_f32") ? Internal::halide_sin(x, fast) : Internal::halide_cos(x, fast);
+            Value *approx = codegen(e);
+
+            // The range reduction loses precision for |x| >= 8192, so
+            // if any lane is that large, call the math library for
+            // each lane instead.
+            Value *large = codegen(abs(x) >= 8192.0f);
+            large = builder->CreateBitCast(large, llvm::Type::getIntNTy(*context, op->type.lanes()));
+            Value *in_range = builder->CreateIsNull(large);
+            BasicBlock *approx_bb = builder->GetInsertBlock();
+            BasicBlock *libm_bb = BasicBlock::Create(*context, op->name + "_large", function);
+            BasicBlock *after_bb = BasicBlock::Create(*context, op->name + "_done", function);
+            builder->CreateCondBr(in_range, after_bb, libm_bb, very_likely_branch);
+
+            builder->SetInsertPoint(libm_bb);
+            string lane_name = unique_name('x');
+            Expr lane_call = Call::make(op->type.element_of(), op->name,
+                                        {Variable::make(x.type().element_of(), lane_name)},
+                                        Call::PureExtern);
+            Value *exact = UndefValue::get(approx->getType());
+            for (int i = 0; i < op->type.lanes(); i++) {
+                Value *idx = ConstantInt::get(i32_t, i);
+                sym_push(lane_name, builder->CreateExtractElement(x_value, idx));
+                exact = builder->CreateInsertElement(exact, codegen(lane_call), idx);
+                sym_pop(lane_name);
+            }
+            builder->CreateBr(after_bb);
+            BasicBlock *libm_pred = builder->GetInsertBlock();
+
+            builder->SetInsertPoint(after_bb);
+            PHINode *phi = builder->CreatePHI(approx->getType(), 2);
+            phi->addIncoming(approx, approx_bb);
+            phi->addIncoming(exact, libm_pred);
+            sym_pop(x_name);
+            value = phi;
+        }
     } else if (op->call_type == Call::PureExtern &&
                (op->name == "is_nan_f32" || op->name == "is_nan_f64")) {
         internal_assert(op->args.size() == 1);
@@ -2915,6 +2995,11 @@ void CodeGen_LLVM::visit(const Call *op) {
     }
 }
 
+void CodeGen_LLVM::visit(const Atomic *op) {
+    ScopedValue<bool> old_emit_atomic_stores(emit_atomic_stores, true);
+    codegen(op->body);
+}
+
 void CodeGen_LLVM::visit(const Prefetch *op) {
     internal_error << "Prefetch encountered during codegen\n";
 }
@@ -3201,6 +3286,11 @@ void CodeGen_LLVM::visit(const Store *op) {
         return;
     }
 
+    if (emit_atomic_stores) {
+        codegen_atomic_store(op);
+        return;
+    }
+
     // Predicated store
     if (!is_one(op->predicate)) {
         codegen_predicated_vector_store(op);
@@ -3302,6 +3392,113 @@ void CodeGen_LLVM::visit(const Store *op) {
 }
 
 
+namespace {
+
+// Replace the loads of the location an atomic store writes to with a
+// variable holding the old value at that location.
+class ReplaceAtomicLoad : public IRMutator2 {
+    using IRMutator2::visit;
+
+    const string &buffer;
+    const Expr &index;
+    const Expr &old_value;
+
+    Expr visit(const Load *op) override {
+        if (op->name == buffer) {
+            if (equal(op->index, index)) {
+                return old_value;
+            }
+            other_loads = true;
+        }
+        return IRMutator2::visit(op);
+    }
+
+public:
+    bool other_loads = false;
+
+    ReplaceAtomicLoad(const string &buffer, const Expr &index, const Expr &old_value)
+        : buffer(buffer), index(index), old_value(old_value) {}
+};
+
+}  // namespace
+
+void CodeGen_LLVM::codegen_atomic_store(const Store *op) {
+    // vectorize_loops scalarizes the bodies of Atomic nodes.
+    internal_assert(op->value.type().is_scalar() && is_one(op->predicate))
+        << "Atomic store should have been scalarized: " << Stmt(op) << "\n";
+
+    Halide::Type value_type = op->value.type();
+    string old_name = unique_name('t');
+    Expr old_value = Variable::make(value_type, old_name);
+
+    // Lets in the value may hide that a load is of the same location
+    // as the store.
+    Expr index = substitute_in_all_lets(op->index);
+    ReplaceAtomicLoad replacer(op->name, index, old_value);
+    Expr value = replacer.mutate(substitute_in_all_lets(op->value));
+    internal_assert(!replacer.other_loads)
+        << "Atomic store to " << op->name
+        << " reads from other locations of the same buffer: " << Stmt(op) << "\n";
+    value = common_subexpression_elimination(value);
+
+    Value *ptr = codegen_buffer_pointer(op->name, value_type, op->index);
+
+    // Integer updates which add, subtract, or take the min or max of
+    // something that doesn't depend on the old value map to a single
+    // instruction.
+    AtomicRMWInst::BinOp rmw_op = AtomicRMWInst::BAD_BINOP;
+    Expr operand;
+    if (value_type.is_int() || value_type.is_uint()) {
+        bool is_int = value_type.is_int();
+        if (const Add *add = value.as<Add>()) {
+            rmw_op = AtomicRMWInst::Add;
+            operand = equal(add->a, old_value) ? add->b : equal(add->b, old_value) ? add->a : Expr();
+        } else if (const Sub *sub = value.as<Sub>()) {
+            rmw_op = AtomicRMWInst::Sub;
+            operand = equal(sub->a, old_value) ? sub->b : Expr();
+        } else if (const Min *min = value.as<Min>()) {
+            rmw_op = is_int ? AtomicRMWInst::Min : AtomicRMWInst::UMin;
+            operand = equal(min->a, old_value) ? min->b : equal(min->b, old_value) ? min->a : Expr();
+        } else if (const Max *max = value.as<Max>()) {
+            rmw_op = is_int ? AtomicRMWInst::Max : AtomicRMWInst::UMax;
+            operand = equal(max->a, old_value) ? max->b : equal(max->b, old_value) ? max->a : Expr();
+        }
+    }
+
+    if (operand.defined() && !expr_uses_var(operand, old_name)) {
+        builder->CreateAtomicRMW(rmw_op, ptr, codegen(operand), AtomicOrdering::Monotonic);
+        return;
+    }
+
+    // Otherwise, compute the new value from the old one and swap it
+    // in, until no other thread changed the old one in between. Floats
+    // are swapped as integers of the same size.
+    llvm::Type *bits_type = IntegerType::get(*context, value_type.bits());
+    Value *bits_ptr = builder->CreatePointerCast(ptr, bits_type->getPointerTo());
+    LoadInst *first_bits = builder->CreateAlignedLoad(bits_ptr, value_type.bytes());
+    first_bits->setAtomic(AtomicOrdering::Monotonic);
+    add_tbaa_metadata(first_bits, op->name, op->index);
+
+    BasicBlock *entry_bb = builder->GetInsertBlock();
+    BasicBlock *loop_bb = BasicBlock::Create(*context, "atomic_update", function);
+    BasicBlock *after_bb = BasicBlock::Create(*context, "after_atomic_update", function);
+    builder->CreateBr(loop_bb);
+    builder->SetInsertPoint(loop_bb);
+
+    PHINode *old_bits = builder->CreatePHI(bits_type, 2);
+    old_bits->addIncoming(first_bits, entry_bb);
+    sym_push(old_name, builder->CreateBitCast(old_bits, llvm_type_of(value_type)));
+    Value *new_bits = builder->CreateBitCast(codegen(value), bits_type);
+    sym_pop(old_name);
+
+    Value *result = builder->CreateAtomicCmpXchg(bits_ptr, old_bits, new_bits,
+                                                 AtomicOrdering::Monotonic,
+                                                 AtomicOrdering::Monotonic);
+    old_bits->addIncoming(builder->CreateExtractValue(result, {0}), builder->GetInsertBlock());
+    builder->CreateCondBr(builder->CreateExtractValue(result, {1}), after_bb, loop_bb);
+    builder->SetInsertPoint(after_bb);
+}
+
 void CodeGen_LLVM::visit(const Block *op) {
     codegen(op->first);
     if (op->rest.defined()) codegen(op->rest);
@@ -3368,6 +3565,109 @@ void CodeGen_LLVM::visit(const Shuffle *op) {
     }
 }
 
+void CodeGen_LLVM::visit(const VectorReduce *op) {
+    codegen_vector_reduce(op);
+}
+
+namespace {
+
+Expr vector_reduce_binop(VectorReduce::Operator op, Expr a, Expr b) {
+    Type t = a.type();
+    switch (op) {
+    case VectorReduce::Add:
+        return Add::make(a, b);
+    case VectorReduce::Mul:
+        return Mul::make(a, b);
+    case VectorReduce::Min:
+        return Min::make(a, b);
+    case VectorReduce::Max:
+        return Max::make(a, b);
+    case VectorReduce::And:
+        return t.is_bool() ? And::make(a, b) :
+            Call::make(t, Call::bitwise_and, {a, b}, Call::PureIntrinsic);
+    case VectorReduce::Or:
+        return t.is_bool() ? Or::make(a, b) :
+            Call::make(t, Call::bitwise_or, {a, b}, Call::PureIntrinsic);
+    }
+    return Expr();
+}
+
+// Check if a vector being summed is a widening of something half as
+// wide, e.g. a product of 16-bit values as 32-bit values.
+bool is_widening_sum(const VectorReduce *op) {
+    Type t = op->value.type();
+    if (op->op != VectorReduce::Add || t.is_float() || t.bits() < 16) {
+        return false;
+    }
+    Type narrow = t.with_bits(t.bits() / 2);
+    Type unsigned_narrow = narrow.with_code(Type::UInt);
+    Expr a = op->value, b;
+    if (const Mul *mul = a.as<Mul>()) {
+        a = mul->a;
+        b = mul->b;
+    }
+    auto narrows = [&](Expr e) {
+        return (lossless_cast(narrow, e).defined() ||
+                lossless_cast(unsigned_narrow, e).defined());
+    };
+    return narrows(a) && (!b.defined() || narrows(b));
+}
+
+}  // namespace
+
+void CodeGen_LLVM::codegen_vector_reduce(const VectorReduce *op) {
+    const int output_lanes = op->type.lanes();
+    const int factor = op->value.type().lanes() / output_lanes;
+
+    if (factor > 2 && factor % 2 == 0 && is_widening_sum(op)) {
+        // Do a reduction by a factor of two first. Many targets
+        // have an instruction for a widening pairwise sum, which
+        // will get picked up when the inner reduction is
+        // generated. The outer reduction is then on half as many
+        // lanes.
+        Expr pairs = VectorReduce::make(op->op, op->value, op->value.type().lanes() / 2);
+        Expr rest = VectorReduce::make(op->op, pairs, output_lanes);
+        codegen_vector_reduce(rest.as<VectorReduce>());
+        return;
+    }
+
+    std::string name = unique_name('v');
+    Expr v = Variable::make(op->value.type(), name);
+    Expr result = v;
+    int lanes = op->value.type().lanes();
+    int remaining = factor;
+
+    while (remaining > 1 && remaining % 2 == 0) {
+        lanes /= 2;
+        remaining /= 2;
+        Expr a, b;
+        if (output_lanes == 1) {
+            // The order doesn't matter for a total reduction, so
+            // combine the two halves.
+            a = Shuffle::make_slice(result, 0, 1, lanes);
+            b = Shuffle::make_slice(result, lanes, 1, lanes);
+        } else {
+            // The even and odd lanes are in the same groups.
+            a = Shuffle::make_slice(result, 0, 2, lanes);
+            b = Shuffle::make_slice(result, 1, 2, lanes);
+        }
+        result = vector_reduce_binop(op->op, a, b);
+    }
+
+    if (remaining > 1) {
+        // Combine the strided slices holding each lane of the
+        // remaining groups.
+        Expr combined;
+        for (int i = 0; i < remaining; i++) {
+            Expr slice = Shuffle::make_slice(result, i, remaining, output_lanes);
+            combined = combined.defined() ? vector_reduce_binop(op->op, combined, slice) : slice;
+        }
+        result = combined;
+    }
+
+    codegen(Let::make(name, op->value, result));
+}
+
 Value *CodeGen_LLVM::create_alloca_at_entry(llvm::Type *t, int n, bool zero_initialize, const string &name) {
     IRBuilderBase::InsertPoint here = builder->saveIP();
     BasicBlock *entry = &builder->GetInsertBlock()->getParent()->getEntryBlock();
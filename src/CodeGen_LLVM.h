@@ -292,6 +292,12 @@ protected:
      * when multiple Allocate nodes shared the same memory. */
     virtual std::string get_allocation_name(const std::string &n) {return n;}
 
+    /** Return true if an allocate node uses a sub-range of a block of
+     * memory shared with other Allocate nodes at other offsets (see
+     * plan_memory). Alias analysis can't use the indices of loads and
+     * stores to tell these apart. */
+    virtual bool is_suballocation(const std::string &n) {return false;}
+
     /** Helpers for implementing fast integer division. */
     // @{
     // Compute high_half(a*b) >> shr. Note that this is a shift in
@@ -346,9 +352,19 @@ protected:
     virtual void visit(const IfThenElse *);
     virtual void visit(const Evaluate *);
     virtual void visit(const Shuffle *);
+    virtual void visit(const VectorReduce *);
     virtual void visit(const Prefetch *);
+    virtual void visit(const Atomic *);
     // @}
 
+    /** Generate code for a horizontal reduction of a vector. The
+     * default implementation combines halves or even and odd lanes
+     * of the vector until each group is down to one lane. Targets
+     * with instructions that reduce adjacent lanes (e.g. dot
+     * products) override this, and defer to it for anything they
+     * can't match. */
+    virtual void codegen_vector_reduce(const VectorReduce *op);
+
     /** Generate code for an allocate node. It has no default
      * implementation - it must be handled in an architecture-specific
      * way. */
@@ -463,6 +479,10 @@ private:
     /** Turn off all unsafe math flags in scopes while this is set. */
     bool strict_float;
 
+    /** Emit stores as atomic read-modify-writes while this is set,
+     * i.e. inside an Atomic node. */
+    bool emit_atomic_stores;
+
     /** Embed an instance of halide_filter_metadata_t in the code, using
      * the given name (by convention, this should be ${FUNCTIONNAME}_metadata)
      * as extern "C" linkage. Note that the return value is a function-returning-
@@ -481,6 +501,12 @@ private:
 
     virtual void codegen_predicated_vector_load(const Load *op);
     virtual void codegen_predicated_vector_store(const Store *op);
+
+    /** Generate a scalar store inside an Atomic node, as an atomic
+     * read-modify-write instruction if the stored value is a simple
+     * update of the old one, and as a compare-and-swap loop
+     * otherwise. */
+    void codegen_atomic_store(const Store *op);
 };
 
 }  // namespace Internal
@@ -79,6 +79,28 @@ int CodeGen_Posix::allocation_padding(Type type) const {
     return type.bytes();
 }
 
+string CodeGen_Posix::get_parent_allocation(const Expr &new_expr) {
+    // Match reinterpret(Handle(), reinterpret(UInt(64), parent) + offset),
+    // where the simplifier may have removed a zero offset.
+    Expr e = new_expr;
+    const Call *call = e.as<Call>();
+    if (call && call->is_intrinsic(Call::reinterpret)) {
+        e = call->args[0];
+    }
+    if (const Add *add = e.as<Add>()) {
+        e = add->a;
+    }
+    call = e.as<Call>();
+    if (call && call->is_intrinsic(Call::reinterpret)) {
+        e = call->args[0];
+    }
+    const Variable *parent = e.as<Variable>();
+    if (!parent || !allocations.contains(parent->name)) {
+        return "";
+    }
+    return parent->name;
+}
+
 CodeGen_Posix::Allocation CodeGen_Posix::create_allocation(const std::string &name, Type type, MemoryType memory_type,
                                                            const std::vector<Expr> &extents, Expr condition,
                                                            Expr new_expr, std::string free_function) {
@@ -130,6 +152,7 @@ CodeGen_Posix::Allocation CodeGen_Posix::create_allocation(const std::string &na
     allocation.destructor = nullptr;
     allocation.destructor_function = nullptr;
     allocation.name = name;
+    allocation.suballocation = false;
 
     if (!new_expr.defined() && extents.empty()) {
         // If it's a scalar allocation, don't try anything clever. We
@@ -181,6 +204,14 @@ CodeGen_Posix::Allocation CodeGen_Posix::create_allocation(const std::string &na
     } else {
         if (new_expr.defined()) {
             allocation.ptr = codegen(new_expr);
+            // An allocation at an offset into another one (see
+            // plan_memory) may overlap the other allocations carved
+            // out of it, so it must share their alias analysis name.
+            string parent = get_parent_allocation(new_expr);
+            if (!parent.empty()) {
+                allocation.name = get_allocation_name(parent);
+                allocation.suballocation = true;
+            }
         } else {
             // call malloc
             llvm::Function *malloc_fn = module->getFunction("halide_malloc");
@@ -261,6 +292,10 @@ void CodeGen_Posix::free_allocation(const std::string &name) {
     sym_pop(name);
 }
 
+bool CodeGen_Posix::is_suballocation(const std::string &n) {
+    return allocations.contains(n) && allocations.get(n).suballocation;
+}
+
 string CodeGen_Posix::get_allocation_name(const std::string &n) {
     if (allocations.contains(n)) {
         return allocations.get(n).name;
@@ -62,6 +62,10 @@ protected:
          * Allocate node name in cases where we detect multiple
          * Allocate nodes can share a single allocation. */
         std::string name;
+
+        /** Whether this allocation is carved out of another one, at
+         * some offset. */
+        bool suballocation;
     };
 
     /** The allocations currently in scope. The stack gets pushed when
@@ -69,6 +73,11 @@ protected:
     Scope<Allocation> allocations;
 
     std::string get_allocation_name(const std::string &n);
+    bool is_suballocation(const std::string &n);
+
+    /** If new_expr points into another allocation in scope, return
+     * the name of that allocation. Otherwise return an empty string. */
+    std::string get_parent_allocation(const Expr &new_expr);
 
 private:
 
@@ -353,6 +353,106 @@ void CodeGen_X86::visit(const Cast *op) {
     CodeGen_Posix::visit(op);
 }
 
+void CodeGen_X86::codegen_vector_reduce(const VectorReduce *op) {
+    const int input_lanes = op->value.type().lanes();
+    const int output_lanes = op->type.lanes();
+    const int factor = input_lanes / output_lanes;
+
+    if (op->op != VectorReduce::Add) {
+        CodeGen_Posix::codegen_vector_reduce(op);
+        return;
+    }
+
+    const Mul *mul = op->value.as<Mul>();
+    const Cast *cast = op->value.as<Cast>();
+
+    // Reduce groups of the given size with an instruction first,
+    // and then reduce the rest generically. The instructions all
+    // produce vectors, so this only applies when there are at least
+    // two groups.
+    auto split = [&](int group) {
+        Expr groups = VectorReduce::make(op->op, op->value, input_lanes / group);
+        Expr rest = VectorReduce::make(op->op, groups, output_lanes);
+        codegen_vector_reduce(rest.as<VectorReduce>());
+    };
+
+    // psadbw sums the absolute differences of groups of eight
+    // bytes into 64-bit lanes.
+    const Call *absd = cast ? cast->value.as<Call>() : nullptr;
+    if (absd && absd->is_intrinsic(Call::absd) &&
+        absd->args[0].type().element_of() == UInt(8) &&
+        op->type.bits() >= 16 && factor % 8 == 0 && input_lanes >= 16) {
+        if (factor > 8) {
+            split(8);
+        } else if (target.has_feature(Target::AVX2) && output_lanes >= 4) {
+            value = call_intrin(UInt(64, output_lanes), 4, "llvm.x86.avx2.psad.bw", absd->args);
+            value = builder->CreateIntCast(value, llvm_type_of(op->type), false);
+        } else {
+            value = call_intrin(UInt(64, output_lanes), 2, "llvm.x86.sse2.psad.bw", absd->args);
+            value = builder->CreateIntCast(value, llvm_type_of(op->type), false);
+        }
+        return;
+    }
+
+    if (op->type.element_of() != Int(32)) {
+        CodeGen_Posix::codegen_vector_reduce(op);
+        return;
+    }
+
+    #if LLVM_VERSION >= 70
+    // vpdpbusd sums groups of four products of unsigned and signed
+    // bytes into 32-bit lanes.
+    if (mul && factor % 4 == 0 && input_lanes >= 8 &&
+        target.has_feature(Target::AVX512_Cascadelake)) {
+        Type u8 = UInt(8, input_lanes), i8 = Int(8, input_lanes);
+        Expr a = lossless_cast(u8, mul->a), b = lossless_cast(i8, mul->b);
+        if (!a.defined() || !b.defined()) {
+            a = lossless_cast(u8, mul->b);
+            b = lossless_cast(i8, mul->a);
+        }
+        if (a.defined() && b.defined()) {
+            if (factor > 4) {
+                split(4);
+                return;
+            }
+            int intrin_lanes = output_lanes >= 16 ? 16 : output_lanes >= 8 ? 8 : 4;
+            string name = "llvm.x86.avx512.vpdpbusd." + std::to_string(intrin_lanes * 32);
+            llvm::Type *t = llvm_type_of(op->type);
+            Value *acc = Constant::getNullValue(t);
+            Value *va = builder->CreateBitCast(codegen(a), t);
+            Value *vb = builder->CreateBitCast(codegen(b), t);
+            value = call_intrin(t, intrin_lanes, name, {acc, va, vb});
+            return;
+        }
+    }
+    #endif
+
+    // pmaddwd sums pairs of products of 16-bit values into 32-bit
+    // lanes. Larger widening sums are split into pairs by the base
+    // class.
+    if (factor == 2 && output_lanes >= 2) {
+        Type i16 = Int(16, input_lanes);
+        Expr a, b;
+        if (mul) {
+            a = lossless_cast(i16, mul->a);
+            b = lossless_cast(i16, mul->b);
+        } else if (cast) {
+            a = lossless_cast(i16, cast);
+            b = make_one(i16);
+        }
+        if (a.defined() && b.defined()) {
+            if (target.has_feature(Target::AVX2) && output_lanes >= 8) {
+                value = call_intrin(op->type, 8, "llvm.x86.avx2.pmadd.wd", {a, b});
+            } else {
+                value = call_intrin(op->type, 4, "llvm.x86.sse2.pmadd.wd", {a, b});
+            }
+            return;
+        }
+    }
+
+    CodeGen_Posix::codegen_vector_reduce(op);
+}
+
 Expr CodeGen_X86::mulhi_shr(Expr a, Expr b, int shr) {
     Type ty = a.type();
     if (ty.is_vector() && ty.bits() == 16) {
@@ -373,6 +473,13 @@ Expr CodeGen_X86::mulhi_shr(Expr a, Expr b, int shr) {
 
 string CodeGen_X86::mcpu() const {
     if (target.has_feature(Target::AVX512_Cannonlake)) return "cannonlake";
+    if (target.has_feature(Target::AVX512_Cascadelake)) {
+#if LLVM_VERSION >= 80
+        return "cascadelake";
+#else
+        return "skylake-avx512";
+#endif
+    }
     if (target.has_feature(Target::AVX512_Skylake)) return "skylake-avx512";
     if (target.has_feature(Target::AVX512_KNL)) return "knl";
     if (target.has_feature(Target::AVX2)) return "haswell";
@@ -401,6 +508,7 @@ string CodeGen_X86::mattrs() const {
     if (target.has_feature(Target::AVX512) ||
         target.has_feature(Target::AVX512_KNL) ||
         target.has_feature(Target::AVX512_Skylake) ||
+        target.has_feature(Target::AVX512_Cascadelake) ||
         target.has_feature(Target::AVX512_Cannonlake)) {
         features += separator + "+avx512f,+avx512cd";
         separator = ",";
@@ -408,9 +516,13 @@ string CodeGen_X86::mattrs() const {
             features += ",+avx512pf,+avx512er";
         }
         if (target.has_feature(Target::AVX512_Skylake) ||
+            target.has_feature(Target::AVX512_Cascadelake) ||
             target.has_feature(Target::AVX512_Cannonlake)) {
             features += ",+avx512vl,+avx512bw,+avx512dq";
         }
+        if (target.has_feature(Target::AVX512_Cascadelake)) {
+            features += ",+avx512vnni";
+        }
         if (target.has_feature(Target::AVX512_Cannonlake)) {
             features += ",+avx512ifma,+avx512vbmi";
         }
@@ -426,6 +538,7 @@ int CodeGen_X86::native_vector_bits() const {
     if (target.has_feature(Target::AVX512) ||
         target.has_feature(Target::AVX512_Skylake) ||
         target.has_feature(Target::AVX512_KNL) ||
+        target.has_feature(Target::AVX512_Cascadelake) ||
         target.has_feature(Target::AVX512_Cannonlake)) {
         return 512;
     } else if (target.has_feature(Target::AVX) ||
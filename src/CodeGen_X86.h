@@ -45,6 +45,10 @@ protected:
     void visit(const NE *);
     void visit(const Select *);
     // @}
+
+    /** Use pmaddwd, psadbw and vpdpbusd for horizontal sums of the
+     * right shape. */
+    void codegen_vector_reduce(const VectorReduce *);
 };
 
 }  // namespace Internal
@@ -240,6 +240,26 @@ private:
         }
     }
 
+    Expr visit(const VectorReduce *op) override {
+        if (op->type.is_scalar()) {
+            return op;
+        } else {
+            // Each output lane is a reduction over a group of
+            // adjacent input lanes. Gather the groups of the output
+            // lanes we want.
+            int factor = op->value.type().lanes() / op->type.lanes();
+            std::vector<int> indices;
+            for (int i = 0; i < new_lanes; i++) {
+                int lane = starting_lane + lane_stride * i;
+                for (int j = 0; j < factor; j++) {
+                    indices.push_back(lane * factor + j);
+                }
+            }
+            Expr value = Shuffle::make({op->value}, indices);
+            return VectorReduce::make(op->op, value, new_lanes);
+        }
+    }
+
     Expr visit(const Call *op) override {
         Type t = op->type.with_lanes(new_lanes);
 
@@ -210,6 +210,20 @@ private:
         return expr;
     }
 
+    Expr visit(const VectorReduce *op) override {
+        Expr value = mutate(op->value);
+        if (value.same_as(op->value)) {
+            return op;
+        }
+        // A bool vector is now a mask, which the And or Or reduces
+        // to a mask.
+        Expr expr = VectorReduce::make(op->op, value, op->type.lanes());
+        if (op->type.is_bool() && op->type.is_scalar()) {
+            expr = NE::make(expr, make_zero(expr.type()));
+        }
+        return expr;
+    }
+
     template <typename NodeType, typename LetType>
     NodeType visit_let(const LetType *op) {
         Expr value = mutate(op->value);
@@ -64,7 +64,9 @@ enum class IRNodeType {
     IfThenElse,
     Evaluate,
     Shuffle,
+    VectorReduce,
     Prefetch,
+    Atomic,
 };
 
 /** The abstract base classes for a node in the Halide IR. */
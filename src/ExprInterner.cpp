@@ -0,0 +1,486 @@
+#include <cmath>
+#include <functional>
+#include <map>
+#include <string>
+
+#include "ExprInterner.h"
+#include "IREquality.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Interval.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+uint64_t mix(uint64_t h, uint64_t v) {
+    return h ^ (v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+}
+
+uint64_t hash_string(const string &s) {
+    return (uint64_t)std::hash<string>()(s);
+}
+
+uint64_t hash_type(Type t) {
+    // Ignores the handle type, which equal() compares deeply.
+    return ((uint64_t)t.code() << 24) | ((uint64_t)t.bits() << 16) | (uint64_t)t.lanes();
+}
+
+uint64_t hash_double(double d) {
+    // equal() treats 0.0 and -0.0 as equal, and all NaNs as equal to
+    // each other, so they must hash the same.
+    if (d == 0) {
+        return 0;
+    } else if (std::isnan(d)) {
+        return 1;
+    }
+    return reinterpret_bits<uint64_t>(d);
+}
+
+bool same_exprs(const vector<Expr> &a, const vector<Expr> &b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (!a[i].same_as(b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename T>
+bool same_binary_op(const IRNode *a, const IRNode *b) {
+    const T *x = (const T *)a;
+    const T *y = (const T *)b;
+    return x->a.same_as(y->a) && x->b.same_as(y->b);
+}
+
+// Compare two nodes whose children are canonical, in every field.
+bool shallow_equal(const IRNode *a, const IRNode *b) {
+    if (a->node_type != b->node_type) {
+        return false;
+    }
+    const BaseExprNode *ea = (const BaseExprNode *)a;
+    const BaseExprNode *eb = (const BaseExprNode *)b;
+    if (!(ea->type == eb->type)) {
+        return false;
+    }
+    switch (a->node_type) {
+    case IRNodeType::IntImm:
+        return ((const IntImm *)a)->value == ((const IntImm *)b)->value;
+    case IRNodeType::UIntImm:
+        return ((const UIntImm *)a)->value == ((const UIntImm *)b)->value;
+    case IRNodeType::FloatImm: {
+        // Compare the bits, so that 0.0 and -0.0 stay distinct.
+        double x = ((const FloatImm *)a)->value, y = ((const FloatImm *)b)->value;
+        return reinterpret_bits<uint64_t>(x) == reinterpret_bits<uint64_t>(y);
+    }
+    case IRNodeType::StringImm:
+        return ((const StringImm *)a)->value == ((const StringImm *)b)->value;
+    case IRNodeType::Cast:
+        return ((const Cast *)a)->value.same_as(((const Cast *)b)->value);
+    case IRNodeType::Variable: {
+        const Variable *x = (const Variable *)a, *y = (const Variable *)b;
+        return (x->name == y->name &&
+                x->param.same_as(y->param) &&
+                x->image.get() == y->image.get() &&
+                x->reduction_domain.same_as(y->reduction_domain));
+    }
+    case IRNodeType::Add: return same_binary_op<Add>(a, b);
+    case IRNodeType::Sub: return same_binary_op<Sub>(a, b);
+    case IRNodeType::Mul: return same_binary_op<Mul>(a, b);
+    case IRNodeType::Div: return same_binary_op<Div>(a, b);
+    case IRNodeType::Mod: return same_binary_op<Mod>(a, b);
+    case IRNodeType::Min: return same_binary_op<Min>(a, b);
+    case IRNodeType::Max: return same_binary_op<Max>(a, b);
+    case IRNodeType::EQ: return same_binary_op<EQ>(a, b);
+    case IRNodeType::NE: return same_binary_op<NE>(a, b);
+    case IRNodeType::LT: return same_binary_op<LT>(a, b);
+    case IRNodeType::LE: return same_binary_op<LE>(a, b);
+    case IRNodeType::GT: return same_binary_op<GT>(a, b);
+    case IRNodeType::GE: return same_binary_op<GE>(a, b);
+    case IRNodeType::And: return same_binary_op<And>(a, b);
+    case IRNodeType::Or: return same_binary_op<Or>(a, b);
+    case IRNodeType::Not:
+        return ((const Not *)a)->a.same_as(((const Not *)b)->a);
+    case IRNodeType::Select: {
+        const Select *x = (const Select *)a, *y = (const Select *)b;
+        return (x->condition.same_as(y->condition) &&
+                x->true_value.same_as(y->true_value) &&
+                x->false_value.same_as(y->false_value));
+    }
+    case IRNodeType::Load: {
+        const Load *x = (const Load *)a, *y = (const Load *)b;
+        return (x->name == y->name &&
+                x->predicate.same_as(y->predicate) &&
+                x->index.same_as(y->index) &&
+                x->image.get() == y->image.get() &&
+                x->param.same_as(y->param));
+    }
+    case IRNodeType::Ramp: {
+        const Ramp *x = (const Ramp *)a, *y = (const Ramp *)b;
+        return x->base.same_as(y->base) && x->stride.same_as(y->stride);
+    }
+    case IRNodeType::Broadcast:
+        return ((const Broadcast *)a)->value.same_as(((const Broadcast *)b)->value);
+    case IRNodeType::Call: {
+        const Call *x = (const Call *)a, *y = (const Call *)b;
+        return (x->name == y->name &&
+                x->call_type == y->call_type &&
+                x->value_index == y->value_index &&
+                x->func.same_as(y->func) &&
+                x->image.get() == y->image.get() &&
+                x->param.same_as(y->param) &&
+                same_exprs(x->args, y->args));
+    }
+    case IRNodeType::Let: {
+        const Let *x = (const Let *)a, *y = (const Let *)b;
+        return (x->name == y->name &&
+                x->value.same_as(y->value) &&
+                x->body.same_as(y->body));
+    }
+    case IRNodeType::Shuffle: {
+        const Shuffle *x = (const Shuffle *)a, *y = (const Shuffle *)b;
+        return x->indices == y->indices && same_exprs(x->vectors, y->vectors);
+    }
+    case IRNodeType::VectorReduce: {
+        const VectorReduce *x = (const VectorReduce *)a, *y = (const VectorReduce *)b;
+        return x->op == y->op && x->value.same_as(y->value);
+    }
+    default:
+        internal_error << "Can't intern a Stmt\n";
+        return false;
+    }
+}
+
+thread_local ExprInterner *current_interner = nullptr;
+
+bool interning_enabled() {
+    static bool enabled = get_env_variable("HL_INTERN_EXPRS") == "1";
+    return enabled;
+}
+
+bool interning_override_set = false;
+bool interning_override = false;
+
+}  // namespace
+
+// Rebuild an Expr bottom-up out of canonical nodes.
+class InternExprs : public IRMutator2 {
+    ExprInterner &interner;
+
+    // The canonical node for each node of the Expr being interned
+    // that has been visited already. The Expr keeps its nodes alive.
+    map<const IRNode *, Expr> memo;
+
+public:
+    InternExprs(ExprInterner &i) : interner(i) {}
+
+    using IRMutator2::mutate;
+
+    Expr mutate(const Expr &e) override {
+        if (!e.defined() || interner.contains(e)) {
+            return e;
+        }
+        auto it = memo.find(e.get());
+        if (it != memo.end()) {
+            return it->second;
+        }
+        Expr canonical = interner.insert(IRMutator2::mutate(e));
+        memo[e.get()] = canonical;
+        return canonical;
+    }
+};
+
+ExprInterner::ExprInterner() : collect_threshold(1024) {
+    // Code compares against these by identity, so they must be the
+    // canonical nodes for their values.
+    insert(Interval::pos_inf);
+    insert(Interval::neg_inf);
+}
+
+ExprInterner::~ExprInterner() {}
+
+Expr ExprInterner::intern(const Expr &e) {
+    if (!e.defined() || contains(e)) {
+        return e;
+    }
+    if (entries.size() >= collect_threshold) {
+        collect();
+        collect_threshold = std::max((size_t)1024, entries.size() * 2);
+    }
+    return InternExprs(*this).mutate(e);
+}
+
+namespace {
+class InternStmtExprs : public IRMutator2 {
+    ExprInterner &interner;
+
+public:
+    InternStmtExprs(ExprInterner &i) : interner(i) {}
+
+    using IRMutator2::mutate;
+
+    Expr mutate(const Expr &e) override {
+        return interner.intern(e);
+    }
+};
+}  // namespace
+
+Stmt ExprInterner::intern(const Stmt &s) {
+    return InternStmtExprs(*this).mutate(s);
+}
+
+bool ExprInterner::contains(const Expr &e) const {
+    return index.count(e.get()) != 0;
+}
+
+uint64_t ExprInterner::hash(const Expr &e) const {
+    auto it = index.find(e.get());
+    internal_assert(it != index.end()) << "Expr is not interned: " << e << "\n";
+    return entries[it->second].hash;
+}
+
+size_t ExprInterner::size() const {
+    return entries.size();
+}
+
+Expr ExprInterner::insert(const Expr &e) {
+    // Hash the fields equal() compares, and the hashes of the
+    // (canonical) children.
+    uint64_t h = mix((uint64_t)e->node_type, hash_type(e.type()));
+    auto child = [&](const Expr &c) {
+        h = mix(h, c.defined() ? hash(c) : 0);
+    };
+    auto children = [&](const vector<Expr> &v) {
+        h = mix(h, v.size());
+        for (const Expr &c : v) {
+            child(c);
+        }
+    };
+
+    switch (e->node_type) {
+    case IRNodeType::IntImm:
+        h = mix(h, (uint64_t)e.as<IntImm>()->value);
+        break;
+    case IRNodeType::UIntImm:
+        h = mix(h, e.as<UIntImm>()->value);
+        break;
+    case IRNodeType::FloatImm:
+        h = mix(h, hash_double(e.as<FloatImm>()->value));
+        break;
+    case IRNodeType::StringImm:
+        h = mix(h, hash_string(e.as<StringImm>()->value));
+        break;
+    case IRNodeType::Cast:
+        child(e.as<Cast>()->value);
+        break;
+    case IRNodeType::Variable:
+        h = mix(h, hash_string(e.as<Variable>()->name));
+        break;
+#define HASH_BINARY_OP(T)                       \
+    case IRNodeType::T: {                       \
+        const T *op = e.as<T>();                \
+        child(op->a);                           \
+        child(op->b);                           \
+        break;                                  \
+    }
+    HASH_BINARY_OP(Add)
+    HASH_BINARY_OP(Sub)
+    HASH_BINARY_OP(Mul)
+    HASH_BINARY_OP(Div)
+    HASH_BINARY_OP(Mod)
+    HASH_BINARY_OP(Min)
+    HASH_BINARY_OP(Max)
+    HASH_BINARY_OP(EQ)
+    HASH_BINARY_OP(NE)
+    HASH_BINARY_OP(LT)
+    HASH_BINARY_OP(LE)
+    HASH_BINARY_OP(GT)
+    HASH_BINARY_OP(GE)
+    HASH_BINARY_OP(And)
+    HASH_BINARY_OP(Or)
+#undef HASH_BINARY_OP
+    case IRNodeType::Not:
+        child(e.as<Not>()->a);
+        break;
+    case IRNodeType::Select: {
+        const Select *op = e.as<Select>();
+        child(op->condition);
+        child(op->true_value);
+        child(op->false_value);
+        break;
+    }
+    case IRNodeType::Load: {
+        const Load *op = e.as<Load>();
+        h = mix(h, hash_string(op->name));
+        child(op->predicate);
+        child(op->index);
+        break;
+    }
+    case IRNodeType::Ramp: {
+        const Ramp *op = e.as<Ramp>();
+        child(op->base);
+        child(op->stride);
+        break;
+    }
+    case IRNodeType::Broadcast:
+        child(e.as<Broadcast>()->value);
+        break;
+    case IRNodeType::Call: {
+        const Call *op = e.as<Call>();
+        h = mix(h, hash_string(op->name));
+        h = mix(h, (uint64_t)op->call_type);
+        h = mix(h, (uint64_t)op->value_index);
+        children(op->args);
+        break;
+    }
+    case IRNodeType::Let: {
+        const Let *op = e.as<Let>();
+        h = mix(h, hash_string(op->name));
+        child(op->value);
+        child(op->body);
+        break;
+    }
+    case IRNodeType::Shuffle: {
+        const Shuffle *op = e.as<Shuffle>();
+        children(op->vectors);
+        for (int i : op->indices) {
+            h = mix(h, (uint64_t)i);
+        }
+        break;
+    }
+    case IRNodeType::VectorReduce: {
+        const VectorReduce *op = e.as<VectorReduce>();
+        h = mix(h, (uint64_t)op->op);
+        child(op->value);
+        break;
+    }
+    default:
+        internal_error << "Can't intern a Stmt\n";
+    }
+
+    auto range = buckets.equal_range(h);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (shallow_equal(it->second, e.get())) {
+            return Expr((const BaseExprNode *)it->second);
+        }
+    }
+
+    index[e.get()] = entries.size();
+    buckets.emplace(h, e.get());
+    entries.push_back({e, h});
+    return e;
+}
+
+void ExprInterner::collect() {
+    // Parents come after their children, so walking backwards frees
+    // a parent before we look at its children.
+    vector<bool> keep(entries.size(), true);
+    for (size_t i = entries.size(); i > 0; i--) {
+        Entry &entry = entries[i - 1];
+        if (entry.expr->ref_count.is_one()) {
+            keep[i - 1] = false;
+            index.erase(entry.expr.get());
+            entry.expr = Expr();
+        }
+    }
+
+    vector<Entry> kept;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (keep[i]) {
+            kept.push_back(entries[i]);
+        }
+    }
+    entries.swap(kept);
+
+    index.clear();
+    buckets.clear();
+    for (size_t i = 0; i < entries.size(); i++) {
+        index[entries[i].expr.get()] = i;
+        buckets.emplace(entries[i].hash, entries[i].expr.get());
+    }
+    debug(3) << "Expr interner holds " << entries.size() << " nodes after collection\n";
+}
+
+ExprInterner *active_expr_interner() {
+    return current_interner;
+}
+
+ScopedExprInterning::ScopedExprInterning() : old_interner(current_interner) {
+    if (expr_interning_enabled()) {
+        interner.reset(new ExprInterner);
+        current_interner = interner.get();
+    }
+}
+
+ScopedExprInterning::~ScopedExprInterning() {
+    current_interner = old_interner;
+}
+
+void set_expr_interning(bool enabled) {
+    interning_override_set = true;
+    interning_override = enabled;
+}
+
+bool expr_interning_enabled() {
+    return interning_override_set ? interning_override : interning_enabled();
+}
+
+void expr_interner_test() {
+    ExprInterner interner;
+    Expr x = Variable::make(Int(32), "x");
+    Expr y = Variable::make(Int(32), "y");
+
+    Expr a = interner.intern((x + y) * (x + y));
+    Expr b = interner.intern((x + y) * (x + y));
+    internal_assert(a.same_as(b)) << "Equal Exprs should intern to the same node\n";
+    const Mul *m = a.as<Mul>();
+    internal_assert(m && m->a.same_as(m->b)) << "Equal children should share a node\n";
+    internal_assert(!interner.intern(x + y + 1).same_as(interner.intern(x + y + 2)));
+
+    // 0.0 and -0.0 are equal() but must not be merged.
+    Expr pz = interner.intern(make_const(Float(32), 0.0));
+    Expr nz = interner.intern(make_const(Float(32), -0.0));
+    internal_assert(!pz.same_as(nz) && interner.hash(pz) == interner.hash(nz));
+
+    // Interning a DAG that is exponentially large as a tree should be fast.
+    Expr e1 = x, e2 = x;
+    for (int i = 0; i < 100; i++) {
+        e1 = e1 * e1 + e1;
+        e2 = e2 * e2 + e2;
+    }
+    internal_assert(interner.intern(e1).same_as(interner.intern(e2)));
+
+    // Nodes nothing else refers to are dropped.
+    a = b = e1 = e2 = Expr();
+    m = nullptr;
+    size_t before = interner.size();
+    interner.collect();
+    internal_assert(interner.size() < before);
+
+    {
+        set_expr_interning(true);
+        ScopedExprInterning interning;
+        ExprInterner *i = active_expr_interner();
+        internal_assert(i);
+        Expr c = i->intern(x * 2 + y);
+        Expr d = i->intern(x * 2 + y);
+        Expr f = i->intern(x * 2 + y + 1);
+        internal_assert(equal(c, d) && !equal(c, f));
+        set_expr_interning(false);
+    }
+    internal_assert(!active_expr_interner());
+
+    debug(0) << "expr_interner_test passed\n";
+}
+
+}  // namespace Internal
+}  // namespace Halide
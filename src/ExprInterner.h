@@ -0,0 +1,107 @@
+#ifndef HALIDE_EXPR_INTERNER_H
+#define HALIDE_EXPR_INTERNER_H
+
+/** \file
+ * Defines a hash-consing table for Exprs, in which structurally equal
+ * Exprs share a single node.
+ */
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Expr.h"
+
+namespace Halide {
+namespace Internal {
+
+/** A table of Exprs in which each distinct Expr is represented by a
+ * single node (its canonical node). The children of a canonical node
+ * are canonical too, so two interned Exprs are structurally equal
+ * iff they are the same node. Each canonical node has a structural
+ * hash, which is equal for any two Exprs that equal() considers
+ * equal.
+ *
+ * Two Exprs are only merged if they match in every field, including
+ * the ones equal() ignores (e.g. the Parameter a Variable refers
+ * to), so interning never changes the meaning of an Expr. */
+class ExprInterner {
+public:
+    ExprInterner();
+    ~ExprInterner();
+
+    /** Return the canonical node structurally equal to e, adding the
+     * nodes of e that have no equal canonical node to the table. Is
+     * linear in the number of distinct nodes of e that aren't already
+     * canonical, even if e is a DAG that is exponentially large as a
+     * tree. */
+    Expr intern(const Expr &e);
+
+    /** Intern every Expr in a Stmt. */
+    Stmt intern(const Stmt &s);
+
+    /** Check if an Expr is a canonical node of this table. */
+    bool contains(const Expr &e) const;
+
+    /** Get the structural hash of a canonical node. */
+    uint64_t hash(const Expr &e) const;
+
+    /** The number of canonical nodes. */
+    size_t size() const;
+
+    /** Drop the canonical nodes that are referenced by nothing but
+     * the table. This also happens automatically when the table
+     * doubles in size. */
+    void collect();
+
+private:
+    struct Entry {
+        Expr expr;
+        uint64_t hash;
+    };
+    // The canonical nodes in the order they were added, so that
+    // parents come after their children.
+    std::vector<Entry> entries;
+    // Maps a canonical node to its index in entries.
+    std::unordered_map<const IRNode *, size_t> index;
+    // Maps a structural hash to the canonical nodes with that hash.
+    std::unordered_multimap<uint64_t, const IRNode *> buckets;
+    size_t collect_threshold;
+
+    friend class InternExprs;
+    Expr insert(const Expr &e);
+};
+
+/** Get the ExprInterner installed for the current thread by a
+ * ScopedExprInterning, or nullptr if there isn't one. When there is,
+ * simplify and bounds inference intern their results, and equal()
+ * compares two canonical nodes in constant time. */
+ExprInterner *active_expr_interner();
+
+/** Install a fresh ExprInterner for the current thread for the
+ * lifetime of this object, if interning is enabled (see
+ * set_expr_interning). lower() uses one for the whole of lowering. */
+class ScopedExprInterning {
+    std::unique_ptr<ExprInterner> interner;
+    ExprInterner *old_interner;
+public:
+    ScopedExprInterning();
+    ~ScopedExprInterning();
+};
+
+/** Enable or disable interning the Exprs made during lowering. This
+ * shares equal subexpressions of the lowered code, and makes equality
+ * tests between them cheap, at the cost of hashing each new Expr made
+ * by the simplifier and bounds inference. Off by default, unless the
+ * environment variable HL_INTERN_EXPRS is set to 1. */
+// @{
+void set_expr_interning(bool enabled);
+bool expr_interning_enabled();
+// @}
+
+void expr_interner_test();
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
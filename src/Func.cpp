@@ -289,8 +289,11 @@ void Stage::set_dim_type(VarOrRVar var, ForType t) {
             dims[i].for_type = t;
 
             // If it's an rvar and the for type is parallel, we need to
-            // validate that this doesn't introduce a race condition.
-            if (!dims[i].is_pure() && var.is_rvar &&
+            // validate that this doesn't introduce a race condition,
+            // unless the updates are atomic.
+            bool atomic = (definition.schedule().atomic() &&
+                           (t == ForType::Vectorized || t == ForType::Parallel));
+            if (!dims[i].is_pure() && var.is_rvar && !atomic &&
                 (t == ForType::Vectorized || t == ForType::Parallel ||
                  t == ForType::GPUBlock || t == ForType::GPUThread ||
                  t == ForType::GPULane)) {
@@ -299,6 +302,8 @@ void Stage::set_dim_type(VarOrRVar var, ForType t) {
                     << ", marking var " << var.name()
                     << " as parallel or vectorized may introduce a race"
                     << " condition resulting in incorrect output."
+                    << " If the update is associative and commutative, such"
+                    << " as a histogram, call atomic() first."
                     << " It is possible to override this error using"
                     << " the allow_race_conditions() method. Use this"
                     << " with great caution, and only when you are willing"
@@ -1405,6 +1410,74 @@ Stage &Stage::allow_race_conditions() {
     return *this;
 }
 
+namespace Internal {
+// Find calls to a Func at a site other than the given one.
+class FindCallsAtOtherSites : public IRGraphVisitor {
+    const string &func;
+    const vector<Expr> &site;
+public:
+    Expr other_call;
+
+    FindCallsAtOtherSites(const string &func, const vector<Expr> &site)
+        : func(func), site(site) {}
+
+protected:
+    using IRGraphVisitor::visit;
+    void visit(const Call *op) {
+        IRGraphVisitor::visit(op);
+        if (op->call_type != Call::Halide || op->name != func) {
+            return;
+        }
+        bool same_site = op->args.size() == site.size();
+        for (size_t i = 0; same_site && i < site.size(); i++) {
+            same_site = equal(op->args[i], site[i]);
+        }
+        if (!same_site) {
+            other_call = op;
+        }
+    }
+};
+}
+
+Stage &Stage::atomic(bool override_associativity_test) {
+    user_assert(!definition.is_init())
+        << "atomic() must be called on an update definition\n";
+    user_assert(definition.values().size() == 1)
+        << "In schedule for " << name()
+        << ", can't make the update atomic since it is a Tuple\n";
+    Type t = definition.values()[0].type();
+    user_assert(!t.is_bool() && !t.is_handle())
+        << "In schedule for " << name()
+        << ", can't make an update of type " << t << " atomic\n";
+
+    // Each update is done by an atomic read-modify-write of the site it
+    // stores to, so it can't read any other site of the same Func, even
+    // if the associativity test is overridden.
+    Internal::FindCallsAtOtherSites check(function.name(), definition.args());
+    definition.values()[0].accept(&check);
+    user_assert(!check.other_call.defined())
+        << "In schedule for " << name()
+        << ", can't make the update atomic since it reads " << check.other_call
+        << ", which is not the site it updates. Atomic updates can only read"
+        << " the value they replace.\n";
+
+    if (!override_associativity_test) {
+        // The updates will be applied in any order, so the operator
+        // must be commutative as well as associative.
+        const auto &prover_result = prove_associativity(function.name(), definition.args(),
+                                                        definition.values());
+        user_assert(prover_result.associative() && prover_result.commutative())
+            << "In schedule for " << name()
+            << ", can't make the update atomic since it can't prove that the"
+            << " operator is associative and commutative. It is possible to"
+            << " override this error by calling atomic(true), if you can prove"
+            << " that applying the updates in any order gives the same result.\n";
+    }
+
+    definition.schedule().atomic() = true;
+    return *this;
+}
+
 Stage &Stage::serial(VarOrRVar var) {
     set_dim_type(var, ForType::Serial);
     return *this;
@@ -1979,6 +2052,12 @@ Func &Func::memoize() {
     return *this;
 }
 
+Func &Func::async() {
+    invalidate_cache();
+    func.schedule().async() = true;
+    return *this;
+}
+
 Func &Func::store_in(MemoryType t) {
     invalidate_cache();
     func.schedule().memory_type() = t;
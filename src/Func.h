@@ -395,6 +395,29 @@ public:
 
     Stage &allow_race_conditions();
 
+    /** Apply each update of this stage as a single atomic
+     * read-modify-write of the value it updates, so that its loops
+     * over RVars can be marked parallel or vectorized without a race
+     * condition, and without the intermediate Funcs of rfactor(). For
+     * example, a parallel histogram:
+     \code
+     Func hist;
+     RDom r(input);
+     hist(x) = 0;
+     hist(clamp(input(r.x, r.y), 0, 255)) += 1;
+     hist.update().atomic().parallel(r.y);
+     \endcode
+     * Call atomic() before parallel() or vectorize(). The update must
+     * be single-valued, and associative and commutative, which is
+     * checked as in rfactor(), unless override_associativity_test is
+     * true. Integer additions, subtractions, mins, and maxes become a
+     * single atomic instruction. Other updates, including all
+     * floating-point ones, retry a compare-and-swap until no other
+     * thread changed the value in between, so they are slower under
+     * contention. Atomic updates are not supported inside GPU
+     * kernels. */
+    Stage &atomic(bool override_associativity_test = false);
+
     Stage &hexagon(VarOrRVar x = Var::outermost());
     Stage &prefetch(const Func &f, VarOrRVar var, Expr offset = 1,
                            PrefetchBoundStrategy strategy = PrefetchBoundStrategy::GuardWithIf);
@@ -2092,6 +2115,20 @@ public:
      */
     Func &memoize();
 
+    /** Produce this Func asynchronously in a separate task, which
+     * can run concurrently with its consumers. The producer is split
+     * out of the loop nest of its consumers and signals them through
+     * a semaphore each time it finishes a realization. If the
+     * storage of the Func is folded (see Func::fold_storage), the
+     * folded buffer becomes a ring buffer: the producer waits for the
+     * consumer to release the rows it no longer needs before
+     * overwriting them. This is useful for overlapping stages of
+     * streaming pipelines whose parallel loops are too short to fill
+     * the machine. The Func may not depend on other Funcs that are
+     * computed within its consumer's loop nest.
+     */
+    Func &async();
+
 
     /** Allocate storage for this function within f's loop over
      * var. Scheduling storage is optional, and can be used to
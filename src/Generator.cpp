@@ -975,7 +975,9 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
                     return gen->build_module(name);
                 };
             if (targets.size() > 1 || !emit_options.substitutions.empty()) {
-                compile_multitarget(function_name, output_files, targets, module_producer, emit_options.substitutions);
+                // Each call makes its own Generator, so the targets can be lowered in parallel.
+                compile_multitarget(function_name, output_files, targets, module_producer, emit_options.substitutions,
+                                    /* module_producer_is_thread_safe */ true);
             } else {
                 user_assert(emit_options.substitutions.empty()) << "substitutions not supported for single-target";
                 // compile_multitarget() will fail if we request anything but library and/or header,
@@ -931,6 +931,12 @@ Stmt inject_hexagon_rpc(Stmt s, const Target &host_target,
             target = target.with_feature(i);
         }
     }
+    // Hardware counters and timelines are only recorded on the host,
+    // but the device code is still profiled.
+    if (host_target.has_feature(Target::ProfileCounters) ||
+        host_target.has_feature(Target::ProfileTimeline)) {
+        target = target.with_feature(Target::Profile);
+    }
 
     Module shared_runtime(runtime_module_name, target);
     Module hexagon_module(pipeline_module_name, target.with_feature(Target::NoRuntime));
@@ -488,6 +488,15 @@ Stmt Prefetch::make(const std::string &name, const std::vector<Type> &types,
     return node;
 }
 
+Stmt Atomic::make(const std::string &producer_name, Stmt body) {
+    internal_assert(body.defined()) << "Atomic of undefined\n";
+
+    Atomic *node = new Atomic;
+    node->producer_name = producer_name;
+    node->body = std::move(body);
+    return node;
+}
+
 Stmt Block::make(Stmt first, Stmt rest) {
     internal_assert(first.defined()) << "Block of undefined\n";
     internal_assert(rest.defined()) << "Block of undefined\n";
@@ -744,6 +753,27 @@ bool Shuffle::is_extract_element() const {
     return indices.size() == 1;
 }
 
+Expr VectorReduce::make(VectorReduce::Operator op,
+                        Expr vec,
+                        int lanes) {
+    internal_assert(vec.defined()) << "VectorReduce of undefined\n";
+    internal_assert(lanes > 0) << "VectorReduce must produce at least one lane\n";
+    if (vec.type().is_bool()) {
+        internal_assert(op == VectorReduce::And || op == VectorReduce::Or)
+            << "The only legal operators for VectorReduce on a Bool "
+            << "vector are And and Or\n";
+    }
+    internal_assert(vec.type().lanes() % lanes == 0)
+        << "Output lanes of VectorReduce must divide input lanes: "
+        << lanes << " does not divide " << vec.type().lanes() << "\n";
+
+    VectorReduce *node = new VectorReduce;
+    node->type = vec.type().with_lanes(lanes);
+    node->op = op;
+    node->value = std::move(vec);
+    return node;
+}
+
 
 template<> void ExprNode<IntImm>::accept(IRVisitor *v) const { v->visit((const IntImm *)this); }
 template<> void ExprNode<UIntImm>::accept(IRVisitor *v) const { v->visit((const UIntImm *)this); }
@@ -773,6 +803,7 @@ template<> void ExprNode<Ramp>::accept(IRVisitor *v) const { v->visit((const Ram
 template<> void ExprNode<Broadcast>::accept(IRVisitor *v) const { v->visit((const Broadcast *)this); }
 template<> void ExprNode<Call>::accept(IRVisitor *v) const { v->visit((const Call *)this); }
 template<> void ExprNode<Shuffle>::accept(IRVisitor *v) const { v->visit((const Shuffle *)this); }
+template<> void ExprNode<VectorReduce>::accept(IRVisitor *v) const { v->visit((const VectorReduce *)this); }
 template<> void ExprNode<Let>::accept(IRVisitor *v) const { v->visit((const Let *)this); }
 template<> void StmtNode<LetStmt>::accept(IRVisitor *v) const { v->visit((const LetStmt *)this); }
 template<> void StmtNode<AssertStmt>::accept(IRVisitor *v) const { v->visit((const AssertStmt *)this); }
@@ -787,6 +818,7 @@ template<> void StmtNode<Block>::accept(IRVisitor *v) const { v->visit((const Bl
 template<> void StmtNode<IfThenElse>::accept(IRVisitor *v) const { v->visit((const IfThenElse *)this); }
 template<> void StmtNode<Evaluate>::accept(IRVisitor *v) const { v->visit((const Evaluate *)this); }
 template<> void StmtNode<Prefetch>::accept(IRVisitor *v) const { v->visit((const Prefetch *)this); }
+template<> void StmtNode<Atomic>::accept(IRVisitor *v) const { v->visit((const Atomic *)this); }
 
 template<> Expr ExprNode<IntImm>::mutate_expr(IRMutator2 *v) const { return v->visit((const IntImm *)this); }
 template<> Expr ExprNode<UIntImm>::mutate_expr(IRMutator2 *v) const { return v->visit((const UIntImm *)this); }
@@ -816,6 +848,7 @@ template<> Expr ExprNode<Ramp>::mutate_expr(IRMutator2 *v) const { return v->vis
 template<> Expr ExprNode<Broadcast>::mutate_expr(IRMutator2 *v) const { return v->visit((const Broadcast *)this); }
 template<> Expr ExprNode<Call>::mutate_expr(IRMutator2 *v) const { return v->visit((const Call *)this); }
 template<> Expr ExprNode<Shuffle>::mutate_expr(IRMutator2 *v) const { return v->visit((const Shuffle *)this); }
+template<> Expr ExprNode<VectorReduce>::mutate_expr(IRMutator2 *v) const { return v->visit((const VectorReduce *)this); }
 template<> Expr ExprNode<Let>::mutate_expr(IRMutator2 *v) const { return v->visit((const Let *)this); }
 
 template<> Stmt StmtNode<LetStmt>::mutate_stmt(IRMutator2 *v) const { return v->visit((const LetStmt *)this); }
@@ -831,6 +864,7 @@ template<> Stmt StmtNode<Block>::mutate_stmt(IRMutator2 *v) const { return v->vi
 template<> Stmt StmtNode<IfThenElse>::mutate_stmt(IRMutator2 *v) const { return v->visit((const IfThenElse *)this); }
 template<> Stmt StmtNode<Evaluate>::mutate_stmt(IRMutator2 *v) const { return v->visit((const Evaluate *)this); }
 template<> Stmt StmtNode<Prefetch>::mutate_stmt(IRMutator2 *v) const { return v->visit((const Prefetch *)this); }
+template<> Stmt StmtNode<Atomic>::mutate_stmt(IRMutator2 *v) const { return v->visit((const Atomic *)this); }
 
 
 Call::ConstString Call::debug_to_file = "debug_to_file";
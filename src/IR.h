@@ -730,6 +730,33 @@ struct Shuffle : public ExprNode<Shuffle> {
     static const IRNodeType _node_type = IRNodeType::Shuffle;
 };
 
+/** Horizontally reduce a vector to a scalar or narrower vector using
+ * the given commutative and associative binary operator. The reduction
+ * factor is dictated by the number of lanes in the input and output
+ * types. Groups of adjacent lanes are combined. The number of lanes in
+ * the output type must be a divisor of the number of lanes of the input
+ * type. */
+struct VectorReduce : public ExprNode<VectorReduce> {
+    // 99.9% of the time people will use this for horizontal addition,
+    // but these are all of our commutative and associative primitive
+    // operators.
+    typedef enum {
+        Add,
+        Mul,
+        Min,
+        Max,
+        And,
+        Or,
+    } Operator;
+
+    Expr value;
+    Operator op;
+
+    static Expr make(Operator op, Expr vec, int lanes);
+
+    static const IRNodeType _node_type = IRNodeType::VectorReduce;
+};
+
 /** Represent a multi-dimensional region of a Func or an ImageParam that
  * needs to be prefetched. */
 struct Prefetch : public StmtNode<Prefetch> {
@@ -749,6 +776,19 @@ struct Prefetch : public StmtNode<Prefetch> {
     static const IRNodeType _node_type = IRNodeType::Prefetch;
 };
 
+/** Apply each store to the buffer called 'producer_name' in the body as
+ * a single atomic read-modify-write, so that the stores of parallel
+ * iterations to the same location don't race. Only the location being
+ * stored to may be loaded from that buffer in the stored value. */
+struct Atomic : public StmtNode<Atomic> {
+    std::string producer_name;
+    Stmt body;
+
+    static Stmt make(const std::string &producer_name, Stmt body);
+
+    static const IRNodeType _node_type = IRNodeType::Atomic;
+};
+
 }  // namespace Internal
 }  // namespace Halide
 
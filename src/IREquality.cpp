@@ -1,4 +1,5 @@
 #include "IREquality.h"
+#include "ExprInterner.h"
 #include "IROperator.h"
 #include "IRVisitor.h"
 
@@ -89,7 +90,9 @@ private:
     void visit(const IfThenElse *);
     void visit(const Evaluate *);
     void visit(const Shuffle *);
+    void visit(const VectorReduce *);
     void visit(const Prefetch *);
+    void visit(const Atomic *);
 };
 
 template<typename T>
@@ -130,12 +133,6 @@ IRComparer::CmpResult IRComparer::compare_expr(const Expr &a, const Expr &b) {
         return result;
     }
 
-    // If in the future we have hashes for Exprs, this is a good place
-    // to compare the hashes:
-    // if (compare_scalar(a.hash(), b.hash()) != Equal) {
-    //   return result;
-    // }
-
     if (compare_scalar(a->node_type, b->node_type) != Equal) {
         return result;
     }
@@ -510,6 +507,14 @@ void IRComparer::visit(const Shuffle *op) {
     }
 }
 
+void IRComparer::visit(const VectorReduce *op) {
+    const VectorReduce *e = expr.as<VectorReduce>();
+
+    compare_scalar(e->op, op->op);
+    // We've already compared types, so it's enough to compare the value
+    compare_expr(e->value, op->value);
+}
+
 void IRComparer::visit(const Prefetch *op) {
     const Prefetch *s = stmt.as<Prefetch>();
 
@@ -527,11 +532,26 @@ void IRComparer::visit(const Prefetch *op) {
     compare_stmt(s->body, op->body);
 }
 
+void IRComparer::visit(const Atomic *op) {
+    const Atomic *s = stmt.as<Atomic>();
+
+    compare_names(s->producer_name, op->producer_name);
+    compare_stmt(s->body, op->body);
+}
+
 } // namespace
 
 
 // Now the methods exposed in the header.
 bool equal(const Expr &a, const Expr &b) {
+    // Canonical nodes with different hashes can't be equal.
+    if (ExprInterner *interner = active_expr_interner()) {
+        if (a.defined() && b.defined() && !a.same_as(b) &&
+            interner->contains(a) && interner->contains(b) &&
+            interner->hash(a) != interner->hash(b)) {
+            return false;
+        }
+    }
     return IRComparer().compare_expr(a, b) == IRComparer::Equal;
 }
 
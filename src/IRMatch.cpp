@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <map>
 
@@ -5,6 +7,7 @@
 #include "IRMatch.h"
 #include "IROperator.h"
 #include "IRVisitor.h"
+#include "Simplify.h"
 
 namespace Halide {
 namespace Internal {
@@ -13,6 +16,83 @@ using std::map;
 using std::string;
 using std::vector;
 
+namespace IRMatcher {
+
+bool is_foldable_const(const BaseExprNode *e) {
+    switch (e->node_type) {
+    case IRNodeType::IntImm:
+    case IRNodeType::UIntImm:
+        return true;
+    case IRNodeType::FloatImm:
+        // NaN doesn't obey the equalities the simplifier assumes
+        return !std::isnan(static_cast<const FloatImm *>(e)->value);
+    case IRNodeType::Broadcast:
+        return is_foldable_const(node_of(static_cast<const Broadcast *>(e)->value));
+    default:
+        return false;
+    }
+}
+
+bool is_const_value(const BaseExprNode *e, int64_t value) {
+    return is_const(Expr(e), value);
+}
+
+bool fold_binary_op(IRNodeType op, int64_t a, int64_t b, int64_t *result) {
+    switch (op) {
+    case IRNodeType::Add:
+        *result = a + b;
+        return true;
+    case IRNodeType::Sub:
+        *result = a - b;
+        return true;
+    case IRNodeType::Mul:
+        *result = a * b;
+        return true;
+    case IRNodeType::Div:
+        if (b == 0) return false;
+        *result = div_imp(a, b);
+        return true;
+    case IRNodeType::Mod:
+        if (b == 0) return false;
+        *result = mod_imp(a, b);
+        return true;
+    case IRNodeType::Min:
+        *result = std::min(a, b);
+        return true;
+    case IRNodeType::Max:
+        *result = std::max(a, b);
+        return true;
+    case IRNodeType::EQ:
+        *result = a == b;
+        return true;
+    case IRNodeType::NE:
+        *result = a != b;
+        return true;
+    case IRNodeType::LT:
+        *result = a < b;
+        return true;
+    case IRNodeType::LE:
+        *result = a <= b;
+        return true;
+    case IRNodeType::GT:
+        *result = a > b;
+        return true;
+    case IRNodeType::GE:
+        *result = a >= b;
+        return true;
+    case IRNodeType::And:
+        *result = a && b;
+        return true;
+    case IRNodeType::Or:
+        *result = a || b;
+        return true;
+    default:
+        return false;
+    }
+}
+
+}  // namespace IRMatcher
+
 void expr_match_test() {
     vector<Expr> matches;
     Expr w = Variable::make(Int(32), "*");
@@ -46,6 +126,57 @@ void expr_match_test() {
 
     internal_assert(expr_match(vec_wild * 3, Ramp::make(x, y, 4) * 3, matches));
 
+    // Rewrite rules
+    {
+        IRMatcher::Wild<0> a;
+        IRMatcher::Wild<1> b;
+        IRMatcher::WildConst<0> c0;
+        IRMatcher::WildConst<1> c1;
+
+        Expr e = x + (y - x);
+        const Add *add = e.as<Add>();
+        IRMatcher::Rewriter<Add> rewrite(add, add->a, add->b);
+        internal_assert(!rewrite(a + (b - b), a));
+        internal_assert(rewrite(a + (b - a), b) && equal(rewrite.result, y));
+
+        e = (x + 3) + 5;
+        add = e.as<Add>();
+        IRMatcher::Rewriter<Add> rewrite2(add, add->a, add->b);
+        internal_assert(!rewrite2((a + c0) + c1, a + (c0 + c1), c0 + c1 == 7));
+        internal_assert(rewrite2((a + c0) + c1, a + (c0 + c1), c0 + c1 == 8) &&
+                        equal(rewrite2.result, x + (Expr(3) + 5)));
+
+        // Literals take on the type of the expression they're combined with.
+        Expr ux = Variable::make(UInt(16), "ux");
+        Expr uy = Variable::make(UInt(16), "uy");
+        e = ux - (uy + ux);
+        const Sub *sub = e.as<Sub>();
+        IRMatcher::Rewriter<Sub> rewrite3(sub, sub->a, sub->b);
+        internal_assert(rewrite3(a - (b + a), 0 - b) &&
+                        equal(rewrite3.result, make_zero(UInt(16)) - uy));
+
+        // Predicates on constants only hold for scalar ints.
+        e = Broadcast::make(x, 4) + Broadcast::make(3, 4);
+        add = e.as<Add>();
+        IRMatcher::Rewriter<Add> rewrite4(add, add->a, add->b);
+        internal_assert(!rewrite4(a + c0, a, c0 == 3));
+        internal_assert(rewrite4(a + c0, c0) && rewrite4.result.same_as(add->b));
+
+        // Selects match on all three operands, and a scalar condition
+        // can select between vectors.
+        IRMatcher::Wild<2> c;
+        IRMatcher::Wild<3> d;
+        Expr vx = Broadcast::make(x, 4), vy = Ramp::make(y, 1, 4);
+        e = Select::make(x != y, vx + vy, vy - vx);
+        const Select *sel = e.as<Select>();
+        IRMatcher::Rewriter<Select> rewrite5(sel, sel->condition, sel->true_value, sel->false_value);
+        internal_assert(!rewrite5(select(a <= b, c, d), select(b < a, d, c)));
+        internal_assert(rewrite5(select(a != b, c + d, d - c), select(a == b, d - c, c + d)) &&
+                        equal(rewrite5.result, Select::make(x == y, vy - vx, vx + vy)));
+        internal_assert(rewrite5(select(a, c + d, d - b), d + select(a, c, 0 - b)) &&
+                        equal(rewrite5.result, vy + Select::make(x != y, vx, make_zero(vx.type()) - vx)));
+    }
+
     std::cout << "expr_match test passed" << std::endl;
 }
 
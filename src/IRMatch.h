@@ -6,6 +6,8 @@
  */
 
 #include "IR.h"
+#include "IREquality.h"
+#include "IROperator.h"
 
 namespace Halide {
 namespace Internal {
@@ -43,6 +45,455 @@ bool expr_match(Expr pattern, Expr expr, std::vector<Expr> &result);
  */
 bool expr_match(Expr pattern, Expr expr, std::map<std::string, Expr> &result);
 
+/** A compiled term-rewriting engine for the simplifier. Rules are
+ * written as C++ expressions over wildcards, for example:
+ *
+ \code
+ IRMatcher::Wild<0> x;
+ IRMatcher::Wild<1> y;
+ IRMatcher::WildConst<0> c0;
+ IRMatcher::WildConst<1> c1;
+ IRMatcher::Rewriter<Add> rewrite(op, a, b);
+ if (rewrite((x + c0) + c1, x + (c0 + c1)) ||
+     rewrite((x - y) + y, x)) {
+     return rewrite.result;
+ }
+ \endcode
+ *
+ * Each side of a rule is a distinct C++ type, so the matcher and the
+ * builder for each rule are generated by the compiler rather than
+ * interpreted at runtime, and a pattern allocates nothing while it is
+ * being matched. Each pattern also carries a compile-time mask of the
+ * node types it can match. Rules are tried one at a time, in the order
+ * they are written, but the Rewriter computes the node type bits of
+ * the operands once per node, so rules whose shape doesn't fit the
+ * operands are rejected with a bitwise and or two, before any of the
+ * operands are inspected.
+ *
+ * A wildcard that appears more than once must match equal Exprs. A
+ * rule can be guarded by a predicate, which is a pattern over bound
+ * wildcards that is evaluated as a scalar integer expression (e.g. c0
+ * + c1 == 0), or one of the predicate functions below. Predicates
+ * over constants only hold if the constants are scalar IntImms.
+ */
+namespace IRMatcher {
+
+constexpr int max_wild = 6;
+
+/** The Exprs bound to wildcards while matching a rule. */
+struct MatcherState {
+    const BaseExprNode *bindings[max_wild];
+    const BaseExprNode *const_bindings[max_wild];
+    uint32_t bound, const_bound;
+
+    void reset() {
+        bound = const_bound = 0;
+    }
+};
+
+constexpr uint64_t node_bit(IRNodeType t) {
+    return (uint64_t)1 << (int)t;
+}
+
+constexpr uint64_t any_node_mask = ~(uint64_t)0;
+
+constexpr uint64_t const_node_mask =
+    node_bit(IRNodeType::IntImm) | node_bit(IRNodeType::UIntImm) |
+    node_bit(IRNodeType::FloatImm) | node_bit(IRNodeType::Broadcast);
+
+/** Check if a node is a constant the simplifier can fold: an IntImm,
+ * UIntImm, non-NaN FloatImm, or a Broadcast of one. */
+bool is_foldable_const(const BaseExprNode *e);
+
+/** Check if a node is a constant equal to the given value, in the
+ * same sense as Internal::is_const(e, value). */
+bool is_const_value(const BaseExprNode *e, int64_t value);
+
+/** Evaluate a binary operator on folded scalar integer constants
+ * the way Halide does. Returns false if the result is undefined. */
+bool fold_binary_op(IRNodeType op, int64_t a, int64_t b, int64_t *result);
+
+/** Check if two bound nodes match for the purposes of a repeated
+ * wildcard. */
+inline bool same_binding(const BaseExprNode *a, const BaseExprNode *b) {
+    return a == b || (a->node_type == b->node_type && equal(Expr(a), Expr(b)));
+}
+
+/** Get the value of a bound node, if it's a scalar IntImm. */
+inline bool fold_binding(const BaseExprNode *e, int64_t *value) {
+    if (e->node_type == IRNodeType::IntImm) {
+        *value = static_cast<const IntImm *>(e)->value;
+        return true;
+    }
+    return false;
+}
+
+inline const BaseExprNode *node_of(const Expr &e) {
+    return static_cast<const BaseExprNode *>(e.get());
+}
+
+/** Check if a pattern could match a node with the given node_bit,
+ * without looking at the node. */
+template<typename P>
+HALIDE_ALWAYS_INLINE bool could_match(uint64_t bit) {
+    return P::mask == any_node_mask || (P::mask & bit);
+}
+
+/** Match a child pattern, rejecting it by node type first. */
+template<typename P>
+HALIDE_ALWAYS_INLINE bool match_child(const P &p, const BaseExprNode *e, MatcherState &state) {
+    return (P::mask & node_bit(e->node_type)) && p.match(e, state);
+}
+
+/** A wildcard that matches any Expr. */
+template<int i>
+struct Wild {
+    static constexpr uint64_t mask = any_node_mask;
+    static constexpr bool is_literal = false;
+
+    HALIDE_ALWAYS_INLINE bool match(const BaseExprNode *e, MatcherState &state) const {
+        if (state.bound & (1 << i)) {
+            return same_binding(state.bindings[i], e);
+        }
+        state.bindings[i] = e;
+        state.bound |= (1 << i);
+        return true;
+    }
+
+    Expr make(const MatcherState &state, Type) const {
+        return Expr(state.bindings[i]);
+    }
+
+    bool fold(const MatcherState &state, int64_t *value) const {
+        return fold_binding(state.bindings[i], value);
+    }
+};
+
+/** A wildcard that matches a foldable constant (see
+ * is_foldable_const). */
+template<int i>
+struct WildConst {
+    static constexpr uint64_t mask = const_node_mask;
+    static constexpr bool is_literal = false;
+
+    HALIDE_ALWAYS_INLINE bool match(const BaseExprNode *e, MatcherState &state) const {
+        if (!is_foldable_const(e)) {
+            return false;
+        }
+        if (state.const_bound & (1 << i)) {
+            return same_binding(state.const_bindings[i], e);
+        }
+        state.const_bindings[i] = e;
+        state.const_bound |= (1 << i);
+        return true;
+    }
+
+    Expr make(const MatcherState &state, Type) const {
+        return Expr(state.const_bindings[i]);
+    }
+
+    bool fold(const MatcherState &state, int64_t *value) const {
+        return fold_binding(state.const_bindings[i], value);
+    }
+};
+
+/** An integer literal in a rule. It matches any constant with that
+ * value, and takes on the type of its sibling when built. */
+struct IntLiteral {
+    static constexpr uint64_t mask = const_node_mask | node_bit(IRNodeType::Cast);
+    static constexpr bool is_literal = true;
+
+    int64_t value;
+
+    HALIDE_ALWAYS_INLINE bool match(const BaseExprNode *e, MatcherState &) const {
+        return is_const_value(e, value);
+    }
+
+    Expr make(const MatcherState &, Type type) const {
+        return make_const(type, value);
+    }
+
+    bool fold(const MatcherState &, int64_t *v) const {
+        *v = value;
+        return true;
+    }
+};
+
+template<typename Op, typename A, typename B>
+struct BinOp {
+    static constexpr uint64_t mask = node_bit(Op::_node_type);
+    static constexpr bool is_literal = false;
+
+    A a;
+    B b;
+
+    HALIDE_ALWAYS_INLINE bool match(const BaseExprNode *e, MatcherState &state) const {
+        if (e->node_type != Op::_node_type) {
+            return false;
+        }
+        const Op *op = static_cast<const Op *>(e);
+        return (match_child(a, node_of(op->a), state) &&
+                match_child(b, node_of(op->b), state));
+    }
+
+    static constexpr IRNodeType root_type = Op::_node_type;
+
+    /** Check if this pattern could match a node of root_type whose
+     * operands have the given node bits, without looking any
+     * deeper. */
+    HALIDE_ALWAYS_INLINE static bool could_match_root(const uint64_t *operand_bits) {
+        return (could_match<A>(operand_bits[0]) &&
+                could_match<B>(operand_bits[1]));
+    }
+
+    /** Match the operands of a node that could_match_root. */
+    HALIDE_ALWAYS_INLINE bool match_root(const BaseExprNode *const *operands, MatcherState &state) const {
+        return (a.match(operands[0], state) &&
+                b.match(operands[1], state));
+    }
+
+    Expr make(const MatcherState &state, Type type) const {
+        // Literals take on the type of the other operand.
+        Expr ea, eb;
+        if (A::is_literal) {
+            eb = b.make(state, type);
+            ea = a.make(state, eb.type());
+        } else {
+            ea = a.make(state, type);
+            eb = b.make(state, ea.type());
+        }
+        match_types(ea, eb);
+        return Op::make(std::move(ea), std::move(eb));
+    }
+
+    bool fold(const MatcherState &state, int64_t *value) const {
+        int64_t va, vb;
+        return (a.fold(state, &va) &&
+                b.fold(state, &vb) &&
+                fold_binary_op(Op::_node_type, va, vb, value));
+    }
+};
+
+template<typename A>
+struct NotOp {
+    static constexpr uint64_t mask = node_bit(IRNodeType::Not);
+    static constexpr bool is_literal = false;
+
+    A a;
+
+    HALIDE_ALWAYS_INLINE bool match(const BaseExprNode *e, MatcherState &state) const {
+        if (e->node_type != IRNodeType::Not) {
+            return false;
+        }
+        return match_child(a, node_of(static_cast<const Not *>(e)->a), state);
+    }
+
+    Expr make(const MatcherState &state, Type type) const {
+        return Not::make(a.make(state, type));
+    }
+
+    bool fold(const MatcherState &state, int64_t *value) const {
+        int64_t va;
+        if (!a.fold(state, &va)) {
+            return false;
+        }
+        *value = !va;
+        return true;
+    }
+};
+
+template<typename C, typename T, typename F>
+struct SelectOp {
+    static constexpr uint64_t mask = node_bit(IRNodeType::Select);
+    static constexpr bool is_literal = false;
+
+    C c;
+    T t;
+    F f;
+
+    HALIDE_ALWAYS_INLINE bool match(const BaseExprNode *e, MatcherState &state) const {
+        if (e->node_type != IRNodeType::Select) {
+            return false;
+        }
+        const Select *op = static_cast<const Select *>(e);
+        return (match_child(c, node_of(op->condition), state) &&
+                match_child(t, node_of(op->true_value), state) &&
+                match_child(f, node_of(op->false_value), state));
+    }
+
+    static constexpr IRNodeType root_type = IRNodeType::Select;
+
+    HALIDE_ALWAYS_INLINE static bool could_match_root(const uint64_t *operand_bits) {
+        return (could_match<C>(operand_bits[0]) &&
+                could_match<T>(operand_bits[1]) &&
+                could_match<F>(operand_bits[2]));
+    }
+
+    HALIDE_ALWAYS_INLINE bool match_root(const BaseExprNode *const *operands, MatcherState &state) const {
+        return (c.match(operands[0], state) &&
+                t.match(operands[1], state) &&
+                f.match(operands[2], state));
+    }
+
+    Expr make(const MatcherState &state, Type type) const {
+        Expr et, ef;
+        if (T::is_literal) {
+            ef = f.make(state, type);
+            et = t.make(state, ef.type());
+        } else {
+            et = t.make(state, type);
+            ef = f.make(state, et.type());
+        }
+        Expr ec = c.make(state, Bool(et.type().lanes()));
+        return Select::make(std::move(ec), std::move(et), std::move(ef));
+    }
+};
+
+/** A predicate on a bound wildcard, implemented by a function on
+ * Exprs. May only be used in the predicate of a rule. */
+template<typename A>
+struct PredicateFn {
+    bool (*fn)(const Expr &);
+    A a;
+
+    bool fold(const MatcherState &state, int64_t *value) const {
+        *value = fn(a.make(state, Type()));
+        return true;
+    }
+};
+
+inline IntLiteral pattern_arg(int x) {
+    return IntLiteral{x};
+}
+
+template<typename T>
+inline T pattern_arg(T t) {
+    return t;
+}
+
+#define HALIDE_MATCHER_BINARY_OPERATOR(op, Op)                          \
+    template<typename A, typename B>                                    \
+    auto op(A a, B b) -> BinOp<Op, decltype(pattern_arg(a)), decltype(pattern_arg(b))> { \
+        return {pattern_arg(a), pattern_arg(b)};                        \
+    }
+
+HALIDE_MATCHER_BINARY_OPERATOR(operator+, Add)
+HALIDE_MATCHER_BINARY_OPERATOR(operator-, Sub)
+HALIDE_MATCHER_BINARY_OPERATOR(operator*, Mul)
+HALIDE_MATCHER_BINARY_OPERATOR(operator/, Div)
+HALIDE_MATCHER_BINARY_OPERATOR(operator%, Mod)
+HALIDE_MATCHER_BINARY_OPERATOR(min, Min)
+HALIDE_MATCHER_BINARY_OPERATOR(max, Max)
+HALIDE_MATCHER_BINARY_OPERATOR(operator==, EQ)
+HALIDE_MATCHER_BINARY_OPERATOR(operator!=, NE)
+HALIDE_MATCHER_BINARY_OPERATOR(operator<, LT)
+HALIDE_MATCHER_BINARY_OPERATOR(operator<=, LE)
+HALIDE_MATCHER_BINARY_OPERATOR(operator>, GT)
+HALIDE_MATCHER_BINARY_OPERATOR(operator>=, GE)
+HALIDE_MATCHER_BINARY_OPERATOR(operator&&, And)
+HALIDE_MATCHER_BINARY_OPERATOR(operator||, Or)
+
+#undef HALIDE_MATCHER_BINARY_OPERATOR
+
+template<typename A>
+auto operator-(A a) -> BinOp<Sub, IntLiteral, decltype(pattern_arg(a))> {
+    return {IntLiteral{0}, pattern_arg(a)};
+}
+
+template<typename A>
+NotOp<A> operator!(A a) {
+    return {a};
+}
+
+template<typename C, typename T, typename F>
+auto select(C c, T t, F f) -> SelectOp<decltype(pattern_arg(c)), decltype(pattern_arg(t)), decltype(pattern_arg(f))> {
+    return {pattern_arg(c), pattern_arg(t), pattern_arg(f)};
+}
+
+#define HALIDE_MATCHER_PREDICATE(name)                                  \
+    template<typename A>                                                \
+    PredicateFn<A> name(A a) {                                          \
+        return {Internal::name, a};                                     \
+    }
+
+HALIDE_MATCHER_PREDICATE(is_const)
+HALIDE_MATCHER_PREDICATE(is_zero)
+HALIDE_MATCHER_PREDICATE(is_positive_const)
+HALIDE_MATCHER_PREDICATE(is_negative_negatable_const)
+
+#undef HALIDE_MATCHER_PREDICATE
+
+/** Applies rewrite rules to the operands of a node being
+ * simplified. Each call tries one rule, and if it matches, sets
+ * result to the rule's replacement and returns true. */
+template<typename Op>
+class Rewriter {
+    Type output_type;
+    const BaseExprNode *operands[3];
+    // The node_bit of each operand, so that most rules can be
+    // rejected without touching the operands at all.
+    uint64_t operand_bits[3];
+    MatcherState state;
+
+    static uint64_t bit_of(const BaseExprNode *e) {
+        return e ? node_bit(e->node_type) : 0;
+    }
+
+    template<typename Before>
+    HALIDE_ALWAYS_INLINE bool match(const Before &before) {
+        static_assert(Before::root_type == Op::_node_type,
+                      "Rewrite rule is for a different type of node");
+        if (!before.could_match_root(operand_bits)) {
+            return false;
+        }
+        state.reset();
+        return before.match_root(operands, state);
+    }
+
+    // Building the result is kept out of line, so that only the
+    // matching code for each rule is inlined into the caller.
+    template<typename After>
+    void build(const After &after) {
+        result = after.make(state, output_type);
+        internal_assert(result.type() == output_type)
+            << "Rewrite rule changed the type of an Expr from "
+            << output_type << " to " << result.type() << "\n";
+    }
+
+public:
+    Expr result;
+
+    /** Make a rewriter for the node op, whose operands have been
+     * simplified to a, b (and c, for a Select). */
+    Rewriter(const Op *op, const Expr &a, const Expr &b, const Expr &c = Expr()) :
+        output_type(op->type),
+        operands{node_of(a), node_of(b), node_of(c)},
+        operand_bits{bit_of(operands[0]), bit_of(operands[1]), bit_of(operands[2])} {}
+
+    template<typename Before, typename After>
+    HALIDE_ALWAYS_INLINE bool operator()(const Before &before, const After &after) {
+        if (!match(before)) {
+            return false;
+        }
+        build(pattern_arg(after));
+        return true;
+    }
+
+    template<typename Before, typename After, typename Predicate>
+    HALIDE_ALWAYS_INLINE bool operator()(const Before &before, const After &after, const Predicate &predicate) {
+        int64_t holds = 0;
+        if (!match(before) ||
+            !predicate.fold(state, &holds) ||
+            !holds) {
+            return false;
+        }
+        build(pattern_arg(after));
+        return true;
+    }
+};
+
+}  // namespace IRMatcher
+
 void expr_match_test();
 
 }  // namespace Internal
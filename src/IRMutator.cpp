@@ -366,6 +366,15 @@ void IRMutator::visit(const Evaluate *op) {
     }
 }
 
+void IRMutator::visit(const Atomic *op) {
+    Stmt body = mutate(op->body);
+    if (body.same_as(op->body)) {
+        stmt = op;
+    } else {
+        stmt = Atomic::make(op->producer_name, std::move(body));
+    }
+}
+
 void IRMutator::visit(const Shuffle *op) {
     vector<Expr> new_vectors(op->vectors.size());
     bool changed = false;
@@ -384,6 +393,15 @@ void IRMutator::visit(const Shuffle *op) {
     }
 }
 
+void IRMutator::visit(const VectorReduce *op) {
+    Expr value = mutate(op->value);
+    if (value.same_as(op->value)) {
+        expr = op;
+    } else {
+        expr = VectorReduce::make(op->op, std::move(value), op->type.lanes());
+    }
+}
+
 
 IRMutator2::IRMutator2() {
 }
@@ -690,6 +708,14 @@ Stmt IRMutator2::visit(const Evaluate *op) {
     return Evaluate::make(std::move(v));
 }
 
+Stmt IRMutator2::visit(const Atomic *op) {
+    Stmt body = mutate(op->body);
+    if (body.same_as(op->body)) {
+        return op;
+    }
+    return Atomic::make(op->producer_name, std::move(body));
+}
+
 Expr IRMutator2::visit(const Shuffle *op) {
     vector<Expr> new_vectors(op->vectors.size());
     bool changed = false;
@@ -707,6 +733,14 @@ Expr IRMutator2::visit(const Shuffle *op) {
     return Shuffle::make(new_vectors, op->indices);
 }
 
+Expr IRMutator2::visit(const VectorReduce *op) {
+    Expr value = mutate(op->value);
+    if (value.same_as(op->value)) {
+        return op;
+    }
+    return VectorReduce::make(op->op, std::move(value), op->type.lanes());
+}
+
 Stmt IRGraphMutator2::mutate(const Stmt &s) {
     auto iter = stmt_replacements.find(s);
     if (iter != stmt_replacements.end()) {
@@ -89,7 +89,9 @@ protected:
     virtual void visit(const IfThenElse *);
     virtual void visit(const Evaluate *);
     virtual void visit(const Shuffle *);
+    virtual void visit(const VectorReduce *);
     virtual void visit(const Prefetch *);
+    virtual void visit(const Atomic *);
 };
 
 
@@ -150,6 +152,7 @@ protected:
     virtual Expr visit(const Call *);
     virtual Expr visit(const Let *);
     virtual Expr visit(const Shuffle *);
+    virtual Expr visit(const VectorReduce *);
 
     virtual Stmt visit(const LetStmt *);
     virtual Stmt visit(const AssertStmt *);
@@ -164,6 +167,7 @@ protected:
     virtual Stmt visit(const IfThenElse *);
     virtual Stmt visit(const Evaluate *);
     virtual Stmt visit(const Prefetch *);
+    virtual Stmt visit(const Atomic *);
 };
 
 /** A mutator that caches and reapplies previously-done mutations, so
@@ -484,7 +484,7 @@ void range_reduce_log(const Expr &input, Expr *reduced, Expr *exponent) {
     *reduced = reinterpret(type, blended);
 }
 
-Expr halide_log(Expr x_full) {
+Expr halide_log(Expr x_full, bool fast) {
     Type type = x_full.type();
     internal_assert(type.element_of() == Float(32));
 
@@ -515,8 +515,20 @@ Expr halide_log(Expr x_full) {
         -0.50000106292873236491f,
         1.0f,
         0.0f};
+    // The same, but of lower degree.
+    float fast_coeff[] = {
+        0.07640318789187280912f,
+        -0.16252961013874300811f,
+        0.20625219040645212387f,
+        -0.25110261010892864775f,
+        0.33320464908377461777f,
+        -0.49997513376789826101f,
+        1.0f,
+        0.0f};
     Expr x1 = reduced - 1.0f;
-    Expr result = evaluate_polynomial(x1, coeff, sizeof(coeff)/sizeof(coeff[0]));
+    Expr result = fast ?
+        evaluate_polynomial(x1, fast_coeff, sizeof(fast_coeff)/sizeof(fast_coeff[0])) :
+        evaluate_polynomial(x1, coeff, sizeof(coeff)/sizeof(coeff[0]));
 
     result += cast(type, exponent) * logf(2.0);
 
@@ -528,7 +540,7 @@ Expr halide_log(Expr x_full) {
     return result;
 }
 
-Expr halide_exp(Expr x_full) {
+Expr halide_exp(Expr x_full, bool fast) {
     Type type = x_full.type();
     internal_assert(type.element_of() == Float(32));
 
@@ -552,7 +564,16 @@ Expr halide_exp(Expr x_full) {
         0.49999899033463041098f,
         1.0f,
         1.0f};
-    Expr result = evaluate_polynomial(x, coeff, sizeof(coeff)/sizeof(coeff[0]));
+    float fast_coeff[] = {
+        0.01314350012789660196f,
+        0.03668965196652099192f,
+        0.16873890085469545053f,
+        0.49970514590562437052f,
+        1.0f,
+        1.0f};
+    Expr result = fast ?
+        evaluate_polynomial(x, fast_coeff, sizeof(fast_coeff)/sizeof(fast_coeff[0])) :
+        evaluate_polynomial(x, coeff, sizeof(coeff)/sizeof(coeff[0]));
 
     // Compute 2^k.
     int fpbias = 127;
@@ -575,6 +596,130 @@ Expr halide_exp(Expr x_full) {
     return result;
 }
 
+namespace {
+
+// Compute sin(x_full) if cosine is false, or cos(x_full)
+// otherwise. Adapted from Cephes' sinf and cosf.
+Expr halide_sin_or_cos(Expr x_full, bool cosine, bool fast) {
+    Type type = x_full.type();
+    internal_assert(type.element_of() == Float(32));
+
+    // Reduce to x_full = k * pi/2 + x, with x in [-pi/4, pi/4]. pi/2
+    // is split into three parts so that the first two products are
+    // exact for |k| < 2^16.
+    float pi_over_2_part1 = 1.5703125f;
+    float pi_over_2_part2 = 4.837512969970703125e-4f;
+    float pi_over_2_part3 = 7.54978995489188216e-8f;
+    float two_over_pi = 0.636619772367581343f;
+
+    Expr k_real = floor(x_full * two_over_pi + 0.5f);
+    Expr k = cast(Int(32, type.lanes()), k_real);
+    if (cosine) {
+        // cos(x) = sin(x + pi/2)
+        k += 1;
+    }
+
+    Expr x = x_full - k_real * pi_over_2_part1;
+    x -= k_real * pi_over_2_part2;
+    x -= k_real * pi_over_2_part3;
+    Expr x2 = x * x;
+
+    // Fitted to minimize the relative error on [-pi/4, pi/4]. sin
+    // is x + x^3 * P(x^2), and cos is 1 - x^2/2 + x^4 * Q(x^2), or
+    // 1 + x^2 * Q(x^2) when fast.
+    float sin_coeff[] = {
+        -1.9513932425e-04f,
+        8.3321482551e-03f,
+        -1.6666654339e-01f};
+    float cos_coeff[] = {
+        2.4430576227e-05f,
+        -1.3887290090e-03f,
+        4.1666645039e-02f};
+    float fast_sin_coeff[] = {
+        8.1623033148e-03f,
+        -1.6663337524e-01f};
+    float fast_cos_coeff[] = {
+        4.0451580968e-02f,
+        -4.9975680267e-01f,
+        1.0f};
+
+    Expr sin_x, cos_x;
+    if (fast) {
+        sin_x = x + x * x2 * evaluate_polynomial(x2, fast_sin_coeff, 2);
+        cos_x = evaluate_polynomial(x2, fast_cos_coeff, 3);
+    } else {
+        sin_x = x + x * x2 * evaluate_polynomial(x2, sin_coeff, 3);
+        cos_x = 1.0f - x2 * 0.5f + x2 * x2 * evaluate_polynomial(x2, cos_coeff, 3);
+    }
+
+    // Pick the quadrant.
+    Expr one = make_one(k.type()), two = make_const(k.type(), 2);
+    Expr result = select((k & one) == one, cos_x, sin_x);
+    result = select((k & two) == two, -result, result);
+
+    // This introduces lots of common subexpressions
+    result = common_subexpression_elimination(result);
+
+    return result;
+}
+
+}  // namespace
+
+Expr halide_sin(Expr x_full, bool fast) {
+    return halide_sin_or_cos(std::move(x_full), false, fast);
+}
+
+Expr halide_cos(Expr x_full, bool fast) {
+    return halide_sin_or_cos(std::move(x_full), true, fast);
+}
+
+Expr halide_atan2(Expr y, Expr x, bool fast) {
+    Type type = y.type();
+    internal_assert(type.element_of() == Float(32) && x.type() == type);
+
+    // Reduce to atan(t) for t in [0, 1], and then fix up the result
+    // using the symmetries of atan2.
+    Expr abs_x = abs(x), abs_y = abs(y);
+    Expr num = min(abs_x, abs_y), den = max(abs_x, abs_y);
+    Expr t = select(den == 0.0f, make_zero(type), num / den);
+
+    Expr result;
+    if (fast) {
+        // Fitted to minimize the relative error of atan(t)/t on
+        // [0, 1].
+        float coeff[] = {
+            2.3372146706e-02f,
+            -9.0928917949e-02f,
+            1.8457836907e-01f,
+            -3.3156896747e-01f,
+            9.9996564648e-01f};
+        result = t * evaluate_polynomial(t * t, coeff, sizeof(coeff)/sizeof(coeff[0]));
+    } else {
+        // Following Cephes' atanf, further reduce t > tan(pi/8) using
+        // atan(t) = pi/4 + atan((t - 1)/(t + 1)), and then use
+        // atan(u) = u + u^3 * P(u^2) on [-tan(pi/8), tan(pi/8)].
+        float coeff[] = {
+            8.0378797258e-02f,
+            -1.3872261721e-01f,
+            1.9977140605e-01f,
+            -3.3332931468e-01f};
+        Expr big = t > 0.414213562373095f;
+        Expr u = select(big, (t - 1.0f) / (t + 1.0f), t);
+        Expr u2 = u * u;
+        result = u + u * u2 * evaluate_polynomial(u2, coeff, sizeof(coeff)/sizeof(coeff[0]));
+        result = select(big, result + 0.785398163397448f, result);
+    }
+
+    result = select(abs_y > abs_x, 1.57079632679489662f - result, result);
+    result = select(x < 0.0f, 3.14159265358979324f - result, result);
+    result = select(y < 0.0f, -result, result);
+
+    // This introduces lots of common subexpressions
+    result = common_subexpression_elimination(result);
+
+    return result;
+}
+
 Expr halide_erf(Expr x_full) {
     user_assert(x_full.type() == Float(32)) << "halide_erf only works for Float(32)";
 
@@ -160,10 +160,30 @@ Expr lossless_cast(Type t, Expr e);
  */
 void match_types(Expr &a, Expr &b);
 
-/** Halide's vectorizable transcendentals. */
+/** Halide's vectorizable transcendentals. Codegen uses these in
+ * place of calls to the corresponding math library functions, which
+ * would otherwise be scalarized. Passing fast = true selects
+ * lower-degree polynomials (see Target::FastTranscendentals). Worst
+ * case errors measured against double-precision libm over finite
+ * inputs are:
+ *
+ * - halide_log: 2 ulp (33 ulp when fast), except near 1, where the
+ *   absolute error is at most 2e-6.
+ * - halide_exp: 2 ulp (81 ulp when fast).
+ * - halide_sin, halide_cos: 2 ulp, except near zeros of the result,
+ *   where the absolute error is at most 1e-7 (1.5e-5 absolute when
+ *   fast). Assumes |a| < 8192, beyond which the range reduction loses
+ *   precision. Codegen calls the math library for each lane of
+ *   vectors with any lane that large.
+ * - halide_atan2: 3 ulp (2e-5 absolute when fast). Returns nan when
+ *   both arguments are infinite.
+ */
 // @{
-Expr halide_log(Expr a);
-Expr halide_exp(Expr a);
+Expr halide_log(Expr a, bool fast = false);
+Expr halide_exp(Expr a, bool fast = false);
+Expr halide_sin(Expr a, bool fast = false);
+Expr halide_cos(Expr a, bool fast = false);
+Expr halide_atan2(Expr y, Expr x, bool fast = false);
 Expr halide_erf(Expr a);
 // @}
 
@@ -237,6 +237,30 @@ ostream &operator<<(ostream &out, const ForType &type) {
     return out;
 }
 
+ostream &operator<<(ostream &out, const VectorReduce::Operator &op) {
+    switch (op) {
+    case VectorReduce::Add:
+        out << "Add";
+        break;
+    case VectorReduce::Mul:
+        out << "Mul";
+        break;
+    case VectorReduce::Min:
+        out << "Min";
+        break;
+    case VectorReduce::Max:
+        out << "Max";
+        break;
+    case VectorReduce::And:
+        out << "And";
+        break;
+    case VectorReduce::Or:
+        out << "Or";
+        break;
+    }
+    return out;
+}
+
 ostream &operator<<(ostream &out, const NameMangling &m) {
     switch(m) {
     case NameMangling::Default:
@@ -788,6 +812,16 @@ void IRPrinter::visit(const Evaluate *op) {
     stream << "\n";
 }
 
+void IRPrinter::visit(const Atomic *op) {
+    do_indent();
+    stream << "atomic " << op->producer_name << " {\n";
+    indent += 2;
+    print(op->body);
+    indent -= 2;
+    do_indent();
+    stream << "}\n";
+}
+
 void IRPrinter::visit(const Shuffle *op) {
     if (op->is_concat()) {
         stream << "concat_vectors(";
@@ -821,5 +855,15 @@ void IRPrinter::visit(const Shuffle *op) {
     }
 }
 
+void IRPrinter::visit(const VectorReduce *op) {
+    stream << "("
+           << op->type
+           << ")vector_reduce("
+           << op->op
+           << ", ";
+    print(op->value);
+    stream << ")";
+}
+
 }  // namespace Internal
 }  // namespace Halide
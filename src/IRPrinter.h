@@ -67,6 +67,10 @@ std::ostream &operator<<(std::ostream &stream, const Stmt &);
  * readable form */
 std::ostream &operator<<(std::ostream &stream, const ForType &);
 
+/** Emit a horizontal vector reduction operator in a human readable
+ * form */
+std::ostream &operator<<(std::ostream &stream, const VectorReduce::Operator &);
+
 /** Emit a halide name mangling value in a human readable format */
 std::ostream &operator<<(std::ostream &stream, const NameMangling &);
 
@@ -152,7 +156,9 @@ protected:
     void visit(const IfThenElse *);
     void visit(const Evaluate *);
     void visit(const Shuffle *);
+    void visit(const VectorReduce *);
     void visit(const Prefetch *);
+    void visit(const Atomic *);
 };
 }  // namespace Internal
 }  // namespace Halide
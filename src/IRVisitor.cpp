@@ -243,6 +243,14 @@ void IRVisitor::visit(const Shuffle *op) {
     }
 }
 
+void IRVisitor::visit(const VectorReduce *op) {
+    op->value.accept(this);
+}
+
+void IRVisitor::visit(const Atomic *op) {
+    op->body.accept(this);
+}
+
 void IRGraphVisitor::include(const Expr &e) {
     auto r = visited.insert(e.get());
     if (r.second) {
@@ -478,5 +486,13 @@ void IRGraphVisitor::visit(const Shuffle *op) {
     }
 }
 
+void IRGraphVisitor::visit(const VectorReduce *op) {
+    include(op->value);
+}
+
+void IRGraphVisitor::visit(const Atomic *op) {
+    include(op->body);
+}
+
 }  // namespace Internal
 }  // namespace Halide
@@ -69,7 +69,9 @@ protected:
     virtual void visit(const IfThenElse *);
     virtual void visit(const Evaluate *);
     virtual void visit(const Shuffle *);
+    virtual void visit(const VectorReduce *);
     virtual void visit(const Prefetch *);
+    virtual void visit(const Atomic *);
 };
 
 /** A base class for algorithms that walk recursively over the IR
@@ -135,7 +137,9 @@ protected:
     void visit(const IfThenElse *) override;
     void visit(const Evaluate *) override;
     void visit(const Shuffle *) override;
+    void visit(const VectorReduce *) override;
     void visit(const Prefetch *) override;
+    void visit(const Atomic *) override;
     // @}
 };
 
@@ -8,6 +8,7 @@
 
 #include <string>
 #include <iostream>
+#include <mutex>
 #include <sstream>
 #include <stdio.h>
 
@@ -2169,9 +2170,15 @@ private:
 
 namespace {
 DebugSections *debug_sections = nullptr;
+
+// Funcs and Vars may be made on several threads at once
+// (e.g. by compile_multitarget), and the heap object list is
+// mutable, so serialize all queries.
+std::mutex debug_sections_mutex;
 }
 
 std::string get_variable_name(const void *var, const std::string &expected_type) {
+    std::lock_guard<std::mutex> lock(debug_sections_mutex);
     if (!debug_sections) return "";
     if (!debug_sections->working) return "";
     std::string name = debug_sections->get_stack_variable_name(var, expected_type);
@@ -2188,12 +2195,14 @@ std::string get_variable_name(const void *var, const std::string &expected_type)
 }
 
 std::string get_source_location() {
+    std::lock_guard<std::mutex> lock(debug_sections_mutex);
     if (!debug_sections) return "";
     if (!debug_sections->working) return "";
     return debug_sections->get_source_location();
 }
 
 void register_heap_object(const void *obj, size_t size, const void *helper) {
+    std::lock_guard<std::mutex> lock(debug_sections_mutex);
     if (!debug_sections) return;
     if (!debug_sections->working) return;
     if (!helper) return;
@@ -2201,6 +2210,7 @@ void register_heap_object(const void *obj, size_t size, const void *helper) {
 }
 
 void deregister_heap_object(const void *obj, size_t size) {
+    std::lock_guard<std::mutex> lock(debug_sections_mutex);
     if (!debug_sections) return;
     if (!debug_sections->working) return;
     debug_sections->deregister_heap_object(obj, size);
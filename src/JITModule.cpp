@@ -1,3 +1,8 @@
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <random>
+#include <sstream>
 #include <string>
 #include <stdint.h>
 #include <mutex>
@@ -14,6 +19,7 @@
 #include "Debug.h"
 #include "LLVM_Output.h"
 #include "CodeGen_LLVM.h"
+#include "IRPrinter.h"
 #include "Pipeline.h"
 
 
@@ -160,7 +166,8 @@ JITModule::Symbol compile_and_get_function(ExecutionEngine &ee, const string &na
         internal_error << "Compiling " << name << " returned nullptr\n";
     }
 
-    JITModule::Symbol symbol(f, fn->getFunctionType());
+    // Functions loaded from the object cache have no llvm IR.
+    JITModule::Symbol symbol(f, fn ? fn->getFunctionType() : nullptr);
 
     debug(2) << "Function " << name << " is at " << f << "\n";
 
@@ -235,6 +242,237 @@ public:
 
 }
 
+namespace {
+
+// The persistent JIT object cache. Each entry is a file named for a
+// hash of everything that determines the generated code: the lowered
+// Module, the Target, and the build of Halide and version of llvm. It
+// holds the object code along with what's needed to load it without
+// regenerating the llvm::Module.
+const char *const object_cache_magic = "halide_jit_object_cache_v2";
+
+// The git commit libHalide was built from, set by the build system:
+// the Makefile defines it directly, and CMake generates a header.
+#ifdef HALIDE_HAVE_BUILD_ID_HEADER
+#include "halide_build_id.h"
+#endif
+#ifndef HALIDE_BUILD_ID
+#define HALIDE_BUILD_ID ""
+#endif
+
+
+std::mutex object_cache_dir_mutex;
+bool object_cache_dir_initialized = false;
+string object_cache_dir_name;
+
+// IRPrinter elides some details that don't matter to a human reader
+// but do matter to codegen. Print those too.
+class ObjectCacheKeyPrinter : public IRPrinter {
+    using IRPrinter::visit;
+
+    void visit(const Variable *op) override {
+        stream << op->type << ' ';
+        IRPrinter::visit(op);
+    }
+
+    void visit(const Load *op) override {
+        stream << op->type << ' ';
+        IRPrinter::visit(op);
+    }
+
+    void visit(const Call *op) override {
+        stream << op->type << ' ' << (int)op->call_type << ' ';
+        IRPrinter::visit(op);
+    }
+
+public:
+    ObjectCacheKeyPrinter(std::ostream &s) : IRPrinter(s) {
+        // Print floating point constants exactly.
+        s << std::setprecision(std::numeric_limits<double>::max_digits10);
+    }
+};
+
+void append_object_cache_key(const Module &m, std::ostream &key) {
+    ObjectCacheKeyPrinter printer(key);
+
+    key << "module " << m.name() << ' ' << m.target().to_string()
+        << ' ' << m.any_strict_float() << '\n';
+    for (const auto &p : m.get_metadata_name_map()) {
+        key << "metadata_name " << p.first << ' ' << p.second << '\n';
+    }
+
+    for (const Buffer<> &b : m.buffers()) {
+        key << "buffer " << b.name() << ' ' << b.type() << ' ' << b.dimensions();
+        for (int i = 0; i < b.dimensions(); i++) {
+            key << ' ' << b.dim(i).min() << ' ' << b.dim(i).extent() << ' ' << b.dim(i).stride();
+        }
+        key << '\n';
+        if (b.data()) {
+            const halide_buffer_t *raw = b.raw_buffer();
+            key.write((const char *)raw->begin(), raw->size_in_bytes());
+        }
+        key << '\n';
+    }
+
+    for (const LoweredFunc &f : m.functions()) {
+        key << "func " << f.name << ' ' << (int)f.linkage << ' ' << (int)f.name_mangling << '\n';
+        for (const LoweredArgument &arg : f.args) {
+            key << "arg " << arg.name << ' ' << (int)arg.kind << ' ' << (int)arg.dimensions
+                << ' ' << arg.type << ' ' << arg.alignment.modulus << ' ' << arg.alignment.remainder << '\n';
+        }
+        printer.print(f.body);
+    }
+
+    for (const ExternalCode &code : m.external_code()) {
+        key << "external_code " << code.name() << ' ' << code.is_c_plus_plus_source() << '\n';
+        key.write((const char *)code.contents().data(), code.contents().size());
+        key << '\n';
+    }
+
+    for (const Module &sub : m.submodules()) {
+        append_object_cache_key(sub, key);
+    }
+}
+
+string object_cache_key(const Module &m) {
+    std::ostringstream key;
+    key << object_cache_magic << ' ' << LLVM_VERSION << ' ' << HALIDE_BUILD_ID << '\n';
+    append_object_cache_key(m, key);
+    return key.str();
+}
+
+// Two independent 64-bit hashes of the key. The first names the
+// cache file, and the second is stored in it and checked on load.
+uint64_t fnv1a_hash(const string &s) {
+    uint64_t h = 14695981039346656037ULL;
+    for (char c : s) {
+        h = (h ^ (uint8_t)c) * 1099511628211ULL;
+    }
+    return h;
+}
+
+uint64_t djb_hash(const string &s) {
+    uint64_t h = 5381;
+    for (char c : s) {
+        h = (h * 33) ^ (uint8_t)c;
+    }
+    return h;
+}
+
+struct CachedObject {
+    uint64_t key_check = 0;
+    string triple, data_layout, mcpu, mattrs;
+    bool use_soft_float_abi = false;
+    bool per_instruction_fast_math_flags = false;
+    string object;
+};
+
+string object_cache_path(const string &dir, const string &key) {
+    std::ostringstream path;
+    path << dir << "/" << std::hex << std::setw(16) << std::setfill('0') << fnv1a_hash(key) << ".o";
+    return path.str();
+}
+
+bool read_cached_object(const string &path, const string &key, CachedObject &result) {
+    std::ifstream f(path, std::ios::in | std::ios::binary);
+    if (!f) {
+        return false;
+    }
+    string magic, key_check, soft_float, fast_math, object_size;
+    std::getline(f, magic);
+    std::getline(f, key_check);
+    std::getline(f, result.triple);
+    std::getline(f, result.data_layout);
+    std::getline(f, result.mcpu);
+    std::getline(f, result.mattrs);
+    std::getline(f, soft_float);
+    std::getline(f, fast_math);
+    std::getline(f, object_size);
+    if (!f || magic != object_cache_magic ||
+        key_check != std::to_string(djb_hash(key))) {
+        debug(1) << "Ignoring stale or corrupt JIT object cache entry " << path << "\n";
+        return false;
+    }
+    result.use_soft_float_abi = soft_float == "1";
+    result.per_instruction_fast_math_flags = fast_math == "1";
+    size_t size = std::strtoull(object_size.c_str(), nullptr, 10);
+    result.object.resize(size);
+    f.read(&result.object[0], size);
+    if ((size_t)f.gcount() != size) {
+        debug(1) << "Ignoring truncated JIT object cache entry " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+void write_cached_object(const string &path, const string &key, const CachedObject &obj) {
+    // Write to a temporary file and rename it into place, so that
+    // concurrent processes never see a partial entry.
+    std::random_device rd;
+    string temp_path = path + ".tmp" + std::to_string(rd());
+    {
+        std::ofstream f(temp_path, std::ios::out | std::ios::binary);
+        f << object_cache_magic << "\n"
+          << djb_hash(key) << "\n"
+          << obj.triple << "\n"
+          << obj.data_layout << "\n"
+          << obj.mcpu << "\n"
+          << obj.mattrs << "\n"
+          << obj.use_soft_float_abi << "\n"
+          << obj.per_instruction_fast_math_flags << "\n"
+          << obj.object.size() << "\n";
+        f.write(obj.object.data(), obj.object.size());
+        if (!f) {
+            debug(1) << "Failed to write JIT object cache entry " << path << "\n";
+            f.close();
+            std::remove(temp_path.c_str());
+            return;
+        }
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        debug(1) << "Failed to write JIT object cache entry " << path << "\n";
+        std::remove(temp_path.c_str());
+    }
+}
+
+// Make a module with no code, but with the target options of a cached
+// object, to create an execution engine for it.
+std::unique_ptr<llvm::Module> make_module_for_cached_object(const CachedObject &obj, const string &name,
+                                                            llvm::LLVMContext &context) {
+    std::unique_ptr<llvm::Module> m(new llvm::Module(name, context));
+    m->setTargetTriple(obj.triple);
+    m->setDataLayout(obj.data_layout);
+    m->addModuleFlag(llvm::Module::Warning, "halide_use_soft_float_abi", obj.use_soft_float_abi ? 1 : 0);
+    m->addModuleFlag(llvm::Module::Warning, "halide_mcpu", llvm::MDString::get(context, obj.mcpu));
+    m->addModuleFlag(llvm::Module::Warning, "halide_mattrs", llvm::MDString::get(context, obj.mattrs));
+    m->addModuleFlag(llvm::Module::Warning, "halide_per_instruction_fast_math_flags",
+                     obj.per_instruction_fast_math_flags ? 1 : 0);
+    return m;
+}
+
+// Captures the object code MCJIT generates for a module.
+class ObjectCapture : public llvm::ObjectCache {
+public:
+    string object;
+
+    void notifyObjectCompiled(const llvm::Module *, llvm::MemoryBufferRef obj) override {
+        object.assign(obj.getBufferStart(), obj.getBufferSize());
+    }
+
+    std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *) override {
+        return nullptr;
+    }
+};
+
+void compile_module_to_jit(JITModuleContents *jit_module,
+                           std::unique_ptr<llvm::Module> m, const string &function_name, const Target &target,
+                           const std::vector<JITModule> &dependencies,
+                           const std::vector<std::string> &requested_exports,
+                           llvm::object::OwningBinary<llvm::object::ObjectFile> *cached_object,
+                           llvm::ObjectCache *object_capture);
+
+}  // namespace
+
 JITModule::JITModule() {
     jit_module = new JITModuleContents();
 }
@@ -242,16 +480,108 @@ JITModule::JITModule() {
 JITModule::JITModule(const Module &m, const LoweredFunc &fn,
                      const std::vector<JITModule> &dependencies) {
     jit_module = new JITModuleContents();
+
+    string cache_dir = object_cache_dir();
+    if (!cache_dir.empty() && !object_cache_supported()) {
+        debug(1) << "Not using the JIT object cache, because this build of Halide "
+                 << "has no build id, or was built with uncommitted changes\n";
+        cache_dir.clear();
+    }
+    string key, cache_path;
+    if (!cache_dir.empty()) {
+        key = object_cache_key(m);
+        cache_path = object_cache_path(cache_dir, key);
+
+        CachedObject cached;
+        if (read_cached_object(cache_path, key, cached)) {
+            std::unique_ptr<llvm::MemoryBuffer> buffer =
+                llvm::MemoryBuffer::getMemBufferCopy(cached.object, cache_path);
+            auto object = llvm::object::ObjectFile::createObjectFile(buffer->getMemBufferRef());
+            if (object) {
+                debug(1) << "Loading " << fn.name << " from JIT object cache entry " << cache_path << "\n";
+                llvm::object::OwningBinary<llvm::object::ObjectFile> binary(std::move(*object), std::move(buffer));
+                std::unique_ptr<llvm::Module> llvm_module =
+                    make_module_for_cached_object(cached, m.name(), jit_module->context);
+                std::vector<JITModule> deps_with_runtime = dependencies;
+                std::vector<JITModule> shared_runtime = JITSharedRuntime::get(llvm_module.get(), m.target());
+                deps_with_runtime.insert(deps_with_runtime.end(), shared_runtime.begin(), shared_runtime.end());
+                compile_module_to_jit(jit_module.get(), std::move(llvm_module), fn.name, m.target(),
+                                      deps_with_runtime, {}, &binary, nullptr);
+                return;
+            }
+            llvm::consumeError(object.takeError());
+            debug(1) << "Ignoring unreadable JIT object cache entry " << cache_path << "\n";
+        }
+    }
+
     std::unique_ptr<llvm::Module> llvm_module(compile_module_to_llvm_module(m, jit_module->context));
     std::vector<JITModule> deps_with_runtime = dependencies;
     std::vector<JITModule> shared_runtime = JITSharedRuntime::get(llvm_module.get(), m.target());
     deps_with_runtime.insert(deps_with_runtime.end(), shared_runtime.begin(), shared_runtime.end());
-    compile_module(std::move(llvm_module), fn.name, m.target(), deps_with_runtime);
+
+    if (cache_dir.empty()) {
+        compile_module(std::move(llvm_module), fn.name, m.target(), deps_with_runtime);
+        return;
+    }
+
+    CachedObject cached;
+    llvm::TargetOptions options;
+    get_target_options(*llvm_module, options, cached.mcpu, cached.mattrs);
+    cached.triple = llvm_module->getTargetTriple();
+    cached.data_layout = llvm_module->getDataLayoutStr();
+    cached.use_soft_float_abi = options.FloatABIType == llvm::FloatABI::Soft;
+    cached.per_instruction_fast_math_flags = !options.UnsafeFPMath;
+
+    ObjectCapture capture;
+    compile_module_to_jit(jit_module.get(), std::move(llvm_module), fn.name, m.target(),
+                          deps_with_runtime, {}, nullptr, &capture);
+    if (!capture.object.empty()) {
+        cached.object = std::move(capture.object);
+        debug(1) << "Saving " << fn.name << " to JIT object cache entry " << cache_path << "\n";
+        write_cached_object(cache_path, key, cached);
+    }
 }
 
 void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &function_name, const Target &target,
                                const std::vector<JITModule> &dependencies,
                                const std::vector<std::string> &requested_exports) {
+    compile_module_to_jit(jit_module.get(), std::move(m), function_name, target,
+                          dependencies, requested_exports, nullptr, nullptr);
+}
+
+void JITModule::set_object_cache_dir(const std::string &dir) {
+    std::lock_guard<std::mutex> lock(object_cache_dir_mutex);
+    object_cache_dir_name = dir;
+    object_cache_dir_initialized = true;
+}
+
+bool JITModule::object_cache_supported() {
+    // Entries made by this build of Halide must be told apart from
+    // those made by any other. A build from a source tree with
+    // uncommitted changes has the same id as one without them.
+    const string id = HALIDE_BUILD_ID;
+    return !id.empty() && !ends_with(id, "-dirty");
+}
+
+std::string JITModule::object_cache_dir() {
+    std::lock_guard<std::mutex> lock(object_cache_dir_mutex);
+    if (!object_cache_dir_initialized) {
+        object_cache_dir_name = get_env_variable("HL_JIT_CACHE_DIR");
+        object_cache_dir_initialized = true;
+    }
+    return object_cache_dir_name;
+}
+
+namespace {
+
+// Compile an llvm module, or load a previously compiled object for
+// it, and populate a JITModule with the result.
+void compile_module_to_jit(JITModuleContents *jit_module,
+                           std::unique_ptr<llvm::Module> m, const string &function_name, const Target &target,
+                           const std::vector<JITModule> &dependencies,
+                           const std::vector<std::string> &requested_exports,
+                           llvm::object::OwningBinary<llvm::object::ObjectFile> *cached_object,
+                           llvm::ObjectCache *object_capture) {
 
     // Ensure that LLVM is initialized
     CodeGen_LLVM::initialize_llvm();
@@ -276,7 +606,7 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     HalideJITMemoryManager *memory_manager = new HalideJITMemoryManager(dependencies);
     engine_builder.setMCJITMemoryManager(std::unique_ptr<RTDyldMemoryManager>(memory_manager));
 
-    engine_builder.setOptLevel(CodeGenOpt::Aggressive);
+    engine_builder.setOptLevel(target.has_feature(Target::FastCompile) ? CodeGenOpt::None : CodeGenOpt::Aggressive);
     if (!mcpu.empty()) {
         engine_builder.setMCPU(mcpu);
     }
@@ -310,14 +640,21 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
         ee->RegisterJITEventListener(listeners[i]);
     }
 
+    if (cached_object) {
+        ee->addObjectFile(std::move(*cached_object));
+    }
+    if (object_capture) {
+        ee->setObjectCache(object_capture);
+    }
+
     // Retrieve function pointers from the compiled module (which also
     // triggers compilation)
     debug(1) << "JIT compiling " << module_name << "\n";
 
-    std::map<std::string, Symbol> exports;
+    std::map<std::string, JITModule::Symbol> exports;
 
-    Symbol entrypoint;
-    Symbol argv_entrypoint;
+    JITModule::Symbol entrypoint;
+    JITModule::Symbol argv_entrypoint;
     if (!function_name.empty()) {
         entrypoint = compile_and_get_function(*ee, function_name);
         exports[function_name] = entrypoint;
@@ -332,6 +669,7 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     debug(2) << "Finalizing object\n";
     ee->finalizeObject();
     memory_manager->work_around_llvm_bugs();
+    ee->setObjectCache(nullptr);
 
     // Do any target-specific post-compilation module meddling
     for (size_t i = 0; i < listeners.size(); i++) {
@@ -352,6 +690,8 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     jit_module->name = function_name;
 }
 
+}  // namespace
+
 const std::map<std::string, JITModule::Symbol> &JITModule::exports() const {
     return jit_module->exports;
 }
@@ -453,6 +793,46 @@ void JITModule::memoization_cache_set_size(int64_t size) const {
     }
 }
 
+void JITModule::memoization_cache_get_stats(halide_memoization_cache_stats_t *stats) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_memoization_cache_get_stats");
+    if (f != exports().end()) {
+        return (reinterpret_bits<void (*)(halide_memoization_cache_stats_t *)>(f->second.address))(stats);
+    }
+}
+
+void JITModule::memoization_cache_set_eviction_policy(halide_memoization_cache_eviction_policy_t policy) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_memoization_cache_set_eviction_policy");
+    if (f != exports().end()) {
+        return (reinterpret_bits<void (*)(halide_memoization_cache_eviction_policy_t)>(f->second.address))(policy);
+    }
+}
+
+void JITModule::memory_pool_set_limit(int64_t limit) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_memory_pool_set_limit");
+    if (f != exports().end()) {
+        return (reinterpret_bits<void (*)(int64_t)>(f->second.address))(limit);
+    }
+}
+
+void JITModule::memory_pool_release() const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_memory_pool_release");
+    if (f != exports().end()) {
+        return (reinterpret_bits<void (*)(void *)>(f->second.address))(nullptr);
+    }
+}
+
+void JITModule::memory_pool_get_stats(halide_memory_pool_stats_t *stats) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_memory_pool_get_stats");
+    if (f != exports().end()) {
+        return (reinterpret_bits<void (*)(halide_memory_pool_stats_t *)>(f->second.address))(stats);
+    }
+}
+
 bool JITModule::compiled() const {
   return jit_module->execution_engine != nullptr;
 }
@@ -463,6 +843,9 @@ JITHandlers runtime_internal_handlers;
 JITHandlers default_handlers;
 JITHandlers active_handlers;
 int64_t default_cache_size;
+halide_memoization_cache_eviction_policy_t default_eviction_policy = halide_memoization_cache_evict_lru;
+// Negative until set with JITSharedRuntime::memory_pool_set_limit.
+int64_t default_pool_limit = -1;
 
 void merge_handlers(JITHandlers &base, const JITHandlers &addins) {
     if (addins.custom_print) {
@@ -639,6 +1022,9 @@ JITModule &make_module(llvm::Module *for_module, Target target,
         // Ensure that JIT feature is set on target as it must be in
         // order for the right runtime components to be added.
         target.set_feature(Target::JIT);
+        // The runtime is shared by everything jitted later, so it is
+        // always fully optimized.
+        target.set_feature(Target::FastCompile, false);
 
         Target one_gpu(target);
         one_gpu.set_feature(Target::OpenCL, false);
@@ -749,6 +1135,12 @@ JITModule &make_module(llvm::Module *for_module, Target target,
             if (default_cache_size != 0) {
                 runtime.memoization_cache_set_size(default_cache_size);
             }
+            if (default_eviction_policy != halide_memoization_cache_evict_lru) {
+                runtime.memoization_cache_set_eviction_policy(default_eviction_policy);
+            }
+            if (default_pool_limit >= 0) {
+                runtime.memory_pool_set_limit(default_pool_limit);
+            }
 
             runtime.jit_module->name = "MainShared";
         } else {
@@ -873,5 +1265,37 @@ void JITSharedRuntime::memoization_cache_set_size(int64_t size) {
     }
 }
 
+void JITSharedRuntime::memoization_cache_get_stats(halide_memoization_cache_stats_t *stats) {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+
+    shared_runtimes(MainShared).memoization_cache_get_stats(stats);
+}
+
+void JITSharedRuntime::memoization_cache_set_eviction_policy(halide_memoization_cache_eviction_policy_t policy) {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+
+    default_eviction_policy = policy;
+    shared_runtimes(MainShared).memoization_cache_set_eviction_policy(policy);
+}
+
+void JITSharedRuntime::memory_pool_set_limit(int64_t limit) {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+
+    default_pool_limit = limit;
+    shared_runtimes(MainShared).memory_pool_set_limit(limit);
+}
+
+void JITSharedRuntime::memory_pool_release() {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+
+    shared_runtimes(MainShared).memory_pool_release();
+}
+
+void JITSharedRuntime::memory_pool_get_stats(halide_memory_pool_stats_t *stats) {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+
+    shared_runtimes(MainShared).memory_pool_get_stats(stats);
+}
+
 }  // namespace Internal
 }  // namespace Halide
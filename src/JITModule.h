@@ -116,8 +116,48 @@ struct JITModule {
     /** Encapsulate device (GPU) and buffer interactions. */
     void memoization_cache_set_size(int64_t size) const;
 
+    /** Get the hit, miss, and eviction counts of the memoization
+     * cache in this module. Leaves stats untouched if the module
+     * has no memoization cache. */
+    void memoization_cache_get_stats(halide_memoization_cache_stats_t *stats) const;
+
+    /** Set the policy the memoization cache in this module uses to
+     * evict entries, if the module has one. */
+    void memoization_cache_set_eviction_policy(halide_memoization_cache_eviction_policy_t policy) const;
+
+    /** Set the number of bytes of freed heap allocations the default
+     * allocator keeps for reuse, return them all to the system, or get
+     * the statistics of that pool, if this module has the allocator. */
+    // @{
+    void memory_pool_set_limit(int64_t limit) const;
+    void memory_pool_release() const;
+    void memory_pool_get_stats(halide_memory_pool_stats_t *stats) const;
+    // @}
+
     /** Return true if compile_module has been called on this module. */
     bool compiled() const;
+
+    /** Persist the object code of JIT-compiled pipelines in the given
+     * directory, and reuse it in this and later runs for pipelines
+     * that lower to exactly the same code for the same target. This
+     * skips generating and compiling llvm IR, which is usually most
+     * of the cost of JIT compilation. Pass an empty string to
+     * disable. The default is the value of the environment variable
+     * HL_JIT_CACHE_DIR. Entries are keyed on the llvm version and
+     * the git commit libHalide was built from (HALIDE_BUILD_ID in the
+     * Makefile and CMake build). The cache is not used by builds
+     * without a build id, or with uncommitted changes, because
+     * entries from them can't be told apart from entries made by
+     * other builds. */
+    static void set_object_cache_dir(const std::string &dir);
+
+    /** Get the directory in which JIT object code is persisted, or
+     * the empty string if it is not. */
+    static std::string object_cache_dir();
+
+    /** Return whether this build of Halide has a build id that allows
+     * it to use the object cache. See set_object_cache_dir. */
+    static bool object_cache_supported();
 };
 
 typedef int (*halide_task)(void *user_context, int, uint8_t *);
@@ -153,6 +193,30 @@ public:
      */
     static void memoization_cache_set_size(int64_t size);
 
+    /** Get the hit, miss, and eviction counts of the memoization
+     * cache. If you are compiling statically, call
+     * halide_memoization_cache_get_stats() instead.
+     */
+    static void memoization_cache_get_stats(halide_memoization_cache_stats_t *stats);
+
+    /** Set the policy the memoization cache uses to decide which
+     * entries to evict. If you are compiling statically, call
+     * halide_memoization_cache_set_eviction_policy() instead.
+     */
+    static void memoization_cache_set_eviction_policy(halide_memoization_cache_eviction_policy_t policy);
+
+    /** Set the number of bytes of freed heap allocations the default
+     * allocator of JIT-compiled pipelines keeps for reuse (see
+     * halide_memory_pool_set_limit), return them all to the system, or
+     * get the reuse statistics of that pool. If you are compiling
+     * statically, call the halide_memory_pool functions instead.
+     */
+    // @{
+    static void memory_pool_set_limit(int64_t limit);
+    static void memory_pool_release();
+    static void memory_pool_get_stats(halide_memory_pool_stats_t *stats);
+    // @}
+
     static void release_all();
 };
 
@@ -93,6 +93,21 @@ class LiftLoopInvariants : public IRMutator2 {
         return IRMutator2::visit(op);
     }
 
+    Stmt visit(const Allocate *op) override {
+        if (!op->new_expr.defined()) {
+            return IRMutator2::visit(op);
+        }
+        // Leave the new_expr alone, so that codegen can still tell
+        // when it points into another allocation (see plan_memory).
+        vector<Expr> new_extents;
+        for (const Expr &e : op->extents) {
+            new_extents.push_back(mutate(e));
+        }
+        return Allocate::make(op->name, op->type, op->memory_type, new_extents,
+                              mutate(op->condition), mutate(op->body),
+                              op->new_expr, op->free_function);
+    }
+
 public:
 
     using IRMutator2::mutate;
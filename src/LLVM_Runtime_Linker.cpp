@@ -94,6 +94,7 @@ DECLARE_CPP_INITMOD(ios_io)
 DECLARE_CPP_INITMOD(linux_clock)
 DECLARE_CPP_INITMOD(linux_host_cpu_count)
 DECLARE_CPP_INITMOD(linux_opengl_context)
+DECLARE_CPP_INITMOD(linux_perf_counters)
 DECLARE_CPP_INITMOD(linux_yield)
 DECLARE_CPP_INITMOD(matlab)
 DECLARE_CPP_INITMOD(metadata)
@@ -803,6 +804,9 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 } else {
                     modules.push_back(get_initmod_profiler(c, bits_64, debug));
                 }
+                if (t.os == Target::Linux && t.arch == Target::X86) {
+                    modules.push_back(get_initmod_linux_perf_counters(c, bits_64, debug));
+                }
             }
 
             if (t.has_feature(Target::MSAN)) {
@@ -853,7 +857,9 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             if (t.has_feature(Target::AVX2)) {
                 modules.push_back(get_initmod_x86_avx2_ll(c));
             }
-            if (t.has_feature(Target::Profile)) {
+            if (t.has_feature(Target::Profile) ||
+                t.has_feature(Target::ProfileCounters) ||
+                t.has_feature(Target::ProfileTimeline)) {
                 modules.push_back(get_initmod_profiler_inlined(c, bits_64, debug));
             }
         }
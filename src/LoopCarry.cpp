@@ -484,6 +484,12 @@ class LoopCarryOverLoop : public IRMutator2 {
         return op;
     }
 
+    Stmt visit(const Atomic *op) override {
+        // Other threads may write to the locations an atomic update
+        // loads from between iterations.
+        return op;
+    }
+
 public:
     LoopCarryOverLoop(const string &var, const Scope<> &s, int max_carried_values)
         : in_consume(s), max_carried_values(max_carried_values) {
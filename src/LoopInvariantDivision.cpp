@@ -0,0 +1,297 @@
+#include <map>
+
+#include "LoopInvariantDivision.h"
+#include "CSE.h"
+#include "IREquality.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Scope.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Is it safe to compute an Expr once before a loop instead of inside
+// it?
+class IsLoopInvariant : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        if (!op->is_pure()) {
+            result = false;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+    void visit(const Load *op) override {
+        result = false;
+    }
+
+    void visit(const Variable *op) override {
+        if (varying.contains(op->name)) {
+            result = false;
+        }
+    }
+
+public:
+    const Scope<> &varying;
+    bool result = true;
+
+    IsLoopInvariant(const Scope<> &v) : varying(v) {}
+};
+
+// The names of the values used to divide by a divisor d. To divide
+// an unsigned N-bit n by d >= 1, let l = ceil(log2(d)), and let
+// multiplier = floor(2^N * (2^l - d) / d) + 1. Then
+//
+//   t = (n * multiplier) >> N
+//   n / d = (t + ((n - t) >> shift1)) >> shift2
+//
+// where shift1 = min(l, 1) and shift2 = max(l, 1) - 1. This is the
+// branch-free method from Granlund and Montgomery, "Division by
+// invariant integers using multiplication", which is also used by
+// libdivide. It is exact for all n and d, and nothing in it
+// overflows. Signed division is reduced to unsigned division by |d|.
+struct Magic {
+    // The divisor, and its absolute value as an unsigned int.
+    Expr divisor, abs_divisor;
+    Expr multiplier, shift1, shift2;
+};
+
+// Replace divisions and mods by values that don't vary inside a loop
+// body.
+class ReplaceDivisions : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Scope<> varying;
+    map<Expr, Magic, IRDeepCompare> magics;
+
+    bool should_replace(const Expr &a, const Expr &b) {
+        Type t = a.type();
+        if (!(t.is_int() || t.is_uint()) ||
+            !(t.bits() == 8 || t.bits() == 16 || t.bits() == 32)) {
+            return false;
+        }
+        Expr d = b;
+        if (const Broadcast *bc = d.as<Broadcast>()) {
+            d = bc->value;
+        }
+        if (!d.type().is_scalar() || is_const(d)) {
+            return false;
+        }
+        IsLoopInvariant check(varying);
+        d.accept(&check);
+        return check.result;
+    }
+
+    const Magic &get_magic(Expr b) {
+        if (const Broadcast *bc = b.as<Broadcast>()) {
+            b = bc->value;
+        }
+        auto it = magics.find(b);
+        if (it != magics.end()) {
+            return it->second;
+        }
+
+        Type t = b.type();
+        Type ut = t.with_code(Type::UInt);
+        Type wide = ut.with_bits(t.bits() * 2);
+        string name = unique_name('d');
+
+        Magic m;
+        m.divisor = Variable::make(t, name);
+        lets.push_back({name, b});
+
+        if (t.is_int()) {
+            Expr abs_divisor = select(m.divisor < 0,
+                                      make_zero(ut) - cast(ut, m.divisor),
+                                      cast(ut, m.divisor));
+            m.abs_divisor = Variable::make(ut, name + ".abs");
+            lets.push_back({name + ".abs", abs_divisor});
+        } else {
+            m.abs_divisor = m.divisor;
+        }
+        Expr d = m.abs_divisor;
+
+        // l = ceil(log2(d))
+        Expr l = make_const(ut, t.bits()) - count_leading_zeros(d - 1);
+
+        // Compute the multiplier at twice the width. d is clamped
+        // to be at least one, because the multiplier may be computed
+        // even if no division by d happens inside the loop. The
+        // division is made directly with the intrinsic (which is
+        // the same as Div for unsigned types), so that a pass over
+        // an enclosing loop doesn't try to rewrite it.
+        Expr wide_d = cast(wide, d);
+        Expr multiplier = ((make_one(wide) << cast(wide, l)) - wide_d) << t.bits();
+        multiplier = Call::make(wide, Call::div_round_to_zero,
+                                {multiplier, max(wide_d, make_one(wide))},
+                                Call::PureIntrinsic);
+        multiplier = cast(ut, multiplier + 1);
+        m.multiplier = Variable::make(ut, name + ".multiplier");
+        lets.push_back({name + ".multiplier", common_subexpression_elimination(multiplier)});
+
+        Expr shift1 = min(l, make_one(ut));
+        Expr shift2 = max(l, make_one(ut)) - 1;
+        m.shift1 = Variable::make(ut, name + ".shift1");
+        m.shift2 = Variable::make(ut, name + ".shift2");
+        lets.push_back({name + ".shift1", common_subexpression_elimination(shift1)});
+        lets.push_back({name + ".shift2", common_subexpression_elimination(shift2)});
+
+        return magics[b] = m;
+    }
+
+    // Divide an unsigned numerator by the absolute value of the divisor.
+    Expr unsigned_divide(const Expr &n, const Magic &m) {
+        Type ut = n.type();
+        Type wide = ut.with_bits(ut.bits() * 2);
+        int lanes = ut.lanes();
+        Expr multiplier = m.multiplier, shift1 = m.shift1, shift2 = m.shift2;
+        if (lanes > 1) {
+            multiplier = Broadcast::make(multiplier, lanes);
+            shift1 = Broadcast::make(shift1, lanes);
+            shift2 = Broadcast::make(shift2, lanes);
+        }
+        Expr t = cast(ut, (cast(wide, n) * cast(wide, multiplier)) >> ut.bits());
+        return (t + ((n - t) >> shift1)) >> shift2;
+    }
+
+    Expr lower(const Expr &a, const Expr &b, bool is_mod) {
+        const Magic &m = get_magic(b);
+        Type t = a.type();
+        Type ut = t.with_code(Type::UInt);
+        int lanes = t.lanes();
+        Expr abs_divisor = m.abs_divisor;
+        if (lanes > 1) {
+            abs_divisor = Broadcast::make(abs_divisor, lanes);
+        }
+
+        Expr result;
+        if (t.is_uint()) {
+            Expr q = unsigned_divide(a, m);
+            result = is_mod ? a - q * abs_divisor : q;
+        } else {
+            // Flip the bits of a negative numerator, divide, and then
+            // flip them back to get floor(a / |b|).
+            Expr sign = cast(ut, a >> make_const(t, t.bits() - 1));
+            Expr q = unsigned_divide(cast(ut, a) ^ sign, m) ^ sign;
+            if (is_mod) {
+                // a - floor(a / |b|) * |b| is the Euclidean
+                // remainder. Compute it unsigned so that it wraps
+                // rather than overflowing.
+                result = cast(ut, a) - q * abs_divisor;
+            } else {
+                // The Euclidean quotient is floor(a / |b|) * sign(b).
+                result = select(m.divisor < 0, make_zero(ut) - q, q);
+            }
+            result = cast(t, result);
+        }
+        return common_subexpression_elimination(result);
+    }
+
+    Expr visit(const Div *op) override {
+        Expr a = mutate(op->a), b = mutate(op->b);
+        if (should_replace(a, b)) {
+            return lower(a, b, false);
+        } else if (a.same_as(op->a) && b.same_as(op->b)) {
+            return op;
+        } else {
+            return Div::make(a, b);
+        }
+    }
+
+    Expr visit(const Mod *op) override {
+        Expr a = mutate(op->a), b = mutate(op->b);
+        if (should_replace(a, b)) {
+            return lower(a, b, true);
+        } else if (a.same_as(op->a) && b.same_as(op->b)) {
+            return op;
+        } else {
+            return Mod::make(a, b);
+        }
+    }
+
+    Expr visit(const Let *op) override {
+        Expr value = mutate(op->value);
+        varying.push(op->name);
+        Expr body = mutate(op->body);
+        varying.pop(op->name);
+        return Let::make(op->name, value, body);
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        Expr value = mutate(op->value);
+        varying.push(op->name);
+        Stmt body = mutate(op->body);
+        varying.pop(op->name);
+        return LetStmt::make(op->name, value, body);
+    }
+
+    Stmt visit(const For *op) override {
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host) {
+            return op;
+        }
+        Expr min = mutate(op->min);
+        Expr extent = mutate(op->extent);
+        varying.push(op->name);
+        Stmt body = mutate(op->body);
+        varying.pop(op->name);
+        return For::make(op->name, min, extent, op->for_type, op->device_api, body);
+    }
+
+public:
+    // The values to compute before the loop, in order.
+    vector<pair<string, Expr>> lets;
+
+    ReplaceDivisions(const string &loop_var) {
+        varying.push(loop_var);
+    }
+};
+
+class LowerLoopInvariantDivision : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Stmt visit(const For *op) override {
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host) {
+            // Leave device code alone.
+            return op;
+        }
+
+        // Replace the divisions by values that don't vary in this
+        // loop, including those in inner loops, and then handle the
+        // rest in the inner loops. This computes the values for each
+        // divisor once, outside the outermost loop possible.
+        ReplaceDivisions replacer(op->name);
+        Stmt body = replacer.mutate(op->body);
+        body = mutate(body);
+
+        Stmt stmt;
+        if (body.same_as(op->body)) {
+            stmt = op;
+        } else {
+            stmt = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+        }
+        for (auto it = replacer.lets.rbegin(); it != replacer.lets.rend(); it++) {
+            stmt = LetStmt::make(it->first, it->second, stmt);
+        }
+        return stmt;
+    }
+};
+
+}  // namespace
+
+Stmt lower_loop_invariant_division(Stmt s) {
+    return LowerLoopInvariantDivision().mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,25 @@
+#ifndef HALIDE_LOOP_INVARIANT_DIVISION_H
+#define HALIDE_LOOP_INVARIANT_DIVISION_H
+
+/** \file
+ * Defines a lowering pass that speeds up integer division and modulo
+ * by values that are not constant, but do not vary within a loop.
+ */
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Rewrite integer divisions and mods by a loop-invariant divisor
+ * (e.g. a Param) inside a loop into a multiply-high and shifts, using
+ * a magic multiplier and shift amounts computed once outside the
+ * loop. Division and modulo by constants are left to codegen, which
+ * already handles them this way. Loops that run on a device other
+ * than the host are left alone. */
+Stmt lower_loop_invariant_division(Stmt s);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -8,6 +8,7 @@
 #include "AddImageChecks.h"
 #include "AddParameterChecks.h"
 #include "AllocationBoundsInference.h"
+#include "AsyncProducers.h"
 #include "BoundSmallAllocations.h"
 #include "Bounds.h"
 #include "BoundsInference.h"
@@ -18,6 +19,7 @@
 #include "DebugToFile.h"
 #include "Deinterleave.h"
 #include "EarlyFree.h"
+#include "ExprInterner.h"
 #include "FindCalls.h"
 #include "Func.h"
 #include "Function.h"
@@ -33,8 +35,11 @@
 #include "Inline.h"
 #include "LICM.h"
 #include "LoopCarry.h"
+#include "LoopInvariantDivision.h"
 #include "LowerWarpShuffles.h"
+#include "LoweringCache.h"
 #include "Memoization.h"
+#include "MemoryPlanning.h"
 #include "PartitionLoops.h"
 #include "Prefetch.h"
 #include "Profiling.h"
@@ -76,10 +81,18 @@ using std::vector;
 
 Module lower(const vector<Function> &output_funcs, const string &pipeline_name, const Target &t,
              const vector<Argument> &args, const LinkageType linkage_type,
-             const vector<IRMutator2 *> &custom_passes) {
+             const vector<IRMutator2 *> &custom_passes,
+             const Parameter &memory_planning_scratch) {
     std::vector<std::string> namespaces;
     std::string simple_pipeline_name = extract_namespaces(pipeline_name, namespaces);
 
+    // If enabled, share equal subexpressions made during lowering.
+    ScopedExprInterning interning;
+
+    // Remember the bounds of expressions queried more than once, in
+    // this pass or in a later one.
+    ScopedBoundsCache bounds_cache;
+
     Module result_module(simple_pipeline_name, t);
 
     // Compute an environment
@@ -118,29 +131,44 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
     // specializations' conditions
     simplify_specializations(env);
 
+    // Time each lowering pass, and reuse its result from an earlier
+    // call to lower if the cache is enabled and nothing it depends on
+    // has changed.
+    LoweringPassRunner passes(outputs, env, pipeline_name, t);
+
     debug(1) << "Creating initial loop nests...\n";
     bool any_memoized = false;
-    Stmt s = schedule_functions(outputs, fused_groups, env, t, any_memoized);
+    Stmt s = passes.run("schedule_functions", Stmt(), [&](const Stmt &) {
+        return schedule_functions(outputs, fused_groups, env, t, any_memoized);
+    }, &any_memoized);
     debug(2) << "Lowering after creating initial loop nests:\n" << s << '\n';
 
     debug(1) << "Canonicalizing GPU var names...\n";
-    s = canonicalize_gpu_vars(s);
+    s = passes.run_stmt_pass("canonicalize_gpu_vars", s, [&](const Stmt &s) {
+        return canonicalize_gpu_vars(s);
+    });
     debug(2) << "Lowering after canonicalizing GPU var names:\n" << s << '\n';
 
     if (any_memoized) {
         debug(1) << "Injecting memoization...\n";
-        s = inject_memoization(s, env, pipeline_name, outputs);
+        s = passes.run("inject_memoization", s, [&](const Stmt &s) {
+            return inject_memoization(s, env, pipeline_name, outputs);
+        });
         debug(2) << "Lowering after injecting memoization:\n" << s << '\n';
     } else {
         debug(1) << "Skipping injecting memoization...\n";
     }
 
     debug(1) << "Injecting tracing...\n";
-    s = inject_tracing(s, pipeline_name, env, outputs, t);
+    s = passes.run("inject_tracing", s, [&](const Stmt &s) {
+        return inject_tracing(s, pipeline_name, env, outputs, t);
+    });
     debug(2) << "Lowering after injecting tracing:\n" << s << '\n';
 
     debug(1) << "Adding checks for parameters\n";
-    s = add_parameter_checks(s, t);
+    s = passes.run_stmt_pass("add_parameter_checks", s, [&](const Stmt &s) {
+        return add_parameter_checks(s, t);
+    });
     debug(2) << "Lowering after injecting parameter checks:\n" << s << '\n';
 
     // Compute the maximum and minimum possible value of each
@@ -151,70 +179,106 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
     // The checks will be in terms of the symbols defined by bounds
     // inference.
     debug(1) << "Adding checks for images\n";
-    s = add_image_checks(s, outputs, t, order, env, func_bounds);
+    s = passes.run("add_image_checks", s, [&](const Stmt &s) {
+        return add_image_checks(s, outputs, t, order, env, func_bounds);
+    });
     debug(2) << "Lowering after injecting image checks:\n" << s << '\n';
 
     // This pass injects nested definitions of variable names, so we
     // can't simplify statements from here until we fix them up. (We
     // can still simplify Exprs).
     debug(1) << "Performing computation bounds inference...\n";
-    s = bounds_inference(s, outputs, order, fused_groups, env, func_bounds, t);
+    s = passes.run("bounds_inference", s, [&](const Stmt &s) {
+        return bounds_inference(s, outputs, order, fused_groups, env, func_bounds, t);
+    });
     debug(2) << "Lowering after computation bounds inference:\n" << s << '\n';
 
     debug(1) << "Performing sliding window optimization...\n";
-    s = sliding_window(s, env);
+    s = passes.run("sliding_window", s, [&](const Stmt &s) {
+        return sliding_window(s, env);
+    });
     debug(2) << "Lowering after sliding window:\n" << s << '\n';
 
     debug(1) << "Performing allocation bounds inference...\n";
-    s = allocation_bounds_inference(s, env, func_bounds);
+    s = passes.run("allocation_bounds_inference", s, [&](const Stmt &s) {
+        return allocation_bounds_inference(s, env, func_bounds);
+    });
     debug(2) << "Lowering after allocation bounds inference:\n" << s << '\n';
 
     debug(1) << "Removing code that depends on undef values...\n";
-    s = remove_undef(s);
+    s = passes.run_stmt_pass("remove_undef", s, [&](const Stmt &s) {
+        return remove_undef(s);
+    });
     debug(2) << "Lowering after removing code that depends on undef values:\n" << s << "\n\n";
 
     // This uniquifies the variable names, so we're good to simplify
     // after this point. This lets later passes assume syntactic
     // equivalence means semantic equivalence.
     debug(1) << "Uniquifying variable names...\n";
-    s = uniquify_variable_names(s);
+    s = passes.run_stmt_pass("uniquify_variable_names", s, [&](const Stmt &s) {
+        return uniquify_variable_names(s);
+    });
     debug(2) << "Lowering after uniquifying variable names:\n" << s << "\n\n";
 
     debug(1) << "Simplifying...\n";
-    s = simplify(s, false); // Keep dead lets. Storage flattening needs them.
+    s = passes.run_stmt_pass("simplify", s, [&](const Stmt &s) {
+        return simplify(s, false); // Keep dead lets. Storage flattening needs them.
+    });
     debug(2) << "Lowering after first simplification:\n" << s << "\n\n";
 
     debug(1) << "Performing storage folding optimization...\n";
-    s = storage_folding(s, env);
+    s = passes.run("storage_folding", s, [&](const Stmt &s) {
+        return storage_folding(s, env);
+    });
     debug(2) << "Lowering after storage folding:\n" << s << '\n';
 
     debug(1) << "Injecting debug_to_file calls...\n";
-    s = debug_to_file(s, outputs, env);
+    s = passes.run("debug_to_file", s, [&](const Stmt &s) {
+        return debug_to_file(s, outputs, env);
+    });
     debug(2) << "Lowering after injecting debug_to_file calls:\n" << s << '\n';
 
     debug(1) << "Injecting prefetches...\n";
-    s = inject_prefetch(s, env);
+    s = passes.run("inject_prefetch", s, [&](const Stmt &s) {
+        return inject_prefetch(s, env);
+    });
     debug(2) << "Lowering after injecting prefetches:\n" << s << "\n\n";
 
     debug(1) << "Dynamically skipping stages...\n";
-    s = skip_stages(s, order);
+    s = passes.run("skip_stages", s, [&](const Stmt &s) {
+        return skip_stages(s, order);
+    });
     debug(2) << "Lowering after dynamically skipping stages:\n" << s << "\n\n";
 
+    debug(1) << "Forking asynchronous producers...\n";
+    s = passes.run("fork_async_producers", s, [&](const Stmt &s) {
+        return fork_async_producers(s, env);
+    });
+    debug(2) << "Lowering after forking asynchronous producers:\n" << s << "\n\n";
+
     debug(1) << "Destructuring tuple-valued realizations...\n";
-    s = split_tuples(s, env);
+    s = passes.run("split_tuples", s, [&](const Stmt &s) {
+        return split_tuples(s, env);
+    });
     debug(2) << "Lowering after destructuring tuple-valued realizations:\n" << s << "\n\n";
 
     debug(1) << "Performing storage flattening...\n";
-    s = storage_flattening(s, outputs, env, t);
+    s = passes.run("storage_flattening", s, [&](const Stmt &s) {
+        return storage_flattening(s, outputs, env, t);
+    });
     debug(2) << "Lowering after storage flattening:\n" << s << "\n\n";
 
     debug(1) << "Unpacking buffer arguments...\n";
-    s = unpack_buffers(s);
+    s = passes.run_stmt_pass("unpack_buffers", s, [&](const Stmt &s) {
+        return unpack_buffers(s);
+    });
     debug(2) << "Lowering after unpacking buffer arguments...\n" << s << "\n\n";
 
     if (any_memoized) {
         debug(1) << "Rewriting memoized allocations...\n";
-        s = rewrite_memoized_allocations(s, env);
+        s = passes.run("rewrite_memoized_allocations", s, [&](const Stmt &s) {
+            return rewrite_memoized_allocations(s, env);
+        });
         debug(2) << "Lowering after rewriting memoized allocations:\n" << s << "\n\n";
     } else {
         debug(1) << "Skipping rewriting memoized allocations...\n";
@@ -225,109 +289,200 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
         t.has_feature(Target::OpenGL) ||
         (t.arch != Target::Hexagon && (t.features_any_of({Target::HVX_64, Target::HVX_128})))) {
         debug(1) << "Selecting a GPU API for GPU loops...\n";
-        s = select_gpu_api(s, t);
+        s = passes.run_stmt_pass("select_gpu_api", s, [&](const Stmt &s) {
+            return select_gpu_api(s, t);
+        });
         debug(2) << "Lowering after selecting a GPU API:\n" << s << "\n\n";
 
         debug(1) << "Injecting host <-> dev buffer copies...\n";
-        s = inject_host_dev_buffer_copies(s, t);
+        s = passes.run("inject_host_dev_buffer_copies", s, [&](const Stmt &s) {
+            return inject_host_dev_buffer_copies(s, t);
+        });
         debug(2) << "Lowering after injecting host <-> dev buffer copies:\n" << s << "\n\n";
 
         debug(1) << "Selecting a GPU API for extern stages...\n";
-        s = select_gpu_api(s, t);
+        s = passes.run_stmt_pass("select_gpu_api.2", s, [&](const Stmt &s) {
+            return select_gpu_api(s, t);
+        });
         debug(2) << "Lowering after selecting a GPU API for extern stages:\n" << s << "\n\n";
     }
 
     if (t.has_feature(Target::OpenGL)) {
         debug(1) << "Injecting OpenGL texture intrinsics...\n";
-        s = inject_opengl_intrinsics(s);
+        s = passes.run_stmt_pass("inject_opengl_intrinsics", s, [&](const Stmt &s) {
+            return inject_opengl_intrinsics(s);
+        });
         debug(2) << "Lowering after OpenGL intrinsics:\n" << s << "\n\n";
     }
 
     if (t.has_gpu_feature() ||
         t.has_feature(Target::OpenGLCompute)) {
         debug(1) << "Injecting per-block gpu synchronization...\n";
-        s = fuse_gpu_thread_loops(s);
+        s = passes.run_stmt_pass("fuse_gpu_thread_loops", s, [&](const Stmt &s) {
+            return fuse_gpu_thread_loops(s);
+        });
         debug(2) << "Lowering after injecting per-block gpu synchronization:\n" << s << "\n\n";
     }
 
     debug(1) << "Simplifying...\n";
-    s = simplify(s);
-    s = unify_duplicate_lets(s);
-    s = remove_trivial_for_loops(s);
+    s = passes.run_stmt_pass("simplify.2", s, [&](const Stmt &s) {
+        return simplify(s);
+    });
+    s = passes.run_stmt_pass("unify_duplicate_lets", s, [&](const Stmt &s) {
+        return unify_duplicate_lets(s);
+    });
+    s = passes.run_stmt_pass("remove_trivial_for_loops", s, [&](const Stmt &s) {
+        return remove_trivial_for_loops(s);
+    });
     debug(2) << "Lowering after second simplifcation:\n" << s << "\n\n";
 
     debug(1) << "Reduce prefetch dimension...\n";
-    s = reduce_prefetch_dimension(s, t);
+    s = passes.run_stmt_pass("reduce_prefetch_dimension", s, [&](const Stmt &s) {
+        return reduce_prefetch_dimension(s, t);
+    });
     debug(2) << "Lowering after reduce prefetch dimension:\n" << s << "\n";
 
     debug(1) << "Unrolling...\n";
-    s = unroll_loops(s);
-    s = simplify(s);
+    s = passes.run_stmt_pass("unroll_loops", s, [&](const Stmt &s) {
+        return unroll_loops(s);
+    });
+    s = passes.run_stmt_pass("simplify.3", s, [&](const Stmt &s) {
+        return simplify(s);
+    });
     debug(2) << "Lowering after unrolling:\n" << s << "\n\n";
 
     debug(1) << "Vectorizing...\n";
-    s = vectorize_loops(s, t);
-    s = simplify(s);
+    s = passes.run_stmt_pass("vectorize_loops", s, [&](const Stmt &s) {
+        return vectorize_loops(s, t);
+    });
+    s = passes.run_stmt_pass("simplify.4", s, [&](const Stmt &s) {
+        return simplify(s);
+    });
     debug(2) << "Lowering after vectorizing:\n" << s << "\n\n";
 
     debug(1) << "Detecting vector interleavings...\n";
-    s = rewrite_interleavings(s);
-    s = simplify(s);
+    s = passes.run_stmt_pass("rewrite_interleavings", s, [&](const Stmt &s) {
+        return rewrite_interleavings(s);
+    });
+    s = passes.run_stmt_pass("simplify.5", s, [&](const Stmt &s) {
+        return simplify(s);
+    });
     debug(2) << "Lowering after rewriting vector interleavings:\n" << s << "\n\n";
 
     debug(1) << "Partitioning loops to simplify boundary conditions...\n";
-    s = partition_loops(s);
-    s = simplify(s);
+    s = passes.run_stmt_pass("partition_loops", s, [&](const Stmt &s) {
+        return partition_loops(s);
+    });
+    s = passes.run_stmt_pass("simplify.6", s, [&](const Stmt &s) {
+        return simplify(s);
+    });
     debug(2) << "Lowering after partitioning loops:\n" << s << "\n\n";
 
     debug(1) << "Trimming loops to the region over which they do something...\n";
-    s = trim_no_ops(s);
+    s = passes.run_stmt_pass("trim_no_ops", s, [&](const Stmt &s) {
+        return trim_no_ops(s);
+    });
     debug(2) << "Lowering after loop trimming:\n" << s << "\n\n";
 
     debug(1) << "Injecting early frees...\n";
-    s = inject_early_frees(s);
+    s = passes.run_stmt_pass("inject_early_frees", s, [&](const Stmt &s) {
+        return inject_early_frees(s);
+    });
     debug(2) << "Lowering after injecting early frees:\n" << s << "\n\n";
 
-    if (t.has_feature(Target::Profile)) {
+    if (t.has_feature(Target::Profile) ||
+        t.has_feature(Target::ProfileCounters) ||
+        t.has_feature(Target::ProfileTimeline)) {
+        bool counters = t.has_feature(Target::ProfileCounters);
+        bool timeline = t.has_feature(Target::ProfileTimeline);
+        user_assert(!counters || (t.os == Target::Linux && t.arch == Target::X86))
+            << "The profile_counters target feature is only supported on x86 Linux, "
+            << "but the target is " << t.to_string() << "\n";
         debug(1) << "Injecting profiling...\n";
-        s = inject_profiling(s, pipeline_name);
+        s = passes.run("inject_profiling", s, [&](const Stmt &s) {
+            return inject_profiling(s, pipeline_name, counters, timeline);
+        });
         debug(2) << "Lowering after injecting profiling:\n" << s << "\n\n";
     }
 
     if (t.has_feature(Target::FuzzFloatStores)) {
         debug(1) << "Fuzzing floating point stores...\n";
-        s = fuzz_float_stores(s);
+        s = passes.run_stmt_pass("fuzz_float_stores", s, [&](const Stmt &s) {
+            return fuzz_float_stores(s);
+        });
         debug(2) << "Lowering after fuzzing floating point stores:\n" << s << "\n\n";
     }
 
     debug(1) << "Bounding small allocations...\n";
-    s = bound_small_allocations(s);
+    s = passes.run_stmt_pass("bound_small_allocations", s, [&](const Stmt &s) {
+        return bound_small_allocations(s);
+    });
     debug(2) << "Lowering after bounding small allocations:\n" << s << "\n\n";
 
+    if (t.has_feature(Target::PlanMemory) || memory_planning_scratch.defined()) {
+        debug(1) << "Planning memory...\n";
+        if (memory_planning_scratch.defined()) {
+            // The result depends on the scratch buffer, which isn't
+            // part of the context the pass runner keys the cache on.
+            s = plan_memory(s, t, memory_planning_scratch);
+        } else {
+            s = passes.run_stmt_pass("plan_memory", s, [&](const Stmt &s) {
+                return plan_memory(s, t, Parameter());
+            });
+        }
+        debug(2) << "Lowering after planning memory:\n" << s << "\n\n";
+    }
+
     if (t.has_feature(Target::CUDA)) {
         debug(1) << "Injecting warp shuffles...\n";
-        s = lower_warp_shuffles(s);
+        s = passes.run_stmt_pass("lower_warp_shuffles", s, [&](const Stmt &s) {
+            return lower_warp_shuffles(s);
+        });
         debug(2) << "Lowering after injecting warp shuffles:\n" << s << "\n\n";
     }
 
+    if (t.arch != Target::Hexagon) {
+        // HVX has no 64-bit lanes for the widening multiplies.
+        debug(1) << "Lowering division by loop invariants...\n";
+        s = passes.run_stmt_pass("lower_loop_invariant_division", s, [&](const Stmt &s) {
+            return lower_loop_invariant_division(s);
+        });
+        debug(2) << "Lowering after lowering division by loop invariants:\n" << s << "\n\n";
+    }
+
     debug(1) << "Simplifying...\n";
-    s = common_subexpression_elimination(s);
+    s = passes.run_stmt_pass("common_subexpression_elimination", s, [&](const Stmt &s) {
+        return common_subexpression_elimination(s);
+    });
 
     if (t.has_feature(Target::OpenGL)) {
         debug(1) << "Detecting varying attributes...\n";
-        s = find_linear_expressions(s);
+        s = passes.run_stmt_pass("find_linear_expressions", s, [&](const Stmt &s) {
+            return find_linear_expressions(s);
+        });
         debug(2) << "Lowering after detecting varying attributes:\n" << s << "\n\n";
 
         debug(1) << "Moving varying attribute expressions out of the shader...\n";
-        s = setup_gpu_vertex_buffer(s);
+        s = passes.run_stmt_pass("setup_gpu_vertex_buffer", s, [&](const Stmt &s) {
+            return setup_gpu_vertex_buffer(s);
+        });
         debug(2) << "Lowering after removing varying attributes:\n" << s << "\n\n";
     }
 
-    s = remove_dead_allocations(s);
-    s = remove_trivial_for_loops(s);
-    s = simplify(s);
-    s = loop_invariant_code_motion(s);
+    s = passes.run_stmt_pass("remove_dead_allocations", s, [&](const Stmt &s) {
+        return remove_dead_allocations(s);
+    });
+    s = passes.run_stmt_pass("remove_trivial_for_loops.2", s, [&](const Stmt &s) {
+        return remove_trivial_for_loops(s);
+    });
+    s = passes.run_stmt_pass("simplify.7", s, [&](const Stmt &s) {
+        return simplify(s);
+    });
+    s = passes.run_stmt_pass("loop_invariant_code_motion", s, [&](const Stmt &s) {
+        return loop_invariant_code_motion(s);
+    });
     debug(1) << "Lowering after final simplification:\n" << s << "\n\n";
+    passes.report();
 
     if (t.arch != Target::Hexagon && (t.features_any_of({Target::HVX_64, Target::HVX_128}))) {
         debug(1) << "Splitting off Hexagon offload...\n";
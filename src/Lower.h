@@ -12,6 +12,7 @@
 #include "Argument.h"
 #include "IR.h"
 #include "Module.h"
+#include "Parameter.h"
 #include "Target.h"
 
 namespace Halide {
@@ -25,10 +26,13 @@ class IRMutator2;
  * contain submodules for computation offloaded to another execution
  * engine or API as well as buffers that are used in the passed in
  * Stmt. Multiple LoweredFuncs are added to support legacy buffer_t
- * calling convention. */
+ * calling convention. If memory_planning_scratch is defined, heap
+ * allocations are packed into a single block of memory that is taken
+ * from that buffer parameter when possible (see plan_memory). */
 Module lower(const std::vector<Function> &output_funcs, const std::string &pipeline_name, const Target &t,
                     const std::vector<Argument> &args, const LinkageType linkage_type,
-                    const std::vector<IRMutator2 *> &custom_passes = std::vector<IRMutator2 *>());
+                    const std::vector<IRMutator2 *> &custom_passes = std::vector<IRMutator2 *>(),
+                    const Parameter &memory_planning_scratch = Parameter());
 
 /** Given a halide function with a schedule, create a statement that
  * evaluates it. Automatically pulls in all the functions f depends
@@ -0,0 +1,628 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <sstream>
+
+#include "LoweringCache.h"
+
+#include "Bounds.h"
+#include "Debug.h"
+#include "IREquality.h"
+#include "IRMutator.h"
+#include "IRPrinter.h"
+#include "IRVisitor.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Prints Exprs with everything that distinguishes them from other
+// Exprs, so that two environments that print the same lower the same.
+class FingerprintPrinter : public IRPrinter {
+    using IRPrinter::visit;
+
+    void visit(const Variable *op) override {
+        stream << op->type << ' ';
+        IRPrinter::visit(op);
+    }
+
+    void visit(const Call *op) override {
+        stream << op->type << ' ' << (int)op->call_type << ' ' << op->value_index << ' ';
+        IRPrinter::visit(op);
+    }
+
+public:
+    FingerprintPrinter(std::ostream &s) : IRPrinter(s) {
+        // Print floating point constants exactly.
+        s << std::setprecision(std::numeric_limits<double>::max_digits10);
+    }
+
+    void print_expr(const Expr &e) {
+        if (e.defined()) {
+            print(e);
+        } else {
+            stream << "(undef)";
+        }
+        stream << ' ';
+    }
+};
+
+// Find the Parameters and Buffers referred to by the environment.
+class FindParametersAndBuffers : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Variable *op) override {
+        if (op->param.defined()) {
+            add(op->param);
+        }
+        if (op->image.defined()) {
+            add(op->image);
+        }
+    }
+
+    void visit(const Call *op) override {
+        IRGraphVisitor::visit(op);
+        if (op->param.defined()) {
+            add(op->param);
+        }
+        if (op->image.defined()) {
+            add(op->image);
+        }
+    }
+
+public:
+    map<string, Parameter> params;
+    map<string, Buffer<>> buffers;
+
+    void add(const Parameter &p) {
+        params.emplace(p.name(), p);
+    }
+
+    void add(const Buffer<> &b) {
+        buffers.emplace(b.name(), b);
+    }
+};
+
+void print_definition(const Definition &def, FingerprintPrinter &printer, std::ostream &s) {
+    s << "definition " << def.is_init() << "\nargs ";
+    for (const Expr &e : def.args()) {
+        printer.print_expr(e);
+    }
+    s << "\nvalues ";
+    for (const Expr &e : def.values()) {
+        printer.print_expr(e);
+    }
+    s << "\npredicate ";
+    printer.print_expr(def.predicate());
+    s << "\n";
+
+    const StageSchedule &sched = def.schedule();
+    s << "stage_schedule " << sched.touched() << ' ' << sched.allow_race_conditions()
+      << ' ' << sched.atomic() << "\n";
+    for (const ReductionVariable &rv : sched.rvars()) {
+        s << "rvar " << rv.var << ' ';
+        printer.print_expr(rv.min);
+        printer.print_expr(rv.extent);
+        s << "\n";
+    }
+    for (const Split &split : sched.splits()) {
+        s << "split " << split.old_var << ' ' << split.outer << ' ' << split.inner << ' '
+          << split.exact << ' ' << (int)split.tail << ' ' << (int)split.split_type << ' ';
+        printer.print_expr(split.factor);
+        s << "\n";
+    }
+    for (const Dim &dim : sched.dims()) {
+        s << "dim " << dim.var << ' ' << dim.for_type << ' ' << dim.device_api
+          << ' ' << (int)dim.dim_type << "\n";
+    }
+    for (const PrefetchDirective &p : sched.prefetches()) {
+        s << "prefetch " << p.name << ' ' << p.var << ' ' << (int)p.strategy << ' ';
+        printer.print_expr(p.offset);
+        s << (p.param.defined() ? p.param.name() : string()) << "\n";
+    }
+    const FuseLoopLevel &fuse = sched.fuse_level();
+    s << "fuse_level " << fuse.level.to_string();
+    for (const auto &a : fuse.align) {
+        s << ' ' << a.first << ' ' << (int)a.second;
+    }
+    s << "\n";
+    for (const FusedPair &p : sched.fused_pairs()) {
+        s << "fused_pair " << p.func_1 << ' ' << p.stage_1 << ' '
+          << p.func_2 << ' ' << p.stage_2 << ' ' << p.var_name << "\n";
+    }
+
+    for (const Specialization &spec : def.specializations()) {
+        s << "specialization " << spec.failure_message << ' ';
+        printer.print_expr(spec.condition);
+        s << "\n";
+        print_definition(spec.definition, printer, s);
+    }
+}
+
+void print_bounds(const vector<Bound> &bounds, FingerprintPrinter &printer, std::ostream &s) {
+    for (const Bound &b : bounds) {
+        s << "bound " << b.var << ' ';
+        printer.print_expr(b.min);
+        printer.print_expr(b.extent);
+        printer.print_expr(b.modulus);
+        printer.print_expr(b.remainder);
+        s << "\n";
+    }
+}
+
+void print_function(const Function &f, FingerprintPrinter &printer,
+                    FindParametersAndBuffers &refs, std::ostream &s) {
+    s << "function " << f.name() << ' ' << f.origin_name() << ' ' << f.frozen() << "\nargs";
+    for (const string &arg : f.args()) {
+        s << ' ' << arg;
+    }
+    s << "\ntypes";
+    for (const Type &t : f.output_types()) {
+        s << ' ' << t;
+    }
+    s << "\n";
+
+    const FuncSchedule &sched = f.schedule();
+    s << "func_schedule " << sched.store_level().to_string() << ' '
+      << sched.compute_level().to_string() << ' ' << sched.memoized() << ' '
+      << sched.async() << ' ' << sched.memory_type() << "\n";
+    for (const StorageDim &d : sched.storage_dims()) {
+        s << "storage_dim " << d.var << ' ' << d.fold_forward << ' ';
+        printer.print_expr(d.alignment);
+        printer.print_expr(d.fold_factor);
+        s << "\n";
+    }
+    // Estimates only matter to the auto-scheduler, so changing them
+    // doesn't invalidate anything.
+    print_bounds(sched.bounds(), printer, s);
+    for (const auto &w : f.wrappers()) {
+        s << "wrapper " << w.first << ' ' << Function(w.second).name() << "\n";
+    }
+
+    if (f.has_pure_definition()) {
+        print_definition(f.definition(), printer, s);
+    }
+    for (const Definition &def : f.updates()) {
+        print_definition(def, printer, s);
+    }
+
+    if (f.has_extern_definition()) {
+        s << "extern " << f.extern_function_name() << ' '
+          << (int)f.extern_definition_name_mangling() << ' '
+          << f.extern_definition_uses_old_buffer_t() << ' '
+          << f.extern_function_device_api() << "\n";
+        for (const ExternFuncArgument &arg : f.extern_arguments()) {
+            s << "extern_arg " << (int)arg.arg_type << ' ';
+            if (arg.is_func()) {
+                s << Function(arg.func).name();
+            } else if (arg.is_expr()) {
+                printer.print_expr(arg.expr);
+            } else if (arg.is_buffer()) {
+                s << arg.buffer.name();
+                refs.add(arg.buffer);
+            } else if (arg.is_image_param()) {
+                s << arg.image_param.name();
+                refs.add(arg.image_param);
+            }
+            s << "\n";
+        }
+    }
+
+    for (const Parameter &p : f.output_buffers()) {
+        s << "output_buffer " << p.name() << "\n";
+        refs.add(p);
+    }
+
+    s << "debug_file " << f.debug_file() << "\n"
+      << "trace " << f.is_tracing_loads() << ' ' << f.is_tracing_stores()
+      << ' ' << f.is_tracing_realizations();
+    for (const string &tag : f.get_trace_tags()) {
+        s << "\ntrace_tag " << tag;
+    }
+    s << "\n";
+
+    f.accept(&refs);
+}
+
+void print_parameter(const Parameter &p, FingerprintPrinter &printer, std::ostream &s) {
+    s << "parameter " << p.name() << ' ' << p.type() << ' ' << p.is_buffer()
+      << ' ' << p.dimensions() << ' ';
+    if (p.is_buffer()) {
+        s << p.host_alignment() << ' ';
+        for (int i = 0; i < p.dimensions(); i++) {
+            printer.print_expr(p.min_constraint(i));
+            printer.print_expr(p.extent_constraint(i));
+            printer.print_expr(p.stride_constraint(i));
+        }
+    } else {
+        printer.print_expr(p.min_value());
+        printer.print_expr(p.max_value());
+    }
+    s << "\n";
+}
+
+void print_buffer(const Buffer<> &b, std::ostream &s) {
+    // Buffers are identified by address. The cache keeps the
+    // environment alive, so the address can't be reused while the
+    // entry exists.
+    s << "buffer " << b.name() << ' ' << (const void *)b.raw_buffer()
+      << ' ' << (const void *)b.data() << ' ' << b.type() << ' ' << b.dimensions();
+    for (int i = 0; i < b.dimensions(); i++) {
+        s << ' ' << b.dim(i).min() << ' ' << b.dim(i).extent() << ' ' << b.dim(i).stride();
+    }
+    s << "\n";
+}
+
+struct CacheEntry {
+    size_t context_hash;
+    std::shared_ptr<const string> context;
+    Stmt input, output;
+    bool flag;
+    // The IR holds weak references to the Functions in the
+    // environment, so keep them alive along with the entry.
+    std::shared_ptr<const map<string, Function>> env;
+};
+
+struct PassCache {
+    // Most recently used first.
+    std::list<CacheEntry> entries;
+    LoweringPassStats stats;
+};
+
+struct LoweringCache {
+    std::mutex mutex;
+    size_t max_entries_per_pass;
+    // Kept in the order the passes first ran in, for reporting.
+    vector<PassCache> passes;
+    map<string, size_t> pass_index;
+
+    LoweringCache() {
+        string size = get_env_variable("HL_LOWERING_CACHE_SIZE");
+        max_entries_per_pass = size.empty() ? 0 : std::max(0, std::atoi(size.c_str()));
+    }
+
+    PassCache &get_pass(const string &name) {
+        auto it = pass_index.find(name);
+        if (it == pass_index.end()) {
+            it = pass_index.emplace(name, passes.size()).first;
+            passes.emplace_back();
+            passes.back().stats.name = name;
+        }
+        return passes[it->second];
+    }
+
+    void trim() {
+        for (PassCache &p : passes) {
+            while (p.entries.size() > max_entries_per_pass) {
+                p.entries.pop_back();
+            }
+        }
+    }
+};
+
+LoweringCache &lowering_cache() {
+    static LoweringCache cache;
+    return cache;
+}
+
+// Point the calls in a Stmt at the Functions and Parameters in a
+// different copy of the environment. The Parameters are matched by
+// name, and the context they were cached under guarantees that the
+// ones with the same name have the same type and constraints, but
+// they are distinct objects, and the Stmt must refer to the ones the
+// caller will bind values to.
+class RebindEnvironment : public IRMutator2 {
+    const map<string, Function> &env;
+    const map<string, Parameter> &params;
+
+    using IRMutator2::visit;
+
+    Parameter rebind(const Parameter &p) {
+        if (!p.defined()) {
+            return p;
+        }
+        auto it = params.find(p.name());
+        if (it == params.end()) {
+            return p;
+        }
+        return it->second;
+    }
+
+    Expr visit(const Variable *op) override {
+        Parameter param = rebind(op->param);
+        if (param.same_as(op->param)) {
+            return op;
+        }
+        return Variable::make(op->type, op->name, op->image, param, op->reduction_domain);
+    }
+
+    Expr visit(const Call *op) override {
+        Expr expr = IRMutator2::visit(op);
+        op = expr.as<Call>();
+        internal_assert(op);
+        FunctionPtr ptr = op->func;
+        if (ptr.defined()) {
+            auto it = env.find(op->name);
+            if (it != env.end() && !it->second.get_contents().same_as(op->func)) {
+                ptr = it->second.get_contents();
+                if (op->func.weak) {
+                    ptr.weaken();
+                }
+            }
+        }
+        Parameter param = rebind(op->param);
+        if (ptr.same_as(op->func) && param.same_as(op->param)) {
+            return expr;
+        }
+        return Call::make(op->type, op->name, op->args, op->call_type,
+                          ptr, op->value_index, op->image, param);
+    }
+
+    Expr visit(const Load *op) override {
+        Expr expr = IRMutator2::visit(op);
+        op = expr.as<Load>();
+        internal_assert(op);
+        Parameter param = rebind(op->param);
+        if (param.same_as(op->param)) {
+            return expr;
+        }
+        return Load::make(op->type, op->name, op->index, op->image, param, op->predicate);
+    }
+
+    Stmt visit(const Store *op) override {
+        Stmt stmt = IRMutator2::visit(op);
+        op = stmt.as<Store>();
+        internal_assert(op);
+        Parameter param = rebind(op->param);
+        if (param.same_as(op->param)) {
+            return stmt;
+        }
+        return Store::make(op->name, op->value, op->index, param, op->predicate);
+    }
+
+    Stmt visit(const Prefetch *op) override {
+        Stmt stmt = IRMutator2::visit(op);
+        op = stmt.as<Prefetch>();
+        internal_assert(op);
+        Parameter param = rebind(op->prefetch.param);
+        if (param.same_as(op->prefetch.param)) {
+            return stmt;
+        }
+        PrefetchDirective prefetch = op->prefetch;
+        prefetch.param = param;
+        return Prefetch::make(op->name, op->types, op->bounds, prefetch, op->condition, op->body);
+    }
+
+public:
+    RebindEnvironment(const map<string, Function> &env, const map<string, Parameter> &params)
+        : env(env), params(params) {}
+};
+
+bool same_stmt(const Stmt &a, const Stmt &b) {
+    if (a.same_as(b)) {
+        return true;
+    } else if (!a.defined() || !b.defined()) {
+        return false;
+    } else {
+        return equal(a, b);
+    }
+}
+
+}  // namespace
+
+void set_lowering_cache_size(size_t entries_per_pass) {
+    LoweringCache &cache = lowering_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    cache.max_entries_per_pass = entries_per_pass;
+    cache.trim();
+}
+
+size_t lowering_cache_size() {
+    LoweringCache &cache = lowering_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    return cache.max_entries_per_pass;
+}
+
+void clear_lowering_cache() {
+    LoweringCache &cache = lowering_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    for (PassCache &p : cache.passes) {
+        p.entries.clear();
+    }
+}
+
+vector<LoweringPassStats> lowering_pass_stats() {
+    LoweringCache &cache = lowering_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    vector<LoweringPassStats> result;
+    for (const PassCache &p : cache.passes) {
+        result.push_back(p.stats);
+    }
+    return result;
+}
+
+void reset_lowering_pass_stats() {
+    LoweringCache &cache = lowering_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    for (PassCache &p : cache.passes) {
+        string name = p.stats.name;
+        p.stats = LoweringPassStats();
+        p.stats.name = name;
+    }
+}
+
+LoweringPassRunner::LoweringPassRunner(const vector<Function> &outputs,
+                                       const map<string, Function> &env,
+                                       const string &pipeline_name,
+                                       const Target &target)
+    : outputs(outputs), env(env), pipeline_name(pipeline_name), target(target) {
+}
+
+void LoweringPassRunner::compute_contexts() {
+    std::ostringstream funcs;
+    FingerprintPrinter printer(funcs);
+    FindParametersAndBuffers refs;
+
+    funcs << "pipeline " << pipeline_name << "\noutputs";
+    for (const Function &f : outputs) {
+        funcs << ' ' << f.name();
+    }
+    funcs << "\n";
+    for (const auto &p : env) {
+        print_function(p.second, printer, refs, funcs);
+    }
+
+    // Passes that only look at the Stmt can still see the Parameters
+    // and Buffers it refers to.
+    std::ostringstream stmt_only;
+    FingerprintPrinter stmt_only_printer(stmt_only);
+    stmt_only << "target " << target.to_string() << "\n";
+    for (const auto &p : refs.params) {
+        print_parameter(p.second, stmt_only_printer, stmt_only);
+    }
+    for (const auto &b : refs.buffers) {
+        print_buffer(b.second, stmt_only);
+    }
+
+    stmt_context = std::make_shared<const string>(stmt_only.str());
+    stmt_context_hash = std::hash<string>()(*stmt_context);
+    env_context = std::make_shared<const string>(*stmt_context + funcs.str());
+    env_context_hash = std::hash<string>()(*env_context);
+    env_copy = std::make_shared<const map<string, Function>>(env);
+    params = std::make_shared<const map<string, Parameter>>(std::move(refs.params));
+}
+
+Stmt LoweringPassRunner::run(const string &name, const Stmt &s,
+                             const std::function<Stmt(const Stmt &)> &pass,
+                             bool *flag) {
+    return run_pass(name, s, pass, flag, true);
+}
+
+Stmt LoweringPassRunner::run_stmt_pass(const string &name, const Stmt &s,
+                                       const std::function<Stmt(const Stmt &)> &pass) {
+    return run_pass(name, s, pass, nullptr, false);
+}
+
+Stmt LoweringPassRunner::run_pass(const string &name, const Stmt &s,
+                                  const std::function<Stmt(const Stmt &)> &pass,
+                                  bool *flag, bool uses_env) {
+    auto t1 = std::chrono::high_resolution_clock::now();
+    BoundsInferenceStats b1 = bounds_inference_stats();
+
+    LoweringCache &cache = lowering_cache();
+    size_t max_entries;
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        max_entries = cache.max_entries_per_pass;
+    }
+
+    if (max_entries > 0 && !env_copy) {
+        compute_contexts();
+    }
+    const std::shared_ptr<const string> &context = uses_env ? env_context : stmt_context;
+    size_t context_hash = uses_env ? env_context_hash : stmt_context_hash;
+
+    Stmt result;
+    bool hit = false;
+    if (max_entries > 0) {
+        std::shared_ptr<const map<string, Function>> entry_env;
+        {
+            std::lock_guard<std::mutex> lock(cache.mutex);
+            PassCache &p = cache.get_pass(name);
+            for (auto it = p.entries.begin(); it != p.entries.end(); it++) {
+                if (it->context_hash == context_hash &&
+                    (it->context == context || *(it->context) == *context) &&
+                    same_stmt(it->input, s)) {
+                    result = it->output;
+                    if (flag) {
+                        *flag = it->flag;
+                    }
+                    entry_env = it->env;
+                    hit = true;
+                    p.entries.splice(p.entries.begin(), p.entries, it);
+                    break;
+                }
+            }
+        }
+        if (hit && entry_env != env_copy) {
+            // The result came from an earlier call to lower, so it
+            // refers to that call's copy of the Functions and
+            // Parameters.
+            result = RebindEnvironment(env, *params).mutate(result);
+        }
+    }
+
+    if (!hit) {
+        result = pass(s);
+        if (max_entries > 0) {
+            std::lock_guard<std::mutex> lock(cache.mutex);
+            PassCache &p = cache.get_pass(name);
+            p.entries.push_front({context_hash, context, s, result,
+                                  flag ? *flag : false, env_copy});
+            cache.trim();
+        }
+    }
+
+    auto t2 = std::chrono::high_resolution_clock::now();
+    double seconds = std::chrono::duration<double>(t2 - t1).count();
+    BoundsInferenceStats b2 = bounds_inference_stats();
+    uint64_t bounds_queries = b2.queries - b1.queries;
+    uint64_t bounds_hits = b2.hits - b1.hits;
+    double bounds_seconds = b2.seconds - b1.seconds;
+    timings.push_back({name, seconds, hit, bounds_queries, bounds_hits, bounds_seconds});
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    LoweringPassStats &stats = cache.get_pass(name).stats;
+    stats.runs++;
+    stats.hits += hit ? 1 : 0;
+    stats.seconds += seconds;
+    stats.bounds_queries += bounds_queries;
+    stats.bounds_hits += bounds_hits;
+    stats.bounds_seconds += bounds_seconds;
+
+    return result;
+}
+
+void LoweringPassRunner::report() const {
+    if (debug::debug_level() < 1) {
+        return;
+    }
+    double total = 0, bounds_total = 0;
+    uint64_t queries = 0, hits = 0;
+    for (const Timing &t : timings) {
+        total += t.seconds;
+        bounds_total += t.bounds_seconds;
+        queries += t.bounds_queries;
+        hits += t.bounds_hits;
+    }
+    debug(1) << "Time spent in each lowering pass, and in bounds queries within it:\n";
+    for (const Timing &t : timings) {
+        debug(1) << "  " << std::left << std::setw(40) << t.name
+                 << std::right << std::fixed << std::setprecision(6) << std::setw(10) << t.seconds
+                 << std::setprecision(1) << std::setw(7) << (total > 0 ? 100 * t.seconds / total : 0) << "%";
+        if (t.bounds_queries > 0) {
+            debug(1) << std::setprecision(6) << std::setw(10) << t.bounds_seconds
+                     << std::setw(8) << t.bounds_queries << " queries, "
+                     << std::setprecision(1) << 100.0 * t.bounds_hits / t.bounds_queries << "% cached";
+        }
+        debug(1) << (t.hit ? " (cached)" : "") << "\n";
+    }
+    debug(1) << "  " << std::left << std::setw(40) << "total"
+             << std::right << std::fixed << std::setprecision(6) << std::setw(10) << total
+             << std::setw(8) << "" << std::setw(10) << bounds_total
+             << std::setw(8) << queries << " queries, "
+             << std::setprecision(1) << (queries > 0 ? 100.0 * hits / queries : 0) << "% cached\n";
+}
+
+}  // namespace Internal
+}  // namespace Halide
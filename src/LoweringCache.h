@@ -0,0 +1,130 @@
+#ifndef HALIDE_LOWERING_CACHE_H
+#define HALIDE_LOWERING_CACHE_H
+
+/** \file
+ * Defines a cache of the results of individual lowering passes, so
+ * that lowering a pipeline again after a small change to it (e.g. in
+ * an autotuning loop) can skip the passes whose inputs are unchanged.
+ */
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Function.h"
+#include "IR.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Time spent in a single lowering pass, accumulated over all calls
+ * to lower since the stats were last reset. Passes that run several
+ * times per call to lower (e.g. simplify) are counted separately for
+ * each place they are run. */
+struct LoweringPassStats {
+    std::string name;
+    uint64_t runs = 0;
+    /** How many of the runs were served from the cache. */
+    uint64_t hits = 0;
+    /** Total time spent in the pass, including cache lookups. */
+    double seconds = 0;
+    /** The bounds queries made by the pass (see BoundsInferenceStats). */
+    uint64_t bounds_queries = 0, bounds_hits = 0;
+    double bounds_seconds = 0;
+};
+
+/** Set the maximum number of results remembered per lowering pass. A
+ * size of zero (the default, unless the environment variable
+ * HL_LOWERING_CACHE_SIZE is set) disables the cache. Shrinking the
+ * cache discards the least recently used results. */
+void set_lowering_cache_size(size_t entries_per_pass);
+size_t lowering_cache_size();
+
+/** Discard all remembered lowering pass results. */
+void clear_lowering_cache();
+
+/** Get the per-pass timings of all calls to lower so far, in the
+ * order in which the passes first ran. */
+std::vector<LoweringPassStats> lowering_pass_stats();
+void reset_lowering_pass_stats();
+
+/** Runs the Stmt passes of a single call to lower, timing each one
+ * and reusing its result from an earlier call to lower if it has
+ * already been run on an identical Stmt in an identical context.
+ *
+ * For passes that look at the environment, the context is everything
+ * in it that lowering can see: every definition and schedule
+ * directive, and the constraints on the Parameters and Buffers they
+ * refer to. Estimates are not included, as only the auto-scheduler
+ * uses them. Passes that only look at the Stmt need just the target
+ * and the Parameter and Buffer constraints to match, so they can skip
+ * work after a schedule change that didn't alter their input (e.g.
+ * marking a Func async doesn't change the Stmt until
+ * fork_async_producers runs). A result from an earlier call to lower
+ * is rebound to the Functions and Parameters of this one, which may
+ * be different objects with the same names.
+ *
+ * A pass that misses generates fresh names with unique_name, so the
+ * passes after it usually miss too, until one of them produces a Stmt
+ * that was seen before. */
+class LoweringPassRunner {
+public:
+    LoweringPassRunner(const std::vector<Function> &outputs,
+                       const std::map<std::string, Function> &env,
+                       const std::string &pipeline_name,
+                       const Target &target);
+
+    /** Run a pass named 'name' on 's'. The name must be unique within
+     * the call to lower. The pass may depend on anything in the
+     * environment. If 'flag' is non-null, it is an extra output of
+     * the pass, and is cached along with the Stmt. */
+    Stmt run(const std::string &name, const Stmt &s,
+             const std::function<Stmt(const Stmt &)> &pass,
+             bool *flag = nullptr);
+
+    /** Run a pass that depends only on 's' and the target. Its result
+     * can be reused even if the environment has changed, as long as
+     * the earlier passes produced the same Stmt. */
+    Stmt run_stmt_pass(const std::string &name, const Stmt &s,
+                       const std::function<Stmt(const Stmt &)> &pass);
+
+    /** Print the time spent in each pass so far, and in bounds
+     * queries within each pass, at debug level 1. */
+    void report() const;
+
+private:
+    struct Timing {
+        std::string name;
+        double seconds;
+        bool hit;
+        uint64_t bounds_queries, bounds_hits;
+        double bounds_seconds;
+    };
+    std::vector<Timing> timings;
+
+    const std::vector<Function> &outputs;
+    const std::map<std::string, Function> &env;
+    const std::string &pipeline_name;
+    const Target &target;
+
+    // Computed lazily, only if the cache is enabled.
+    std::shared_ptr<const std::string> env_context, stmt_context;
+    size_t env_context_hash = 0, stmt_context_hash = 0;
+    std::shared_ptr<const std::map<std::string, Function>> env_copy;
+    // The Parameters the environment refers to, by name.
+    std::shared_ptr<const std::map<std::string, Parameter>> params;
+
+    void compute_contexts();
+
+    Stmt run_pass(const std::string &name, const Stmt &s,
+                  const std::function<Stmt(const Stmt &)> &pass,
+                  bool *flag, bool uses_env);
+};
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
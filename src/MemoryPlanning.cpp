@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <map>
+
+#include "MemoryPlanning.h"
+#include "Bounds.h"
+#include "CodeGen_Internal.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+#include "Simplify.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Every allocation carved out of the slab starts on this boundary,
+// which is at least the alignment of halide_malloc on all targets.
+const int64_t slab_alignment = 128;
+
+struct PlannedAllocation {
+    const Allocate *op;
+    // The bytes reserved for it in the slab, including padding.
+    int64_t size;
+    // The span of program order over which it is live, inclusive.
+    int start, end;
+    int64_t offset;
+};
+
+// Find the heap allocations that can be carved out of the slab, and
+// when each of them is live. Time advances at the start and end of
+// each allocation and at each Free, in program order, so two
+// allocations can share memory if their spans don't overlap. An
+// allocation inside a serial loop is live for the span of one
+// iteration, which is fine as the iterations run one at a time.
+class FindAllocationLifetimes : public IRVisitor {
+    using IRVisitor::visit;
+
+    // Track constant bounds
+    Scope<Interval> scope;
+
+    // The number of enclosing loops whose iterations may run
+    // concurrently, or on another device.
+    int concurrent_depth = 0;
+
+    int time = 0;
+
+    // The indices in 'allocations' of the planned allocations in scope.
+    Scope<int> live;
+
+    // Return the bytes to reserve for an allocation, or zero if it
+    // isn't a heap allocation with a constant upper bound on its size.
+    int64_t plannable_size(const Allocate *op) {
+        if (concurrent_depth > 0 ||
+            op->new_expr.defined() ||
+            op->extents.empty() ||
+            (op->memory_type != MemoryType::Heap &&
+             op->memory_type != MemoryType::Auto)) {
+            return 0;
+        }
+
+        // Leave allocations that will go on the stack alone.
+        int32_t constant_size = op->constant_allocation_size();
+        if (constant_size > 0 &&
+            op->memory_type == MemoryType::Auto &&
+            can_allocation_fit_on_stack((int64_t)constant_size * op->type.bytes())) {
+            return 0;
+        }
+
+        Expr total_extent = make_const(Int(64), 1);
+        for (const Expr &e : op->extents) {
+            total_extent *= e;
+        }
+        Expr bound = find_constant_bound(total_extent, Direction::Upper, scope);
+        if (!bound.defined()) {
+            return 0;
+        }
+        const int64_t *elems = as_const_int(simplify(bound));
+        if (!elems || *elems <= 0 || *elems > 0x7fffffff) {
+            return 0;
+        }
+
+        // Pad by one element, like the heap allocations made by
+        // CodeGen_Posix, as vector loads may read a scalar past the
+        // end.
+        int64_t bytes = (*elems + 1) * op->type.bytes();
+        return (bytes + slab_alignment - 1) / slab_alignment * slab_alignment;
+    }
+
+    void visit(const LetStmt *op) override {
+        op->value.accept(this);
+        Interval b = find_constant_bounds(op->value, scope);
+        ScopedBinding<Interval> bind(scope, op->name, b);
+        op->body.accept(this);
+    }
+
+    void visit(const Let *op) override {
+        op->value.accept(this);
+        Interval b = find_constant_bounds(op->value, scope);
+        ScopedBinding<Interval> bind(scope, op->name, b);
+        op->body.accept(this);
+    }
+
+    void visit(const For *op) override {
+        op->min.accept(this);
+        op->extent.accept(this);
+        Interval min_bounds = find_constant_bounds(op->min, scope);
+        Interval max_bounds = find_constant_bounds(op->min + op->extent - 1, scope);
+        Interval b = Interval::make_union(min_bounds, max_bounds);
+        b.min = simplify(b.min);
+        b.max = simplify(b.max);
+        ScopedBinding<Interval> bind(scope, op->name, b);
+        bool concurrent = (op->for_type != ForType::Serial ||
+                           (op->device_api != DeviceAPI::None &&
+                            op->device_api != DeviceAPI::Host));
+        ScopedValue<int> old_depth(concurrent_depth, concurrent_depth + (concurrent ? 1 : 0));
+        op->body.accept(this);
+    }
+
+    void visit(const Allocate *op) override {
+        int64_t size = plannable_size(op);
+        if (size == 0) {
+            IRVisitor::visit(op);
+            return;
+        }
+        int idx = (int)allocations.size();
+        allocations.push_back({op, size, time++, -1, 0});
+        {
+            ScopedBinding<int> bind(live, op->name, idx);
+            IRVisitor::visit(op);
+        }
+        if (allocations[idx].end < 0) {
+            allocations[idx].end = time++;
+        }
+    }
+
+    void visit(const Free *op) override {
+        if (live.contains(op->name)) {
+            PlannedAllocation &a = allocations[live.get(op->name)];
+            if (a.end < 0) {
+                a.end = time++;
+            }
+        }
+    }
+
+public:
+    vector<PlannedAllocation> allocations;
+};
+
+// Assign offsets to the allocations, largest first, placing each at
+// the lowest offset that doesn't overlap anything already placed that
+// is live at the same time. Returns the size of the slab.
+int64_t assign_offsets(vector<PlannedAllocation> &allocations) {
+    vector<PlannedAllocation *> order;
+    for (PlannedAllocation &a : allocations) {
+        order.push_back(&a);
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [](const PlannedAllocation *a, const PlannedAllocation *b) {
+                         return a->size > b->size;
+                     });
+
+    int64_t slab_size = 0;
+    vector<const PlannedAllocation *> placed;
+    for (PlannedAllocation *a : order) {
+        vector<const PlannedAllocation *> conflicts;
+        for (const PlannedAllocation *p : placed) {
+            if (p->start <= a->end && a->start <= p->end) {
+                conflicts.push_back(p);
+            }
+        }
+        std::sort(conflicts.begin(), conflicts.end(),
+                  [](const PlannedAllocation *a, const PlannedAllocation *b) {
+                      return a->offset < b->offset;
+                  });
+        int64_t offset = 0;
+        for (const PlannedAllocation *c : conflicts) {
+            if (c->offset >= offset + a->size) {
+                break;
+            }
+            offset = std::max(offset, c->offset + c->size);
+        }
+        a->offset = offset;
+        placed.push_back(a);
+        slab_size = std::max(slab_size, offset + a->size);
+    }
+    return slab_size;
+}
+
+// Point each planned allocation at its offset in the slab.
+class CarveAllocations : public IRMutator2 {
+    using IRMutator2::visit;
+
+    const map<const Allocate *, int64_t> &offsets;
+    Expr slab;
+
+    Stmt visit(const Allocate *op) override {
+        auto it = offsets.find(op);
+        if (it == offsets.end()) {
+            return IRMutator2::visit(op);
+        }
+        // CodeGen_Posix recognizes this pattern, and gives the
+        // allocation the same alias analysis name as the slab.
+        Expr ptr = reinterpret(Handle(), reinterpret(UInt(64), slab) + make_const(UInt(64), it->second));
+        return Allocate::make(op->name, op->type, op->memory_type, op->extents, op->condition,
+                              mutate(op->body), ptr, "halide_device_host_nop_free");
+    }
+
+public:
+    CarveAllocations(const map<const Allocate *, int64_t> &offsets, Expr slab)
+        : offsets(offsets), slab(slab) {}
+};
+
+}  // namespace
+
+Stmt plan_memory(const Stmt &s, const Target &t, const Parameter &scratch) {
+    FindAllocationLifetimes lifetimes;
+    s.accept(&lifetimes);
+    vector<PlannedAllocation> &allocations = lifetimes.allocations;
+    if (allocations.empty()) {
+        return s;
+    }
+
+    int64_t slab_size = assign_offsets(allocations);
+    if (slab_size > 0x7fffffff) {
+        debug(1) << "Not planning memory, as the slab would take " << slab_size << " bytes\n";
+        return s;
+    }
+
+    int64_t total_size = 0;
+    map<const Allocate *, int64_t> offsets;
+    for (const PlannedAllocation &a : allocations) {
+        debug(2) << "Placing " << a.op->name << " (" << a.size << " bytes, live over ["
+                 << a.start << ", " << a.end << "]) at offset " << a.offset << "\n";
+        total_size += a.size;
+        offsets[a.op] = a.offset;
+    }
+    debug(1) << "Packed " << allocations.size() << " allocations totalling "
+             << total_size << " bytes into a slab of " << slab_size << " bytes\n";
+
+    string slab_name = unique_name("memory_plan_slab");
+    Expr slab = Variable::make(Handle(), slab_name);
+    Stmt body = CarveAllocations(offsets, slab).mutate(s);
+
+    Expr size = make_const(Int(32), slab_size);
+    if (!scratch.defined()) {
+        return Allocate::make(slab_name, UInt(8), MemoryType::Heap, {size}, const_true(), body);
+    }
+
+    user_assert(scratch.is_buffer() && scratch.type() == UInt(8) && scratch.dimensions() == 1)
+        << "The scratch buffer " << scratch.name()
+        << " used for memory planning must be a one-dimensional uint8 ImageParam\n";
+
+    Expr buf = Variable::make(type_of<halide_buffer_t *>(), scratch.name() + ".buffer", scratch);
+    Expr host = Call::make(Handle(), Call::buffer_get_host, {buf}, Call::Extern);
+    Expr extent = Call::make(Int(32), Call::buffer_get_extent, {buf, 0}, Call::Extern);
+    Expr host_bits = reinterpret(UInt(64), host);
+    Expr use_scratch = (host_bits != make_zero(UInt(64)) &&
+                        host_bits % make_const(UInt(64), slab_alignment) == make_zero(UInt(64)) &&
+                        extent >= size);
+
+    // Use the scratch buffer if we can, and fall back to the heap
+    // otherwise. The heap allocation is null when it isn't needed, so
+    // its destructor never runs.
+    string heap_name = slab_name + ".heap";
+    Expr heap = Variable::make(Handle(), heap_name);
+    body = Allocate::make(slab_name, UInt(8), MemoryType::Heap, {size}, const_true(), body,
+                          Call::make(Handle(), Call::if_then_else, {use_scratch, host, heap}, Call::PureIntrinsic),
+                          "halide_device_host_nop_free");
+    Expr malloc_size = make_const(UInt(t.bits), slab_size);
+    Expr heap_ptr = Call::make(Handle(), Call::if_then_else,
+                               {use_scratch,
+                                reinterpret(Handle(), make_zero(UInt(64))),
+                                Call::make(Handle(), "halide_malloc", {malloc_size}, Call::Extern)},
+                               Call::PureIntrinsic);
+    body = Allocate::make(heap_name, UInt(8), MemoryType::Heap, {size}, !use_scratch, body,
+                          heap_ptr, "halide_free");
+
+    // A scratch buffer with no memory is a query for its size.
+    Expr set_extent = Call::make(type_of<halide_buffer_t *>(), Call::buffer_set_bounds,
+                                 {buf, 0, 0, size}, Call::Extern);
+    Stmt query = IfThenElse::make(host_bits == make_zero(UInt(64)), Evaluate::make(set_extent));
+    return Block::make(query, body);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,33 @@
+#ifndef HALIDE_MEMORY_PLANNING_H
+#define HALIDE_MEMORY_PLANNING_H
+
+/** \file
+ * Defines the lowering pass that packs the heap allocations of a
+ * pipeline into a single preallocated block of memory.
+ */
+
+#include "IR.h"
+#include "Parameter.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Find the heap allocations with a constant upper bound on their
+ * size that are not inside a parallel loop, work out when each one is
+ * live, and carve them all out of one slab, at offsets chosen so that
+ * allocations that are live at the same time don't overlap. The slab
+ * is allocated once, at the start of the pipeline.
+ *
+ * If 'scratch' is defined it must be a one-dimensional uint8 buffer
+ * parameter. Its memory is used as the slab if it is large enough and
+ * aligned to 128 bytes; otherwise the slab is allocated on the heap as
+ * usual. If the scratch buffer has no host memory, its extent is set
+ * to the size required, so that a caller can find out how large a
+ * scratch buffer to allocate. */
+Stmt plan_memory(const Stmt &s, const Target &t, const Parameter &scratch);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
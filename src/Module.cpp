@@ -3,6 +3,7 @@
 #include <array>
 #include <fstream>
 #include <future>
+#include <mutex>
 
 #include "CodeGen_C.h"
 #include "CodeGen_Internal.h"
@@ -15,6 +16,7 @@
 #include "Outputs.h"
 #include "PythonExtensionGen.h"
 #include "StmtToHtml.h"
+#include "Util.h"
 #include "WrapExternStages.h"
 
 using Halide::Internal::debug;
@@ -301,7 +303,11 @@ Module Module::resolve_submodules() const {
     for (const auto &ec : external_code()) {
         lowered_module.append(ec);
     }
-    for (const auto &m : submodules()) {
+    // The submodules are compiled independently, so compile them in
+    // parallel, but append them in their original order.
+    std::vector<Buffer<uint8_t>> bufs(submodules().size());
+    run_compile_tasks(submodules().size(), [&](size_t i) {
+        const Module &m = submodules()[i];
         Module copy(m.resolve_submodules());
 
         // Propagate external code blocks.
@@ -319,7 +325,9 @@ Module Module::resolve_submodules() const {
             }
         }
 
-        auto buf = copy.compile_to_buffer();
+        bufs[i] = copy.compile_to_buffer();
+    });
+    for (const auto &buf : bufs) {
         lowered_module.append(buf);
     }
 
@@ -468,7 +476,8 @@ void compile_multitarget(const std::string &fn_name,
                          const Outputs &output_files,
                          const std::vector<Target> &targets,
                          ModuleProducer module_producer,
-                         const std::map<std::string, std::string> &suffixes) {
+                         const std::map<std::string, std::string> &suffixes,
+                         bool module_producer_is_thread_safe) {
     user_assert(!fn_name.empty()) << "Function name must be specified.\n";
     user_assert(!targets.empty()) << "Must specify at least one target.\n";
 
@@ -513,6 +522,9 @@ void compile_multitarget(const std::string &fn_name,
     TemporaryObjectFileDir temp_dir;
     std::vector<Expr> wrapper_args;
     std::vector<LoweredArgument> base_target_args;
+    std::vector<std::string> sub_fn_names;
+    std::vector<Target> sub_fn_targets;
+    std::vector<Outputs> sub_outs;
     for (const Target &target : targets) {
         // arch-bits-os must be identical across all targets.
         if (target.os != base_target.os ||
@@ -555,16 +567,13 @@ void compile_multitarget(const std::string &fn_name,
             sub_fn_target = sub_fn_target.without_feature(Target::Matlab);
         }
 
-        Module sub_module = module_producer(sub_fn_name, sub_fn_target);
-        // Re-assign every time -- should be the same across all targets anyway,
-        // but base_target is always the last one we encounter.
-        base_target_args = sub_module.get_function_by_name(sub_fn_name).args;
-
         Outputs sub_out = add_suffixes(output_files, suffix);
         internal_assert(sub_out.object_name.empty());
         sub_out.object_name = temp_dir.add_temp_object_file(output_files.static_library_name, suffix, target);
-        debug(1) << "compile_multitarget: compile_sub_target " << sub_out.object_name << "\n";
-        sub_module.compile(sub_out);
+
+        sub_fn_names.push_back(sub_fn_name);
+        sub_fn_targets.push_back(sub_fn_target);
+        sub_outs.push_back(sub_out);
 
         uint64_t cur_target_features[kFeaturesWordCount] = {0};
         for (int i = 0; i < Target::FeatureEnd; ++i) {
@@ -596,9 +605,11 @@ void compile_multitarget(const std::string &fn_name,
 
     // If we haven't specified "no runtime", build a runtime with the base target
     // and add that to the result.
+    Outputs runtime_out;
+    Target runtime_target;
     if (!base_target.has_feature(Target::NoRuntime)) {
         // Start with a bare Target, set only the features we know are common to all.
-        Target runtime_target(base_target.os, base_target.arch, base_target.bits);
+        runtime_target = Target(base_target.os, base_target.arch, base_target.bits);
         for (int i = 0; i < Target::FeatureEnd; ++i) {
             // We never want NoRuntime set here.
             if (i == Target::NoRuntime) {
@@ -610,12 +621,40 @@ void compile_multitarget(const std::string &fn_name,
                 runtime_target.set_feature((Target::Feature) i);
             }
         }
-        Outputs runtime_out = Outputs().object(
+        runtime_out = Outputs().object(
             temp_dir.add_temp_object_file(output_files.static_library_name, "_runtime", runtime_target));
-        debug(1) << "compile_multitarget: compile_standalone_runtime " << runtime_out.static_library_name << "\n";
-        compile_standalone_runtime(runtime_out, runtime_target);
     }
 
+    // Produce and compile each sub-target, and the runtime, in
+    // parallel. run_compile_tasks makes the names each one generates
+    // independent of the others, so the resulting objects don't
+    // depend on compile_threads(), or on whether module_producer is
+    // serialized.
+    std::mutex module_producer_mutex;
+    run_compile_tasks(targets.size() + 1, [&](size_t i) {
+        if (i == targets.size()) {
+            if (!runtime_out.object_name.empty()) {
+                debug(1) << "compile_multitarget: compile_standalone_runtime " << runtime_out.object_name << "\n";
+                compile_standalone_runtime(runtime_out, runtime_target);
+            }
+            return;
+        }
+        Module sub_module = [&]() {
+            std::unique_lock<std::mutex> lock(module_producer_mutex, std::defer_lock);
+            if (!module_producer_is_thread_safe) {
+                lock.lock();
+            }
+            return module_producer(sub_fn_names[i], sub_fn_targets[i]);
+        }();
+        // These should be the same across all targets anyway, but
+        // base_target is always the last one.
+        if (i == targets.size() - 1) {
+            base_target_args = sub_module.get_function_by_name(sub_fn_names[i]).args;
+        }
+        debug(1) << "compile_multitarget: compile_sub_target " << sub_outs[i].object_name << "\n";
+        sub_module.compile(sub_outs[i]);
+    });
+
     if (needs_wrapper) {
         Expr indirect_result = Call::make(Int(32), Call::call_cached_indirect_function, wrapper_args, Call::Intrinsic);
         std::string private_result_name = unique_name(fn_name + "_result");
@@ -166,11 +166,21 @@ Outputs compile_standalone_runtime(const Outputs &output_files, Target t);
 
 typedef std::function<Module(const std::string &, const Target &)> ModuleProducer;
 
+/** Compile the Modules made by module_producer for each of the given
+ * targets into one static library, along with a wrapper that picks
+ * the first one the host can run. The targets are produced and
+ * compiled in parallel on up to Internal::compile_threads() threads;
+ * the output is the same for any number of threads. Calls to
+ * module_producer are serialized unless module_producer_is_thread_safe
+ * is set, which is only true if the calls share no Funcs, Pipelines
+ * or other mutable state (e.g. if each one makes a fresh
+ * Generator). */
 void compile_multitarget(const std::string &fn_name,
                          const Outputs &output_files,
                          const std::vector<Target> &targets,
                          ModuleProducer module_producer,
-                         const std::map<std::string, std::string> &suffixes = {});
+                         const std::map<std::string, std::string> &suffixes = {},
+                         bool module_producer_is_thread_safe = false);
 
 }  // namespace Halide
 
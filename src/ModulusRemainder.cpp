@@ -60,7 +60,9 @@ public:
     void visit(const Free *);
     void visit(const Evaluate *);
     void visit(const Shuffle *);
+    void visit(const VectorReduce *);
     void visit(const Prefetch *);
+    void visit(const Atomic *);
 };
 
 ModulusRemainder modulus_remainder(Expr e) {
@@ -394,6 +396,12 @@ void ComputeModulusRemainder::visit(const Shuffle *op) {
     remainder = 0;
 }
 
+void ComputeModulusRemainder::visit(const VectorReduce *op) {
+    internal_assert(op->type.is_scalar()) << "modulus_remainder of vector\n";
+    modulus = 1;
+    remainder = 0;
+}
+
 void ComputeModulusRemainder::visit(const LetStmt *) {
     internal_assert(false) << "modulus_remainder of statement\n";
 }
@@ -446,5 +454,9 @@ void ComputeModulusRemainder::visit(const Prefetch *) {
     internal_assert(false) << "modulus_remainder of statement\n";
 }
 
+void ComputeModulusRemainder::visit(const Atomic *) {
+    internal_assert(false) << "modulus_remainder of statement\n";
+}
+
 }  // namespace Internal
 }  // namespace Halide
@@ -330,6 +330,24 @@ class MonotonicVisitor : public IRVisitor {
         result = Monotonic::Constant;
     }
 
+    void visit(const VectorReduce *op) {
+        op->value.accept(this);
+        switch (op->op) {
+        case VectorReduce::Add:
+        case VectorReduce::Min:
+        case VectorReduce::Max:
+        case VectorReduce::And:
+        case VectorReduce::Or:
+            // These reductions are monotonic in each of the lanes.
+            break;
+        case VectorReduce::Mul:
+            if (result != Monotonic::Constant) {
+                result = Monotonic::Unknown;
+            }
+            break;
+        }
+    }
+
     void visit(const LetStmt *op) {
         internal_error << "Monotonic of statement\n";
     }
@@ -382,6 +400,10 @@ class MonotonicVisitor : public IRVisitor {
         internal_error << "Monotonic of statement\n";
     }
 
+    void visit(const Atomic *op) {
+        internal_error << "Monotonic of statement\n";
+    }
+
 public:
     Monotonic result;
 
@@ -1,9 +1,11 @@
 #include <algorithm>
+#include <future>
 
 #include "Argument.h"
 #include "FindCalls.h"
 #include "Func.h"
 #include "IRVisitor.h"
+#include "ImageParam.h"
 #include "InferArguments.h"
 #include "LLVM_Headers.h"
 #include "LLVM_Output.h"
@@ -18,6 +20,7 @@ using namespace Halide::Internal;
 
 namespace Halide {
 
+using std::pair;
 using std::set;
 using std::string;
 using std::vector;
@@ -42,6 +45,45 @@ Outputs static_library_outputs(const string &filename_prefix, const Target &targ
     return outputs;
 }
 
+// Make a copy of a module that is compiled for a different target.
+Module with_target(const Module &m, const Target &t) {
+    Module result(m.name(), t);
+    for (const auto &f : m.functions()) {
+        result.append(f);
+    }
+    for (const auto &buf : m.buffers()) {
+        result.append(buf);
+    }
+    for (const auto &sub : m.submodules()) {
+        result.append(sub);
+    }
+    for (const auto &ec : m.external_code()) {
+        result.append(ec);
+    }
+    for (const auto &p : m.get_metadata_name_map()) {
+        result.remap_metadata_name(p.first, p.second);
+    }
+    result.set_any_strict_float(m.any_strict_float());
+    return result;
+}
+
+// If the optimized module being compiled in the background by a
+// tiered jit compilation is done (or if wait is true, once it is
+// done), replace jit_module with it. Returns whether jit_module
+// changed.
+bool install_optimized_jit_module(std::shared_future<JITModule> &optimized,
+                                  JITModule &jit_module, bool wait) {
+    if (!optimized.valid()) {
+        return false;
+    }
+    if (!wait && optimized.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return false;
+    }
+    jit_module = optimized.get();
+    optimized = std::shared_future<JITModule>();
+    return true;
+}
+
 }  // namespace
 
 struct PipelineContents {
@@ -57,10 +99,21 @@ struct PipelineContents {
     JITModule jit_module;
     Target jit_target;
 
+    /** Whether to jit compile in two tiers. See
+     * Pipeline::set_tiered_jit. */
+    bool tiered_jit = false;
+
+    /** If jit_module is the quickly-compiled first tier, the fully
+     * optimized module that will replace it, which is being compiled
+     * on another thread. */
+    std::shared_future<JITModule> optimized_jit_module;
+
     /** Clear all cached state */
     void invalidate_cache() {
         module = Module("", Target());
         jit_module = JITModule();
+        // This waits for the optimized module if it's still compiling.
+        optimized_jit_module = std::shared_future<JITModule>();
         jit_target = Target();
         inferred_args.clear();
     }
@@ -81,6 +134,10 @@ struct PipelineContents {
     /** A set of custom passes to use when lowering this Func. */
     vector<CustomLoweringPass> custom_lowering_passes;
 
+    /** The buffer parameter whose memory is used for the allocations
+     * packed together by memory planning, if any. */
+    Parameter memory_planning_scratch;
+
     /** The inferred arguments. Also the arguments to the main
      * function in the jit_module above. The two must be updated
      * together. */
@@ -309,6 +366,25 @@ vector<Argument> Pipeline::infer_arguments(Stmt body) {
         contents->inferred_args.push_back(contents->user_context_arg);
     }
 
+    // The memory planning scratch buffer isn't referred to by any
+    // Func, so it must be added explicitly.
+    const Parameter &scratch = contents->memory_planning_scratch;
+    if (scratch.defined()) {
+        bool has_scratch = false;
+        for (const auto &arg : contents->inferred_args) {
+            if (arg.arg.name == scratch.name()) {
+                has_scratch = true;
+            }
+        }
+        if (!has_scratch) {
+            InferredArgument a = {
+                Argument(scratch.name(), Argument::InputBuffer, scratch.type(), scratch.dimensions()),
+                scratch,
+                Buffer<>()};
+            contents->inferred_args.push_back(a);
+        }
+    }
+
     // Return the inferred argument types, minus any constant images
     // (we'll embed those in the binary by default), and minus the user_context arg.
     vector<Argument> result;
@@ -391,7 +467,8 @@ Module Pipeline::compile_to_module(const vector<Argument> &args,
             custom_passes.push_back(p.pass);
         }
 
-        contents->module = lower(contents->outputs, new_fn_name, target, lowering_args, linkage_type, custom_passes);
+        contents->module = lower(contents->outputs, new_fn_name, target, lowering_args, linkage_type, custom_passes,
+                                 contents->memory_planning_scratch);
     }
 
     return contents->module;
@@ -422,6 +499,9 @@ void *Pipeline::compile_jit(const Target &target_arg) {
     // old jit module.
     if (contents->jit_target == target &&
         contents->jit_module.compiled()) {
+        if (install_optimized_jit_module(contents->optimized_jit_module, contents->jit_module, false)) {
+            debug(1) << "Switching to the optimized jit module for " << generate_function_name() << "\n";
+        }
         debug(2) << "Reusing old jit module compiled for :\n" << contents->jit_target << "\n";
         return contents->jit_module.main_function();
     }
@@ -450,9 +530,13 @@ void *Pipeline::compile_jit(const Target &target_arg) {
     auto f = module.get_function_by_name(name);
 
     std::map<std::string, JITExtern> lowered_externs = contents->jit_externs;
+    std::vector<JITModule> dependencies = make_externs_jit_module(target_arg, lowered_externs);
 
-    // Compile to jit module
-    JITModule jit_module(module, f, make_externs_jit_module(target_arg, lowered_externs));
+    // Compile to jit module. If compiling in tiers, first make code
+    // that is quick to compile.
+    const bool tiered = contents->tiered_jit && !target.has_feature(Target::FastCompile);
+    Module first_tier = tiered ? with_target(module, target.with_feature(Target::FastCompile)) : module;
+    JITModule jit_module(first_tier, f, dependencies);
 
     // Dump bitcode to a file if the environment variable
     // HL_GENBITCODE is defined to a nonzero value.
@@ -468,9 +552,39 @@ void *Pipeline::compile_jit(const Target &target_arg) {
 
     contents->jit_module = jit_module;
 
+    if (tiered) {
+        // Compile the fully optimized code on another thread. Calls
+        // made after it finishes will use it. The lowered module is
+        // never mutated, so it's safe to share with that thread.
+        debug(1) << "Compiling optimized jit module for " << name << " in the background\n";
+        contents->optimized_jit_module =
+            std::async(std::launch::async, [module, f, dependencies]() {
+                return JITModule(module, f, dependencies);
+            }).share();
+    }
+
     return jit_module.main_function();
 }
 
+void Pipeline::set_tiered_jit(bool tiered) {
+    user_assert(defined()) << "Pipeline is undefined\n";
+    if (!tiered) {
+        // Don't keep running the first tier.
+        install_optimized_jit_module(contents->optimized_jit_module, contents->jit_module, true);
+    }
+    contents->tiered_jit = tiered;
+}
+
+bool Pipeline::tiered_jit() const {
+    user_assert(defined()) << "Pipeline is undefined\n";
+    return contents->tiered_jit;
+}
+
+void Pipeline::wait_for_optimized_jit() {
+    user_assert(defined()) << "Pipeline is undefined\n";
+    install_optimized_jit_module(contents->optimized_jit_module, contents->jit_module, true);
+}
+
 
 void Pipeline::set_error_handler(void (*handler)(void *, const char *)) {
     user_assert(defined()) << "Pipeline is undefined\n";
@@ -532,6 +646,21 @@ const vector<CustomLoweringPass> &Pipeline::custom_lowering_passes() {
     return contents->custom_lowering_passes;
 }
 
+void Pipeline::set_memory_planning_scratch(const ImageParam &scratch) {
+    user_assert(defined()) << "Pipeline is undefined\n";
+    user_assert(scratch.type() == UInt(8) && scratch.dimensions() == 1)
+        << "The memory planning scratch buffer " << scratch.name()
+        << " must be a one-dimensional uint8 ImageParam\n";
+    contents->invalidate_cache();
+    contents->memory_planning_scratch = scratch.parameter();
+}
+
+void Pipeline::clear_memory_planning_scratch() {
+    if (!defined()) return;
+    contents->invalidate_cache();
+    contents->memory_planning_scratch = Parameter();
+}
+
 const JITHandlers &Pipeline::jit_handlers() {
     user_assert(defined()) << "Pipeline is undefined\n";
     return contents->jit_handlers;
@@ -681,8 +810,83 @@ struct JITFuncCallContext {
     }
 };
 
+void check_outputs_allocated(const Pipeline::RealizationArg &outputs) {
+    if (outputs.r) {
+        for (size_t i = 0; i < outputs.r->size(); i++) {
+            user_assert((*outputs.r)[i].data() != nullptr || (*outputs.r)[i].has_device_allocation())
+                << "Buffer at " << &((*outputs.r)[i]) << " is unallocated. "
+                << "The Buffers in a Realization passed to realize must all be allocated\n";
+        }
+    } else if (outputs.buffer_list) {
+        for (const Buffer<> &buf : *outputs.buffer_list) {
+            user_assert(buf.data() != nullptr || buf.has_device_allocation())
+                << "Buffer at " << &buf << " is unallocated. "
+                << "The Buffers in a Realization passed to realize must all be allocated\n";
+        }
+    } else {
+        user_assert(outputs.buf && (outputs.buf->host || outputs.buf->device))
+            << "Buffer at " << (void *)outputs.buf << " is unallocated. "
+            << "The Buffers passed to realize must all be allocated\n";
+    }
+}
+
+Target default_jit_target(bool compiled, const Target &jit_target, const Target &target) {
+    // If target is unspecified...
+    if (target.os == Target::OSUnknown) {
+        // If we've already jit-compiled for a specific target, use that.
+        if (compiled) {
+            return jit_target;
+        } else {
+            // Otherwise get the target from the environment
+            return get_jit_target_from_environment();
+        }
+    }
+    return target;
+}
+
 }  // namespace
 
+struct PreparedCallContents {
+    mutable RefCount ref_count;
+
+    // Keeps the compiled code alive, even if the Pipeline is
+    // recompiled.
+    JITModule jit_module;
+    int (*argv_function)(const void **);
+
+    // The optimized module to switch to when it's ready, if
+    // jit_module is the first tier of a tiered jit compilation.
+    std::shared_future<JITModule> optimized_jit_module;
+    Target target;
+
+    JITFuncCallContext call_context;
+    // The user context argument points here.
+    void *user_context_storage;
+
+    // The void * arguments to the argv function.
+    vector<const void *> argv;
+
+    // The Buffers and Parameters the arguments point into.
+    vector<Buffer<>> buffers;
+    vector<Parameter> params;
+
+    PreparedCallContents(const JITHandlers &handlers)
+        : argv_function(nullptr), call_context(handlers),
+          user_context_storage(&call_context.jit_context) {}
+};
+
+namespace Internal {
+template<>
+RefCount &ref_count<PreparedCallContents>(const PreparedCallContents *p) {
+    return p->ref_count;
+}
+
+template<>
+void destroy<PreparedCallContents>(const PreparedCallContents *p) {
+    delete p;
+}
+}  // namespace Internal
+
 struct Pipeline::JITCallArgs {
     size_t size{0};
     const void **store;
@@ -834,34 +1038,8 @@ void Pipeline::realize(RealizationArg outputs, const Target &t,
 
     debug(2) << "Realizing Pipeline for " << target << "\n";
 
-    if (outputs.r) {
-        for (size_t i = 0; i < outputs.r->size(); i++) {
-            user_assert((*outputs.r)[i].data() != nullptr || (*outputs.r)[i].has_device_allocation())
-                << "Buffer at " << &((*outputs.r)[i]) << " is unallocated. "
-                << "The Buffers in a Realization passed to realize must all be allocated\n";
-        }
-    } else if (outputs.buffer_list) {
-        for (const Buffer<> &buf : *outputs.buffer_list) {
-            user_assert(buf.data() != nullptr || buf.has_device_allocation())
-                << "Buffer at " << &buf << " is unallocated. "
-                << "The Buffers in a Realization passed to realize must all be allocated\n";
-        }
-    } else {
-        user_assert(outputs.buf && (outputs.buf->host || outputs.buf->device))
-            << "Buffer at " << (void *)outputs.buf << " is unallocated. "
-            << "The Buffers passed to realize must all be allocated\n";
-    }
-
-    // If target is unspecified...
-    if (target.os == Target::OSUnknown) {
-        // If we've already jit-compiled for a specific target, use that.
-        if (contents->jit_module.compiled()) {
-            target = contents->jit_target;
-        } else {
-            // Otherwise get the target from the environment
-            target = get_jit_target_from_environment();
-        }
-    }
+    check_outputs_allocated(outputs);
+    target = default_jit_target(contents->jit_module.compiled(), contents->jit_target, target);
 
     // We need to make a context for calling the jitted function to
     // carry the the set of custom handlers. Here's how handlers get
@@ -939,7 +1117,9 @@ void Pipeline::realize(RealizationArg outputs, const Target &t,
     debug(2) << "Back from jitted function. Exit status was " << exit_status << "\n";
 
     // If we're profiling, report runtimes and reset profiler stats.
-    if (target.has_feature(Target::Profile)) {
+    if (target.has_feature(Target::Profile) ||
+        target.has_feature(Target::ProfileCounters) ||
+        target.has_feature(Target::ProfileTimeline)) {
         JITModule::Symbol report_sym =
             contents->jit_module.find_symbol_by_name("halide_profiler_report");
         JITModule::Symbol reset_sym =
@@ -957,9 +1137,96 @@ void Pipeline::realize(RealizationArg outputs, const Target &t,
     jit_context.finalize(exit_status);
 }
 
-void Pipeline::infer_input_bounds(RealizationArg outputs, const ParamMap &param_map) {
-    Target target = get_jit_target_from_environment();
+PreparedCall Pipeline::prepare(RealizationArg outputs, const Target &t,
+                              const ParamMap &param_map) {
+    user_assert(defined()) << "Can't prepare a call to an undefined Pipeline\n";
+
+    check_outputs_allocated(outputs);
+    Target target = default_jit_target(contents->jit_module.compiled(), contents->jit_target, t);
+
+    debug(2) << "Preparing a call to Pipeline for " << target << "\n";
+
+    compile_jit(target);
+
+    PreparedCall call;
+    call.contents = new PreparedCallContents(jit_handlers());
+    PreparedCallContents &c = *call.contents;
+    c.jit_module = contents->jit_module;
+    c.argv_function = contents->jit_module.argv_function();
+    c.optimized_jit_module = contents->optimized_jit_module;
+    c.target = target;
+
+    JITCallArgs args(contents->inferred_args.size() + outputs.size());
+    prepare_jit_call_arguments(outputs, target, param_map,
+                               &c.user_context_storage, false, args);
+    c.argv.assign(args.store, args.store + args.size);
+
+    // Hold on to everything the arguments point into.
+    const bool no_param_map = &param_map == &ParamMap::empty_map();
+    for (const InferredArgument &arg : contents->inferred_args) {
+        if (arg.buffer.defined()) {
+            c.buffers.push_back(arg.buffer);
+        } else if (arg.param.defined() && !arg.param.same_as(contents->user_context_arg.param)) {
+            Buffer<> *buf_out_param = nullptr;
+            Parameter p = no_param_map ? arg.param : param_map.map(arg.param, buf_out_param);
+            if (p.is_buffer() && p.buffer().defined()) {
+                c.buffers.push_back(p.buffer());
+            }
+            c.params.push_back(p);
+        }
+    }
+    if (outputs.r) {
+        for (size_t i = 0; i < outputs.r->size(); i++) {
+            c.buffers.push_back((*outputs.r)[i]);
+        }
+    } else if (outputs.buffer_list) {
+        for (const Buffer<> &buf : *outputs.buffer_list) {
+            c.buffers.push_back(buf);
+        }
+    }
+
+    return call;
+}
+
+PreparedCall::PreparedCall() : contents(nullptr) {
+}
+
+bool PreparedCall::defined() const {
+    return contents.defined();
+}
+
+void PreparedCall::run() {
+    user_assert(defined()) << "Can't run an undefined PreparedCall\n";
+
+    if (install_optimized_jit_module(contents->optimized_jit_module, contents->jit_module, false)) {
+        contents->argv_function = contents->jit_module.argv_function();
+    }
+
+    int exit_status = contents->argv_function(contents->argv.data());
+
+    // If we're profiling, report runtimes and reset profiler stats.
+    if (contents->target.has_feature(Target::Profile) ||
+        contents->target.has_feature(Target::ProfileCounters) ||
+        contents->target.has_feature(Target::ProfileTimeline)) {
+        JITModule::Symbol report_sym =
+            contents->jit_module.find_symbol_by_name("halide_profiler_report");
+        JITModule::Symbol reset_sym =
+            contents->jit_module.find_symbol_by_name("halide_profiler_reset");
+        if (report_sym.address && reset_sym.address) {
+            void *uc = &contents->call_context.jit_context;
+            void (*report_fn_ptr)(void *) = (void (*)(void *))(report_sym.address);
+            report_fn_ptr(uc);
+
+            void (*reset_fn_ptr)() = (void (*)())(reset_sym.address);
+            reset_fn_ptr();
+        }
+    }
+
+    contents->call_context.finalize(exit_status);
+}
 
+vector<pair<size_t, Runtime::Buffer<>>> Pipeline::query_input_bounds(RealizationArg &outputs, const Target &target,
+                                                                      const ParamMap &param_map) {
     compile_jit(target);
 
     // This has to happen after a runtime has been compiled in compile_jit.
@@ -994,10 +1261,12 @@ void Pipeline::infer_input_bounds(RealizationArg outputs, const ParamMap &param_
         }
     }
 
+    vector<pair<size_t, Runtime::Buffer<>>> result;
+
     // No need to query if all the inputs are bound already.
     if (query_indices.empty()) {
         debug(1) << "All inputs are bound. No need for bounds inference\n";
-        return;
+        return result;
     }
 
     int iter = 0;
@@ -1039,9 +1308,18 @@ void Pipeline::infer_input_bounds(RealizationArg outputs, const ParamMap &param_
 
     debug(1) << "Bounds inference converged after " << iter << " iterations\n";
 
-    // Now allocate the resulting buffers
     for (size_t i : query_indices) {
-        InferredArgument ia = contents->inferred_args[i];
+        result.emplace_back(i, std::move(tracked_buffers[i].query));
+    }
+    return result;
+}
+
+void Pipeline::infer_input_bounds(RealizationArg outputs, const ParamMap &param_map) {
+    Target target = get_jit_target_from_environment();
+
+    // Now allocate the resulting buffers
+    for (auto &query : query_input_bounds(outputs, target, param_map)) {
+        InferredArgument ia = contents->inferred_args[query.first];
         Buffer<> *buf_out_param = nullptr;
         Parameter &p = param_map.map(ia.param, buf_out_param);
 
@@ -1051,14 +1329,14 @@ void Pipeline::infer_input_bounds(RealizationArg outputs, const ParamMap &param_
         internal_assert(!p.buffer().defined());
 
         // Allocate enough memory with the right type and dimensionality.
-        tracked_buffers[i].query.allocate();
+        query.second.allocate();
 
         if (buf_out_param != nullptr) {
-            *buf_out_param = Buffer<>(*tracked_buffers[i].query.raw_buffer());
+            *buf_out_param = Buffer<>(*query.second.raw_buffer());
         } else {
             // Bind this parameter to this buffer, giving away the
             // buffer. The user retrieves it via ImageParam::get.
-            p.set_buffer(Buffer<>(std::move(tracked_buffers[i].query)));
+            p.set_buffer(Buffer<>(std::move(query.second)));
         }
     }
 }
@@ -1081,6 +1359,162 @@ void Pipeline::infer_input_bounds(int x_size, int y_size, int z_size, int w_size
     infer_input_bounds(r, param_map);
 }
 
+StreamedInput::StreamedInput(const ImageParam &param, std::function<void(Buffer<> &)> load)
+    : param(std::make_shared<const ImageParam>(param)), load(std::move(load)) {
+}
+
+namespace {
+
+// Make the next window of a streamed input, of the given shape. The
+// part that overlaps the previous window is copied from it, and the
+// rest is loaded. Falls back to loading the whole window unless the
+// windows only differ in one dimension.
+Buffer<> next_window(const StreamedInput &input, const Runtime::Buffer<> &shape,
+                     const Buffer<> &prev, StripStats &stats) {
+    vector<int> mins, extents;
+    int differing_dims = 0, differing_dim = 0;
+    bool overlaps = prev.defined();
+    for (int i = 0; i < shape.dimensions(); i++) {
+        mins.push_back(shape.dim(i).min());
+        extents.push_back(shape.dim(i).extent());
+        if (prev.defined() &&
+            (prev.dim(i).min() != mins[i] || prev.dim(i).extent() != extents[i])) {
+            differing_dims++;
+            differing_dim = i;
+            overlaps = overlaps && (prev.dim(i).min() <= shape.dim(i).max() &&
+                                    prev.dim(i).max() >= shape.dim(i).min());
+        }
+    }
+
+    if (prev.defined() && differing_dims == 0) {
+        // The same window as last time.
+        stats.values_reused += prev.number_of_elements();
+        return prev;
+    }
+
+    Buffer<> window(shape.type(), extents, input.param->name());
+    window.set_min(mins);
+
+    if (!overlaps || differing_dims > 1) {
+        input.load(window);
+        stats.values_loaded += window.number_of_elements();
+        return window;
+    }
+
+    window.copy_from(prev);
+
+    // Load the part of the window before the previous one, and the
+    // part after it.
+    int d = differing_dim;
+    int prev_min = prev.dim(d).min(), prev_max = prev.dim(d).max();
+    int ranges[2][2] = {{window.dim(d).min(), prev_min - 1},
+                        {prev_max + 1, window.dim(d).max()}};
+    uint64_t loaded = 0;
+    for (auto &r : ranges) {
+        int lo = std::max(r[0], window.dim(d).min());
+        int hi = std::min(r[1], window.dim(d).max());
+        if (lo <= hi) {
+            Buffer<> region(window.get()->cropped(d, lo, hi - lo + 1));
+            input.load(region);
+            loaded += region.number_of_elements();
+        }
+    }
+    stats.values_loaded += loaded;
+    stats.values_reused += window.number_of_elements() - loaded;
+    return window;
+}
+
+}  // namespace
+
+StripStats Pipeline::realize_in_strips(vector<int32_t> sizes, int strip_height,
+                                       const vector<StreamedInput> &inputs,
+                                       std::function<void(const Realization &)> store,
+                                       const Target &t, const ParamMap &param_map) {
+    user_assert(defined()) << "Can't realize an undefined Pipeline\n";
+    user_assert(!sizes.empty()) << "realize_in_strips requires an output with at least one dimension\n";
+    user_assert(strip_height > 0) << "The strip height passed to realize_in_strips must be positive\n";
+    for (const StreamedInput &in : inputs) {
+        user_assert(!in.param->get().defined())
+            << "The streamed input " << in.param->name() << " must not have a Buffer bound to it\n";
+    }
+
+    Target target = default_jit_target(contents->jit_module.compiled(), contents->jit_target, t);
+    compile_jit(target);
+
+    // The output buffers, which are reused for each strip.
+    const int d = sizes.size() > 1 ? 1 : 0;
+    vector<int32_t> strip_sizes = sizes;
+    strip_sizes[d] = std::min(strip_height, sizes[d]);
+    vector<Buffer<>> outputs;
+    size_t output_bytes = 0;
+    for (auto &out : contents->outputs) {
+        user_assert(out.has_pure_definition() || out.has_extern_definition()) <<
+            "Can't realize Pipeline with undefined output Func: " << out.name() << ".\n";
+        for (Type type : out.output_types()) {
+            outputs.emplace_back(type, strip_sizes);
+            output_bytes += outputs.back().size_in_bytes();
+        }
+    }
+
+    StripStats stats;
+    vector<Buffer<>> windows(inputs.size());
+    for (int strip_min = 0; strip_min < sizes[d]; strip_min += strip_height) {
+        int strip_extent = std::min(strip_height, sizes[d] - strip_min);
+
+        vector<Buffer<>> strip_bufs;
+        for (Buffer<> &out : outputs) {
+            Runtime::Buffer<> b = out.get()->cropped(d, 0, strip_extent);
+            b.translate(d, strip_min);
+            strip_bufs.emplace_back(std::move(b));
+        }
+        Realization strip(strip_bufs);
+
+        // Find the window of each streamed input this strip needs.
+        RealizationArg strip_arg(strip);
+        auto queries = query_input_bounds(strip_arg, target, param_map);
+
+        ParamMap strip_params = param_map;
+        size_t bytes = output_bytes;
+        for (const Buffer<> &w : windows) {
+            if (w.defined()) {
+                bytes += w.size_in_bytes();
+            }
+        }
+        for (auto &query : queries) {
+            const Parameter &p = contents->inferred_args[query.first].param;
+            size_t i = 0;
+            while (i < inputs.size() && !inputs[i].param->parameter().same_as(p)) {
+                i++;
+            }
+            user_assert(i < inputs.size())
+                << "The ImageParam " << p.name() << " has no Buffer bound to it,"
+                << " and is not one of the streamed inputs to realize_in_strips\n";
+
+            Buffer<> window = next_window(inputs[i], query.second, windows[i], stats);
+            if (!window.same_as(windows[i])) {
+                // Both the old and new windows are alive here.
+                bytes += window.size_in_bytes();
+                stats.peak_bytes = std::max(stats.peak_bytes, bytes);
+                if (windows[i].defined()) {
+                    bytes -= windows[i].size_in_bytes();
+                }
+            }
+            windows[i] = window;
+            strip_params.set(*inputs[i].param, windows[i]);
+        }
+        stats.peak_bytes = std::max(stats.peak_bytes, bytes);
+
+        realize(strip, target, strip_params);
+        for (size_t i = 0; i < strip.size(); i++) {
+            strip[i].copy_to_host();
+        }
+        store(strip);
+        stats.strips++;
+    }
+
+    return stats;
+}
+
 void Pipeline::invalidate_cache() {
     if (defined()) {
         contents->invalidate_cache();
@@ -7,6 +7,7 @@
  * pipeline.
  */
 
+#include <memory>
 #include <vector>
 
 #include "AutoSchedule.h"
@@ -22,8 +23,10 @@ namespace Halide {
 
 struct Argument;
 class Func;
+class ImageParam;
 struct Outputs;
 struct PipelineContents;
+struct PreparedCallContents;
 
 namespace Internal {
 class IRMutator2;
@@ -54,6 +57,62 @@ struct CustomLoweringPass {
 
 struct JITExtern;
 
+/** A call to a jit-compiled Pipeline with all of its arguments bound
+ * ahead of time. See Pipeline::prepare. Running it calls the compiled
+ * code directly, skipping the argument inference and marshalling done
+ * by each call to Pipeline::realize. Copies of a PreparedCall share
+ * the same state, and must not be run concurrently. */
+class PreparedCall {
+    Internal::IntrusivePtr<PreparedCallContents> contents;
+
+    friend class Pipeline;
+
+public:
+    /** Make an undefined PreparedCall. */
+    PreparedCall();
+
+    /** Check if this PreparedCall is defined. */
+    bool defined() const;
+
+    /** Run the pipeline, writing into the output buffers it was
+     * prepared with. Scalar Params are read through the address of
+     * their storage, so new values set on them since the call was
+     * prepared are used. ImageParams stay bound to the buffers they
+     * held when the call was prepared. Errors are reported as in
+     * Pipeline::realize. */
+    void run();
+};
+
+/** An input to Pipeline::realize_in_strips that is loaded a window
+ * at a time, rather than being held in memory whole. */
+struct StreamedInput {
+    /** The ImageParam the windows are bound to. It must not have a
+     * Buffer bound to it. */
+    std::shared_ptr<const ImageParam> param;
+
+    /** Called to fill in a region of the input. The Buffer passed in
+     * has the type, dimensions, mins and extents of the region, and
+     * host memory to write it into. */
+    std::function<void(Buffer<> &region)> load;
+
+    StreamedInput(const ImageParam &param, std::function<void(Buffer<> &)> load);
+};
+
+/** A summary of a call to Pipeline::realize_in_strips. */
+struct StripStats {
+    /** The number of strips the output was split into. */
+    int strips = 0;
+
+    /** The number of values of the streamed inputs requested from
+     * StreamedInput::load, and the number copied from the window used
+     * by the previous strip instead. */
+    uint64_t values_loaded = 0, values_reused = 0;
+
+    /** The most bytes held at once in input windows and output
+     * strips. */
+    size_t peak_bytes = 0;
+};
+
 /** A class representing a Halide pipeline. Constructed from the Func
  * or Funcs that it outputs. */
 class Pipeline {
@@ -98,6 +157,13 @@ public:
     void prepare_jit_call_arguments(RealizationArg &output, const Target &target, const ParamMap &param_map,
                                     void *user_context, bool is_bounds_inference, JITCallArgs &args_result);
 
+    // Find the region required of each unbound buffer argument to
+    // compute the given outputs. Returns unallocated buffers of the
+    // required shape, paired with the index of the argument in the
+    // inferred arguments.
+    std::vector<std::pair<size_t, Runtime::Buffer<>>> query_input_bounds(RealizationArg &outputs, const Target &target,
+                                                                         const ParamMap &param_map);
+
     static std::vector<Internal::JITModule> make_externs_jit_module(const Target &target,
                                                                     std::map<std::string, JITExtern> &externs_in_out);
 
@@ -254,6 +320,28 @@ public:
      */
      void *compile_jit(const Target &target = get_jit_target_from_environment());
 
+    /** Jit compile this pipeline in two tiers. When set, jit
+     * compilation first makes code with Target::FastCompile, which
+     * compiles much faster but may run several times slower, and
+     * then compiles fully optimized code on a background thread.
+     * Calls to realize (and to PreparedCalls made by prepare) after
+     * the optimized code is ready switch over to it. This is useful
+     * when the first result is needed quickly, e.g. in interactive
+     * tools. Lowering is not repeated for the second tier, only llvm
+     * optimization and code generation. Invalidating the compiled
+     * code (e.g. by changing a schedule) waits for an optimized
+     * compilation that is still running. Turning tiering off waits
+     * for and switches to the optimized code, if any is still
+     * compiling. Off by default. */
+    void set_tiered_jit(bool tiered);
+
+    /** Get whether this pipeline is jit compiled in two tiers. */
+    bool tiered_jit() const;
+
+    /** If the code in use is the first tier of a tiered jit
+     * compilation, wait for the optimized code and switch to it. */
+    void wait_for_optimized_jit();
+
     /** Set the error handler function that be called in the case of
      * runtime errors during halide pipelines. If you are compiling
      * statically, you can also just define your own function with
@@ -390,6 +478,22 @@ public:
     /** Get the custom lowering passes. */
     const std::vector<CustomLoweringPass> &custom_lowering_passes();
 
+    /** Pack the heap allocations of the pipeline with a constant
+     * upper bound on their size into a single block of memory, and
+     * use the memory of the given one-dimensional uint8 ImageParam as
+     * that block when it is large enough and aligned to 128
+     * bytes. Otherwise the block is allocated on the heap once per
+     * call. If the buffer passed for the ImageParam has no host
+     * memory, its extent is set to the number of bytes required. The
+     * ImageParam is added to the inferred arguments when jitting, and
+     * must be in the argument list when compiling ahead of time. See
+     * also Target::PlanMemory, which plans memory without a scratch
+     * buffer. */
+    void set_memory_planning_scratch(const ImageParam &scratch);
+
+    /** Stop using a scratch buffer for memory planning. */
+    void clear_memory_planning_scratch();
+
     /** See Func::realize */
     // @{
     Realization realize(std::vector<int32_t> sizes, const Target &target = Target(),
@@ -418,6 +522,34 @@ public:
     void realize(RealizationArg output, const Target &target = Target(),
                  const ParamMap &param_map = ParamMap::empty_map());
 
+    /** Jit-compile the Pipeline if necessary, and bind the arguments
+     * of a call to it that writes into the given output buffers, for
+     * use by callers that run a small pipeline many times. The
+     * returned PreparedCall keeps the compiled code, the Buffers in a
+     * Realization, and the Buffers bound to ImageParams alive. A raw
+     * halide_buffer_t must outlive it. Handlers set on the Pipeline
+     * after the call is prepared are not used by it. */
+    PreparedCall prepare(RealizationArg output, const Target &target = Target(),
+                         const ParamMap &param_map = ParamMap::empty_map());
+
+    /** Evaluate this Pipeline over an output of the given size one
+     * strip at a time, for inputs and outputs too large to hold in
+     * memory. The output is split along its second dimension (or
+     * its first, if it has only one) into strips strip_height
+     * high. For each strip, the region of each streamed input it
+     * needs is found with a bounds query, and loaded into a window
+     * bound to its ImageParam. The part of the window that overlaps
+     * the previous strip's window is copied from it rather than
+     * loaded again. Each strip of the output is passed to 'store'
+     * once it is computed, with the mins of its Buffers set to its
+     * position in the output; the Buffers are reused for the next
+     * strip. All other ImageParams must be bound as usual. */
+    StripStats realize_in_strips(std::vector<int32_t> sizes, int strip_height,
+                                 const std::vector<StreamedInput> &inputs,
+                                 std::function<void(const Realization &strip)> store,
+                                 const Target &target = Target(),
+                                 const ParamMap &param_map = ParamMap::empty_map());
+
     /** For a given size of output, or a given set of output buffers,
      * determine the bounds required of all unbound ImageParams
      * referenced. Communicates the result by allocating new buffers
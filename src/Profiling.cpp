@@ -27,11 +27,40 @@ public:
 
     string pipeline_name;
 
-    InjectProfiling(const string &pipeline_name) : pipeline_name(pipeline_name) {
+    // Whether to read the hardware counters of each thread whenever
+    // it changes Func.
+    bool profiling_counters;
+
+    // Whether to record when each thread starts and finishes each
+    // Func on a timeline.
+    bool profiling_timeline;
+
+    InjectProfiling(const string &pipeline_name, bool profiling_counters, bool profiling_timeline)
+        : pipeline_name(pipeline_name), profiling_counters(profiling_counters),
+          profiling_timeline(profiling_timeline) {
         indices["overhead"] = 0;
         stack.push_back(0);
     }
 
+    // Tell the runtime that the calling thread is now computing the
+    // given func, or nothing if the index is negative.
+    Stmt set_counters_func(int idx) {
+        Expr profiler_pipeline_state = Variable::make(Handle(), "profiler_pipeline_state");
+        return Evaluate::make(Call::make(Int(32), "halide_profiler_counters_set_func",
+                                         {profiler_pipeline_state, idx}, Call::Extern));
+    }
+
+    // Wrap a statement run by a single thread in calls that record
+    // it on the timeline as computing the given func.
+    Stmt record_on_timeline(int idx, Stmt s) {
+        Expr profiler_pipeline_state = Variable::make(Handle(), "profiler_pipeline_state");
+        Stmt enter = Evaluate::make(Call::make(Int(32), "halide_profiler_timeline_enter",
+                                               {profiler_pipeline_state, idx}, Call::Extern));
+        Stmt exit = Evaluate::make(Call::make(Int(32), "halide_profiler_timeline_exit",
+                                              {profiler_pipeline_state, idx}, Call::Extern));
+        return Block::make({enter, s, exit});
+    }
+
     map<int, uint64_t> func_stack_current; // map from func id -> current stack allocation
     map<int, uint64_t> func_stack_peak; // map from func id -> peak stack allocation
 
@@ -209,6 +238,14 @@ private:
 
         body = Block::make(Evaluate::make(set_task), body);
 
+        if (profiling_counters) {
+            body = Block::make(set_counters_func(idx), body);
+        }
+
+        if (profiling_timeline && op->is_producer) {
+            body = record_on_timeline(idx, body);
+        }
+
         return ProducerConsumer::make(op->name, op->is_producer, body);
     }
 
@@ -241,9 +278,15 @@ private:
             // hexagon. We don't support per-func stats remotely,
             // which means we can't do memory accounting.
             bool old_profiling_memory = profiling_memory;
+            bool old_profiling_counters = profiling_counters;
+            bool old_profiling_timeline = profiling_timeline;
             profiling_memory = false;
+            profiling_counters = false;
+            profiling_timeline = false;
             body = mutate(body);
             profiling_memory = old_profiling_memory;
+            profiling_counters = old_profiling_counters;
+            profiling_timeline = old_profiling_timeline;
 
             // Get the profiler state pointer from scratch inside the
             // kernel. There will be a separate copy of the state on
@@ -258,17 +301,39 @@ private:
             body = op->body;
         }
 
+        // The tasks of a parallel loop run on many threads, which
+        // each need to know which func they are computing. The
+        // thread that launched the loop picks up where it left off.
+        bool update_counters = (profiling_counters && op->is_parallel() &&
+                                (op->device_api == DeviceAPI::None ||
+                                 op->device_api == DeviceAPI::Host));
+        if (update_counters) {
+            body = Block::make({set_counters_func(stack.back()), body,
+                                set_counters_func(halide_profiler_outside_of_halide)});
+        }
+
+        // Likewise, each task of a parallel loop is a separate span
+        // on the timeline of the thread that runs it.
+        if (profiling_timeline && op->is_parallel() &&
+            (op->device_api == DeviceAPI::None ||
+             op->device_api == DeviceAPI::Host)) {
+            body = record_on_timeline(stack.back(), body);
+        }
+
         Stmt stmt = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
 
         if (update_active_threads) {
             stmt = Block::make({decr_active_threads, stmt, incr_active_threads});
         }
+        if (update_counters) {
+            stmt = Block::make(stmt, set_counters_func(stack.back()));
+        }
         return stmt;
     }
 };
 
-Stmt inject_profiling(Stmt s, string pipeline_name) {
-    InjectProfiling profiling(pipeline_name);
+Stmt inject_profiling(Stmt s, string pipeline_name, bool counters, bool timeline) {
+    InjectProfiling profiling(pipeline_name, counters, timeline);
     s = profiling.mutate(s);
 
     int num_funcs = (int)(profiling.indices.size());
@@ -276,7 +341,8 @@ Stmt inject_profiling(Stmt s, string pipeline_name) {
     Expr func_names_buf = Variable::make(Handle(), "profiling_func_names");
 
     Expr start_profiler = Call::make(Int(32), "halide_profiler_pipeline_start",
-                                     {pipeline_name, num_funcs, func_names_buf}, Call::Extern);
+                                     {pipeline_name, num_funcs, func_names_buf, timeline ? 1 : 0},
+                                     Call::Extern);
 
     Expr get_state = Call::make(Handle(), "halide_profiler_get_state", {}, Call::Extern);
 
@@ -304,6 +370,13 @@ Stmt inject_profiling(Stmt s, string pipeline_name) {
     Stmt decr_active_threads =
         Evaluate::make(Call::make(Int(32), "halide_profiler_decr_active_threads",
                                   {profiler_state}, Call::Extern));
+    if (counters) {
+        // Bill the hardware counts of the calling thread to the
+        // overhead slot until the first func starts, and stop billing
+        // when the pipeline returns.
+        s = Block::make({profiling.set_counters_func(0), s,
+                         profiling.set_counters_func(halide_profiler_outside_of_halide)});
+    }
     s = Block::make({incr_active_threads, s, decr_active_threads});
 
     s = LetStmt::make("profiler_pipeline_state", get_pipeline_state, s);
@@ -311,6 +384,14 @@ Stmt inject_profiling(Stmt s, string pipeline_name) {
     // If there was a problem starting the profiler, it will call an
     // appropriate halide error function and then return the
     // (negative) error code as the token.
+    if (timeline) {
+        // Only registered once the profiler has started, so that a
+        // failed start does not uninstall the thread pool hook of
+        // another running timeline pipeline.
+        Expr end_timeline = Call::make(Int(32), Call::register_destructor,
+                                       {Expr("halide_profiler_timeline_pipeline_end"), get_state}, Call::Intrinsic);
+        s = Block::make(Evaluate::make(end_timeline), s);
+    }
     s = Block::make(AssertStmt::make(profiler_token >= 0, profiler_token), s);
     s = LetStmt::make("profiler_token", start_profiler, s);
 
@@ -22,6 +22,23 @@
  *   f0:          0.025673ms (42%)
  *   mandelbrot:  0.006444ms (10%)   peak: 505344   num: 104000   avg: 5376
  *   argmin:      0.027715ms (46%)   stack: 20
+ *
+ * With the 'profile_counters' target flag (x86 Linux only), each
+ * thread also reads its hardware performance counters whenever it
+ * starts or stops computing a func, and the report adds the
+ * instructions per cycle and last-level cache misses per thousand
+ * instructions of each func, and of each thread. Low IPC with a high
+ * miss rate suggests a func is memory-bound. Reading the counters
+ * costs a system call per produce node and per parallel task, so
+ * this is more intrusive than the sampling profiler alone.
+ *
+ * With the 'profile_timeline' target flag, each thread records when
+ * it starts and finishes computing each func, and the thread pool
+ * records when each parallel task starts and finishes, and how long
+ * threads waited before starting on each parallel loop. The report
+ * writes this timeline out as Chrome trace JSON, to the file named by
+ * HL_TIMELINE_FILE, or halide_timeline.json (see
+ * halide_profiler_write_timeline).
  */
 
 #include "IR.h"
@@ -33,10 +50,12 @@ namespace Internal {
  * high-resolution timing into the generated code (via spawning a
  * thread that acts as a sampling profiler); summaries of execution
  * times and counts will be logged at the end. Should be done before
- * storage flattening, but after all bounds inference.
- *
+ * storage flattening, but after all bounds inference. If counters
+ * is true, also read the hardware counters of each thread whenever
+ * it changes func. If timeline is true, also record when each thread
+ * starts and finishes each func.
  */
-Stmt inject_profiling(Stmt, std::string);
+Stmt inject_profiling(Stmt, std::string, bool counters = false, bool timeline = false);
 
 }  // namespace Internal
 }  // namespace Halide
@@ -70,13 +70,15 @@ class ExprCost : public IRVisitor {
     void visit(const Cast *op) {
         op->value.accept(this);
         arith += 1;
+        ops[(int)OpKind::Cast]++;
     }
 
     template<typename T>
-    void visit_binary_operator(const T *op, int op_cost) {
+    void visit_binary_operator(const T *op, int op_cost, OpKind kind) {
         op->a.accept(this);
         op->b.accept(this);
         arith += op_cost;
+        ops[(int)kind]++;
     }
 
     // The costs of all the simple binary operations is set to one.
@@ -84,25 +86,26 @@ class ExprCost : public IRVisitor {
     // beneficial. Write a test case to validate this and update the costs
     // accordingly.
 
-    void visit(const Add *op) { visit_binary_operator(op, 1); }
-    void visit(const Sub *op) { visit_binary_operator(op, 1); }
-    void visit(const Mul *op) { visit_binary_operator(op, 1); }
-    void visit(const Div *op) { visit_binary_operator(op, 1); }
-    void visit(const Mod *op) { visit_binary_operator(op, 1); }
-    void visit(const Min *op) { visit_binary_operator(op, 1); }
-    void visit(const Max *op) { visit_binary_operator(op, 1); }
-    void visit(const EQ *op) { visit_binary_operator(op, 1); }
-    void visit(const NE *op) { visit_binary_operator(op, 1); }
-    void visit(const LT *op) { visit_binary_operator(op, 1); }
-    void visit(const LE *op) { visit_binary_operator(op, 1); }
-    void visit(const GT *op) { visit_binary_operator(op, 1); }
-    void visit(const GE *op) { visit_binary_operator(op, 1); }
-    void visit(const And *op) { visit_binary_operator(op, 1); }
-    void visit(const Or *op) { visit_binary_operator(op, 1); }
+    void visit(const Add *op) { visit_binary_operator(op, 1, OpKind::AddSub); }
+    void visit(const Sub *op) { visit_binary_operator(op, 1, OpKind::AddSub); }
+    void visit(const Mul *op) { visit_binary_operator(op, 1, OpKind::Mul); }
+    void visit(const Div *op) { visit_binary_operator(op, 1, OpKind::DivMod); }
+    void visit(const Mod *op) { visit_binary_operator(op, 1, OpKind::DivMod); }
+    void visit(const Min *op) { visit_binary_operator(op, 1, OpKind::MinMax); }
+    void visit(const Max *op) { visit_binary_operator(op, 1, OpKind::MinMax); }
+    void visit(const EQ *op) { visit_binary_operator(op, 1, OpKind::Compare); }
+    void visit(const NE *op) { visit_binary_operator(op, 1, OpKind::Compare); }
+    void visit(const LT *op) { visit_binary_operator(op, 1, OpKind::Compare); }
+    void visit(const LE *op) { visit_binary_operator(op, 1, OpKind::Compare); }
+    void visit(const GT *op) { visit_binary_operator(op, 1, OpKind::Compare); }
+    void visit(const GE *op) { visit_binary_operator(op, 1, OpKind::Compare); }
+    void visit(const And *op) { visit_binary_operator(op, 1, OpKind::Compare); }
+    void visit(const Or *op) { visit_binary_operator(op, 1, OpKind::Compare); }
 
     void visit(const Not *op) {
         op->a.accept(this);
         arith += 1;
+        ops[(int)OpKind::Compare]++;
     }
 
     void visit(const Select *op) {
@@ -110,6 +113,7 @@ class ExprCost : public IRVisitor {
         op->true_value.accept(this);
         op->false_value.accept(this);
         arith += 1;
+        ops[(int)OpKind::Select]++;
     }
 
     void visit(const Call *call) {
@@ -160,15 +164,19 @@ class ExprCost : public IRVisitor {
             arith += 1;
             memory += call->type.bytes();
             detailed_byte_loads[call->name] += (int64_t)call->type.bytes();
+            ops[(int)OpKind::Load]++;
         } else if (call->is_extern()) {
             // TODO: Suffix based matching is kind of sketchy; but going ahead with
             // it for now. Also not all the PureExtern's are accounted for yet.
             if (ends_with(call->name, "_f64")) {
                 arith += 20;
+                ops[(int)OpKind::Math]++;
             } else if (ends_with(call->name, "_f32")) {
                 arith += 10;
+                ops[(int)OpKind::Math]++;
             } else if (ends_with(call->name, "_f16")) {
                 arith += 5;
+                ops[(int)OpKind::Math]++;
             } else {
                 // There is no visibility into an extern stage so there is no
                 // way to know the cost of the call statically. Modeling the
@@ -185,17 +193,25 @@ class ExprCost : public IRVisitor {
                     call->is_intrinsic(Call::shift_right) || call->is_intrinsic(Call::div_round_to_zero) ||
                     call->is_intrinsic(Call::mod_round_to_zero) || call->is_intrinsic(Call::undef)) {
                 arith += 1;
+                if (call->is_intrinsic(Call::div_round_to_zero) ||
+                    call->is_intrinsic(Call::mod_round_to_zero)) {
+                    ops[(int)OpKind::DivMod]++;
+                } else if (!call->is_intrinsic(Call::undef)) {
+                    ops[(int)OpKind::Bitwise]++;
+                }
             } else if (call->is_intrinsic(Call::abs) || call->is_intrinsic(Call::absd) ||
                        call->is_intrinsic(Call::lerp) || call->is_intrinsic(Call::random) ||
                        call->is_intrinsic(Call::count_leading_zeros) ||
                        call->is_intrinsic(Call::count_trailing_zeros)) {
                 arith += 5;
+                ops[(int)OpKind::Math]++;
             } else if (call->is_intrinsic(Call::likely) ||
                        call->is_intrinsic(Call::likely_if_innermost)) {
                 // Likely does not result in actual operations.
             } else {
                 // For other intrinsics, use 1 for the arithmetic cost.
                 arith += 1;
+                ops[(int)OpKind::Bitwise]++;
                 user_warning << "Unhandled intrinsic call " << call->name << '\n';
             }
         }
@@ -207,6 +223,7 @@ class ExprCost : public IRVisitor {
 
     void visit(const Shuffle *op) {
         arith += 1;
+        ops[(int)OpKind::Bitwise]++;
     }
 
     void visit(const Let *let) {
@@ -238,8 +255,14 @@ public:
     // Detailed breakdown of bytes loaded by the allocation or function
     // they are loaded from.
     map<string, int64_t> detailed_byte_loads;
+    // The number of operations of each kind.
+    int64_t ops[num_op_kinds];
 
-    ExprCost() : arith(0), memory(0) {}
+    ExprCost() : arith(0), memory(0) {
+        for (int i = 0; i < num_op_kinds; i++) {
+            ops[i] = 0;
+        }
+    }
 };
 
 // Return the number of bytes required to store a single value of the
@@ -322,8 +345,25 @@ map<string, Expr> compute_expr_detailed_byte_loads(Expr expr) {
     return loads;
 }
 
+// Return the number of operations of each kind in an expression.
+vector<int64_t> compute_expr_op_histogram(Expr expr) {
+    expr = simplify(expr);
+    ExprCost cost_visitor;
+    expr.accept(&cost_visitor);
+    return vector<int64_t>(cost_visitor.ops, cost_visitor.ops + num_op_kinds);
+}
+
 } // anonymous namespace
 
+const char *op_kind_name(OpKind kind) {
+    static const char *names[num_op_kinds] = {
+        "add_sub", "mul", "div_mod", "min_max", "compare", "select",
+        "cast", "bitwise", "math", "load", "store"
+    };
+    internal_assert((int)kind >= 0 && (int)kind < num_op_kinds);
+    return names[(int)kind];
+}
+
 RegionCosts::RegionCosts(const map<string, Function> &_env) : env(_env) {
     for (const auto &kv : env) {
         // Pre-compute the function costs without any inlining.
@@ -592,6 +632,96 @@ Cost RegionCosts::get_func_stage_cost(const Function &f, int stage, const set<st
     return cost;
 }
 
+vector<int64_t> RegionCosts::get_func_stage_op_histogram(const Function &f, int stage,
+                                                         const set<string> &inlines) {
+    if (f.has_extern_definition()) {
+        return vector<int64_t>();
+    }
+
+    Definition def = get_stage_definition(f, stage);
+
+    vector<int64_t> histogram(num_op_kinds, 0);
+    auto accumulate = [&](const Expr &e) {
+        Expr inlined_expr = perform_inline(e, env, inlines);
+        vector<int64_t> expr_histogram = compute_expr_op_histogram(inlined_expr);
+        for (int i = 0; i < num_op_kinds; i++) {
+            histogram[i] += expr_histogram[i];
+        }
+    };
+
+    for (const auto &e : def.values()) {
+        accumulate(e);
+        histogram[(int)OpKind::Store]++;
+    }
+
+    if (!f.is_pure()) {
+        for (const auto &arg : def.args()) {
+            accumulate(arg);
+        }
+    }
+
+    return histogram;
+}
+
+vector<Expr> RegionCosts::stage_region_op_histogram(string func, int stage, const DimBounds &bounds,
+                                                    const set<string> &inlines) {
+    Function curr_f = get_element(env, func);
+
+    Box stage_region;
+    const vector<Dim> &dims = get_stage_dims(curr_f, stage);
+    for (int d = 0; d < (int)dims.size() - 1; d++) {
+        stage_region.push_back(get_element(bounds, dims[d].var));
+    }
+
+    Expr size = box_size(stage_region);
+    vector<int64_t> per_value = get_func_stage_op_histogram(curr_f, stage, inlines);
+    if (!size.defined() || per_value.empty()) {
+        return vector<Expr>();
+    }
+
+    vector<Expr> histogram;
+    for (int64_t count : per_value) {
+        histogram.push_back(simplify(size * make_const(Int(64), count)));
+    }
+    return histogram;
+}
+
+vector<Expr> RegionCosts::region_op_histogram(const map<string, Box> &regions,
+                                              const set<string> &inlines) {
+    vector<Expr> histogram(num_op_kinds, make_zero(Int(64)));
+    for (const auto &r : regions) {
+        // The operations of pure inlined functions are accounted for in
+        // their consumers.
+        if (inlines.find(r.first) != inlines.end()) {
+            continue;
+        }
+
+        Function curr_f = get_element(env, r.first);
+        DimBounds pure_bounds;
+        const vector<string> &args = curr_f.args();
+        internal_assert(args.size() == r.second.size());
+        for (size_t d = 0; d < args.size(); d++) {
+            pure_bounds.emplace(args[d], r.second[d]);
+        }
+
+        int num_stages = curr_f.updates().size() + 1;
+        for (int s = 0; s < num_stages; s++) {
+            DimBounds stage_bounds = get_stage_bounds(curr_f, s, pure_bounds);
+            vector<Expr> stage_histogram = stage_region_op_histogram(r.first, s, stage_bounds, inlines);
+            if (stage_histogram.empty()) {
+                return vector<Expr>();
+            }
+            for (int i = 0; i < num_op_kinds; i++) {
+                histogram[i] += stage_histogram[i];
+            }
+        }
+    }
+    for (Expr &e : histogram) {
+        e = simplify(e);
+    }
+    return histogram;
+}
+
 vector<Cost> RegionCosts::get_func_cost(const Function &f, const set<string> &inlines) {
     if (f.has_extern_definition()) {
         return { Cost() };
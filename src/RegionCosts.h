@@ -36,6 +36,25 @@ struct Cost {
     }
 };
 
+/** The kinds of operations counted by RegionCosts::region_op_histogram. */
+enum class OpKind {
+    AddSub = 0,
+    Mul,
+    DivMod,
+    MinMax,
+    Compare,
+    Select,
+    Cast,
+    Bitwise,
+    Math,
+    Load,
+    Store,
+};
+const int num_op_kinds = (int)OpKind::Store + 1;
+
+/** Return a short name for an OpKind, e.g. "add_sub". */
+const char *op_kind_name(OpKind kind);
+
 /** Auto scheduling component which is used to assign costs for computing a
  * region of a function or one of its stages. */
 struct RegionCosts {
@@ -111,6 +130,24 @@ struct RegionCosts {
         detailed_load_costs(const std::map<std::string, Box> &regions,
                             const std::set<std::string> &inlines = std::set<std::string>());
 
+    /** Return the number of operations of each kind (indexed by OpKind)
+     * needed to produce a single value of a function stage, or an empty
+     * vector if the stage is an extern definition. 'inlines' specifies
+     * names of all the inlined functions. */
+    std::vector<int64_t> get_func_stage_op_histogram(const Function &f, int stage,
+                                                     const std::set<std::string> &inlines = std::set<std::string>());
+
+    /** Return the number of operations of each kind needed to produce a
+     * region (specified by 'bounds') of a function stage, or an empty
+     * vector if it cannot be determined. */
+    std::vector<Expr> stage_region_op_histogram(std::string func, int stage, const DimBounds &bounds,
+                                                const std::set<std::string> &inlines = std::set<std::string>());
+
+    /** Same as stage_region_op_histogram above but this adds up the
+     * operations of all stages of many function regions. */
+    std::vector<Expr> region_op_histogram(const std::map<std::string, Box> &regions,
+                                          const std::set<std::string> &inlines = std::set<std::string>());
+
     /** Return the size of the region of 'func' in bytes. */
     Expr region_size(std::string func, const Box &region);
 
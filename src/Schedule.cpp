@@ -213,11 +213,12 @@ struct FuncScheduleContents {
     std::vector<Bound> estimates;
     std::map<std::string, Internal::FunctionPtr> wrappers;
     bool memoized;
+    bool async;
     MemoryType memory_type;
 
     FuncScheduleContents() :
         store_level(LoopLevel::inlined()), compute_level(LoopLevel::inlined()),
-        memoized(false), memory_type(MemoryType::Auto) {};
+        memoized(false), async(false), memory_type(MemoryType::Auto) {};
 
     // Pass an IRMutator2 through to all Exprs referenced in the FuncScheduleContents
     void mutate(IRMutator2 *mutator) {
@@ -276,9 +277,10 @@ struct StageScheduleContents {
     std::vector<FusedPair> fused_pairs;
     bool touched;
     bool allow_race_conditions;
+    bool atomic;
 
     StageScheduleContents() : fuse_level(FuseLoopLevel()), touched(false),
-                              allow_race_conditions(false) {};
+                              allow_race_conditions(false), atomic(false) {};
 
     // Pass an IRMutator2 through to all Exprs referenced in the StageScheduleContents
     void mutate(IRMutator2 *mutator) {
@@ -327,6 +329,7 @@ FuncSchedule FuncSchedule::deep_copy(
     copy.contents->bounds = contents->bounds;
     copy.contents->estimates = contents->estimates;
     copy.contents->memoized = contents->memoized;
+    copy.contents->async = contents->async;
     copy.contents->memory_type = contents->memory_type;
 
     // Deep-copy wrapper functions.
@@ -347,6 +350,14 @@ bool FuncSchedule::memoized() const {
     return contents->memoized;
 }
 
+bool &FuncSchedule::async() {
+    return contents->async;
+}
+
+bool FuncSchedule::async() const {
+    return contents->async;
+}
+
 MemoryType FuncSchedule::memory_type() const {
     return contents->memory_type;
 }
@@ -467,6 +478,7 @@ StageSchedule StageSchedule::get_copy() const {
     copy.contents->fused_pairs = contents->fused_pairs;
     copy.contents->touched = contents->touched;
     copy.contents->allow_race_conditions = contents->allow_race_conditions;
+    copy.contents->atomic = contents->atomic;
     return copy;
 }
 
@@ -534,6 +546,14 @@ bool StageSchedule::allow_race_conditions() const {
     return contents->allow_race_conditions;
 }
 
+bool &StageSchedule::atomic() {
+    return contents->atomic;
+}
+
+bool StageSchedule::atomic() const {
+    return contents->atomic;
+}
+
 void StageSchedule::accept(IRVisitor *visitor) const {
     for (const ReductionVariable &r : rvars()) {
         if (r.min.defined()) {
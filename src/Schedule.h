@@ -393,6 +393,13 @@ public:
     bool memoized() const;
     // @}
 
+    /** This flag is set to true if the function should be computed
+     * asynchronously with respect to its consumers. See Func::async. */
+    // @{
+    bool &async();
+    bool async() const;
+    // @}
+
     /** The list and order of dimensions used to store this
      * function. The first dimension in the vector corresponds to the
      * innermost dimension for storage (i.e. which dimension is
@@ -538,6 +545,13 @@ public:
     bool &allow_race_conditions();
     // @}
 
+    /** Is each update of this stage applied atomically, so that its
+     * loops over RVars can run in parallel? See \ref Stage::atomic */
+    // @{
+    bool atomic() const;
+    bool &atomic();
+    // @}
+
     /** Pass an IRVisitor through to all Exprs referenced in the
      * Schedule. */
     void accept(IRVisitor *) const;
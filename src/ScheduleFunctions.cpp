@@ -88,6 +88,9 @@ Stmt build_provide_loop_nest_helper(string func_name,
 
     // Make the (multi-dimensional multi-valued) store node.
     Stmt stmt = Provide::make(func_name, values, site);
+    if (stage_s.atomic()) {
+        stmt = Atomic::make(func_name, stmt);
+    }
 
     // A map of the dimensions for which we know the extent is a
     // multiple of some Expr. This can happen due to a bound, or
@@ -7,8 +7,10 @@
 #include "Bounds.h"
 #include "Debug.h"
 #include "Deinterleave.h"
+#include "ExprInterner.h"
 #include "ExprUsesVar.h"
 #include "IREquality.h"
+#include "IRMatch.h"
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "IRPrinter.h"
@@ -139,7 +141,7 @@ bool propagate_indeterminate_expression(const Expr &e0, const Expr &e1, const Ex
 }
 
 #if LOG_EXPR_MUTATIONS || LOG_STMT_MUTATIONS
-static int debug_indent = 0;
+thread_local int debug_indent = 0;
 #endif
 
 }
@@ -571,7 +573,7 @@ private:
     }
 
     Expr visit(const Add *op) override {
-        int64_t ia = 0, ib = 0, ic = 0;
+        int64_t ia = 0, ib = 0;
         uint64_t ua = 0, ub = 0;
         double fa = 0.0f, fb = 0.0f;
 
@@ -613,51 +615,23 @@ private:
         const Broadcast *broadcast_a = a.as<Broadcast>();
         const Broadcast *broadcast_b = b.as<Broadcast>();
         const Add *add_a = a.as<Add>();
-        const Add *add_b = b.as<Add>();
-        const Sub *sub_a = a.as<Sub>();
-        const Sub *sub_b = b.as<Sub>();
-        const Mul *mul_a = a.as<Mul>();
         const Mul *mul_b = b.as<Mul>();
-
-        const Div *div_a = a.as<Div>();
-        const Div *div_b = b.as<Div>();
-
-        const Add *add_div_a_a = div_a ? div_a->a.as<Add>(): nullptr;
-        const Sub *sub_div_a_a = div_a ? div_a->a.as<Sub>(): nullptr;
-        const Add *add_div_b_a = div_b ? div_b->a.as<Add>(): nullptr;
-        const Sub *sub_div_b_a = div_b ? div_b->a.as<Sub>(): nullptr;
-
-        const Div *div_a_a = mul_a ? mul_a->a.as<Div>() : nullptr;
-        const Mod *mod_a = a.as<Mod>();
         const Mod *mod_b = b.as<Mod>();
 
         const Mul *mul_a_a = add_a ? add_a->a.as<Mul>(): nullptr;
         const Mod *mod_a_a = add_a ? add_a->a.as<Mod>(): nullptr;
         const Mul *mul_a_b = add_a ? add_a->b.as<Mul>(): nullptr;
         const Mod *mod_a_b = add_a ? add_a->b.as<Mod>(): nullptr;
-        const Div *div_a_b = add_a ? add_a->b.as<Div>() : nullptr;
-        const Add *add_a_b_a = div_a_b ? div_a_b->a.as<Add>() : nullptr;
 
-        const Max *max_b = b.as<Max>();
-
-        const Min *min_a = a.as<Min>();
-        const Max *max_a = a.as<Max>();
-        const Sub *sub_a_a = min_a ? min_a->a.as<Sub>() : nullptr;
-        const Sub *sub_a_b = min_a ? min_a->b.as<Sub>() : nullptr;
-        const Add *add_a_a = min_a ? min_a->a.as<Add>() : nullptr;
-        const Add *add_a_b = min_a ? min_a->b.as<Add>() : nullptr;
-        sub_a_a = max_a ? max_a->a.as<Sub>() : sub_a_a;
-        sub_a_b = max_a ? max_a->b.as<Sub>() : sub_a_b;
-        add_a_a = max_a ? max_a->a.as<Add>() : add_a_a;
-        add_a_b = max_a ? max_a->b.as<Add>() : add_a_b;
-        add_a_a = mul_a ? mul_a->a.as<Add>() : add_a_a;
-        add_a_a = div_a ? div_a->a.as<Add>() : add_a_a;
-
-        const Div *div_a_a_a = add_a_a ? add_a_a->a.as<Div>() : nullptr;
-        const Div *div_a_a_b = add_a_a ? add_a_a->b.as<Div>() : nullptr;
-
-        const Select *select_a = a.as<Select>();
-        const Select *select_b = b.as<Select>();
+        IRMatcher::Wild<0> x;
+        IRMatcher::Wild<1> y;
+        IRMatcher::Wild<2> z;
+        IRMatcher::Wild<3> w;
+        IRMatcher::Wild<4> u;
+        IRMatcher::WildConst<0> c0;
+        IRMatcher::WildConst<1> c1;
+        IRMatcher::WildConst<2> c2;
+        IRMatcher::Rewriter<Add> rewrite(op, a, b);
 
         if (const_int(a, &ia) &&
             const_int(b, &ib)) {
@@ -717,312 +691,74 @@ private:
             return Broadcast::make(mutate(broadcast_a->value + broadcast_b->value),
                                    broadcast_a->lanes);
 
-        } else if (select_a &&
-                   select_b &&
-                   equal(select_a->condition, select_b->condition)) {
-            // select(c, a, b) + select(c, d, e) -> select(c, a+d, b+e)
-            return mutate(Select::make(select_a->condition,
-                                       select_a->true_value + select_b->true_value,
-                                       select_a->false_value + select_b->false_value));
-        } else if (select_a &&
-                   is_simple_const(b) &&
-                   (is_simple_const(select_a->true_value) ||
-                    is_simple_const(select_a->false_value))) {
-            // select(c, c1, c2) + c3 -> select(c, c1+c3, c2+c3)
-            return mutate(Select::make(select_a->condition,
-                                       select_a->true_value + b,
-                                       select_a->false_value + b));
-        } else if (add_a &&
-                   is_simple_const(add_a->b)) {
-            // In ternary expressions, pull constants outside
-            if (is_simple_const(b)) {
-                return mutate(add_a->a + (add_a->b + b));
-            } else {
-                return mutate((add_a->a + b) + add_a->b);
-            }
-        } else if (add_b &&
-                   is_simple_const(add_b->b)) {
-            return mutate((a + add_b->a) + add_b->b);
-        } else if (sub_a &&
-                   is_simple_const(sub_a->a)) {
-            if (is_simple_const(b)) {
-                return mutate((sub_a->a + b) - sub_a->b);
-            } else {
-                return mutate((b - sub_a->b) + sub_a->a);
-            }
-
-        } else if (sub_a &&
-                   equal(b, sub_a->b)) {
+        } else if (rewrite(select(x, y, z) + select(x, w, u), select(x, y + w, z + u)) ||
+                   rewrite(select(x, c0, y) + c1, select(x, c0 + c1, y + c1)) ||
+                   rewrite(select(x, y, c0) + c1, select(x, y + c1, c0 + c1)) ||
+                   // In ternary expressions, pull constants outside
+                   rewrite((x + c0) + c1, x + (c0 + c1)) ||
+                   rewrite((x + c0) + y, (x + y) + c0) ||
+                   rewrite(x + (y + c0), (x + y) + c0) ||
+                   rewrite((c0 - x) + c1, (c0 + c1) - x) ||
+                   rewrite((c0 - x) + y, (y - x) + c0)) {
+            return mutate(rewrite.result);
+        } else if (rewrite((x - y) + y, x)) {
             // Additions that cancel an inner term
-            // (a - b) + b
-            return sub_a->a;
-        } else if (sub_a &&
-                   is_zero(sub_a->a)) {
-            return mutate(b - sub_a->b);
-        } else if (sub_b && equal(a, sub_b->b)) {
-            // a + (b - a)
-            return sub_b->a;
-        } else if (sub_b &&
-                   is_simple_const(sub_b->a)) {
-            // a + (7 - b) -> (a - b) + 7
-            return mutate((a - sub_b->b) + sub_b->a);
-        } else if (sub_a &&
-                   sub_b &&
-                   equal(sub_a->b, sub_b->a)) {
-            // (a - b) + (b - c) -> a - c
-            return mutate(sub_a->a - sub_b->b);
-        } else if (sub_a &&
-                   sub_b &&
-                   equal(sub_a->a, sub_b->b)) {
-            // (a - b) + (c - a) -> c - b
-            return mutate(sub_b->a - sub_a->b);
-        } else if (mul_b &&
-                   is_negative_negatable_const(mul_b->b)) {
-            // a + b*-x -> a - b*x
-            return mutate(a - mul_b->a * (-mul_b->b));
-        } else if (mul_a &&
-                   !is_const(b) && // Leave constants on the right
-                   is_negative_negatable_const(mul_a->b)) {
-            // a*-x + b -> b - a*x
-            return mutate(b - mul_a->a * (-mul_a->b));
-        } else if (mul_b &&
-                   !is_const(a) &&
-                   equal(a, mul_b->a) &&
-                   no_overflow(op->type)) {
-            // a + a*b -> a*(1 + b)
-            return mutate(a * (make_one(op->type) + mul_b->b));
-        } else if (mul_b &&
-                   !is_const(a) &&
-                   equal(a, mul_b->b) &&
-                   no_overflow(op->type)) {
-            // a + b*a -> (1 + b)*a
-            return mutate((make_one(op->type) + mul_b->a) * a);
-        } else if (mul_a &&
-                   !is_const(b) &&
-                   equal(mul_a->a, b) &&
-                   no_overflow(op->type)) {
-            // a*b + a -> a*(b + 1)
-            return mutate(mul_a->a * (mul_a->b + make_one(op->type)));
-        } else if (mul_a &&
-                   !is_const(b) &&
-                   equal(mul_a->b, b) &&
-                   no_overflow(op->type)) {
-            // a*b + b -> (a + 1)*b
-            return mutate((mul_a->a + make_one(op->type)) * b);
-        } else if (no_overflow(op->type) &&
-                   div_a && add_div_a_a &&
-                   is_simple_const(add_div_a_a->b) &&
-                   is_simple_const(div_a->b) &&
-                   is_simple_const(b)) {
-            // (y + c1)/c2 + c3 -> (y + (c1 + c2*c3))/c2
-            return mutate((add_div_a_a->a + (add_div_a_a->b + div_a->b*b))/div_a->b);
-        } else if (no_overflow(op->type) &&
-                   add_a &&
-                   div_a_b &&
-                   add_a_b_a &&
-                   is_simple_const(add_a_b_a->b) &&
-                   is_simple_const(div_a_b->b) &&
-                   is_simple_const(b)) {
-            // (x + (y + c1)/c2) + c3 -> x + (y + (c1 + c2*c3))/c2
-            return mutate(add_a->a + (add_a_b_a->a + (add_a_b_a->b + div_a_b->b*b))/div_a_b->b);
-        } else if (no_overflow(op->type) &&
-                   div_a && sub_div_a_a &&
-                   !is_zero(sub_div_a_a->a) &&
-                   is_simple_const(sub_div_a_a->a) &&
-                   is_simple_const(div_a->b) &&
-                   is_simple_const(b)) {
-            // (c1 - y)/c2 + c3 + -> ((c1 + c2*c3) - y)/c2
-            // If c1 == 0, we shouldn't pull in c3 inside the division; otherwise,
-            // it will cause a cycle with the division simplification rule.
-            return mutate(((sub_div_a_a->a + div_a->b*b) - sub_div_a_a->b)/div_a->b);
-        } else if (no_overflow(op->type) &&
-                   div_b && add_div_b_a &&
-                   is_simple_const(div_b->b) &&
-                   equal(a, add_div_b_a->a)) {
-            // x + (x + y)/c -> ((c + 1)*x + y)/c
-            return mutate(((div_b->b + 1)*a + add_div_b_a->b)/div_b->b);
-        } else if (no_overflow(op->type) &&
-                   div_b && sub_div_b_a &&
-                   is_simple_const(div_b->b) &&
-                   equal(a, sub_div_b_a->a)) {
-            // x + (x - y)/c -> ((c + 1)*x - y)/c
-            return mutate(((div_b->b + 1)*a - sub_div_b_a->b)/div_b->b);
-        } else if (no_overflow(op->type) &&
-                   div_b && add_div_b_a &&
-                   is_simple_const(div_b->b) &&
-                   equal(a, add_div_b_a->b)) {
-            // x + (y + x)/c -> ((c + 1)*x + y)/c
-            return mutate(((div_b->b + 1)*a + add_div_b_a->a)/div_b->b);
-        } else if (no_overflow(op->type) &&
-                   div_b && sub_div_b_a &&
-                   is_simple_const(div_b->b) &&
-                   equal(a, sub_div_b_a->b)) {
-            // x + (y - x)/c -> ((c - 1)*x + y)/c
-            return mutate(((div_b->b - 1)*a + sub_div_b_a->a)/div_b->b);
-        } else if (no_overflow(op->type) &&
-                   div_a && add_div_a_a &&
-                   is_simple_const(div_a->b) &&
-                   equal(b, add_div_a_a->a)) {
-            // (x + y)/c + x + -> ((c + 1)*x + y)/c
-            return mutate(((div_a->b + 1)*b + add_div_a_a->b)/div_a->b);
-        } else if (no_overflow(op->type) &&
-                   div_a && sub_div_a_a &&
-                   is_simple_const(div_a->b) &&
-                   equal(b, sub_div_a_a->a)) {
-            // (x - y)/c + x + -> ((1 + c)*x - y)/c
-            return mutate(((1 + div_a->b)*b - sub_div_a_a->b)/div_a->b);
-        } else if (no_overflow(op->type) &&
-                   div_a && add_div_a_a &&
-                   is_simple_const(div_a->b) &&
-                   equal(b, add_div_a_a->b)) {
-            // (y + x)/c + x -> (y + (1 + c)*x)/c
-            return mutate((add_div_a_a->a + (1 + div_a->b)*b)/div_a->b);
-        } else if (no_overflow(op->type) &&
-                   div_a && sub_div_a_a &&
-                   is_simple_const(div_a->b) &&
-                   equal(b, sub_div_a_a->b)) {
-            // (y - x)/c + x -> (y + (-1 + c)*x)/c
-            return mutate((sub_div_a_a->a + (- 1 + div_a->b)*b)/div_a->b);
-        } else if (no_overflow(op->type) &&
-                   min_a &&
-                   sub_a_b &&
-                   equal(sub_a_b->b, b)) {
-            // min(a, b-c) + c -> min(a+c, b)
-            return mutate(Min::make(Add::make(min_a->a, b), sub_a_b->a));
-        } else if (no_overflow(op->type) &&
-                   min_a &&
-                   sub_a_a &&
-                   equal(sub_a_a->b, b)) {
-            // min(a-c, b) + c -> min(a, b+c)
-            return mutate(Min::make(sub_a_a->a, Add::make(min_a->b, b)));
-        } else if (no_overflow(op->type) &&
-                   max_a &&
-                   sub_a_b &&
-                   equal(sub_a_b->b, b)) {
-            // max(a, b-c) + c -> max(a+c, b)
-            return mutate(Max::make(Add::make(max_a->a, b), sub_a_b->a));
-        } else if (no_overflow(op->type) &&
-                   max_a &&
-                   sub_a_a &&
-                   equal(sub_a_a->b, b)) {
-            // max(a-c, b) + c -> max(a, b+c)
-            return mutate(Max::make(sub_a_a->a, Add::make(max_a->b, b)));
-
-        } else if (no_overflow(op->type) &&
-                   min_a &&
-                   add_a_b &&
-                   const_int(add_a_b->b, &ia) &&
-                   const_int(b, &ib) &&
-                   ia + ib == 0) {
-            // min(a, b + (-2)) + 2 -> min(a + 2, b)
-            return mutate(Min::make(Add::make(min_a->a, b), add_a_b->a));
-        } else if (no_overflow(op->type) &&
-                   min_a &&
-                   add_a_a &&
-                   const_int(add_a_a->b, &ia) &&
-                   const_int(b, &ib) &&
-                   ia + ib == 0) {
-            // min(a + (-2), b) + 2 -> min(a, b + 2)
-            return mutate(Min::make(add_a_a->a, Add::make(min_a->b, b)));
-        } else if (no_overflow(op->type) &&
-                   max_a &&
-                   add_a_b &&
-                   const_int(add_a_b->b, &ia) &&
-                   const_int(b, &ib) &&
-                   ia + ib == 0) {
-            // max(a, b + (-2)) + 2 -> max(a + 2, b)
-            return mutate(Max::make(Add::make(max_a->a, b), add_a_b->a));
-        } else if (no_overflow(op->type) &&
-                   max_a &&
-                   add_a_a &&
-                   const_int(add_a_a->b, &ia) &&
-                   const_int(b, &ib) &&
-                   ia + ib == 0) {
-            // max(a + (-2), b) + 2 -> max(a, b + 2)
-            return mutate(Max::make(add_a_a->a, Add::make(max_a->b, b)));
-        } else if (min_a &&
-                   max_b &&
-                   equal(min_a->a, max_b->a) &&
-                   equal(min_a->b, max_b->b)) {
-            // min(x, y) + max(x, y) -> x + y
-            return mutate(min_a->a + min_a->b);
-        } else if (min_a &&
-                   max_b &&
-                   equal(min_a->a, max_b->b) &&
-                   equal(min_a->b, max_b->a)) {
-            // min(x, y) + max(y, x) -> x + y
-            return mutate(min_a->a + min_a->b);
-        } else if (no_overflow(op->type) &&
-                   div_a &&
-                   add_a_a &&
-                   const_int(add_a_a->b, &ia) &&
-                   const_int(div_a->b, &ib) && ib &&
-                   const_int(b, &ic)) {
-            // ((a + ia) / ib + ic) -> (a + (ia + ib*ic)) / ib
-            return mutate((add_a_a->a + IntImm::make(op->type, ia + ib*ic)) / div_a->b);
-        } else if (mul_a &&
-                   mul_b &&
-                   equal(mul_a->a, mul_b->a)) {
-            // Pull out common factors a*x + b*x
-            return mutate(mul_a->a * (mul_a->b + mul_b->b));
-        } else if (mul_a &&
-                   mul_b &&
-                   equal(mul_a->b, mul_b->a)) {
-            return mutate(mul_a->b * (mul_a->a + mul_b->b));
-        } else if (mul_a &&
-                   mul_b &&
-                   equal(mul_a->b, mul_b->b)) {
-            return mutate(mul_a->b * (mul_a->a + mul_b->a));
-        } else if (mul_a &&
-                   mul_b &&
-                   equal(mul_a->a, mul_b->b)) {
-            return mutate(mul_a->a * (mul_a->b + mul_b->a));
-        } else if (mul_a &&
-                   mul_b &&
-                   const_int(mul_a->b, &ia) &&
-                   const_int(mul_b->b, &ib) &&
-                   (ia % ib == 0 || ib % ia == 0)) {
-            if (ia % ib == 0) {
-                Expr factor = make_const(op->type, div_imp(ia, ib));
-                return mutate((mul_a->a * factor + mul_b->a) * mul_b->b);
-            } else {
-                Expr factor = make_const(op->type, div_imp(ib, ia));
-                return mutate((mul_a->a + mul_b->a * factor) * mul_a->b);
-            }
-        } else if (mod_a &&
-                   mul_b &&
-                   equal(mod_a->b, mul_b->b)) {
-            // (x%3) + y*3 -> y*3 + x%3
-            return mutate(b + a);
+            return rewrite.result;
+        } else if (rewrite((0 - x) + y, y - x)) {
+            return mutate(rewrite.result);
+        } else if (rewrite(x + (y - x), y)) {
+            return rewrite.result;
+        } else if (rewrite(x + (c0 - y), (x - y) + c0) ||
+                   rewrite((x - y) + (y - z), x - z) ||
+                   rewrite((x - y) + (z - x), z - y) ||
+                   rewrite(x + y * z, x - y * (-z), is_negative_negatable_const(z)) ||
+                   // Leave constants on the right
+                   rewrite(x * y + z, z - x * (-y), !is_const(z) && is_negative_negatable_const(y)) ||
+                   (no_overflow(op->type) &&
+                    (rewrite(x + x * y, x * (1 + y), !is_const(x)) ||
+                     rewrite(x + y * x, (1 + y) * x, !is_const(x)) ||
+                     rewrite(x * y + x, x * (y + 1), !is_const(x)) ||
+                     rewrite(x * y + y, (x + 1) * y, !is_const(y)) ||
+                     rewrite((x + c0) / c1 + c2, (x + (c0 + c1 * c2)) / c1) ||
+                     rewrite((x + (y + c0) / c1) + c2, x + (y + (c0 + c1 * c2)) / c1) ||
+                     // If c0 == 0, we shouldn't pull c2 inside the
+                     // division; otherwise, it will cause a cycle with
+                     // the division simplification rule.
+                     rewrite((c0 - x) / c1 + c2, ((c0 + c1 * c2) - x) / c1, !is_zero(c0)) ||
+                     rewrite(x + (x + y) / c0, ((c0 + 1) * x + y) / c0) ||
+                     rewrite(x + (x - y) / c0, ((c0 + 1) * x - y) / c0) ||
+                     rewrite(x + (y + x) / c0, ((c0 + 1) * x + y) / c0) ||
+                     rewrite(x + (y - x) / c0, ((c0 - 1) * x + y) / c0) ||
+                     rewrite((x + y) / c0 + x, ((c0 + 1) * x + y) / c0) ||
+                     rewrite((x - y) / c0 + x, ((1 + c0) * x - y) / c0) ||
+                     rewrite((y + x) / c0 + x, (y + (1 + c0) * x) / c0) ||
+                     rewrite((y - x) / c0 + x, (y + (-1 + c0) * x) / c0) ||
+                     rewrite(min(x, y - z) + z, min(x + z, y)) ||
+                     rewrite(min(y - z, x) + z, min(y, x + z)) ||
+                     rewrite(max(x, y - z) + z, max(x + z, y)) ||
+                     rewrite(max(y - z, x) + z, max(y, x + z)) ||
+                     rewrite(min(x, y + c0) + c1, min(x + c1, y), c0 + c1 == 0) ||
+                     rewrite(min(y + c0, x) + c1, min(y, x + c1), c0 + c1 == 0) ||
+                     rewrite(max(x, y + c0) + c1, max(x + c1, y), c0 + c1 == 0) ||
+                     rewrite(max(y + c0, x) + c1, max(y, x + c1), c0 + c1 == 0))) ||
+                   rewrite(min(x, y) + max(x, y), x + y) ||
+                   rewrite(min(x, y) + max(y, x), x + y) ||
+                   // Pull out common factors
+                   rewrite(x * y + x * z, x * (y + z)) ||
+                   rewrite(y * x + x * z, x * (y + z)) ||
+                   rewrite(y * x + z * x, x * (y + z)) ||
+                   rewrite(x * y + z * x, x * (y + z)) ||
+                   rewrite(x * c0 + y * c1, (x * (c0 / c1) + y) * c1, c0 % c1 == 0) ||
+                   rewrite(x * c0 + y * c1, (x + y * (c1 / c0)) * c0, c1 % c0 == 0) ||
+                   rewrite(x % y + z * y, z * y + x % y)) {
+            return mutate(rewrite.result);
         } else if (no_overflow_int(op->type) &&
-                   mul_a &&
-                   mod_b &&
-                   div_a_a &&
-                   equal(mul_a->b, div_a_a->b) &&
-                   equal(mul_a->b, mod_b->b) &&
-                   equal(div_a_a->a, mod_b->a)) {
-            // (x/3)*3 + x%3 -> x
-            return div_a_a->a;
+                   rewrite((x / y) * y + x % y, x)) {
+            return rewrite.result;
         } else if (no_overflow_int(op->type) &&
-                   mul_a &&
-                   mod_b &&
-                   add_a_a &&
-                   div_a_a_b &&
-                   equal(mul_a->b, div_a_a_b->b) &&
-                   equal(mul_a->b, mod_b->b) &&
-                   equal(div_a_a_b->a, mod_b->a)) {
-            // (y + (x/3))*3 + x%3 -> y*3 + x
-            return mutate(add_a_a->a * mul_a->b + mod_b->a);
-        } else if (no_overflow_int(op->type) &&
-                   mul_a &&
-                   mod_b &&
-                   add_a_a &&
-                   div_a_a_a &&
-                   equal(mul_a->b, div_a_a_a->b) &&
-                   equal(mul_a->b, mod_b->b) &&
-                   equal(div_a_a_a->a, mod_b->a)) {
-            // ((x/3) + y)*3 + x%3 -> x + y*3
-            return mutate(mod_b->a + add_a_a->b * mul_a->b);
+                   (rewrite((z + x / y) * y + x % y, z * y + x) ||
+                    rewrite((x / y + z) * y + x % y, x + z * y))) {
+            return mutate(rewrite.result);
         } else if (no_overflow_int(op->type) &&
                    add_a &&
                    mul_a_a &&
@@ -1055,29 +791,10 @@ private:
                    (!mod_a_a || !equal(mod_a_a->b, mul_b->b))) {
             // (y + (x%3)) + z*3 -> y + (z*3 + x%3)
             return mutate(add_a->a + (b + add_a->b));
-        } else if (mul_a && mul_b &&
-                   const_int(mul_a->b, &ia) &&
-                   const_int(mul_b->b, &ib) &&
-                   ia % ib == 0) {
-            // x*4 + y*2 -> (x*2 + y)*2
-            Expr ratio = make_const(a.type(), div_imp(ia, ib));
-            return mutate((mul_a->a * ratio + mul_b->a) * mul_b->b);
         } else if (no_overflow_int(op->type) &&
-                   div_a &&
-                   mod_b &&
-                   is_two(div_a->b) &&
-                   is_two(mod_b->b) &&
-                   equal(div_a->a, mod_b->a)) {
-            // x / 2 + x % 2 -> (x + 1) / 2
-            return mutate((div_a->a + make_one(op->type)) / div_a->b);
-        } else if (no_overflow_int(op->type) &&
-                   div_b &&
-                   mod_a &&
-                   is_two(div_b->b) &&
-                   is_two(mod_a->b) &&
-                   equal(div_b->a, mod_a->a)) {
-            // x % 2 + x / 2 -> (x + 1) / 2
-            return mutate((div_b->a + make_one(op->type)) / div_b->b);
+                   (rewrite(x / 2 + x % 2, (x + 1) / 2) ||
+                    rewrite(x % 2 + x / 2, (x + 1) / 2))) {
+            return mutate(rewrite.result);
         } else if (a.same_as(op->a) && b.same_as(op->b)) {
             // If we've made no changes, and can't find a rule to apply, return the operator unchanged.
             return op;
@@ -1115,53 +832,20 @@ private:
         const Broadcast *broadcast_a = a.as<Broadcast>();
         const Broadcast *broadcast_b = b.as<Broadcast>();
 
-        const Add *add_a = a.as<Add>();
-        const Add *add_b = b.as<Add>();
-        const Sub *sub_a = a.as<Sub>();
-        const Sub *sub_b = b.as<Sub>();
-        const Mul *mul_a = a.as<Mul>();
-        const Mul *mul_b = b.as<Mul>();
-        const Div *div_a_a = mul_a ? mul_a->a.as<Div>() : nullptr;
-        const Div *div_b_a = mul_b ? mul_b->a.as<Div>() : nullptr;
-
-        const Div *div_a = a.as<Div>();
-        const Div *div_b = b.as<Div>();
-
-        const Add *add_div_a_a = div_a ? div_a->a.as<Add>(): nullptr;
-        const Sub *sub_div_a_a = div_a ? div_a->a.as<Sub>(): nullptr;
-        const Add *add_div_b_a = div_b ? div_b->a.as<Add>(): nullptr;
-        const Sub *sub_div_b_a = div_b ? div_b->a.as<Sub>(): nullptr;
-
-        const Min *min_b = b.as<Min>();
-        const Add *add_b_a = min_b ? min_b->a.as<Add>() : nullptr;
-        const Add *add_b_b = min_b ? min_b->b.as<Add>() : nullptr;
-
         const Min *min_a = a.as<Min>();
-        const Add *add_a_a = min_a ? min_a->a.as<Add>() : nullptr;
-        const Add *add_a_b = min_a ? min_a->b.as<Add>() : nullptr;
-
-        if (add_a) {
-            add_a_a = add_a->a.as<Add>();
-            add_a_b = add_a->b.as<Add>();
-        }
-
-        if (div_a) {
-            add_a_a = div_a->a.as<Add>();
-            add_a_b = div_a->b.as<Add>();
-        }
-        if (div_b) {
-            add_b_a = div_b->a.as<Add>();
-            add_b_b = div_b->b.as<Add>();
-        }
-
+        const Min *min_b = b.as<Min>();
         const Max *max_a = a.as<Max>();
         const Max *max_b = b.as<Max>();
 
-        const Sub *sub_a_a = div_a ? div_a->a.as<Sub>() : nullptr;
-        const Sub *sub_b_a = div_b ? div_b->a.as<Sub>() : nullptr;
-
-        const Select *select_a = a.as<Select>();
-        const Select *select_b = b.as<Select>();
+        IRMatcher::Wild<0> x;
+        IRMatcher::Wild<1> y;
+        IRMatcher::Wild<2> z;
+        IRMatcher::Wild<3> w;
+        IRMatcher::Wild<4> u;
+        IRMatcher::WildConst<0> c0;
+        IRMatcher::WildConst<1> c1;
+        IRMatcher::WildConst<2> c2;
+        IRMatcher::Rewriter<Sub> rewrite(op, a, b);
 
         int64_t a_round_up_factor = 0, b_round_up_factor = 0;
         Expr a_round_up = is_round_up(a, &a_round_up_factor);
@@ -1209,337 +893,80 @@ private:
             // Broadcast + Broadcast
             return Broadcast::make(mutate(broadcast_a->value - broadcast_b->value),
                                    broadcast_a->lanes);
-        } else if (select_a && select_b &&
-                   equal(select_a->condition, select_b->condition)) {
-            // select(c, a, b) - select(c, d, e) -> select(c, a+d, b+e)
-            return mutate(Select::make(select_a->condition,
-                                       select_a->true_value - select_b->true_value,
-                                       select_a->false_value - select_b->false_value));
-        } else if (select_a &&
-                   equal(select_a->true_value, b)) {
-            // select(c, a, b) - a -> select(c, 0, b-a)
-            return mutate(Select::make(select_a->condition,
-                                       make_zero(op->type),
-                                       select_a->false_value - select_a->true_value));
-        } else if (select_a &&
-                   equal(select_a->false_value, b)) {
-            // select(c, a, b) - b -> select(c, a-b, 0)
-            return mutate(Select::make(select_a->condition,
-                                       select_a->true_value - select_a->false_value,
-                                       make_zero(op->type)));
-        } else if (select_b &&
-                   equal(select_b->true_value, a)) {
-            // a - select(c, a, b) -> select(c, 0, a-b)
-            return mutate(Select::make(select_b->condition,
-                                       make_zero(op->type),
-                                       select_b->true_value - select_b->false_value));
-        } else if (select_b &&
-                   equal(select_b->false_value, a)) {
-            // b - select(c, a, b) -> select(c, b-a, 0)
-            return mutate(Select::make(select_b->condition,
-                                       select_b->false_value - select_b->true_value,
-                                       make_zero(op->type)));
-        } else if (add_a && equal(add_a->b, b)) {
+        } else if (rewrite(select(x, y, z) - select(x, w, u), select(x, y - w, z - u)) ||
+                   rewrite(select(x, y, z) - y, select(x, 0, z - y)) ||
+                   rewrite(select(x, y, z) - z, select(x, y - z, 0)) ||
+                   rewrite(y - select(x, y, z), select(x, 0, y - z)) ||
+                   rewrite(z - select(x, y, z), select(x, z - y, 0))) {
+            return mutate(rewrite.result);
+        } else if (rewrite((x + y) - y, x) ||
+                   rewrite((x + y) - x, y)) {
             // Ternary expressions where a term cancels
-            return add_a->a;
-        } else if (add_a &&
-                   equal(add_a->a, b)) {
-            return add_a->b;
-        } else if (add_b &&
-                   equal(add_b->b, a)) {
-            return mutate(make_zero(add_b->a.type()) - add_b->a);
-        } else if (add_b &&
-                   equal(add_b->a, a)) {
-            return mutate(make_zero(add_b->a.type()) - add_b->b);
-        } else if (max_a &&
-                   equal(max_a->a, b) &&
-                   !is_const(b) &&
-                   no_overflow(op->type)) {
-            // max(a, b) - a -> max(0, b-a)
-            return mutate(Max::make(make_zero(op->type), max_a->b - max_a->a));
-        } else if (min_a &&
-                   equal(min_a->a, b) &&
-                   !is_const(b) &&
-                   no_overflow(op->type)) {
-            // min(a, b) - a -> min(0, b-a)
-            return mutate(Min::make(make_zero(op->type), min_a->b - min_a->a));
-        } else if (max_a &&
-                   equal(max_a->b, b) &&
-                   !is_const(b) &&
-                   no_overflow(op->type)) {
-            // max(a, b) - b -> max(a-b, 0)
-            return mutate(Max::make(max_a->a - max_a->b, make_zero(op->type)));
-        } else if (min_a &&
-                   equal(min_a->b, b) &&
-                   !is_const(b) &&
-                   no_overflow(op->type)) {
-            // min(a, b) - b -> min(a-b, 0)
-            return mutate(Min::make(min_a->a - min_a->b, make_zero(op->type)));
-        } else if (max_b &&
-                   equal(max_b->a, a) &&
-                   !is_const(a) &&
-                   no_overflow(op->type)) {
-            // a - max(a, b) -> 0 - max(0, b-a) -> min(0, a-b)
-            return mutate(Min::make(make_zero(op->type), max_b->a - max_b->b));
-        } else if (min_b &&
-                   equal(min_b->a, a) &&
-                   !is_const(a) &&
-                   no_overflow(op->type)) {
-            // a - min(a, b) -> 0 - min(0, b-a) -> max(0, a-b)
-            return mutate(Max::make(make_zero(op->type), min_b->a - min_b->b));
-        } else if (max_b &&
-                   equal(max_b->b, a) &&
-                   !is_const(a) &&
-                   no_overflow(op->type)) {
-            // b - max(a, b) -> 0 - max(a-b, 0) -> min(b-a, 0)
-            return mutate(Min::make(max_b->b - max_b->a, make_zero(op->type)));
-        } else if (min_b &&
-                   equal(min_b->b, a) &&
-                   !is_const(a) &&
-                   no_overflow(op->type)) {
-            // b - min(a, b) -> 0 - min(a-b, 0) -> max(b-a, 0)
-            return mutate(Max::make(min_b->b - min_b->a, make_zero(op->type)));
-        } else if (add_a &&
-                   is_simple_const(add_a->b)) {
-            // In ternary expressions, pull constants outside
-            if (is_simple_const(b)) {
-                return mutate(add_a->a + (add_a->b - b));
-            } else {
-                return mutate((add_a->a - b) + add_a->b);
-            }
-        } else if (sub_a &&
-                   sub_b &&
-                   is_const(sub_a->a) &&
-                   is_const(sub_b->a)) {
-            // (c1 - a) - (c2 - b) -> (b - a) + (c1 - c2)
-            return mutate((sub_b->b - sub_a->b) + (sub_a->a - sub_b->a));
-        } else if (sub_b) {
-            // a - (b - c) -> a + (c - b)
-            return mutate(a + (sub_b->b - sub_b->a));
-        } else if (mul_b &&
-                   is_negative_negatable_const(mul_b->b)) {
-            // a - b*-x -> a + b*x
-            return mutate(a + mul_b->a * (-mul_b->b));
-        } else if (mul_b &&
-                   !is_const(a) &&
-                   equal(a, mul_b->a) &&
-                   no_overflow(op->type)) {
-            // a - a*b -> a*(1 - b)
-            return mutate(a * (make_one(op->type) - mul_b->b));
-        } else if (mul_b &&
-                   !is_const(a) &&
-                   equal(a, mul_b->b) &&
-                   no_overflow(op->type)) {
-            // a - b*a -> (1 - b)*a
-            return mutate((make_one(op->type) - mul_b->a) * a);
-        } else if (mul_a &&
-                   !is_const(b) &&
-                   equal(mul_a->a, b) &&
-                   no_overflow(op->type)) {
-            // a*b - a -> a*(b - 1)
-            return mutate(mul_a->a * (mul_a->b - make_one(op->type)));
-        } else if (mul_a &&
-                   !is_const(b) &&
-                   equal(mul_a->b, b) &&
-                   no_overflow(op->type)) {
-            // a*b - b -> (a - 1)*b
-            return mutate((mul_a->a - make_one(op->type)) * b);
-        } else if (add_b &&
-                   is_simple_const(add_b->b)) {
-            return mutate((a - add_b->a) - add_b->b);
-        } else if (sub_a &&
-                   is_simple_const(sub_a->a) &&
-                   is_simple_const(b)) {
-            return mutate((sub_a->a - b) - sub_a->b);
-        } else if (mul_a &&
-                   mul_b &&
-                   equal(mul_a->a, mul_b->a)) {
-            // Pull out common factors a*x + b*x
-            return mutate(mul_a->a * (mul_a->b - mul_b->b));
-        } else if (mul_a &&
-                   mul_b &&
-                   equal(mul_a->b, mul_b->a)) {
-            return mutate(mul_a->b * (mul_a->a - mul_b->b));
-        } else if (mul_a &&
-                   mul_b &&
-                   equal(mul_a->b, mul_b->b)) {
-            return mutate(mul_a->b * (mul_a->a - mul_b->a));
-        } else if (mul_a &&
-                   mul_b &&
-                   equal(mul_a->a, mul_b->b)) {
-            return mutate(mul_a->a * (mul_a->b - mul_b->a));
-        } else if (add_a &&
-                   add_b &&
-                   equal(add_a->b, add_b->b)) {
-            // Quaternary expressions where a term cancels
-            // (a + b) - (c + b) -> a - c
-            return mutate(add_a->a - add_b->a);
-        } else if (add_a &&
-                   add_b &&
-                   equal(add_a->a, add_b->a)) {
-            // (a + b) - (a + c) -> b - c
-            return mutate(add_a->b - add_b->b);
-        } else if (add_a &&
-                   add_b &&
-                   equal(add_a->a, add_b->b)) {
-            // (a + b) - (c + a) -> b - c
-            return mutate(add_a->b - add_b->a);
-        } else if (add_a &&
-                   add_b &&
-                   equal(add_a->b, add_b->a)) {
-            // (b + a) - (a + c) -> b - c
-            return mutate(add_a->a - add_b->b);
-        } else if (add_a &&
-                   add_a_a &&
-                   equal(add_a_a->a, b)) {
-            // ((a + b) + c) - a -> b + c
-            return mutate(add_a_a->b + add_a->b);
-        } else if (add_a &&
-                   add_a_a &&
-                   equal(add_a_a->b, b)) {
-            // ((a + b) + c) - b -> a + c
-            return mutate(add_a_a->a + add_a->b);
-        } else if (add_a &&
-                   add_a_b &&
-                   equal(add_a_b->a, b)) {
-            // (a + (b + c)) - b -> a + c
-            return mutate(add_a->a + add_a_b->b);
-        } else if (add_a &&
-                   add_a_b &&
-                   equal(add_a_b->b, b)) {
-            // (a + (b + c)) - c -> a + b
-            return mutate(add_a->a + add_a_b->a);
-        } else if (no_overflow(op->type) &&
-                   div_b && sub_div_b_a &&
-                   is_simple_const(a) &&
-                   is_simple_const(sub_div_b_a->a) &&
-                   is_simple_const(div_b->b) &&
-                   is_positive_const(div_b->b)) {
-            // c1 - (c2 - y)/c3 and c3 > 0-> ((c1*c3 - c2 + (c3 - 1)) + y)/c3
-            return mutate(((a*div_b->b - sub_div_b_a->a) + sub_div_b_a->b + (div_b->b - 1))/div_b->b);
-        } else if (no_overflow(op->type) &&
-                   div_b && add_div_b_a &&
-                   is_simple_const(a) &&
-                   is_simple_const(add_div_b_a->b) &&
-                   is_simple_const(div_b->b) &&
-                   is_positive_const(div_b->b)) {
-            // c1 - (y + c2)/c3 and c3 > 0 -> ((c1*c3 - c2 + (c3 - 1)) - y)/c3
-            return mutate(((a*div_b->b - add_div_b_a->b) - add_div_b_a->a + (div_b->b - 1))/div_b->b);
-        } else if (no_overflow(op->type) &&
-                   div_b && add_div_b_a &&
-                   is_simple_const(div_b->b) &&
-                   is_positive_const(div_b->b) &&
-                   equal(a, add_div_b_a->a)) {
-            // x - (x + y)/c and c > 0 -> ((c - 1)*x - y + (c - 1))/c
-            return mutate(((div_b->b - 1)*a - add_div_b_a->b + (div_b->b - 1))/div_b->b);
-        } else if (no_overflow(op->type) &&
-                   div_b && sub_div_b_a &&
-                   is_simple_const(div_b->b) &&
-                   is_positive_const(div_b->b) &&
-                   equal(a, sub_div_b_a->a)) {
-            // x - (x - y)/c and c > 0 -> ((c - 1)*x + y + (c - 1))/c
-            return mutate(((div_b->b - 1)*a + sub_div_b_a->b + (div_b->b - 1))/div_b->b);
-        } else if (no_overflow(op->type) &&
-                   div_b && add_div_b_a &&
-                   is_simple_const(div_b->b) &&
-                   is_positive_const(div_b->b) &&
-                   equal(a, add_div_b_a->b)) {
-            // x - (y + x)/c and c > 0 -> ((c - 1)*x - y + (c - 1))/c
-            return mutate(((div_b->b - 1)*a - add_div_b_a->a + (div_b->b - 1))/div_b->b);
-        } else if (no_overflow(op->type) &&
-                   div_b && sub_div_b_a &&
-                   is_simple_const(div_b->b) &&
-                   is_positive_const(div_b->b) &&
-                   equal(a, sub_div_b_a->b)) {
-            // x - (y - x)/c and c > 0 -> ((c + 1)*x - y + (c - 1))/c
-            return mutate(((div_b->b + 1)*a - sub_div_b_a->a + (div_b->b - 1))/div_b->b);
-        } else if (no_overflow(op->type) &&
-                   div_a && add_div_a_a &&
-                   is_simple_const(div_a->b) &&
-                   equal(b, add_div_a_a->a)) {
-            // (x + y)/c - x + -> ((1 - c)*x + y)/c
-            return mutate(((1 - div_a->b)*b + add_div_a_a->b)/div_a->b);
-        } else if (no_overflow(op->type) &&
-                   div_a && sub_div_a_a &&
-                   is_simple_const(div_a->b) &&
-                   equal(b, sub_div_a_a->a)) {
-            // (x - y)/c - x + -> ((1 - c)*x - y)/c
-            return mutate(((1 - div_a->b)*b - sub_div_a_a->b)/div_a->b);
-        } else if (no_overflow(op->type) &&
-                   div_a && add_div_a_a &&
-                   is_simple_const(div_a->b) &&
-                   equal(b, add_div_a_a->b)) {
-            // (y + x)/c - x -> (y + (1 - c)*x)/c
-            return mutate((add_div_a_a->a + (1 - div_a->b)*b)/div_a->b);
-        } else if (no_overflow(op->type) &&
-                   div_a && sub_div_a_a &&
-                   is_simple_const(div_a->b) &&
-                   equal(b, sub_div_a_a->b)) {
-            // (y - x)/c - x -> (y - (c + 1)*x)/c
-            return mutate((sub_div_a_a->a - (div_a->b + 1)*b)/div_a->b);
-        } else if (no_overflow(op->type) &&
-                   min_b &&
-                   add_b_a &&
-                   equal(a, add_b_a->a)) {
-            // Quaternary expressions involving mins where a term
-            // cancels. These are important for bounds inference
-            // simplifications.
-            // a - min(a + b, c) -> max(-b, a-c)
-            return mutate(max(0 - add_b_a->b, a - min_b->b));
-        } else if (no_overflow(op->type) &&
-                   min_b &&
-                   add_b_a &&
-                   equal(a, add_b_a->b)) {
-            // a - min(b + a, c) -> max(-b, a-c)
-            return mutate(max(0 - add_b_a->a, a - min_b->b));
-        } else if (no_overflow(op->type) &&
-                   min_b &&
-                   add_b_b &&
-                   equal(a, add_b_b->a)) {
-            // a - min(c, a + b) -> max(-b, a-c)
-            return mutate(max(0 - add_b_b->b, a - min_b->a));
-        } else if (no_overflow(op->type) &&
-                   min_b &&
-                   add_b_b &&
-                   equal(a, add_b_b->b)) {
-            // a - min(c, b + a) -> max(-b, a-c)
-            return mutate(max(0 - add_b_b->a, a - min_b->a));
-        } else if (no_overflow(op->type) &&
-                   min_a &&
-                   add_a_a &&
-                   equal(b, add_a_a->a)) {
-            // min(a + b, c) - a -> min(b, c-a)
-            return mutate(min(add_a_a->b, min_a->b - b));
-        } else if (no_overflow(op->type) &&
-                   min_a &&
-                   add_a_a &&
-                   equal(b, add_a_a->b)) {
-            // min(b + a, c) - a -> min(b, c-a)
-            return mutate(min(add_a_a->a, min_a->b - b));
-        } else if (no_overflow(op->type) &&
-                   min_a &&
-                   add_a_b &&
-                   equal(b, add_a_b->a)) {
-            // min(c, a + b) - a -> min(b, c-a)
-            return mutate(min(add_a_b->b, min_a->a - b));
-        } else if (no_overflow(op->type) &&
-                   min_a &&
-                   add_a_b &&
-                   equal(b, add_a_b->b)) {
-            // min(c, b + a) - a -> min(b, c-a)
-            return mutate(min(add_a_b->a, min_a->a - b));
-        } else if (min_a &&
-                   min_b &&
-                   equal(min_a->a, min_b->b) &&
-                   equal(min_a->b, min_b->a)) {
-            // min(a, b) - min(b, a) -> 0
-            return make_zero(op->type);
-        } else if (max_a &&
-                   max_b &&
-                   equal(max_a->a, max_b->b) &&
-                   equal(max_a->b, max_b->a)) {
-            // max(a, b) - max(b, a) -> 0
-            return make_zero(op->type);
+            return rewrite.result;
+        } else if (rewrite(x - (y + x), 0 - y) ||
+                   rewrite(x - (x + y), 0 - y) ||
+                   (no_overflow(op->type) &&
+                    (rewrite(max(x, y) - x, max(0, y - x), !is_const(x)) ||
+                     rewrite(min(x, y) - x, min(0, y - x), !is_const(x)) ||
+                     rewrite(max(x, y) - y, max(x - y, 0), !is_const(y)) ||
+                     rewrite(min(x, y) - y, min(x - y, 0), !is_const(y)) ||
+                     rewrite(x - max(x, y), min(0, x - y), !is_const(x)) ||
+                     rewrite(x - min(x, y), max(0, x - y), !is_const(x)) ||
+                     rewrite(y - max(x, y), min(y - x, 0), !is_const(y)) ||
+                     rewrite(y - min(x, y), max(y - x, 0), !is_const(y)))) ||
+                   // In ternary expressions, pull constants outside
+                   rewrite((x + c0) - c1, x + (c0 - c1)) ||
+                   rewrite((x + c0) - y, (x - y) + c0) ||
+                   rewrite((x - y) - (z - w), (w - y) + (x - z), is_const(x) && is_const(z)) ||
+                   rewrite(x - (y - z), x + (z - y)) ||
+                   rewrite(x - y * z, x + y * (-z), is_negative_negatable_const(z)) ||
+                   (no_overflow(op->type) &&
+                    (rewrite(x - x * y, x * (1 - y), !is_const(x)) ||
+                     rewrite(x - y * x, (1 - y) * x, !is_const(x)) ||
+                     rewrite(x * y - x, x * (y - 1), !is_const(x)) ||
+                     rewrite(x * y - y, (x - 1) * y, !is_const(y)))) ||
+                   rewrite(x - (y + c0), (x - y) - c0) ||
+                   rewrite((c0 - x) - c1, (c0 - c1) - x) ||
+                   // Pull out common factors
+                   rewrite(x * y - x * z, x * (y - z)) ||
+                   rewrite(y * x - x * z, x * (y - z)) ||
+                   rewrite(y * x - z * x, x * (y - z)) ||
+                   rewrite(x * y - z * x, x * (y - z)) ||
+                   // Quaternary expressions where a term cancels
+                   rewrite((x + y) - (z + y), x - z) ||
+                   rewrite((x + y) - (x + z), y - z) ||
+                   rewrite((x + y) - (z + x), y - z) ||
+                   rewrite((y + x) - (x + z), y - z) ||
+                   rewrite(((x + y) + z) - x, y + z) ||
+                   rewrite(((x + y) + z) - y, x + z) ||
+                   rewrite((x + (y + z)) - y, x + z) ||
+                   rewrite((x + (y + z)) - z, x + y) ||
+                   (no_overflow(op->type) &&
+                    (rewrite(c0 - (c1 - x) / c2, ((c0 * c2 - c1) + x + (c2 - 1)) / c2, is_positive_const(c2)) ||
+                     rewrite(c0 - (x + c1) / c2, ((c0 * c2 - c1) - x + (c2 - 1)) / c2, is_positive_const(c2)) ||
+                     rewrite(x - (x + y) / c0, ((c0 - 1) * x - y + (c0 - 1)) / c0, is_positive_const(c0)) ||
+                     rewrite(x - (x - y) / c0, ((c0 - 1) * x + y + (c0 - 1)) / c0, is_positive_const(c0)) ||
+                     rewrite(x - (y + x) / c0, ((c0 - 1) * x - y + (c0 - 1)) / c0, is_positive_const(c0)) ||
+                     rewrite(x - (y - x) / c0, ((c0 + 1) * x - y + (c0 - 1)) / c0, is_positive_const(c0)) ||
+                     rewrite((x + y) / c0 - x, ((1 - c0) * x + y) / c0) ||
+                     rewrite((x - y) / c0 - x, ((1 - c0) * x - y) / c0) ||
+                     rewrite((y + x) / c0 - x, (y + (1 - c0) * x) / c0) ||
+                     rewrite((y - x) / c0 - x, (y - (c0 + 1) * x) / c0) ||
+                     // Quaternary expressions involving mins where a
+                     // term cancels. These are important for bounds
+                     // inference simplifications.
+                     rewrite(x - min(x + y, z), max(0 - y, x - z)) ||
+                     rewrite(x - min(y + x, z), max(0 - y, x - z)) ||
+                     rewrite(x - min(z, x + y), max(0 - y, x - z)) ||
+                     rewrite(x - min(z, y + x), max(0 - y, x - z)) ||
+                     rewrite(min(x + y, z) - x, min(y, z - x)) ||
+                     rewrite(min(y + x, z) - x, min(y, z - x)) ||
+                     rewrite(min(z, x + y) - x, min(y, z - x)) ||
+                     rewrite(min(z, y + x) - x, min(y, z - x))))) {
+            return mutate(rewrite.result);
+        } else if (rewrite(min(x, y) - min(y, x), 0) ||
+                   rewrite(max(x, y) - max(y, x), 0)) {
+            return rewrite.result;
         } else if (no_overflow(op->type) &&
                    min_a &&
                    min_b &&
@@ -1566,22 +993,9 @@ private:
             return mutate(max_a->b - max_b->a);
         } else if (no_overflow(op->type) &&
                    (op->type.is_int() || op->type.is_uint()) &&
-                   mul_a &&
-                   div_a_a &&
-                   is_positive_const(mul_a->b) &&
-                   equal(mul_a->b, div_a_a->b) &&
-                   equal(div_a_a->a, b)) {
-            // (x/4)*4 - x -> -(x%4)
-            return mutate(make_zero(a.type()) - (b % mul_a->b));
-        } else if (no_overflow(op->type) &&
-                   (op->type.is_int() || op->type.is_uint()) &&
-                   mul_b &&
-                   div_b_a &&
-                   is_positive_const(mul_b->b) &&
-                   equal(mul_b->b, div_b_a->b) &&
-                   equal(div_b_a->a, a)) {
-            // x - (x/4)*4 -> x%4
-            return mutate(a % mul_b->b);
+                   (rewrite((x / y) * y - x, 0 - (x % y), is_positive_const(y)) ||
+                    rewrite(x - (x / y) * y, x % y, is_positive_const(y)))) {
+            return mutate(rewrite.result);
         } else if (no_overflow_int(op->type) &&
                    a_round_up.defined() &&
                    a_round_up_factor == 2 &&
@@ -1594,117 +1008,24 @@ private:
                    equal(b_round_up, a)) {
             // x - ((x + 1)/2)*2 -> -(x%2)
             return mutate(make_zero(op->type) - (a % make_const(op->type, b_round_up_factor)));
-        } else if (mul_a &&
-                   mul_b &&
-                   const_int(mul_a->b, &ia) &&
-                   const_int(mul_b->b, &ib) &&
-                   ib % ia == 0) {
-            // x * a - y * (a * b) -> (x - y * b) * a
-            Expr ratio = make_const(a.type(), div_imp(ib, ia));
-            return mutate((mul_a->a - mul_b->a * ratio) * mul_a->b);
-        } else if (mul_a &&
-                   mul_b &&
-                   const_int(mul_a->b, &ia) &&
-                   const_int(mul_b->b, &ib) &&
-                   ia % ib == 0) {
-            // x * (a * b) - y * a -> (x * b - y) * a
-            Expr ratio = make_const(a.type(), div_imp(ia, ib));
-            return mutate((mul_a->a * ratio - mul_b->a) * mul_b->b);
-        } else if (div_a &&
-                   div_b &&
-                   is_positive_const(div_a->b) &&
-                   equal(div_a->b, div_b->b) &&
-                   op->type.is_int() &&
-                   no_overflow(op->type) &&
-                   add_a_a &&
-                   add_b_a &&
-                   equal(add_a_a->a, add_b_a->a) &&
-                   (is_simple_const(add_a_a->b) ||
-                    is_simple_const(add_b_a->b))) {
-            // This pattern comes up in bounds inference on upsampling code:
-            // (x + a)/c - (x + b)/c ->
-            //    ((c + a - 1 - b) - (x + a)%c)/c (duplicates a)
-            // or ((x + b)%c + (a - b))/c         (duplicates b)
-            Expr x = add_a_a->a, a = add_a_a->b, b = add_b_a->b, c = div_a->b;
-            if (is_simple_const(b)) {
-                // Use the version that injects two copies of b
-                return mutate((((x + (b % c)) % c) + (a - b))/c);
-            } else {
-                // Use the version that injects two copies of a
-                return mutate((((c + a - 1) - b) - ((x + (a % c)) % c))/c);
-            }
-        } else if (div_a &&
-                   div_b &&
-                   is_positive_const(div_a->b) &&
-                   equal(div_a->b, div_b->b) &&
-                   op->type.is_int() &&
-                   no_overflow(op->type) &&
-                   add_b_a &&
-                   equal(div_a->a, add_b_a->a)) {
-            // Same as above, where a == 0
-            Expr x = div_a->a, b = add_b_a->b, c = div_a->b;
-            return mutate(((c - 1 - b) - (x % c))/c);
-        } else if (div_a &&
-                   div_b &&
-                   is_positive_const(div_a->b) &&
-                   equal(div_a->b, div_b->b) &&
-                   op->type.is_int() &&
-                   no_overflow(op->type) &&
-                   add_a_a &&
-                   equal(add_a_a->a, div_b->a)) {
-            // Same as above, where b == 0
-            Expr x = add_a_a->a, a = add_a_a->b, c = div_a->b;
-            return mutate(((x % c) + a)/c);
-        } else if (div_a &&
-                   div_b &&
-                   is_positive_const(div_a->b) &&
-                   equal(div_a->b, div_b->b) &&
-                   op->type.is_int() &&
-                   no_overflow(op->type) &&
-                   sub_b_a &&
-                   equal(div_a->a, sub_b_a->a)) {
-            // Same as above, where a == 0 and b is subtracted
-            Expr x = div_a->a, b = sub_b_a->b, c = div_a->b;
-            return mutate(((c - 1 + b) - (x % c))/c);
-        } else if (div_a &&
-                   div_b &&
-                   is_positive_const(div_a->b) &&
-                   equal(div_a->b, div_b->b) &&
-                   op->type.is_int() &&
-                   no_overflow(op->type) &&
-                   sub_a_a &&
-                   equal(sub_a_a->a, div_b->a)) {
-            // Same as above, where b == 0, and a is subtracted
-            Expr x = sub_a_a->a, a = sub_a_a->b, c = div_a->b;
-            return mutate(((x % c) - a)/c);
-        } else if (div_a &&
-                   div_b &&
-                   is_positive_const(div_a->b) &&
-                   equal(div_a->b, div_b->b) &&
-                   op->type.is_int() &&
-                   no_overflow(op->type) &&
-                   sub_a_a &&
-                   add_b_a &&
-                   equal(sub_a_a->a, add_b_a->a) &&
-                   is_simple_const(add_b_a->b)) {
-            // Same as above, where a is subtracted and b is a constant
-            // (x - a)/c - (x + b)/c -> ((x + b)%c - a - b)/c
-            Expr x = sub_a_a->a, a = sub_a_a->b, b = add_b_a->b, c = div_a->b;
-            return mutate((((x + (b % c)) % c) - a - b)/c);
-        } else if (div_a &&
-                   div_b &&
-                   is_positive_const(div_a->b) &&
-                   equal(div_a->b, div_b->b) &&
-                   op->type.is_int() &&
-                   no_overflow(op->type) &&
-                   add_a_a &&
-                   sub_b_a &&
-                   equal(add_a_a->a, sub_b_a->a) &&
-                   is_simple_const(add_a_a->b)) {
-            // Same as above, where b is subtracted and a is a constant
-            // (x + a)/c - (x - b)/c -> (b - (x + a)%c + (a + c - 1))/c
-            Expr x = add_a_a->a, a = add_a_a->b, b = sub_b_a->b, c = div_a->b;
-            return mutate((b - (x + (a % c))%c + (a + c - 1))/c);
+        } else if (rewrite(x * c0 - y * c1, (x - y * (c1 / c0)) * c0, c1 % c0 == 0) ||
+                   rewrite(x * c0 - y * c1, (x * (c0 / c1) - y) * c1, c0 % c1 == 0) ||
+                   (op->type.is_int() &&
+                    no_overflow(op->type) &&
+                    // This pattern comes up in bounds inference on upsampling code:
+                    // (x + a)/c - (x + b)/c ->
+                    //    ((x + b)%c + (a - b))/c         (duplicates b)
+                    // or ((c + a - 1 - b) - (x + a)%c)/c (duplicates a)
+                    (rewrite((x + y) / z - (x + c0) / z, (((x + (c0 % z)) % z) + (y - c0)) / z, is_positive_const(z)) ||
+                     rewrite((x + c0) / z - (x + y) / z, (((z + c0 - 1) - y) - ((x + (c0 % z)) % z)) / z, is_positive_const(z)) ||
+                     // Same as above, where a or b is zero, or subtracted
+                     rewrite(x / z - (x + y) / z, ((z - 1 - y) - (x % z)) / z, is_positive_const(z)) ||
+                     rewrite((x + y) / z - x / z, ((x % z) + y) / z, is_positive_const(z)) ||
+                     rewrite(x / z - (x - y) / z, ((z - 1 + y) - (x % z)) / z, is_positive_const(z)) ||
+                     rewrite((x - y) / z - x / z, ((x % z) - y) / z, is_positive_const(z)) ||
+                     rewrite((x - y) / z - (x + c0) / z, (((x + (c0 % z)) % z) - y - c0) / z, is_positive_const(z)) ||
+                     rewrite((x + c0) / z - (x - y) / z, (y - (x + (c0 % z)) % z + (c0 + z - 1)) / z, is_positive_const(z))))) {
+            return mutate(rewrite.result);
         } else if (no_overflow(op->type) &&
                    min_a &&
                    min_b &&
@@ -2572,11 +1893,7 @@ private:
         const Broadcast *broadcast_b = b.as<Broadcast>();
         const Ramp *ramp_a = a.as<Ramp>();
         const Add *add_a = a.as<Add>();
-        const Add *add_a_a = add_a ? add_a->a.as<Add>() : nullptr;
-        const Add *add_a_b = add_a ? add_a->b.as<Add>() : nullptr;
         const Add *add_b = b.as<Add>();
-        const Add *add_b_a = add_b ? add_b->a.as<Add>() : nullptr;
-        const Add *add_b_b = add_b ? add_b->b.as<Add>() : nullptr;
         const Mul *mul_a = a.as<Mul>();
         const Mul *mul_b = b.as<Mul>();
         const Mul *mul_a_a = add_a ? add_a->a.as<Mul>() : nullptr;
@@ -2604,7 +1921,11 @@ private:
         const Select *select_b = b.as<Select>();
         const Broadcast *broadcast_a_b = min_a ? min_a->b.as<Broadcast>() : nullptr;
 
-        min_a_a = max_a ? max_a->a.as<Min>() : min_a_a;
+        IRMatcher::Wild<0> x;
+        IRMatcher::Wild<1> y;
+        IRMatcher::Wild<2> z;
+        IRMatcher::Wild<3> w;
+        IRMatcher::Rewriter<Min> rewrite(op, a, b);
 
         // Detect if the lhs or rhs is a rounding-up operation
         int64_t a_round_up_factor = 0, b_round_up_factor = 0;
@@ -2767,18 +2088,9 @@ private:
                    equal(div_b_a_a->a, b)) {
             // min(a, (a/4)*4 + c) -> a (where c >= 3)
             return a;
-        } else if (max_a &&
-                   min_b &&
-                   equal(max_a->a, min_b->a) &&
-                   equal(max_a->b, min_b->b)) {
-            // min(max(x, y), min(x, y)) -> min(x, y)
-            return mutate(min(max_a->a, max_a->b));
-        } else if (max_a &&
-                   min_b &&
-                   equal(max_a->a, min_b->b) &&
-                   equal(max_a->b, min_b->a)) {
-            // min(max(x, y), min(y, x)) -> min(x, y)
-            return mutate(min(max_a->a, max_a->b));
+        } else if (rewrite(min(max(x, y), min(x, y)), min(x, y)) ||
+                   rewrite(min(max(x, y), min(y, x)), min(x, y))) {
+            return mutate(rewrite.result);
         } else if (max_a &&
                    (equal(max_a->a, b) || equal(max_a->b, b))) {
             // min(max(x, y), x) -> x
@@ -2812,130 +2124,35 @@ private:
                    equal(min_a_a_a_a->b, b)) {
             // min(min(min(min(min(x, y), z), w), l), y) -> min(min(min(min(x, y), z), w), l)
             return a;
-        } else if (max_a &&
-                   max_b &&
-                   equal(max_a->a, max_b->a)) {
-            // Distributive law for min/max
-            // min(max(x, y), max(x, z)) -> max(min(y, z), x)
-            return mutate(Max::make(Min::make(max_a->b, max_b->b), max_a->a));
-        } else if (max_a &&
-                   max_b &&
-                   equal(max_a->a, max_b->b)) {
-            // min(max(x, y), max(z, x)) -> max(min(y, z), x)
-            return mutate(Max::make(Min::make(max_a->b, max_b->a), max_a->a));
-        } else if (max_a &&
-                   max_b &&
-                   equal(max_a->b, max_b->a)) {
-            // min(max(y, x), max(x, z)) -> max(min(y, z), x)
-            return mutate(Max::make(Min::make(max_a->a, max_b->b), max_a->b));
-        } else if (max_a &&
-                   max_b &&
-                   equal(max_a->b, max_b->b)) {
-            // min(max(y, x), max(z, x)) -> max(min(y, z), x)
-            return mutate(Max::make(Min::make(max_a->a, max_b->a), max_a->b));
-        } else if (min_a &&
-                   min_b &&
-                   equal(min_a->a, min_b->a)) {
-            // min(min(x, y), min(x, z)) -> min(min(y, z), x)
-            return mutate(Min::make(Min::make(min_a->b, min_b->b), min_a->a));
-        } else if (min_a &&
-                   min_b &&
-                   equal(min_a->a, min_b->b)) {
-            // min(min(x, y), min(z, x)) -> min(min(y, z), x)
-            return mutate(Min::make(Min::make(min_a->b, min_b->a), min_a->a));
-        } else if (min_a &&
-                   min_b &&
-                   equal(min_a->b, min_b->a)) {
-            // min(min(y, x), min(x, z)) -> min(min(y, z), x)
-            return mutate(Min::make(Min::make(min_a->a, min_b->b), min_a->b));
-        } else if (min_a &&
-                   min_b &&
-                   equal(min_a->b, min_b->b)) {
-            // min(min(y, x), min(z, x)) -> min(min(y, z), x)
-            return mutate(Min::make(Min::make(min_a->a, min_b->a), min_a->b));
-        } else if (max_a &&
-                   min_a_a &&
-                   equal(min_a_a->b, b)) {
-            // min(max(min(x, y), z), y) -> min(max(x, z), y)
-            return mutate(min(max(min_a_a->a, max_a->b), b));
-        } else if (max_a &&
-                   min_a_a &&
-                   equal(min_a_a->a, b)) {
-            // min(max(min(y, x), z), y) -> min(max(x, z), y)
-            return mutate(min(max(min_a_a->b, max_a->b), b));
-        } else if (no_overflow(op->type) &&
-                   add_a &&
-                   add_b &&
-                   equal(add_a->b, add_b->b)) {
-            // Distributive law for addition
-            // min(a + b, c + b) -> min(a, c) + b
-            return mutate(min(add_a->a, add_b->a)) + add_a->b;
-        } else if (no_overflow(op->type) &&
-                   add_a &&
-                   add_b &&
-                   equal(add_a->a, add_b->a)) {
-            // min(b + a, b + c) -> min(a, c) + b
-            return mutate(min(add_a->b, add_b->b)) + add_a->a;
-        } else if (no_overflow(op->type) &&
-                   add_a &&
-                   add_b &&
-                   equal(add_a->a, add_b->b)) {
-            // min(b + a, c + b) -> min(a, c) + b
-            return mutate(min(add_a->b, add_b->a)) + add_a->a;
-        } else if (no_overflow(op->type) &&
-                   add_a &&
-                   add_b &&
-                   equal(add_a->b, add_b->a)) {
-            // min(a + b, b + c) -> min(a, c) + b
-            return mutate(min(add_a->a, add_b->b)) + add_a->b;
-        } else if (no_overflow(op->type) &&
-                   add_a_a &&
-                   add_b &&
-                   equal(add_a_a->a, add_b->a)) {
-            // min((a + b) + c, a + d) -> min(b + c, d) + a
-            return mutate(min(add_a_a->b + add_a->b, add_b->b)) + add_b->a;
-        } else if (no_overflow(op->type) &&
-                   add_a_a &&
-                   add_b &&
-                   equal(add_a_a->b, add_b->a)) {
-            // min((b + a) + c, a + d) -> min(b + c, d) + a
-            return mutate(min(add_a_a->a + add_a->b, add_b->b)) + add_b->a;
-        } else if (no_overflow(op->type) &&
-                   add_a &&
-                   add_b_a &&
-                   equal(add_a->a, add_b_a->a)) {
-            // min(a + d, (a + b) + c) -> min(d, b + c) + a
-            return mutate(min(add_a->b, add_b_a->b + add_b->b)) + add_a->a;
-        } else if (no_overflow(op->type) &&
-                   add_a &&
-                   add_b_a &&
-                   equal(add_a->a, add_b_a->b)) {
-            // min(a + d, (b + a) + c) -> min(d, b + c) + a
-            return mutate(min(add_a->b, add_b_a->a + add_b->b)) + add_a->a;
-        } else if (no_overflow(op->type) &&
-                   add_a_b &&
-                   add_b &&
-                   equal(add_a_b->a, add_b->a)) {
-            // min(a + (b + c), b + d) -> min(a + c, d) + b
-            return mutate(min(add_a->a + add_a_b->b, add_b->b)) + add_b->a;
-        } else if (no_overflow(op->type) &&
-                   add_a_b &&
-                   add_b &&
-                   equal(add_a_b->b, add_b->a)) {
-            // min(a + (c + b), b + d) -> min(a + c, d) + b
-            return mutate(min(add_a->a + add_a_b->a, add_b->b)) + add_b->a;
-        } else if (no_overflow(op->type) &&
-                   add_a &&
-                   add_b_b &&
-                   equal(add_a->a, add_b_b->a)) {
-            // min(b + d, a + (b + c)) -> min(d, a + c) + b
-            return mutate(min(add_a->b, add_b->a + add_b_b->b)) + add_a->a;
-        } else if (no_overflow(op->type) &&
-                   add_a &&
-                   add_b_b &&
-                   equal(add_a->a, add_b_b->b)) {
-            // min(b + d, a + (c + b)) -> min(d, a + c) + b
-            return mutate(min(add_a->b, add_b->a + add_b_b->a)) + add_a->a;
+        } else if (// Distributive law for min/max
+                   rewrite(min(max(x, y), max(x, z)), max(min(y, z), x)) ||
+                   rewrite(min(max(x, y), max(z, x)), max(min(y, z), x)) ||
+                   rewrite(min(max(y, x), max(x, z)), max(min(y, z), x)) ||
+                   rewrite(min(max(y, x), max(z, x)), max(min(y, z), x)) ||
+                   rewrite(min(min(x, y), min(x, z)), min(min(y, z), x)) ||
+                   rewrite(min(min(x, y), min(z, x)), min(min(y, z), x)) ||
+                   rewrite(min(min(y, x), min(x, z)), min(min(y, z), x)) ||
+                   rewrite(min(min(y, x), min(z, x)), min(min(y, z), x)) ||
+                   rewrite(min(max(min(x, y), z), y), min(max(x, z), y)) ||
+                   rewrite(min(max(min(y, x), z), y), min(max(x, z), y))) {
+            return mutate(rewrite.result);
+        } else if (no_overflow(op->type) &&
+                   // Distributive law for addition
+                   (rewrite(min(x + y, z + y), min(x, z) + y) ||
+                    rewrite(min(y + x, y + z), min(x, z) + y) ||
+                    rewrite(min(y + x, z + y), min(x, z) + y) ||
+                    rewrite(min(x + y, y + z), min(x, z) + y) ||
+                    rewrite(min((x + y) + z, x + w), min(y + z, w) + x) ||
+                    rewrite(min((y + x) + z, x + w), min(y + z, w) + x) ||
+                    rewrite(min(x + w, (x + y) + z), min(w, y + z) + x) ||
+                    rewrite(min(x + w, (y + x) + z), min(w, y + z) + x) ||
+                    rewrite(min(x + (y + z), y + w), min(x + z, w) + y) ||
+                    rewrite(min(x + (z + y), y + w), min(x + z, w) + y) ||
+                    rewrite(min(y + w, x + (y + z)), min(w, x + z) + y) ||
+                    rewrite(min(y + w, x + (z + y)), min(w, x + z) + y))) {
+            // Only the min needs simplifying further.
+            const Add *sum = rewrite.result.as<Add>();
+            return mutate(sum->a) + sum->b;
         } else if (min_a &&
                    is_simple_const(min_a->b)) {
             if (is_simple_const(b)) {
@@ -3122,11 +2339,7 @@ private:
         const Broadcast *broadcast_b = b.as<Broadcast>();
         const Ramp *ramp_a = a.as<Ramp>();
         const Add *add_a = a.as<Add>();
-        const Add *add_a_a = add_a ? add_a->a.as<Add>() : nullptr;
-        const Add *add_a_b = add_a ? add_a->b.as<Add>() : nullptr;
         const Add *add_b = b.as<Add>();
-        const Add *add_b_a = add_b ? add_b->a.as<Add>() : nullptr;
-        const Add *add_b_b = add_b ? add_b->b.as<Add>() : nullptr;
         const Mul *mul_a = a.as<Mul>();
         const Mul *mul_b = b.as<Mul>();
         const Mul *mul_a_a = add_a ? add_a->a.as<Mul>() : nullptr;
@@ -3145,7 +2358,6 @@ private:
         const Max *max_a_a_a = max_a_a ? max_a_a->a.as<Max>() : nullptr;
         const Max *max_a_a_a_a = max_a_a_a ? max_a_a_a->a.as<Max>() : nullptr;
         const Min *min_a = a.as<Min>();
-        const Min *min_b = b.as<Min>();
         const Call *call_a = a.as<Call>();
         const Call *call_b = b.as<Call>();
         const Shuffle *shuffle_a = a.as<Shuffle>();
@@ -3154,7 +2366,11 @@ private:
         const Select *select_b = b.as<Select>();
         const Broadcast *broadcast_a_b = max_a ? max_a->b.as<Broadcast>() : nullptr;
 
-        max_a_a = min_a ? min_a->a.as<Max>() : max_a_a;
+        IRMatcher::Wild<0> x;
+        IRMatcher::Wild<1> y;
+        IRMatcher::Wild<2> z;
+        IRMatcher::Wild<3> w;
+        IRMatcher::Rewriter<Max> rewrite(op, a, b);
 
         // Detect if the lhs or rhs is a rounding-up operation
         int64_t a_round_up_factor = 0, b_round_up_factor = 0;
@@ -3305,18 +2521,9 @@ private:
                    equal(div_b_a_a->a, b)) {
             // max(a, (a/4)*4 + c) -> (a/4)*4 + c (where c >= 3)
             return b;
-        } else if (min_a &&
-                   max_b &&
-                   equal(min_a->a, max_b->a) &&
-                   equal(min_a->b, max_b->b)) {
-            // max(min(x, y), max(x, y)) -> max(x, y)
-            return mutate(max(min_a->a, min_a->b));
-        } else if (min_a &&
-                   max_b &&
-                   equal(min_a->a, max_b->b) &&
-                   equal(min_a->b, max_b->a)) {
-            // max(min(x, y), max(y, x)) -> max(x, y)
-            return mutate(max(min_a->a, min_a->b));
+        } else if (rewrite(max(min(x, y), max(x, y)), max(x, y)) ||
+                   rewrite(max(min(x, y), max(y, x)), max(x, y))) {
+            return mutate(rewrite.result);
         } else if (min_a &&
                    (equal(min_a->a, b) || equal(min_a->b, b))) {
             // max(min(x, y), x) -> x
@@ -3348,130 +2555,35 @@ private:
                    equal(max_a_a_a_a->b, b)) {
             // max(max(max(max(max(x, y), z), w), l), y) -> max(max(max(max(x, y), z), w), l)
             return a;
-        } else if (max_a &&
-                   max_b &&
-                   equal(max_a->a, max_b->a)) {
-            // Distributive law for min/max
-            // max(max(x, y), max(x, z)) -> max(max(y, z), x)
-            return mutate(Max::make(Max::make(max_a->b, max_b->b), max_a->a));
-        } else if (max_a &&
-                   max_b &&
-                   equal(max_a->a, max_b->b)) {
-            // max(max(x, y), max(z, x)) -> max(max(y, z), x)
-            return mutate(Max::make(Max::make(max_a->b, max_b->a), max_a->a));
-        } else if (max_a &&
-                   max_b &&
-                   equal(max_a->b, max_b->a)) {
-            // max(max(y, x), max(x, z)) -> max(max(y, z), x)
-            return mutate(Max::make(Max::make(max_a->a, max_b->b), max_a->b));
-        } else if (max_a &&
-                   max_b &&
-                   equal(max_a->b, max_b->b)) {
-            // max(max(y, x), max(z, x)) -> max(max(y, z), x)
-            return mutate(Max::make(Max::make(max_a->a, max_b->a), max_a->b));
-        } else if (min_a &&
-                   min_b &&
-                   equal(min_a->a, min_b->a)) {
-            // max(min(x, y), min(x, z)) -> min(max(y, z), x)
-            return mutate(Min::make(Max::make(min_a->b, min_b->b), min_a->a));
-        } else if (min_a &&
-                   min_b &&
-                   equal(min_a->a, min_b->b)) {
-            // max(min(x, y), min(z, x)) -> min(max(y, z), x)
-            return mutate(Min::make(Max::make(min_a->b, min_b->a), min_a->a));
-        } else if (min_a &&
-                   min_b &&
-                   equal(min_a->b, min_b->a)) {
-            // max(min(y, x), min(x, z)) -> min(max(y, z), x)
-            return mutate(Min::make(Max::make(min_a->a, min_b->b), min_a->b));
-        } else if (min_a &&
-                   min_b &&
-                   equal(min_a->b, min_b->b)) {
-            // max(min(y, x), min(z, x)) -> min(max(y, z), x)
-            return mutate(Min::make(Max::make(min_a->a, min_b->a), min_a->b));
-        } else if (min_a &&
-                   max_a_a &&
-                   equal(max_a_a->b, b)) {
-            // max(min(max(x, y), z), y) -> max(min(x, z), y)
-            return mutate(max(min(max_a_a->a, min_a->b), b));
-        } else if (min_a &&
-                   max_a_a &&
-                   equal(max_a_a->a, b)) {
-            // max(min(max(y, x), z), y) -> max(min(x, z), y)
-            return mutate(max(min(max_a_a->b, min_a->b), b));
-        } else if (no_overflow(op->type) &&
-                   add_a &&
-                   add_b &&
-                   equal(add_a->b, add_b->b)) {
-            // Distributive law for addition
-            // max(a + b, c + b) -> max(a, c) + b
-            return mutate(max(add_a->a, add_b->a)) + add_a->b;
-        } else if (no_overflow(op->type) &&
-                   add_a &&
-                   add_b &&
-                   equal(add_a->a, add_b->a)) {
-            // max(b + a, b + c) -> max(a, c) + b
-            return mutate(max(add_a->b, add_b->b)) + add_a->a;
-        } else if (no_overflow(op->type) &&
-                   add_a &&
-                   add_b &&
-                   equal(add_a->a, add_b->b)) {
-            // max(b + a, c + b) -> max(a, c) + b
-            return mutate(max(add_a->b, add_b->a)) + add_a->a;
-        } else if (no_overflow(op->type) &&
-                   add_a &&
-                   add_b &&
-                   equal(add_a->b, add_b->a)) {
-            // max(a + b, b + c) -> max(a, c) + b
-            return mutate(max(add_a->a, add_b->b)) + add_a->b;
-        } else if (no_overflow(op->type) &&
-                   add_a_a &&
-                   add_b &&
-                   equal(add_a_a->a, add_b->a)) {
-            // max((a + b) + c, a + d) -> max(b + c, d) + a
-            return mutate(max(add_a_a->b + add_a->b, add_b->b)) + add_b->a;
-        } else if (no_overflow(op->type) &&
-                   add_a_a &&
-                   add_b &&
-                   equal(add_a_a->b, add_b->a)) {
-            // max((b + a) + c, a + d) -> max(b + c, d) + a
-            return mutate(max(add_a_a->a + add_a->b, add_b->b)) + add_b->a;
-        } else if (no_overflow(op->type) &&
-                   add_a_b &&
-                   add_b &&
-                   equal(add_a_b->a, add_b->a)) {
-            // max(a + (b + c), b + d) -> max(a + c, d) + b
-            return mutate(max(add_a->a + add_a_b->b, add_b->b)) + add_b->a;
-        } else if (no_overflow(op->type) &&
-                   add_a_b &&
-                   add_b &&
-                   equal(add_a_b->b, add_b->a)) {
-            // max(a + (c + b), b + d) -> max(a + c, d) + b
-            return mutate(max(add_a->a + add_a_b->a, add_b->b)) + add_b->a;
-        } else if (no_overflow(op->type) &&
-                   add_a &&
-                   add_b_a &&
-                   equal(add_a->a, add_b_a->a)) {
-            // max(a + d, (a + b) + c) -> max(d, b + c) + a
-            return mutate(max(add_a->b, add_b_a->b + add_b->b)) + add_a->a;
-        } else if (no_overflow(op->type) &&
-                   add_a &&
-                   add_b_a &&
-                   equal(add_a->a, add_b_a->b)) {
-            // max(a + d, (b + a) + c) -> max(d, b + c) + a
-            return mutate(max(add_a->b, add_b_a->a + add_b->b)) + add_a->a;
-        } else if (no_overflow(op->type) &&
-                   add_a &&
-                   add_b_b &&
-                   equal(add_a->a, add_b_b->a)) {
-            // max(b + d, a + (b + c)) -> max(d, a + c) + b
-            return mutate(max(add_a->b, add_b->a + add_b_b->b)) + add_a->a;
-        } else if (no_overflow(op->type) &&
-                   add_a &&
-                   add_b_b &&
-                   equal(add_a->a, add_b_b->b)) {
-            // max(b + d, a + (c + b)) -> max(d, a + c) + b
-            return mutate(max(add_a->b, add_b->a + add_b_b->a)) + add_a->a;
+        } else if (// Distributive law for min/max
+                   rewrite(max(max(x, y), max(x, z)), max(max(y, z), x)) ||
+                   rewrite(max(max(x, y), max(z, x)), max(max(y, z), x)) ||
+                   rewrite(max(max(y, x), max(x, z)), max(max(y, z), x)) ||
+                   rewrite(max(max(y, x), max(z, x)), max(max(y, z), x)) ||
+                   rewrite(max(min(x, y), min(x, z)), min(max(y, z), x)) ||
+                   rewrite(max(min(x, y), min(z, x)), min(max(y, z), x)) ||
+                   rewrite(max(min(y, x), min(x, z)), min(max(y, z), x)) ||
+                   rewrite(max(min(y, x), min(z, x)), min(max(y, z), x)) ||
+                   rewrite(max(min(max(x, y), z), y), max(min(x, z), y)) ||
+                   rewrite(max(min(max(y, x), z), y), max(min(x, z), y))) {
+            return mutate(rewrite.result);
+        } else if (no_overflow(op->type) &&
+                   // Distributive law for addition
+                   (rewrite(max(x + y, z + y), max(x, z) + y) ||
+                    rewrite(max(y + x, y + z), max(x, z) + y) ||
+                    rewrite(max(y + x, z + y), max(x, z) + y) ||
+                    rewrite(max(x + y, y + z), max(x, z) + y) ||
+                    rewrite(max((x + y) + z, x + w), max(y + z, w) + x) ||
+                    rewrite(max((y + x) + z, x + w), max(y + z, w) + x) ||
+                    rewrite(max(x + (y + z), y + w), max(x + z, w) + y) ||
+                    rewrite(max(x + (z + y), y + w), max(x + z, w) + y) ||
+                    rewrite(max(x + w, (x + y) + z), max(w, y + z) + x) ||
+                    rewrite(max(x + w, (y + x) + z), max(w, y + z) + x) ||
+                    rewrite(max(y + w, x + (y + z)), max(w, x + z) + y) ||
+                    rewrite(max(y + w, x + (z + y)), max(w, x + z) + y))) {
+            // Only the max needs simplifying further.
+            const Add *sum = rewrite.result.as<Add>();
+            return mutate(sum->a) + sum->b;
         } else if (max_a && is_simple_const(max_a->b)) {
             if (is_simple_const(b)) {
                 // max(max(x, 4), 5) -> max(x, 4)
@@ -4542,21 +3654,19 @@ private:
 
         const Call *ct = true_value.as<Call>();
         const Call *cf = false_value.as<Call>();
-        const Select *sel_t = true_value.as<Select>();
-        const Select *sel_f = false_value.as<Select>();
-        const Add *add_t = true_value.as<Add>();
-        const Add *add_f = false_value.as<Add>();
-        const Sub *sub_t = true_value.as<Sub>();
-        const Sub *sub_f = false_value.as<Sub>();
-        const Mul *mul_t = true_value.as<Mul>();
-        const Mul *mul_f = false_value.as<Mul>();
+
+        IRMatcher::Wild<0> x;
+        IRMatcher::Wild<1> y;
+        IRMatcher::Wild<2> z;
+        IRMatcher::Wild<3> w;
+        IRMatcher::Rewriter<Select> rewrite(op, condition, true_value, false_value);
 
         if (is_zero(condition)) {
             return false_value;
         } else if (is_one(condition)) {
             return true_value;
-        } else if (equal(true_value, false_value)) {
-            return true_value;
+        } else if (rewrite(select(x, y, y), y)) {
+            return rewrite.result;
         } else if (true_value.type().is_bool() &&
                    is_one(true_value) &&
                    is_zero(false_value)) {
@@ -4576,12 +3686,10 @@ private:
         } else if (const Broadcast *b = condition.as<Broadcast>()) {
             // Select of broadcast -> scalar select
             return mutate(Select::make(b->value, true_value, false_value));
-        } else if (const NE *ne = condition.as<NE>()) {
-            // Normalize select(a != b, c, d) to select(a == b, d, c)
-            return mutate(Select::make(ne->a == ne->b, false_value, true_value));
-        } else if (const LE *le = condition.as<LE>()) {
-            // Normalize select(a <= b, c, d) to select(b < a, d, c)
-            return mutate(Select::make(le->b < le->a, false_value, true_value));
+        } else if (rewrite(select(x != y, z, w), select(x == y, w, z)) ||
+                   rewrite(select(x <= y, z, w), select(y < x, w, z))) {
+            // Normalize the condition to == or <
+            return mutate(rewrite.result);
         } else if (ct && ct->is_intrinsic(Call::likely) &&
                    equal(ct->args[0], false_value)) {
             // select(cond, likely(a), a) -> likely(a)
@@ -4591,100 +3699,28 @@ private:
                    equal(cf->args[0], true_value)) {
             // select(cond, a, likely(a)) -> likely(a)
             return false_value;
-        } else if (sel_t &&
-                   equal(sel_t->true_value, false_value)) {
-            // select(a, select(b, c, d), c) -> select(a && !b, d, c)
-            return mutate(Select::make(condition && !sel_t->condition, sel_t->false_value, false_value));
-        } else if (sel_t &&
-                   equal(sel_t->false_value, false_value)) {
-            // select(a, select(b, c, d), d) -> select(a && b, c, d)
-            return mutate(Select::make(condition && sel_t->condition, sel_t->true_value, false_value));
-        } else if (sel_f &&
-                   equal(sel_f->false_value, true_value)) {
-            // select(a, d, select(b, c, d)) -> select(a || !b, d, c)
-            return mutate(Select::make(condition || !sel_f->condition, true_value, sel_f->true_value));
-        } else if (sel_f &&
-                   equal(sel_f->true_value, true_value)) {
-            // select(a, d, select(b, d, c)) -> select(a || b, d, c)
-            return mutate(Select::make(condition || sel_f->condition, true_value, sel_f->false_value));
-        } else if (sel_t &&
-                   equal(sel_t->condition, condition)) {
-            // select(a, select(a, b, c), d) -> select(a, b, d)
-            return mutate(Select::make(condition, sel_t->true_value, false_value));
-        } else if (sel_f &&
-                   equal(sel_f->condition, condition)) {
-            // select(a, b, select(a, c, d)) -> select(a, b, d)
-            return mutate(Select::make(condition, true_value, sel_f->false_value));
-        } else if (add_t &&
-                   add_f &&
-                   equal(add_t->a, add_f->a)) {
-            // select(c, a+b, a+d) -> a + select(x, b, d)
-            return mutate(add_t->a + Select::make(condition, add_t->b, add_f->b));
-        } else if (add_t &&
-                   add_f &&
-                   equal(add_t->a, add_f->b)) {
-            // select(c, a+b, d+a) -> a + select(x, b, d)
-            return mutate(add_t->a + Select::make(condition, add_t->b, add_f->a));
-        } else if (add_t &&
-                   add_f &&
-                   equal(add_t->b, add_f->a)) {
-            // select(c, b+a, a+d) -> a + select(x, b, d)
-            return mutate(add_t->b + Select::make(condition, add_t->a, add_f->b));
-        } else if (add_t &&
-                   add_f &&
-                   equal(add_t->b, add_f->b)) {
-            // select(c, b+a, d+a) -> select(x, b, d) + a
-            return mutate(Select::make(condition, add_t->a, add_f->a) + add_t->b);
-        } else if (sub_t &&
-                   sub_f &&
-                   equal(sub_t->a, sub_f->a)) {
-            // select(c, a-b, a-d) -> a - select(x, b, d)
-            return mutate(sub_t->a - Select::make(condition, sub_t->b, sub_f->b));
-        } else if (sub_t &&
-                   sub_f &&
-                   equal(sub_t->b, sub_f->b)) {
-            // select(c, b-a, d-a) -> select(x, b, d) - a
-            return mutate(Select::make(condition, sub_t->a, sub_f->a) - sub_t->b);\
-        } else if (add_t &&
-                   sub_f &&
-                   equal(add_t->a, sub_f->a)) {
-            // select(c, a+b, a-d) -> a + select(x, b, 0-d)
-            return mutate(add_t->a + Select::make(condition, add_t->b, make_zero(sub_f->b.type()) - sub_f->b));
-        } else if (add_t &&
-                   sub_f &&
-                   equal(add_t->b, sub_f->a)) {
-            // select(c, b+a, a-d) -> a + select(x, b, 0-d)
-            return mutate(add_t->b + Select::make(condition, add_t->a, make_zero(sub_f->b.type()) - sub_f->b));
-        } else if (sub_t &&
-                   add_f &&
-                   equal(sub_t->a, add_f->a)) {
-            // select(c, a-b, a+d) -> a + select(x, 0-b, d)
-            return mutate(sub_t->a + Select::make(condition, make_zero(sub_t->b.type()) - sub_t->b, add_f->b));
-        } else if (sub_t &&
-                   add_f &&
-                   equal(sub_t->a, add_f->b)) {
-            // select(c, a-b, d+a) -> a + select(x, 0-b, d)
-            return mutate(sub_t->a + Select::make(condition, make_zero(sub_t->b.type()) - sub_t->b, add_f->a));
-        } else if (mul_t &&
-                   mul_f &&
-                   equal(mul_t->a, mul_f->a)) {
-            // select(c, a*b, a*d) -> a * select(x, b, d)
-            return mutate(mul_t->a * Select::make(condition, mul_t->b, mul_f->b));
-        } else if (mul_t &&
-                   mul_f &&
-                   equal(mul_t->a, mul_f->b)) {
-            // select(c, a*b, d*a) -> a * select(x, b, d)
-            return mutate(mul_t->a * Select::make(condition, mul_t->b, mul_f->a));
-        } else if (mul_t &&
-                   mul_f &&
-                   equal(mul_t->b, mul_f->a)) {
-            // select(c, b*a, a*d) -> a * select(x, b, d)
-            return mutate(mul_t->b * Select::make(condition, mul_t->a, mul_f->b));
-        } else if (mul_t &&
-                   mul_f &&
-                   equal(mul_t->b, mul_f->b)) {
-            // select(c, b*a, d*a) -> select(x, b, d) * a
-            return mutate(Select::make(condition, mul_t->a, mul_f->a) * mul_t->b);
+        } else if (rewrite(select(x, select(y, z, w), z), select(x && !y, w, z)) ||
+                   rewrite(select(x, select(y, z, w), w), select(x && y, z, w)) ||
+                   rewrite(select(x, y, select(z, w, y)), select(x || !z, y, w)) ||
+                   rewrite(select(x, y, select(z, y, w)), select(x || z, y, w)) ||
+                   rewrite(select(x, select(x, y, z), w), select(x, y, w)) ||
+                   rewrite(select(x, y, select(x, z, w)), select(x, y, w)) ||
+                   // Pull common terms out of the arms
+                   rewrite(select(x, y + z, y + w), y + select(x, z, w)) ||
+                   rewrite(select(x, y + z, w + y), y + select(x, z, w)) ||
+                   rewrite(select(x, z + y, y + w), y + select(x, z, w)) ||
+                   rewrite(select(x, z + y, w + y), select(x, z, w) + y) ||
+                   rewrite(select(x, y - z, y - w), y - select(x, z, w)) ||
+                   rewrite(select(x, z - y, w - y), select(x, z, w) - y) ||
+                   rewrite(select(x, y + z, y - w), y + select(x, z, 0 - w)) ||
+                   rewrite(select(x, z + y, y - w), y + select(x, z, 0 - w)) ||
+                   rewrite(select(x, y - z, y + w), y + select(x, 0 - z, w)) ||
+                   rewrite(select(x, y - z, w + y), y + select(x, 0 - z, w)) ||
+                   rewrite(select(x, y * z, y * w), y * select(x, z, w)) ||
+                   rewrite(select(x, y * z, w * y), y * select(x, z, w)) ||
+                   rewrite(select(x, z * y, y * w), y * select(x, z, w)) ||
+                   rewrite(select(x, z * y, w * y), select(x, z, w) * y)) {
+            return mutate(rewrite.result);
         } else if (condition.same_as(op->condition) &&
                    true_value.same_as(op->true_value) &&
                    false_value.same_as(op->false_value)) {
@@ -5225,6 +4261,36 @@ private:
         }
     }
 
+    Expr visit(const VectorReduce *op) override {
+        Expr value = mutate(op->value);
+
+        const int lanes = op->type.lanes();
+        const int factor = value.type().lanes() / lanes;
+        if (factor == 1) {
+            return value;
+        }
+
+        const Broadcast *b = value.as<Broadcast>();
+        if (b && op->op != VectorReduce::Mul) {
+            // Reducing a broadcast
+            Expr v = b->value;
+            if (op->op == VectorReduce::Add) {
+                v = mutate(Mul::make(v, make_const(v.type(), factor)));
+            }
+            if (lanes == 1) {
+                return v;
+            } else {
+                return Broadcast::make(v, lanes);
+            }
+        }
+
+        if (value.same_as(op->value)) {
+            return op;
+        } else {
+            return VectorReduce::make(op->op, value, lanes);
+        }
+    }
+
     Expr visit(const Shuffle *op) override {
         if (op->is_extract_element() &&
             (op->vectors[0].as<Ramp>() ||
@@ -5915,13 +4981,21 @@ private:
 Expr simplify(Expr e, bool remove_dead_lets,
               const Scope<Interval> &bounds,
               const Scope<ModulusRemainder> &alignment) {
-    return Simplify(remove_dead_lets, &bounds, &alignment).mutate(e);
+    Expr result = Simplify(remove_dead_lets, &bounds, &alignment).mutate(e);
+    if (ExprInterner *interner = active_expr_interner()) {
+        result = interner->intern(result);
+    }
+    return result;
 }
 
 Stmt simplify(Stmt s, bool remove_dead_lets,
               const Scope<Interval> &bounds,
               const Scope<ModulusRemainder> &alignment) {
-    return Simplify(remove_dead_lets, &bounds, &alignment).mutate(s);
+    Stmt result = Simplify(remove_dead_lets, &bounds, &alignment).mutate(s);
+    if (ExprInterner *interner = active_expr_interner()) {
+        result = interner->intern(result);
+    }
+    return result;
 }
 
 class SimplifyExprs : public IRMutator2 {
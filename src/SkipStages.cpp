@@ -294,8 +294,25 @@ private:
             op = stmt.as<ProducerConsumer>();
             internal_assert(op);
             if (op->name == buffer) {
-                Stmt body = IfThenElse::make(compute_predicate, op->body);
-                stmt = ProducerConsumer::make(op->name, op->is_producer, body);
+                // Acquiring space in the ring buffer of an async
+                // producer with folded storage (see StorageFolding)
+                // must happen whether or not we compute the stage, or
+                // the semaphore gets out of balance with the
+                // consumer, so leave those acquires unguarded.
+                vector<Stmt> acquires;
+                Stmt body = op->body;
+                while (const Block *block = body.as<Block>()) {
+                    const Evaluate *eval = block->first.as<Evaluate>();
+                    const Call *call = eval ? eval->value.as<Call>() : nullptr;
+                    if (call && call->name == "halide_semaphore_acquire") {
+                        acquires.push_back(block->first);
+                        body = block->rest;
+                    } else {
+                        break;
+                    }
+                }
+                acquires.push_back(IfThenElse::make(compute_predicate, body));
+                stmt = ProducerConsumer::make(op->name, op->is_producer, Block::make(acquires));
             }
         }
         return stmt;
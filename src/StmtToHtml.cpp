@@ -506,6 +506,22 @@ private:
         stream << close_div();
     }
 
+    void visit(const Atomic *op) {
+        stream << open_div("Atomic");
+        int id = unique_id();
+        stream << open_span("Matched");
+        stream << open_expand_button(id);
+        stream << keyword("atomic") << " ";
+        stream << var(op->producer_name);
+        stream << close_expand_button() << " {";
+        stream << close_span();
+        stream << open_div("AtomicBody Indent", id);
+        print(op->body);
+        stream << close_div();
+        stream << matched("}");
+        stream << close_div();
+    }
+
     // To avoid generating ridiculously deep DOMs, we flatten blocks here.
     void visit_block_stmt(Stmt stmt) {
         if (const Block *b = stmt.as<Block>()) {
@@ -599,6 +615,19 @@ private:
         stream << close_span();
     }
 
+    void visit(const VectorReduce *op) {
+        stream << open_span("VectorReduce");
+        stream << open_span("Matched");
+        stream << open_span("Type") << op->type << close_span();
+        std::ostringstream name;
+        name << "vector_reduce_" << op->op;
+        stream << "(" << symbol(name.str()) << "(";
+        stream << close_span();
+        print(op->value);
+        stream << matched("))");
+        stream << close_span();
+    }
+
 public:
     void print(Expr ir) {
         ir.accept(this);
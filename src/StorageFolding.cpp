@@ -292,6 +292,69 @@ public:
           dim(dim), storage_dim(storage_dim) {}
 };
 
+// Check whether the produce or consume nodes for a func are nested
+// inside some loop within a statement.
+class ProducerConsumerInLoop : public IRVisitor {
+    const string &func;
+    int loop_depth = 0;
+
+    using IRVisitor::visit;
+
+    void visit(const For *op) {
+        loop_depth++;
+        IRVisitor::visit(op);
+        loop_depth--;
+    }
+
+    void visit(const ProducerConsumer *op) {
+        if (op->name == func && loop_depth > 0) {
+            result = true;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+public:
+    bool result = false;
+    ProducerConsumerInLoop(const string &f) : func(f) {}
+};
+
+// Turn the folded storage of an async func into a ring buffer. The
+// producer acquires space in the fold from a semaphore before
+// writing each new slice, and the consumer releases each slice
+// once it no longer needs it. Both are unconditional, so that the
+// semaphore stays balanced even if the stage is skipped.
+class InjectFoldingSemaphores : public IRMutator {
+    const string &func;
+    string sema_var;
+    Expr acquire_amount, release_amount;
+
+    using IRMutator::visit;
+
+    void visit(const ProducerConsumer *op) {
+        if (op->name == func) {
+            Expr sema = Variable::make(type_of<halide_semaphore_t *>(), sema_var);
+            Stmt body = op->body;
+            if (op->is_producer) {
+                Expr acquire = Call::make(Int(32), "halide_semaphore_acquire",
+                                          {sema, acquire_amount}, Call::Extern);
+                body = Block::make(Evaluate::make(acquire), body);
+            } else {
+                Expr release = Call::make(Int(32), "halide_semaphore_release",
+                                          {sema, release_amount}, Call::Extern);
+                body = Block::make(body, Evaluate::make(release));
+            }
+            stmt = ProducerConsumer::make(op->name, op->is_producer, body);
+        } else {
+            IRMutator::visit(op);
+        }
+    }
+
+public:
+    InjectFoldingSemaphores(const string &f, const string &s, Expr a, Expr r)
+        : func(f), sema_var(s), acquire_amount(a), release_amount(r) {}
+};
+
 // Attempt to fold the storage of a particular function in a statement
 class AttemptStorageFoldingOfFunction : public IRMutator {
     Function func;
@@ -383,6 +446,12 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
                     ((min_monotonic_increasing || max_monotonic_decreasing) &&
                      can_prove(extent <= explicit_factor));
                 if (!can_skip_dynamic_checks) {
+                    user_assert(!func.schedule().async())
+                        << "Can't fold the storage of " << func.name()
+                        << " over loop " << op->name << " by " << explicit_factor
+                        << " because it is scheduled async, and the fold could not"
+                        << " be proven to be safe without dynamic checks.\n";
+
                     // If we didn't find a monotonic dimension, or
                     // couldn't prove the extent was small enough, and we
                     // have an explicit fold factor, we need to
@@ -434,10 +503,55 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
                     }
                 }
 
+                if (factor.defined() && func.schedule().async()) {
+                    // The producer and consumer will run concurrently,
+                    // synchronizing once per iteration of this
+                    // loop. That's only possible if they're not nested
+                    // inside some inner loop.
+                    ProducerConsumerInLoop in_loop(func.name());
+                    body.accept(&in_loop);
+                    if (in_loop.result) {
+                        user_assert(!explicit_factor.defined())
+                            << "Can't fold the storage of async Func " << func.name()
+                            << " over loop " << op->name << " because it is not"
+                            << " computed at that loop level.\n";
+                        debug(3) << "Not folding async Func because it is not computed at this loop level\n";
+                        factor = Expr();
+                    }
+                }
+
                 if (factor.defined()) {
                     debug(3) << "Proceeding with factor " << factor << "\n";
 
                     Fold fold = {(int)i - 1, factor};
+
+                    if (func.schedule().async()) {
+                        // Work out how many new slices the producer
+                        // writes in each iteration, and how many slices
+                        // the consumer is done with after each
+                        // iteration. Over a full run of the loop these
+                        // sum to the same thing, so the semaphore is
+                        // back to the fold factor after each run.
+                        fold.semaphore = func.name() + ".folding_semaphore." + unique_name('_');
+                        Expr prev_min = substitute(op->name, loop_var - 1, min);
+                        Expr prev_max = substitute(op->name, loop_var - 1, max);
+                        Expr next_min = substitute(op->name, loop_var + 1, min);
+                        Expr next_max = substitute(op->name, loop_var + 1, max);
+                        Expr extent = max - min + 1;
+                        Expr first_iteration = loop_var <= op->min;
+                        Expr last_iteration = loop_var >= op->min + op->extent - 1;
+                        Expr acquire, release;
+                        if (min_monotonic_increasing) {
+                            acquire = select(first_iteration, extent, max - prev_max);
+                            release = select(last_iteration, extent, next_min - min);
+                        } else {
+                            acquire = select(first_iteration, extent, prev_min - min);
+                            release = select(last_iteration, extent, max - next_max);
+                        }
+                        body = InjectFoldingSemaphores(func.name(), fold.semaphore,
+                                                       simplify(acquire), simplify(release)).mutate(body);
+                    }
+
                     dims_folded.push_back(fold);
                     body = FoldStorageOfFunction(func.name(), (int)i - 1, factor, dynamic_footprint).mutate(body);
 
@@ -494,6 +608,8 @@ public:
     struct Fold {
         int dim;
         Expr factor;
+        // The semaphore guarding the ring buffer, if the func is async.
+        string semaphore;
     };
     vector<Fold> dims_folded;
 
@@ -539,6 +655,22 @@ class StorageFolding : public IRMutator {
             }
 
             stmt = Realize::make(op->name, op->types, op->memory_type, bounds, op->condition, body);
+
+            // Allocate and initialize the semaphores guarding any
+            // ring buffers outside the realization, so that they're
+            // shared by the producer and consumer once they're forked
+            // apart.
+            for (const auto &fold : folder.dims_folded) {
+                if (fold.semaphore.empty()) {
+                    continue;
+                }
+                Expr sema = Variable::make(type_of<halide_semaphore_t *>(), fold.semaphore);
+                Expr init = Call::make(Int(32), "halide_semaphore_init", {sema, fold.factor}, Call::Extern);
+                stmt = Block::make(Evaluate::make(init), stmt);
+                stmt = Allocate::make(fold.semaphore, UInt(64), MemoryType::Stack,
+                                      {(int)(sizeof(halide_semaphore_t) / sizeof(uint64_t))},
+                                      const_true(), stmt);
+            }
         }
     }
 
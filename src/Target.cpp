@@ -134,6 +134,7 @@ Target calculate_host_target() {
         const uint32_t avx512_knl = avx512 | avx512pf | avx512er;
         const uint32_t avx512_skylake = avx512 | avx512vl | avx512bw | avx512dq;
         const uint32_t avx512_cannonlake = avx512_skylake | avx512ifma; // Assume ifma => vbmi
+        const uint32_t avx512vnni = 1U << 11; // In ecx
         if ((info2[1] & avx2) == avx2) {
             initial_features.push_back(Target::AVX2);
         }
@@ -144,6 +145,9 @@ Target calculate_host_target() {
             }
             if ((info2[1] & avx512_skylake) == avx512_skylake) {
                 initial_features.push_back(Target::AVX512_Skylake);
+                if ((info2[2] & avx512vnni) == avx512vnni) {
+                    initial_features.push_back(Target::AVX512_Cascadelake);
+                }
             }
             if ((info2[1] & avx512_cannonlake) == avx512_cannonlake) {
                 initial_features.push_back(Target::AVX512_Cannonlake);
@@ -269,6 +273,13 @@ const std::map<std::string, Target::Feature> feature_name_map = {
     {"legacy_buffer_wrappers", Target::LegacyBufferWrappers},
     {"tsan", Target::TSAN},
     {"asan", Target::ASAN},
+    {"plan_memory", Target::PlanMemory},
+    {"profile_counters", Target::ProfileCounters},
+    {"profile_timeline", Target::ProfileTimeline},
+    {"avx512_cascadelake", Target::AVX512_Cascadelake},
+    {"arm_dot_prod", Target::ARMDotProd},
+    {"fast_transcendentals", Target::FastTranscendentals},
+    {"fast_compile", Target::FastCompile},
     // NOTE: When adding features to this map, be sure to update
     // PyEnums.cpp and halide.cmake as well.
 };
@@ -98,6 +98,13 @@ struct Target {
         LegacyBufferWrappers = halide_target_feature_legacy_buffer_wrappers,
         TSAN = halide_target_feature_tsan,
         ASAN = halide_target_feature_asan,
+        PlanMemory = halide_target_feature_plan_memory,
+        ProfileCounters = halide_target_feature_profile_counters,
+        ProfileTimeline = halide_target_feature_profile_timeline,
+        AVX512_Cascadelake = halide_target_feature_avx512_cascadelake,
+        ARMDotProd = halide_target_feature_arm_dot_prod,
+        FastTranscendentals = halide_target_feature_fast_transcendentals,
+        FastCompile = halide_target_feature_fast_compile,
         FeatureEnd = halide_target_feature_end
     };
     Target() : os(OSUnknown), arch(ArchUnknown), bits(0) {}
@@ -270,12 +277,14 @@ struct Target {
             }
         } else if (arch == Target::X86) {
             if (is_integer && (has_feature(Halide::Target::AVX512_Skylake) ||
+                               has_feature(Halide::Target::AVX512_Cascadelake) ||
                                has_feature(Halide::Target::AVX512_Cannonlake))) {
-                // AVX512BW exists on Skylake and Cannonlake
+                // AVX512BW exists on Skylake, Cascade Lake and Cannonlake
                 return 64 / data_size;
             } else if (t.is_float() && (has_feature(Halide::Target::AVX512) ||
                                         has_feature(Halide::Target::AVX512_KNL) ||
                                         has_feature(Halide::Target::AVX512_Skylake) ||
+                                        has_feature(Halide::Target::AVX512_Cascadelake) ||
                                         has_feature(Halide::Target::AVX512_Cannonlake))) {
                 // AVX512F is on all AVX512 architectures
                 return 64 / data_size;
@@ -2,8 +2,11 @@
 #include "Debug.h"
 #include "Error.h"
 #include "Introspection.h"
+#include "ThreadPool.h"
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <exception>
 #include <iomanip>
 #include <map>
 #include <mutex>
@@ -107,12 +110,130 @@ const int num_unique_name_counters = (1 << 14);
 // the correct behavior.
 std::atomic<int> unique_name_counters[num_unique_name_counters] = {};
 
+// Set by ScopedUniqueNameCounters and run_compile_tasks.
+thread_local int *thread_unique_name_counters = nullptr;
+
 int unique_count(size_t h) {
     h = h & (num_unique_name_counters - 1);
+    if (thread_unique_name_counters) {
+        return thread_unique_name_counters[h]++;
+    }
     return unique_name_counters[h]++;
 }
+
+// Copy the counters unique_name is using on this thread.
+void get_unique_name_counters(int *dst) {
+    for (int i = 0; i < num_unique_name_counters; i++) {
+        dst[i] = (thread_unique_name_counters ?
+                  thread_unique_name_counters[i] :
+                  unique_name_counters[i].load());
+    }
+}
+
+// Advance the counters unique_name is using on this thread past the
+// given ones.
+void merge_unique_name_counters(const int *src) {
+    for (int i = 0; i < num_unique_name_counters; i++) {
+        if (thread_unique_name_counters) {
+            thread_unique_name_counters[i] = std::max(thread_unique_name_counters[i], src[i]);
+        } else {
+            int c = unique_name_counters[i].load();
+            while (c < src[i] &&
+                   !unique_name_counters[i].compare_exchange_weak(c, src[i])) {
+            }
+        }
+    }
+}
+
+std::atomic<int> compile_threads_override{0};
 }  // namespace
 
+ScopedUniqueNameCounters::ScopedUniqueNameCounters()
+    : counters(new int[num_unique_name_counters]),
+      old_counters(thread_unique_name_counters) {
+    get_unique_name_counters(counters.get());
+    thread_unique_name_counters = counters.get();
+}
+
+ScopedUniqueNameCounters::~ScopedUniqueNameCounters() {
+    thread_unique_name_counters = old_counters;
+    merge_unique_name_counters(counters.get());
+}
+
+void set_compile_threads(int threads) {
+    user_assert(threads > 0) << "The number of compile threads must be positive\n";
+    compile_threads_override = threads;
+}
+
+int compile_threads() {
+    if (compile_threads_override > 0) {
+        return compile_threads_override;
+    }
+    static int threads = []() {
+        string env = get_env_variable("HL_COMPILE_THREADS");
+        int t = env.empty() ? (int)ThreadPool<void>::num_processors_online() : std::atoi(env.c_str());
+        return std::max(t, 1);
+    }();
+    return threads;
+}
+
+void run_compile_tasks(size_t n, const std::function<void(size_t)> &task) {
+    // Every task starts from the counters as they are now, so that
+    // the names a task makes don't depend on which tasks ran before
+    // it.
+    std::unique_ptr<int[]> start(new int[num_unique_name_counters]);
+    get_unique_name_counters(start.get());
+
+    vector<std::unique_ptr<int[]>> counters(n);
+    #ifdef WITH_EXCEPTIONS
+    vector<std::exception_ptr> exceptions(n);
+    #endif
+    auto run = [&](size_t i) {
+        counters[i].reset(new int[num_unique_name_counters]);
+        memcpy(counters[i].get(), start.get(), num_unique_name_counters * sizeof(int));
+        int *old_counters = thread_unique_name_counters;
+        thread_unique_name_counters = counters[i].get();
+        #ifdef WITH_EXCEPTIONS
+        try {
+            task(i);
+        } catch (...) {
+            exceptions[i] = std::current_exception();
+        }
+        #else
+        task(i);
+        #endif
+        thread_unique_name_counters = old_counters;
+    };
+
+    size_t threads = std::min(n, (size_t)compile_threads());
+    if (threads <= 1) {
+        for (size_t i = 0; i < n; i++) {
+            run(i);
+        }
+    } else {
+        ThreadPool<void> pool(threads);
+        vector<std::future<void>> results;
+        for (size_t i = 0; i < n; i++) {
+            results.push_back(pool.async([&run, i]() { run(i); }));
+        }
+        for (auto &r : results) {
+            r.wait();
+        }
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        merge_unique_name_counters(counters[i].get());
+    }
+
+    #ifdef WITH_EXCEPTIONS
+    for (size_t i = 0; i < n; i++) {
+        if (exceptions[i]) {
+            std::rethrow_exception(exceptions[i]);
+        }
+    }
+    #endif
+}
+
 // There are three possible families of names returned by the methods below:
 // 1) char pattern: (char that isn't '$') + number (e.g. v234)
 // 2) string pattern: (string without '$') + '$' + number (e.g. fr#nk82$42)
@@ -15,7 +15,9 @@
 
 #include <cstdint>
 #include <cstring>
+#include <functional>
 #include <limits>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -135,6 +137,42 @@ std::string unique_name(char prefix);
 std::string unique_name(const std::string &prefix);
 // @}
 
+/** For the lifetime of this object, unique_name on the current thread
+ * counts from a private copy of the counters, taken when the object
+ * is made. The names it returns are unique relative to each other and
+ * to every name returned before the copy was taken, but not to names
+ * made concurrently on other threads, so only use this around work
+ * that never meets those (e.g. lowering a separate pipeline). Because
+ * the sequence of names no longer depends on what other threads are
+ * doing, neither does the output of the work. On destruction the
+ * shared counters are advanced past every name it returned. */
+class ScopedUniqueNameCounters {
+    std::unique_ptr<int[]> counters;
+    int *old_counters;
+public:
+    ScopedUniqueNameCounters();
+    ~ScopedUniqueNameCounters();
+};
+
+/** Set the number of threads used to compile independent pieces of a
+ * pipeline (e.g. the targets of compile_multitarget). Defaults to the
+ * environment variable HL_COMPILE_THREADS if it is set, and otherwise
+ * to the number of cores. With one thread, everything is compiled on
+ * the calling thread. */
+// @{
+void set_compile_threads(int threads);
+int compile_threads();
+// @}
+
+/** Run task(0), task(1), ... task(n - 1) on up to compile_threads()
+ * threads, and wait for them all to finish. Each task makes unique
+ * names from its own copy of the counters as they were when this was
+ * called (as if by a ScopedUniqueNameCounters), so the results are the
+ * same whatever the number of threads or the order in which the tasks
+ * run. If any tasks throw, the exception from the
+ * lowest-numbered one is rethrown once they have all finished. */
+void run_compile_tasks(size_t n, const std::function<void(size_t)> &task);
+
 /** Test if the first string starts with the second string */
 bool starts_with(const std::string &str, const std::string &prefix);
 
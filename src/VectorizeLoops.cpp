@@ -231,6 +231,28 @@ bool uses_gpu_vars(Expr s) {
     return uses.uses_gpu;
 }
 
+class LoadsFrom : public IRVisitor {
+    const string &buffer;
+
+    using IRVisitor::visit;
+
+    void visit(const Load *op) {
+        if (op->name == buffer) {
+            result = true;
+        }
+        IRVisitor::visit(op);
+    }
+public:
+    bool result = false;
+    LoadsFrom(const string &b) : buffer(b) {}
+};
+
+bool loads_from(Expr e, const string &buffer) {
+    LoadsFrom l(buffer);
+    e.accept(&l);
+    return l.result;
+}
+
 // Wrap a vectorized predicate around a Load/Store node.
 class PredicateLoadStore : public IRMutator2 {
     string var;
@@ -294,6 +316,13 @@ class PredicateLoadStore : public IRMutator2 {
         return Load::make(op->type, op->name, index, op->image, op->param, predicate);
     }
 
+    Stmt visit(const Atomic *op) override {
+        // The stores in an atomic node are scalar updates, which
+        // can't be predicated on a vector condition.
+        valid = false;
+        return op;
+    }
+
     Stmt visit(const Store *op) override {
         valid = valid && should_predicate_store_load(op->value.type().bits());
         if (!valid) {
@@ -341,6 +370,10 @@ public:
     bool is_vectorized() const  {
         return valid && vectorized;
     }
+
+    bool is_valid() const {
+        return valid;
+    }
 };
 
 // Substitutes a vector for a scalar var in a Stmt. Used on the
@@ -701,7 +734,152 @@ class VectorSubs : public IRMutator2 {
         return (op->condition.type().lanes() > 1) ? scalarize(op) : op;
     }
 
+    // Try to vectorize an atomic update of the form f[i] = f[i] op
+    // g(var), where i does not depend on the var being vectorized
+    // over, by reducing across the lanes with a VectorReduce node
+    // and then applying a single scalar update. The update may be
+    // guarded by a condition, in which case lanes for which the
+    // condition is false contribute the identity of the
+    // operator, and loads are predicated on the condition. Returns
+    // an undefined Stmt if the update doesn't have this form.
+    Stmt vectorize_atomic_reduction(const Atomic *op, Expr condition) {
+        const Store *store = substitute_in_all_lets(op->body).as<Store>();
+        if (!store || !is_one(store->predicate)) {
+            return Stmt();
+        }
+
+        VectorReduce::Operator reduce_op;
+        Expr a, b;
+        if (const Add *add = store->value.as<Add>()) {
+            reduce_op = VectorReduce::Add;
+            a = add->a;
+            b = add->b;
+        } else if (const Mul *mul = store->value.as<Mul>()) {
+            reduce_op = VectorReduce::Mul;
+            a = mul->a;
+            b = mul->b;
+        } else if (const Min *min = store->value.as<Min>()) {
+            reduce_op = VectorReduce::Min;
+            a = min->a;
+            b = min->b;
+        } else if (const Max *max = store->value.as<Max>()) {
+            reduce_op = VectorReduce::Max;
+            a = max->a;
+            b = max->b;
+        } else {
+            return Stmt();
+        }
+
+        // Put the load of the location being updated in a.
+        const Load *load = a.as<Load>();
+        if (!load || load->name != store->name) {
+            std::swap(a, b);
+            load = a.as<Load>();
+        }
+        if (!load || load->name != store->name ||
+            !is_one(load->predicate) ||
+            !equal(load->index, store->index) ||
+            loads_from(b, store->name)) {
+            return Stmt();
+        }
+
+        // If the lanes update different locations we can't reduce
+        // within the vector.
+        Expr index = mutate(store->index);
+        if (index.type().is_vector()) {
+            return Stmt();
+        }
+
+        int lanes = replacement.type().lanes();
+        Type t = store->value.type();
+        b = widen(mutate(b), lanes);
+
+        if (condition.defined()) {
+            condition = mutate(condition);
+            if (condition.type().is_vector()) {
+                if (const Call *c = condition.as<Call>()) {
+                    if (c->is_intrinsic(Call::likely) ||
+                        c->is_intrinsic(Call::likely_if_innermost)) {
+                        condition = c->args[0];
+                    }
+                }
+                // The loads for lanes for which the condition is
+                // false may be out of bounds, so they must be
+                // predicated.
+                PredicateLoadStore p(var, condition, in_hexagon, target);
+                b = p.mutate(b);
+                if (!p.is_valid()) {
+                    return Stmt();
+                }
+                Expr identity;
+                switch (reduce_op) {
+                case VectorReduce::Add:
+                    identity = make_zero(t);
+                    break;
+                case VectorReduce::Mul:
+                    identity = make_one(t);
+                    break;
+                case VectorReduce::Min:
+                    identity = t.max();
+                    break;
+                case VectorReduce::Max:
+                    identity = t.min();
+                    break;
+                default:
+                    internal_error << "Unexpected reduction operator\n";
+                }
+                b = Select::make(condition, b, Broadcast::make(identity, lanes));
+                condition = Expr();
+            }
+        }
+
+        Expr reduced = VectorReduce::make(reduce_op, b, 1);
+        Expr value;
+        switch (reduce_op) {
+        case VectorReduce::Add:
+            value = Add::make(a, reduced);
+            break;
+        case VectorReduce::Mul:
+            value = Mul::make(a, reduced);
+            break;
+        case VectorReduce::Min:
+            value = Min::make(a, reduced);
+            break;
+        case VectorReduce::Max:
+            value = Max::make(a, reduced);
+            break;
+        default:
+            internal_error << "Unexpected reduction operator\n";
+        }
+
+        Stmt s = Store::make(store->name, value, index, store->param, const_true());
+        s = Atomic::make(op->producer_name, s);
+        if (condition.defined()) {
+            s = IfThenElse::make(condition, s);
+        }
+        return s;
+    }
+
+    Stmt visit(const Atomic *op) override {
+        Stmt s = vectorize_atomic_reduction(op, Expr());
+        if (s.defined()) {
+            return s;
+        }
+        // Several lanes of an atomic update may write to the same
+        // location, so the lanes are applied one at a time.
+        return scalarize(op);
+    }
+
     Stmt visit(const IfThenElse *op) override {
+        if (const Atomic *atomic = op->then_case.as<Atomic>()) {
+            if (!op->else_case.defined()) {
+                Stmt s = vectorize_atomic_reduction(atomic, op->condition);
+                if (s.defined()) {
+                    return s;
+                }
+            }
+        }
+
         Expr cond = mutate(op->condition);
         int lanes = cond.type().lanes();
         debug(3) << "Vectorizing over " << var << "\n"
@@ -0,0 +1,23 @@
+# Writes a header defining HALIDE_BUILD_ID, the git commit libHalide is
+# built from, with a -dirty suffix if the source tree has uncommitted
+# changes. Run by src/CMakeLists.txt on every build, with SOURCE_DIR and
+# OUTPUT set, and BUILD_ID set to override the id.
+if (NOT BUILD_ID)
+  execute_process(COMMAND git describe --always --dirty --abbrev=40
+                  WORKING_DIRECTORY "${SOURCE_DIR}"
+                  OUTPUT_VARIABLE BUILD_ID
+                  OUTPUT_STRIP_TRAILING_WHITESPACE
+                  ERROR_QUIET)
+endif()
+
+set(CONTENTS "#define HALIDE_BUILD_ID \"${BUILD_ID}\"\n")
+set(OLD_CONTENTS "")
+if (EXISTS "${OUTPUT}")
+  file(READ "${OUTPUT}" OLD_CONTENTS)
+endif()
+
+# Only rewrite the header when the id changes, so that JITModule.cpp is
+# rebuilt when, and only when, it needs to be.
+if (NOT CONTENTS STREQUAL OLD_CONTENTS)
+  file(WRITE "${OUTPUT}" "${CONTENTS}")
+endif()
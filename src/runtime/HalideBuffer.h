@@ -976,6 +976,17 @@ public:
         initialize_shape(sizes);
     }
 
+    /** As above, but share ownership of the data via an
+     * AllocationHeader the caller has constructed, with a reference
+     * count of one. Its deallocate_fn is called with the header when
+     * the last Buffer referring to the data is destroyed. Useful for
+     * memory the Buffer didn't allocate itself, such as a
+     * memory-mapped file. */
+    explicit Buffer(halide_type_t t, add_const_if_T_is_const<void> *data, const std::vector<int> &sizes,
+                    AllocationHeader *owner) : Buffer(t, data, sizes) {
+        alloc = owner;
+    }
+
     /** Initialize an Buffer from a pointer to the min coordinate and
      * an array describing the shape.  Does not take ownership of the
      * data, and does not set the host_dirty flag. */
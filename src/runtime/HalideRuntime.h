@@ -177,6 +177,33 @@ extern void halide_join_thread(struct halide_thread *);
  */
 extern int halide_set_num_threads(int n);
 
+/** A counting semaphore, used to pipeline async producers with their
+ * consumers (see Func::async). Must be initialized with
+ * halide_semaphore_init before use. */
+struct halide_semaphore_t {
+    uint64_t _private[4];
+};
+
+/** Operations on semaphores. halide_semaphore_init sets the count,
+ * and must not race with any other operation on the
+ * semaphore. halide_semaphore_release increments the count by n,
+ * waking any threads waiting in halide_semaphore_acquire. Acquire
+ * blocks until the count is at least n and then decrements it by
+ * n. halide_semaphore_try_acquire does the same but returns false
+ * instead of blocking. Init, release, and acquire return zero.
+ *
+ * The default thread pool makes sure that a thread blocking in
+ * halide_semaphore_acquire can't starve the task that would release
+ * it, by waking or spawning another worker if necessary. Custom
+ * implementations of halide_do_par_for must run tasks concurrently
+ * for async Funcs with folded storage to make progress. */
+//@{
+extern int halide_semaphore_init(struct halide_semaphore_t *, int n);
+extern int halide_semaphore_release(struct halide_semaphore_t *, int n);
+extern int halide_semaphore_acquire(struct halide_semaphore_t *, int n);
+extern bool halide_semaphore_try_acquire(struct halide_semaphore_t *, int n);
+//@}
+
 /** Halide calls these functions to allocate and free memory. To
  * replace in AOT code, use the halide_set_custom_malloc and
  * halide_set_custom_free, or (on platforms that support weak
@@ -205,6 +232,46 @@ extern halide_malloc_t halide_set_custom_malloc(halide_malloc_t user_malloc);
 extern halide_free_t halide_set_custom_free(halide_free_t user_free);
 //@}
 
+/** The default implementations of halide_malloc and halide_free keep
+ * freed blocks in a pool, and hand them out again to later allocations
+ * of a similar size, within and across pipeline invocations. This
+ * avoids a trip to the system allocator for every tile of a Func
+ * computed inside a parallel loop. Blocks are grouped into size classes
+ * spaced four per power of two, and each size class is split into
+ * shards picked by the calling thread, so threads mostly reuse the
+ * blocks they freed themselves without contending for a lock.
+ *
+ * The pool holds at most 'limit' bytes of free blocks. Blocks freed
+ * while the pool is full go back to the system allocator. The default
+ * limit is 64 MB; a limit of zero disables the pool. Lowering the
+ * limit releases all blocks held by the pool. These functions have no
+ * effect on custom allocators set with halide_set_custom_malloc. */
+//@{
+extern void halide_memory_pool_set_limit(int64_t limit);
+
+/** Return all free blocks held by the pool to the system allocator. */
+extern void halide_memory_pool_release(void *user_context);
+
+struct halide_memory_pool_stats_t {
+    /** The number of allocations served from the pool, and the number
+     * that had to go to the system allocator. Allocations too large
+     * for any size class are not counted. */
+    uint64_t hits, misses;
+
+    /** The number of blocks returned to the system allocator because
+     * the pool was full or was released. */
+    uint64_t releases;
+
+    /** The current and peak number of bytes held by the pool. */
+    int64_t current_size, peak_size;
+};
+
+/** Get the hit, miss, and release counts of the pool, along with its
+ * occupancy. The counters accumulate from program start. They are also
+ * printed by halide_profiler_report. */
+extern void halide_memory_pool_get_stats(struct halide_memory_pool_stats_t *stats);
+//@}
+
 /** Halide calls these functions to interact with the underlying
  * system runtime functions. To replace in AOT code on platforms that
  * support weak linking, define these functions yourself, or use
@@ -381,9 +448,12 @@ struct halide_trace_event_t {
  * trace_realization. See Func::set_custom_trace. The default
  * implementation either prints events via halide_print, or if
  * HL_TRACE_FILE is defined, dumps the trace to that file in a
- * sequence of trace packets. The header for a trace packet is defined
- * below. If the trace is going to be large, you may want to make the
- * file a named pipe, and then read from that pipe into gzip.
+ * compact binary format, from which readers reconstruct a sequence of
+ * trace packets. The header for a trace packet and the format of the
+ * file are defined below. The file is written by a background thread,
+ * and is complete up to each end_pipeline event when it is traced. If
+ * the trace is going to be large, you may want to make the file a
+ * named pipe, and then read from that pipe into gzip.
  *
  * halide_trace returns a unique ID which will be passed to future
  * events that "belong" to the earlier event as the parent id. The
@@ -499,7 +569,64 @@ struct halide_trace_packet_t {
     #endif
 };
 
+/** Binary traces written by halide_default_trace are a sequence of
+ * chunks, each of which starts with this header and is followed by
+ * 'size' bytes of compactly encoded packets. Each thread fills its
+ * own chunk, so the packets of one thread appear in the order they
+ * happened, but chunks of different threads are interleaved
+ * arbitrarily. To put them back in order, every packet carries an
+ * epoch: the count of events other than loads and stores that had
+ * been traced when it happened. Each such event increments the epoch,
+ * so it is the only one at its epoch, and it precedes the loads and
+ * stores at the same epoch.
+ *
+ * The first word of a chunk is halide_trace_chunk_magic, which is
+ * never a valid packet size, so readers can tell chunks apart from
+ * plain halide_trace_packet_t structs.
+ *
+ * Within a chunk, each packet is encoded relative to the one before
+ * it (for the first one, relative to all zeros and empty names), using
+ * varints of 7 bits per byte, least significant first, with the high
+ * bit set on all bytes but the last. Signed differences are zig-zag
+ * encoded. A packet is:
+ * - A byte of halide_trace_chunk_flags_t.
+ * - The difference between its epoch and the previous one.
+ * - The difference between its id and the previous one.
+ * - If halide_trace_chunk_new_parent, the difference between its
+ *   parent_id and the previous one.
+ * - If halide_trace_chunk_new_header, the type code and bits as one
+ *   byte each, then the lanes, event, value_index and dimensions as
+ *   varints.
+ * - Its coordinates, as differences from the coordinates of the
+ *   previous packet if halide_trace_chunk_delta_coordinates, and from
+ *   zero otherwise.
+ * - The bytes of its value.
+ * - If halide_trace_chunk_new_names, its func and trace_tag, each
+ *   null-terminated.
+ */
+struct halide_trace_chunk_t {
+    /** Always halide_trace_chunk_magic. */
+    uint32_t magic;
 
+    /** The number of bytes of packets following this header. */
+    uint32_t size;
+
+    /** The number of packets in the chunk. */
+    uint32_t packets;
+
+    /** No packet in a later chunk has an epoch before this one. */
+    uint32_t horizon;
+};
+
+#define halide_trace_chunk_magic 0xc0de7acfu
+
+/** Which fields of a packet in a chunk differ from the previous packet. */
+enum halide_trace_chunk_flags_t {
+    halide_trace_chunk_new_names = 1,
+    halide_trace_chunk_new_header = 2,
+    halide_trace_chunk_new_parent = 4,
+    halide_trace_chunk_delta_coordinates = 8
+};
 
 /** Set the file descriptor that Halide should write binary trace
  * events to. If called with 0 as the argument, Halide outputs trace
@@ -768,6 +895,53 @@ extern void halide_memoization_cache_release(void *user_context, void *host);
  */
 extern void halide_memoization_cache_cleanup();
 
+/** Counters describing the behavior of the memoization cache, as
+ * returned by halide_memoization_cache_get_stats. */
+struct halide_memoization_cache_stats_t {
+    /** The number of calls to halide_memoization_cache_lookup that
+     * found a matching entry, and the number that did not. */
+    uint64_t hits, misses;
+
+    /** The number of entries removed to keep the cache within its
+     * size budget. */
+    uint64_t evictions;
+
+    /** The number of entries currently in the cache. */
+    uint64_t entries;
+
+    /** The current and maximum size of the cache, in bytes. */
+    int64_t current_size, max_size;
+};
+
+/** Get the current hit, miss, and eviction counts of the memoization
+ * cache, along with its occupancy. The counters accumulate from
+ * program start, or from the last call to
+ * halide_memoization_cache_reset_stats or
+ * halide_memoization_cache_cleanup. */
+extern void halide_memoization_cache_get_stats(struct halide_memoization_cache_stats_t *stats);
+
+/** Reset the hit, miss, and eviction counters of the memoization
+ * cache to zero. */
+extern void halide_memoization_cache_reset_stats();
+
+/** The policies the memoization cache can use to decide which entries
+ * to evict when it exceeds its size budget. */
+typedef enum halide_memoization_cache_eviction_policy_t {
+    /** Evict the least recently used entry. This is the default. */
+    halide_memoization_cache_evict_lru = 0,
+
+    /** Record how long each entry took to compute, and of the few
+     * least recently used entries, evict the one that is cheapest to
+     * recompute per byte of storage. This favors keeping results that
+     * are expensive to recompute, at the cost of reading the clock on
+     * each cache miss and store. */
+    halide_memoization_cache_evict_cost_aware = 1,
+} halide_memoization_cache_eviction_policy_t;
+
+/** Set the policy the memoization cache uses to evict entries. Only
+ * entries stored after this call have their compute cost recorded. */
+extern void halide_memoization_cache_set_eviction_policy(halide_memoization_cache_eviction_policy_t policy);
+
 /** Create a unique file with a name of the form prefixXXXXXsuffix in an arbitrary
  * (but writable) directory; this is typically $TMP or /tmp, but the specific
  * location is not guaranteed. (Note that the exact form of the file name
@@ -1137,7 +1311,14 @@ typedef enum halide_target_feature_t {
     halide_target_feature_tsan = 52, ///< Enable hooks for TSAN support.
     halide_target_feature_asan = 53, ///< Enable hooks for ASAN support.
     halide_target_feature_d3d12compute = 54, ///< Enable Direct3D 12 Compute runtime.
-    halide_target_feature_end = 55 ///< A sentinel. Every target is considered to have this feature, and setting this feature does nothing.
+    halide_target_feature_plan_memory = 55, ///< Pack the heap allocations of the pipeline into a single block of memory, allocated once per call.
+    halide_target_feature_profile_counters = 56, ///< Like profile, but also read hardware performance counters (cycles, instructions, cache misses) on each thread, and report them per Func. Linux x86 only.
+    halide_target_feature_profile_timeline = 57, ///< Like profile, but also record when each thread starts and finishes each Func and each parallel task, and write the timeline out as Chrome trace JSON.
+    halide_target_feature_avx512_cascadelake = 58, ///< Enable the AVX512 features supported by Cascade Lake Xeon server processors. This adds AVX512-VNNI (dot products of 8-bit and 16-bit values) to the Skylake set.
+    halide_target_feature_arm_dot_prod = 59, ///< Enable the ARMv8.2-a dot product instructions (udot and sdot).
+    halide_target_feature_fast_transcendentals = 60, ///< Use lower-degree polynomials for vectorized exp, log, pow, sin, cos and atan2, trading accuracy for speed.
+    halide_target_feature_fast_compile = 61, ///< Run fewer llvm optimization passes and generate machine code at a lower optimization level, making code that compiles faster but runs slower.
+    halide_target_feature_end = 62 ///< A sentinel. Every target is considered to have this feature, and setting this feature does nothing.
 } halide_target_feature_t;
 
 /** This function is called internally by Halide in some situations to determine
@@ -1503,6 +1684,12 @@ struct halide_profiler_func_stats {
     /** The average number of thread pool worker threads active while computing this Func. */
     uint64_t active_threads_numerator, active_threads_denominator;
 
+    /** The number of cycles, instructions retired, and last-level
+     * cache misses counted by the threads computing this Func, summed
+     * over all threads. Only gathered by pipelines compiled with the
+     * -profile_counters target flag. */
+    uint64_t cycles, instructions, llc_misses;
+
     /** The name of this Func. A global constant string. */
     const char *name;
 
@@ -1555,6 +1742,32 @@ struct halide_profiler_pipeline_stats {
     int num_allocs;
 };
 
+/** Hardware counters gathered for one thread by pipelines compiled
+ * with the -profile_counters target flag. */
+struct halide_profiler_thread_stats {
+    /** The number of cycles, instructions retired, and last-level
+     * cache misses counted on this thread while it ran Halide code. */
+    uint64_t cycles, instructions, llc_misses;
+
+    /** The counter values when the thread last changed Func. */
+    uint64_t last_cycles, last_instructions, last_llc_misses;
+
+    /** The pipeline stats and index of the Func the thread is
+     * running, which will be billed for the counts since the last
+     * change. The pipeline is null when the thread is outside of
+     * Halide code. */
+    struct halide_profiler_pipeline_stats *pipeline;
+    int func;
+
+    /** The file descriptor of the group of counters for this thread,
+     * or negative if they could not be opened. */
+    int fd;
+
+    /** The id of the operating system thread, or zero if this entry
+     * is unused. */
+    int thread;
+};
+
 /** The global state of the profiler. */
 
 struct halide_profiler_state {
@@ -1587,6 +1800,12 @@ struct halide_profiler_state {
 
     /** Sampling thread reference to be joined at shutdown. */
     struct halide_thread *sampling_thread;
+
+    /** A table of hardware counters for each thread, filled in by
+     * pipelines compiled with the -profile_counters target flag. Null
+     * if there are none. Unused entries have a thread id of zero. */
+    struct halide_profiler_thread_stats *threads;
+    int num_threads;
 };
 
 /** Profiler func ids with special meanings. */
@@ -1626,6 +1845,17 @@ void halide_profiler_shutdown();
  * reset. Also happens at process exit. */
 extern void halide_profiler_report(void *user_context);
 
+/** Write the timeline recorded by pipelines compiled with the
+ * -profile_timeline target flag to a file, as JSON in the Chrome
+ * Trace Event format, which can be viewed in chrome://tracing. There
+ * is a row for each thread, with spans for each Func it computed,
+ * each task of a parallel loop it ran, and the time it waited to
+ * start on a parallel loop after the loop was enqueued.
+ * halide_profiler_report also writes the timeline, to the file named
+ * by the environment variable HL_TIMELINE_FILE, or
+ * halide_timeline.json by default. Returns zero on success. */
+extern int halide_profiler_write_timeline(void *user_context, const char *filename);
+
 /// \name "Float16" functions
 /// These functions operate of bits (``uint16_t``) representing a half
 /// precision floating point number (IEEE-754 2008 binary16).
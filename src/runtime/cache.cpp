@@ -80,6 +80,12 @@ struct CacheEntry {
     halide_dimension_t *computed_bounds;
     // The actual stored data.
     halide_buffer_t *buf;
+    // The total size of the stored data in bytes.
+    size_t size_in_bytes;
+    // How long it took to compute the stored data, in
+    // nanoseconds. Only measured when using the cost-aware eviction
+    // policy, zero otherwise.
+    uint64_t cost_ns;
 
     bool init(const uint8_t *cache_key, size_t cache_key_size,
               uint32_t key_hash,
@@ -93,6 +99,9 @@ struct CacheEntry {
 struct CacheBlockHeader {
     CacheEntry *entry;
     uint32_t hash;
+    // The time of the cache miss that led to this block being
+    // allocated, or zero if compute costs are not being tracked.
+    uint64_t miss_time_ns;
 };
 
 // Each host block has extra space to store a header just before the
@@ -121,6 +130,8 @@ WEAK bool CacheEntry::init(const uint8_t *cache_key, size_t cache_key_size,
     in_use_count = 0;
     tuple_count = tuples;
     dimensions = computed_bounds_buf->dimensions;
+    size_in_bytes = 0;
+    cost_ns = 0;
 
     // Allocate all the necessary space (or die)
     size_t storage_bytes = 0;
@@ -165,6 +176,7 @@ WEAK bool CacheEntry::init(const uint8_t *cache_key, size_t cache_key_size,
         for (int j = 0; j < dimensions; j++) {
             buf[i].dim[j] = tuple_buffers[i]->dim[j];
         }
+        size_in_bytes += buf[i].size_in_bytes();
     }
     return true;
 }
@@ -177,35 +189,295 @@ WEAK void CacheEntry::destroy() {
     halide_free(NULL, metadata_storage);
 }
 
-WEAK uint32_t djb_hash(const uint8_t *key, size_t key_size)  {
-    uint32_t h = 5381;
-    for (size_t i = 0; i < key_size; i++) {
-        h = (h << 5) + h + key[i];
+// Hash a cache key a 64-bit word at a time (the mixing function from
+// MurmurHash64A). Cache keys are typically a few dozen bytes of
+// names and scalar parameter values, so this is several times faster
+// than hashing a byte at a time.
+WEAK uint32_t hash_key(const uint8_t *key, size_t key_size) {
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
+    const int r = 47;
+    uint64_t h = 0x8445d61a4e774912ULL ^ ((uint64_t)key_size * m);
+
+    size_t words = key_size / sizeof(uint64_t);
+    for (size_t i = 0; i < words; i++) {
+        uint64_t k;
+        memcpy(&k, key + i * sizeof(uint64_t), sizeof(k));
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+
+    const uint8_t *tail = key + words * sizeof(uint64_t);
+    size_t tail_size = key_size & (sizeof(uint64_t) - 1);
+    if (tail_size) {
+        uint64_t k = 0;
+        for (size_t i = tail_size; i > 0; i--) {
+            k = (k << 8) | tail[i - 1];
+        }
+        h ^= k;
+        h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+// The cache is split into independently locked shards, selected by
+// the low bits of the key hash, so that threads looking up different
+// keys rarely contend. Each shard has its own hash table, which grows
+// as entries are added, and its own LRU list. The size budget is
+// shared by all the shards.
+const int kCacheShardBits = 4;
+const int kCacheShards = 1 << kCacheShardBits;
+const size_t kInitialShardBuckets = 16;
+
+// When using the cost-aware eviction policy, this many of the least
+// recently used entries are considered for each eviction.
+const int kEvictionSampleSize = 8;
+
+struct CacheShard {
+    halide_mutex lock;
+
+    // The hash table. Allocated on the first store. Always a power of
+    // two in size.
+    CacheEntry **buckets;
+    size_t bucket_count;
+    size_t entry_count;
+
+    CacheEntry *most_recently_used;
+    CacheEntry *least_recently_used;
+
+    // Statistics, reported by halide_memoization_cache_get_stats.
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+
+    CacheEntry **bucket(uint32_t h) {
+        return &buckets[(h >> kCacheShardBits) & (bucket_count - 1)];
+    }
+
+    void insert(CacheEntry *entry);
+    void remove(CacheEntry *entry);
+    void make_most_recent(CacheEntry *entry);
+    bool grow();
+    CacheEntry *pick_victim();
+    void prune();
+    void clear();
+#if CACHE_DEBUGGING
+    void validate();
+#endif
+} __attribute__((aligned(64)));
+
+WEAK CacheShard cache_shards[kCacheShards];
+
+const int64_t kDefaultCacheSize = 1 << 20;
+
+// The budget and current size are measured in bytes of host memory,
+// so a pointer-sized integer suffices and can be updated atomically
+// on all targets.
+WEAK intptr_t max_cache_size = kDefaultCacheSize;
+WEAK intptr_t current_cache_size = 0;
+
+WEAK halide_memoization_cache_eviction_policy_t eviction_policy = halide_memoization_cache_evict_lru;
+
+WEAK __attribute((always_inline)) CacheShard *shard_for_hash(uint32_t h) {
+    return &cache_shards[h & (kCacheShards - 1)];
+}
+
+WEAK __attribute((always_inline)) bool cache_over_budget() {
+    return __atomic_load_n(&current_cache_size, __ATOMIC_RELAXED) >
+        __atomic_load_n(&max_cache_size, __ATOMIC_RELAXED);
+}
+
+WEAK bool CacheShard::grow() {
+    size_t new_bucket_count = bucket_count ? bucket_count * 2 : kInitialShardBuckets;
+    CacheEntry **new_buckets = (CacheEntry **)halide_malloc(NULL, new_bucket_count * sizeof(CacheEntry *));
+    if (!new_buckets) {
+        return false;
+    }
+    for (size_t i = 0; i < new_bucket_count; i++) {
+        new_buckets[i] = NULL;
+    }
+
+    CacheEntry **old_buckets = buckets;
+    size_t old_bucket_count = bucket_count;
+    buckets = new_buckets;
+    bucket_count = new_bucket_count;
+
+    // Rehash the existing entries.
+    for (size_t i = 0; i < old_bucket_count; i++) {
+        CacheEntry *entry = old_buckets[i];
+        while (entry != NULL) {
+            CacheEntry *next = entry->next;
+            CacheEntry **b = bucket(entry->hash);
+            entry->next = *b;
+            *b = entry;
+            entry = next;
+        }
+    }
+    if (old_buckets) {
+        halide_free(NULL, old_buckets);
+    }
+    return true;
+}
+
+WEAK void CacheShard::insert(CacheEntry *entry) {
+    // Keep the average chain length at most two. If we can't grow
+    // the table, just keep using the current one.
+    if (entry_count >= bucket_count * 2) {
+        grow();
+    }
+
+    CacheEntry **b = bucket(entry->hash);
+    entry->next = *b;
+    *b = entry;
+
+    entry->more_recent = NULL;
+    entry->less_recent = most_recently_used;
+    if (most_recently_used != NULL) {
+        most_recently_used->more_recent = entry;
+    }
+    most_recently_used = entry;
+    if (least_recently_used == NULL) {
+        least_recently_used = entry;
+    }
+    entry_count++;
+}
+
+WEAK void CacheShard::remove(CacheEntry *entry) {
+    // Remove from hash table
+    CacheEntry **prev = bucket(entry->hash);
+    while (*prev != NULL && *prev != entry) {
+        prev = &((*prev)->next);
+    }
+    halide_assert(NULL, *prev != NULL);
+    *prev = entry->next;
+
+    // Remove from the recency list
+    if (entry->more_recent != NULL) {
+        entry->more_recent->less_recent = entry->less_recent;
+    } else {
+        halide_assert(NULL, most_recently_used == entry);
+        most_recently_used = entry->less_recent;
+    }
+    if (entry->less_recent != NULL) {
+        entry->less_recent->more_recent = entry->more_recent;
+    } else {
+        halide_assert(NULL, least_recently_used == entry);
+        least_recently_used = entry->more_recent;
     }
-    return h;
+    entry_count--;
 }
 
-WEAK halide_mutex memoization_lock = { { 0 } };
+WEAK void CacheShard::make_most_recent(CacheEntry *entry) {
+    if (entry == most_recently_used) {
+        return;
+    }
+    halide_assert(NULL, entry->more_recent != NULL);
+    if (entry->less_recent != NULL) {
+        entry->less_recent->more_recent = entry->more_recent;
+    } else {
+        halide_assert(NULL, least_recently_used == entry);
+        least_recently_used = entry->more_recent;
+    }
+    entry->more_recent->less_recent = entry->less_recent;
 
-const size_t kHashTableSize = 256;
+    entry->more_recent = NULL;
+    entry->less_recent = most_recently_used;
+    if (most_recently_used != NULL) {
+        most_recently_used->more_recent = entry;
+    }
+    most_recently_used = entry;
+}
 
-WEAK CacheEntry *cache_entries[kHashTableSize];
+WEAK CacheEntry *CacheShard::pick_victim() {
+    // Entries currently in use by a caller can't be evicted.
+    CacheEntry *candidate = least_recently_used;
+    while (candidate != NULL && candidate->in_use_count != 0) {
+        candidate = candidate->more_recent;
+    }
+    if (candidate == NULL ||
+        eviction_policy != halide_memoization_cache_evict_cost_aware) {
+        return candidate;
+    }
+
+    // Of the few least recently used entries, evict the one that is
+    // cheapest to recompute per byte of storage it would free.
+    CacheEntry *victim = candidate;
+    float victim_cost = (float)victim->cost_ns / (float)(victim->size_in_bytes + 1);
+    int sampled = 1;
+    for (candidate = candidate->more_recent;
+         candidate != NULL && sampled < kEvictionSampleSize;
+         candidate = candidate->more_recent) {
+        if (candidate->in_use_count != 0) {
+            continue;
+        }
+        sampled++;
+        float cost = (float)candidate->cost_ns / (float)(candidate->size_in_bytes + 1);
+        if (cost < victim_cost) {
+            victim = candidate;
+            victim_cost = cost;
+        }
+    }
+    return victim;
+}
 
-WEAK CacheEntry *most_recently_used = NULL;
-WEAK CacheEntry *least_recently_used = NULL;
+WEAK void CacheShard::prune() {
+#if CACHE_DEBUGGING
+    validate();
+#endif
+    while (cache_over_budget()) {
+        CacheEntry *victim = pick_victim();
+        if (victim == NULL) {
+            break;
+        }
+        remove(victim);
+        __atomic_sub_fetch(&current_cache_size, (intptr_t)victim->size_in_bytes, __ATOMIC_RELAXED);
+        evictions++;
 
-const uint64_t kDefaultCacheSize = 1 << 20;
-WEAK int64_t max_cache_size = kDefaultCacheSize;
-WEAK int64_t current_cache_size = 0;
+        // Deallocate the entry.
+        victim->destroy();
+        halide_free(NULL, victim);
+    }
+#if CACHE_DEBUGGING
+    validate();
+#endif
+}
+
+WEAK void CacheShard::clear() {
+    for (size_t i = 0; i < bucket_count; i++) {
+        CacheEntry *entry = buckets[i];
+        while (entry != NULL) {
+            CacheEntry *next = entry->next;
+            __atomic_sub_fetch(&current_cache_size, (intptr_t)entry->size_in_bytes, __ATOMIC_RELAXED);
+            entry->destroy();
+            halide_free(NULL, entry);
+            entry = next;
+        }
+    }
+    if (buckets) {
+        halide_free(NULL, buckets);
+    }
+    buckets = NULL;
+    bucket_count = 0;
+    entry_count = 0;
+    most_recently_used = NULL;
+    least_recently_used = NULL;
+    hits = misses = evictions = 0;
+}
 
 #if CACHE_DEBUGGING
-WEAK void validate_cache() {
-    print(NULL) << "validating cache, "
-                << "current size " << current_cache_size
-                << " of maximum " << max_cache_size << "\n";
-    int entries_in_hash_table = 0;
-    for (size_t i = 0; i < kHashTableSize; i++) {
-        CacheEntry *entry = cache_entries[i];
+WEAK void CacheShard::validate() {
+    print(NULL) << "validating cache shard " << (int)(this - cache_shards) << ", "
+                << "current size " << (int64_t)current_cache_size
+                << " of maximum " << (int64_t)max_cache_size << "\n";
+    size_t entries_in_hash_table = 0;
+    for (size_t i = 0; i < bucket_count; i++) {
+        CacheEntry *entry = buckets[i];
         while (entry != NULL) {
             entries_in_hash_table++;
             if (entry->more_recent == NULL && entry != most_recently_used) {
@@ -219,22 +491,23 @@ WEAK void validate_cache() {
             entry = entry->next;
         }
     }
-    int entries_from_mru = 0;
+    size_t entries_from_mru = 0;
     CacheEntry *mru_chain = most_recently_used;
     while (mru_chain != NULL) {
         entries_from_mru++;
         mru_chain = mru_chain->less_recent;
     }
-    int entries_from_lru = 0;
+    size_t entries_from_lru = 0;
     CacheEntry *lru_chain = least_recently_used;
     while (lru_chain != NULL) {
         entries_from_lru++;
         lru_chain = lru_chain->more_recent;
     }
-    print(NULL) << "hash entries " << entries_in_hash_table
-                << ", mru entries " << entries_from_mru
-                << ", lru entries " << entries_from_lru << "\n";
-    if (entries_in_hash_table != entries_from_mru) {
+    print(NULL) << "hash entries " << (uint64_t)entries_in_hash_table
+                << ", mru entries " << (uint64_t)entries_from_mru
+                << ", lru entries " << (uint64_t)entries_from_lru << "\n";
+    if (entries_in_hash_table != entries_from_mru ||
+        entries_in_hash_table != entry_count) {
         halide_print(NULL, "cache invalid case 3\n");
         __builtin_trap();
     }
@@ -249,62 +522,35 @@ WEAK void validate_cache() {
 }
 #endif
 
-WEAK void prune_cache() {
-#if CACHE_DEBUGGING
-    validate_cache();
-#endif
-    CacheEntry *prune_candidate = least_recently_used;
-    while (current_cache_size > max_cache_size &&
-           prune_candidate != NULL) {
-        CacheEntry *more_recent = prune_candidate->more_recent;
-
-        if (prune_candidate->in_use_count == 0) {
-            uint32_t h = prune_candidate->hash;
-            uint32_t index = h % kHashTableSize;
-
-            // Remove from hash table
-            CacheEntry *prev_hash_entry = cache_entries[index];
-            if (prev_hash_entry == prune_candidate) {
-                cache_entries[index] = prune_candidate->next;
-            } else {
-                while (prev_hash_entry != NULL && prev_hash_entry->next != prune_candidate) {
-                    prev_hash_entry = prev_hash_entry->next;
-                }
-                halide_assert(NULL, prev_hash_entry != NULL);
-                prev_hash_entry->next = prune_candidate->next;
-            }
-
-            // Remove from less recent chain.
-            if (least_recently_used == prune_candidate) {
-                least_recently_used = more_recent;
-            }
-            if (more_recent != NULL) {
-                more_recent->less_recent = prune_candidate->less_recent;
-            }
-
-            // Remove from more recent chain.
-            if (most_recently_used == prune_candidate) {
-                most_recently_used = prune_candidate->less_recent;
-            }
-            if (prune_candidate->less_recent != NULL) {
-                prune_candidate->less_recent = more_recent;
-            }
+// Prune shards other than the given one (which may be NULL) until
+// the cache is back within budget. Takes each shard's lock in turn,
+// so the caller must not hold any of them.
+WEAK void prune_other_shards(CacheShard *skip) {
+    for (int i = 0; i < kCacheShards && cache_over_budget(); i++) {
+        CacheShard *shard = &cache_shards[i];
+        if (shard == skip) continue;
+        ScopedMutexLock lock(&shard->lock);
+        shard->prune();
+    }
+}
 
-            // Decrease cache used amount.
-            for (uint32_t i = 0; i < prune_candidate->tuple_count; i++) {
-                current_cache_size -= prune_candidate->buf[i].size_in_bytes();
-            }
+WEAK bool entry_matches(CacheEntry *entry, uint32_t h, const uint8_t *cache_key, int32_t size,
+                        halide_buffer_t *computed_bounds,
+                        int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    if (entry->hash != h || entry->key_size != (size_t)size ||
+        !keys_equal(entry->key, cache_key, size) ||
+        !buffer_has_shape(computed_bounds, entry->computed_bounds) ||
+        entry->tuple_count != (uint32_t)tuple_count) {
+        return false;
+    }
 
-            // Deallocate the entry.
-            prune_candidate->destroy();
-            halide_free(NULL, prune_candidate);
+    // Check all the tuple buffers have the same bounds (they should).
+    for (int32_t i = 0; i < tuple_count; i++) {
+        if (!buffer_has_shape(tuple_buffers[i], entry->buf[i].dim)) {
+            return false;
         }
-
-        prune_candidate = more_recent;
     }
-#if CACHE_DEBUGGING
-    validate_cache();
-#endif
+    return true;
 }
 
 }}} // namespace Halide::Runtime::Internal
@@ -316,64 +562,45 @@ WEAK void halide_memoization_cache_set_size(int64_t size) {
         size = kDefaultCacheSize;
     }
 
-    ScopedMutexLock lock(&memoization_lock);
+    // Clamp the budget to the address space.
+    const int64_t largest = (int64_t)(((uintptr_t)-1) >> 1);
+    if (size > largest) {
+        size = largest;
+    }
 
-    max_cache_size = size;
-    prune_cache();
+    __atomic_store_n(&max_cache_size, (intptr_t)size, __ATOMIC_RELAXED);
+    prune_other_shards(NULL);
+}
+
+WEAK void halide_memoization_cache_set_eviction_policy(halide_memoization_cache_eviction_policy_t policy) {
+    eviction_policy = policy;
 }
 
 WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cache_key, int32_t size,
                                          halide_buffer_t *computed_bounds, int32_t tuple_count, halide_buffer_t **tuple_buffers) {
-    uint32_t h = djb_hash(cache_key, size);
-    uint32_t index = h % kHashTableSize;
+    uint32_t h = hash_key(cache_key, size);
+    CacheShard *shard = shard_for_hash(h);
 
-    ScopedMutexLock lock(&memoization_lock);
+    {
+        ScopedMutexLock lock(&shard->lock);
 
 #if CACHE_DEBUGGING
-    debug_print_key(user_context, "halide_memoization_cache_lookup", cache_key, size);
+        debug_print_key(user_context, "halide_memoization_cache_lookup", cache_key, size);
 
-    debug_print_buffer(user_context, "computed_bounds", *computed_bounds);
+        debug_print_buffer(user_context, "computed_bounds", *computed_bounds);
 
-    {
-        for (int32_t i = 0; i < tuple_count; i++) {
-            halide_buffer_t *buf = tuple_buffers[i];
-            debug_print_buffer(user_context, "Allocation bounds", *buf);
+        {
+            for (int32_t i = 0; i < tuple_count; i++) {
+                halide_buffer_t *buf = tuple_buffers[i];
+                debug_print_buffer(user_context, "Allocation bounds", *buf);
+            }
         }
-    }
 #endif
 
-    CacheEntry *entry = cache_entries[index];
-    while (entry != NULL) {
-        if (entry->hash == h && entry->key_size == (size_t)size &&
-            keys_equal(entry->key, cache_key, size) &&
-            buffer_has_shape(computed_bounds, entry->computed_bounds) &&
-            entry->tuple_count == (uint32_t)tuple_count) {
-
-            // Check all the tuple buffers have the same bounds (they should).
-            bool all_bounds_equal = true;
-            for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
-                all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
-            }
-
-            if (all_bounds_equal) {
-                if (entry != most_recently_used) {
-                    halide_assert(user_context, entry->more_recent != NULL);
-                    if (entry->less_recent != NULL) {
-                        entry->less_recent->more_recent = entry->more_recent;
-                    } else {
-                        halide_assert(user_context, least_recently_used == entry);
-                        least_recently_used = entry->more_recent;
-                    }
-                    halide_assert(user_context, entry->more_recent != NULL);
-                    entry->more_recent->less_recent = entry->less_recent;
-
-                    entry->more_recent = NULL;
-                    entry->less_recent = most_recently_used;
-                    if (most_recently_used != NULL) {
-                        most_recently_used->more_recent = entry;
-                    }
-                    most_recently_used = entry;
-                }
+        CacheEntry *entry = shard->buckets ? *shard->bucket(h) : NULL;
+        while (entry != NULL) {
+            if (entry_matches(entry, h, cache_key, size, computed_bounds, tuple_count, tuple_buffers)) {
+                shard->make_most_recent(entry);
 
                 for (int32_t i = 0; i < tuple_count; i++) {
                     halide_buffer_t *buf = tuple_buffers[i];
@@ -381,11 +608,23 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
                 }
 
                 entry->in_use_count += tuple_count;
+                shard->hits++;
 
                 return 0;
             }
+            entry = entry->next;
         }
-        entry = entry->next;
+
+        shard->misses++;
+    }
+
+    // On a miss, allocate the buffers to compute into without
+    // holding the shard lock.
+    uint64_t miss_time_ns = 0;
+    if (eviction_policy == halide_memoization_cache_evict_cost_aware) {
+        miss_time_ns = halide_current_time_ns(user_context);
+        // Zero means "not measured".
+        if (miss_time_ns == 0) miss_time_ns = 1;
     }
 
     for (int32_t i = 0; i < tuple_count; i++) {
@@ -403,12 +642,9 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
         CacheBlockHeader *header = get_pointer_to_header(buf->host);
         header->hash = h;
         header->entry = NULL;
+        header->miss_time_ns = miss_time_ns;
     }
 
-#if CACHE_DEBUGGING
-    validate_cache();
-#endif
-
     return 1;
 }
 
@@ -417,107 +653,97 @@ WEAK int halide_memoization_cache_store(void *user_context, const uint8_t *cache
                                         int32_t tuple_count, halide_buffer_t **tuple_buffers) {
     debug(user_context) << "halide_memoization_cache_store\n";
 
-    uint32_t h = get_pointer_to_header(tuple_buffers[0]->host)->hash;
+    CacheBlockHeader *first_header = get_pointer_to_header(tuple_buffers[0]->host);
+    uint32_t h = first_header->hash;
+    uint64_t cost_ns = 0;
+    if (first_header->miss_time_ns != 0) {
+        cost_ns = halide_current_time_ns(user_context) - first_header->miss_time_ns;
+    }
 
-    uint32_t index = h % kHashTableSize;
+    CacheShard *shard = shard_for_hash(h);
 
-    ScopedMutexLock lock(&memoization_lock);
+    {
+        ScopedMutexLock lock(&shard->lock);
 
 #if CACHE_DEBUGGING
-    debug_print_key(user_context, "halide_memoization_cache_store", cache_key, size);
+        debug_print_key(user_context, "halide_memoization_cache_store", cache_key, size);
 
-    debug_print_buffer(user_context, "computed_bounds", *computed_bounds);
+        debug_print_buffer(user_context, "computed_bounds", *computed_bounds);
 
-    {
-        for (int32_t i = 0; i < tuple_count; i++) {
-            halide_buffer_t *buf = tuple_buffers[i];
-            debug_print_buffer(user_context, "Allocation bounds", *buf);
+        {
+            for (int32_t i = 0; i < tuple_count; i++) {
+                halide_buffer_t *buf = tuple_buffers[i];
+                debug_print_buffer(user_context, "Allocation bounds", *buf);
+            }
         }
-    }
 #endif
 
-    CacheEntry *entry = cache_entries[index];
-    while (entry != NULL) {
-        if (entry->hash == h && entry->key_size == (size_t)size &&
-            keys_equal(entry->key, cache_key, size) &&
-            buffer_has_shape(computed_bounds, entry->computed_bounds) &&
-            entry->tuple_count == (uint32_t)tuple_count) {
-
-            bool all_bounds_equal = true;
-            bool no_host_pointers_equal = true;
-            {
-                for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
-                    halide_buffer_t *buf = tuple_buffers[i];
-                    all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
-                    if (entry->buf[i].host == buf->host) {
-                        no_host_pointers_equal = false;
-                    }
+        CacheEntry *entry = shard->buckets ? *shard->bucket(h) : NULL;
+        while (entry != NULL) {
+            if (entry_matches(entry, h, cache_key, size, computed_bounds, tuple_count, tuple_buffers)) {
+                for (int32_t i = 0; i < tuple_count; i++) {
+                    halide_assert(user_context, entry->buf[i].host != tuple_buffers[i]->host);
                 }
-            }
-            if (all_bounds_equal) {
-                halide_assert(user_context, no_host_pointers_equal);
                 // This entry is still in use by the caller. Mark it as having no cache entry
                 // so halide_memoization_cache_release can free the buffer.
                 for (int32_t i = 0; i < tuple_count; i++) {
                     get_pointer_to_header(tuple_buffers[i]->host)->entry = NULL;
-
                 }
                 return 0;
             }
+            entry = entry->next;
         }
-        entry = entry->next;
-    }
 
-    uint64_t added_size = 0;
-    {
-        for (int32_t i = 0; i < tuple_count; i++) {
-            halide_buffer_t *buf = tuple_buffers[i];
-            added_size += buf->size_in_bytes();
+        uint64_t added_size = 0;
+        {
+            for (int32_t i = 0; i < tuple_count; i++) {
+                halide_buffer_t *buf = tuple_buffers[i];
+                added_size += buf->size_in_bytes();
+            }
         }
-    }
-    current_cache_size += added_size;
-    prune_cache();
-
-    CacheEntry *new_entry = (CacheEntry *)halide_malloc(NULL, sizeof(CacheEntry));
-    bool inited = false;
-    if (new_entry) {
-        inited = new_entry->init(cache_key, size, h, computed_bounds, tuple_count, tuple_buffers);
-    }
-    if (!inited) {
-        current_cache_size -= added_size;
+        __atomic_add_fetch(&current_cache_size, (intptr_t)added_size, __ATOMIC_RELAXED);
+        shard->prune();
 
-        // This entry is still in use by the caller. Mark it as having no cache entry
-        // so halide_memoization_cache_release can free the buffer.
-        for (int32_t i = 0; i < tuple_count; i++) {
-            get_pointer_to_header(tuple_buffers[i]->host)->entry = NULL;
+        CacheEntry *new_entry = (CacheEntry *)halide_malloc(NULL, sizeof(CacheEntry));
+        bool inited = false;
+        if (new_entry) {
+            inited = new_entry->init(cache_key, size, h, computed_bounds, tuple_count, tuple_buffers);
         }
+        if (!inited) {
+            __atomic_sub_fetch(&current_cache_size, (intptr_t)added_size, __ATOMIC_RELAXED);
 
-        if (new_entry) {
-            halide_free(user_context, new_entry);
+            // This entry is still in use by the caller. Mark it as having no cache entry
+            // so halide_memoization_cache_release can free the buffer.
+            for (int32_t i = 0; i < tuple_count; i++) {
+                get_pointer_to_header(tuple_buffers[i]->host)->entry = NULL;
+            }
+
+            if (new_entry) {
+                halide_free(user_context, new_entry);
+            }
+            return 0;
         }
-        return 0;
-    }
 
-    new_entry->next = cache_entries[index];
-    new_entry->less_recent = most_recently_used;
-    if (most_recently_used != NULL) {
-        most_recently_used->more_recent = new_entry;
-    }
-    most_recently_used = new_entry;
-    if (least_recently_used == NULL) {
-        least_recently_used = new_entry;
-    }
-    cache_entries[index] = new_entry;
+        new_entry->cost_ns = cost_ns;
+        shard->insert(new_entry);
 
-    new_entry->in_use_count = tuple_count;
+        new_entry->in_use_count = tuple_count;
 
-    for (int32_t i = 0; i < tuple_count; i++) {
-        get_pointer_to_header(tuple_buffers[i]->host)->entry = new_entry;
-    }
+        for (int32_t i = 0; i < tuple_count; i++) {
+            get_pointer_to_header(tuple_buffers[i]->host)->entry = new_entry;
+        }
 
 #if CACHE_DEBUGGING
-    validate_cache();
+        shard->validate();
 #endif
+    }
+
+    // If this shard alone couldn't free enough space, evict from the
+    // others.
+    if (cache_over_budget()) {
+        prune_other_shards(shard);
+    }
+
     debug(user_context) << "Exiting halide_memoization_cache_store\n";
 
     return 0;
@@ -531,33 +757,50 @@ WEAK void halide_memoization_cache_release(void *user_context, void *host) {
     if (entry == NULL) {
         halide_free(user_context, header);
     } else {
-        ScopedMutexLock lock(&memoization_lock);
+        CacheShard *shard = shard_for_hash(entry->hash);
+        ScopedMutexLock lock(&shard->lock);
 
         halide_assert(user_context, entry->in_use_count > 0);
         entry->in_use_count--;
 #if CACHE_DEBUGGING
-        validate_cache();
+        shard->validate();
 #endif
     }
 
     debug(user_context) << "Exited halide_memoization_cache_release.\n";
 }
 
+WEAK void halide_memoization_cache_get_stats(halide_memoization_cache_stats_t *stats) {
+    stats->hits = 0;
+    stats->misses = 0;
+    stats->evictions = 0;
+    stats->entries = 0;
+    for (int i = 0; i < kCacheShards; i++) {
+        CacheShard *shard = &cache_shards[i];
+        ScopedMutexLock lock(&shard->lock);
+        stats->hits += shard->hits;
+        stats->misses += shard->misses;
+        stats->evictions += shard->evictions;
+        stats->entries += shard->entry_count;
+    }
+    stats->current_size = __atomic_load_n(&current_cache_size, __ATOMIC_RELAXED);
+    stats->max_size = __atomic_load_n(&max_cache_size, __ATOMIC_RELAXED);
+}
+
+WEAK void halide_memoization_cache_reset_stats() {
+    for (int i = 0; i < kCacheShards; i++) {
+        CacheShard *shard = &cache_shards[i];
+        ScopedMutexLock lock(&shard->lock);
+        shard->hits = shard->misses = shard->evictions = 0;
+    }
+}
+
 WEAK void halide_memoization_cache_cleanup() {
     debug(NULL) << "halide_memoization_cache_cleanup\n";
-    for (size_t i = 0; i < kHashTableSize; i++) {
-        CacheEntry *entry = cache_entries[i];
-        cache_entries[i] = NULL;
-        while (entry != NULL) {
-            CacheEntry *next = entry->next;
-            entry->destroy();
-            halide_free(NULL, entry);
-            entry = next;
-        }
+    for (int i = 0; i < kCacheShards; i++) {
+        cache_shards[i].clear();
     }
     current_cache_size = 0;
-    most_recently_used = NULL;
-    least_recently_used = NULL;
 }
 
 namespace {
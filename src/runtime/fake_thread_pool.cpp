@@ -25,6 +25,13 @@ namespace Halide { namespace Runtime { namespace Internal {
 WEAK halide_do_task_t custom_do_task = halide_default_do_task;
 WEAK halide_do_par_for_t custom_do_par_for = halide_default_do_par_for;
 
+WEAK uintptr_t current_thread_id() {
+    return 1;
+}
+
+// Tasks all run on the calling thread, so there is nothing to record.
+WEAK void (*thread_pool_timeline_hook)(int event, int64_t arg) = NULL;
+
 }}} // namespace Halide::Runtime::Internal
 
 extern "C" {
@@ -41,9 +48,48 @@ WEAK void halide_mutex_lock(halide_mutex *mutex) {
 WEAK void halide_mutex_unlock(halide_mutex *mutex) {
 }
 
+// There's only ever one thread, so nothing can be waiting on a
+// condition variable.
+WEAK void halide_cond_signal(struct halide_cond *cond) {
+}
+
+WEAK void halide_cond_broadcast(struct halide_cond *cond) {
+}
+
+WEAK void halide_cond_wait(struct halide_cond *cond, struct halide_mutex *mutex) {
+}
+
 WEAK void halide_shutdown_thread_pool() {
 }
 
+// There's only ever one thread, so a semaphore is just a count.
+WEAK int halide_semaphore_init(halide_semaphore_t *sema, int n) {
+    *(int *)sema = n;
+    return 0;
+}
+
+WEAK int halide_semaphore_release(halide_semaphore_t *sema, int n) {
+    *(int *)sema += n;
+    return 0;
+}
+
+WEAK bool halide_semaphore_try_acquire(halide_semaphore_t *sema, int n) {
+    if (*(int *)sema < n) {
+        return false;
+    }
+    *(int *)sema -= n;
+    return true;
+}
+
+WEAK int halide_semaphore_acquire(halide_semaphore_t *sema, int n) {
+    if (!halide_semaphore_try_acquire(sema, n)) {
+        // Nothing else could ever release it.
+        halide_error(NULL, "halide_semaphore_acquire would block forever on a platform without threads.");
+        return -1;
+    }
+    return 0;
+}
+
 WEAK int halide_set_num_threads(int n) {
     if (n < 0) {
         halide_error(NULL, "halide_set_num_threads: must be >= 0.");
@@ -0,0 +1,177 @@
+#include "HalideRuntime.h"
+
+// Reads the hardware performance counters of each thread for
+// pipelines compiled with the -profile_counters target flag. Generated
+// code calls halide_profiler_counters_set_func whenever a thread
+// starts or stops computing a Func, and the counts since the previous
+// call are billed to the Func the thread was computing.
+
+// The syscall numbers vary across platforms. Like linux_clock, this
+// module is only used on x86.
+#ifdef BITS_64
+#define SYS_GETTID 186
+#define SYS_PERF_EVENT_OPEN 298
+#endif
+
+#ifdef BITS_32
+#define SYS_GETTID 224
+#define SYS_PERF_EVENT_OPEN 336
+#endif
+
+extern "C" {
+extern int syscall(int num, ...);
+}
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+// The first version of struct perf_event_attr from
+// linux/perf_event.h, which all kernels that have perf_event_open
+// accept.
+struct perf_event_attr {
+    uint32_t type;
+    uint32_t size;
+    uint64_t config;
+    uint64_t sample_period;
+    uint64_t sample_type;
+    uint64_t read_format;
+    uint64_t flags;
+    uint32_t wakeup_events;
+    uint32_t bp_type;
+    uint64_t config1;
+};
+
+#define PERF_TYPE_HARDWARE 0
+#define PERF_COUNT_HW_CPU_CYCLES 0
+#define PERF_COUNT_HW_INSTRUCTIONS 1
+#define PERF_COUNT_HW_CACHE_MISSES 3
+#define PERF_FORMAT_GROUP 8
+
+// Bits of perf_event_attr::flags. Counting only user space works
+// with the default perf_event_paranoid setting.
+#define PERF_ATTR_FLAG_EXCLUDE_KERNEL (1 << 5)
+#define PERF_ATTR_FLAG_EXCLUDE_HV (1 << 6)
+
+// Threads are found in this table by hashing their id. Threads which
+// don't fit aren't counted.
+#define MAX_COUNTED_THREADS 256
+WEAK halide_profiler_thread_stats counted_threads[MAX_COUNTED_THREADS];
+
+// Open a counter of the calling thread, on any cpu. Returns a
+// negative value on failure.
+WEAK int open_counter(uint64_t config, int group_fd) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.flags = PERF_ATTR_FLAG_EXCLUDE_KERNEL | PERF_ATTR_FLAG_EXCLUDE_HV;
+    return syscall(SYS_PERF_EVENT_OPEN, &attr, 0, -1, group_fd, 0);
+}
+
+// Read the group of counters of a thread: cycles, instructions, and
+// cache misses, in the order they were opened.
+WEAK bool read_counters(int fd, uint64_t *values) {
+    // The group is read as the number of counters followed by their
+    // values.
+    uint64_t buf[4];
+    if (read(fd, buf, sizeof(buf)) != (ssize_t)sizeof(buf) || buf[0] != 3) {
+        return false;
+    }
+    values[0] = buf[1];
+    values[1] = buf[2];
+    values[2] = buf[3];
+    return true;
+}
+
+WEAK void open_thread_counters(halide_profiler_thread_stats *t) {
+    // The other counters of the group are read through the leader,
+    // but must stay open to keep counting, for as long as the thread
+    // might run Halide code.
+    int leader = open_counter(PERF_COUNT_HW_CPU_CYCLES, -1);
+    int instructions = open_counter(PERF_COUNT_HW_INSTRUCTIONS, leader);
+    int llc_misses = open_counter(PERF_COUNT_HW_CACHE_MISSES, leader);
+    uint64_t values[3];
+    if (leader < 0 || instructions < 0 || llc_misses < 0 ||
+        !read_counters(leader, values)) {
+        // Without all three the rates can't be computed.
+        if (leader >= 0) close(leader);
+        if (instructions >= 0) close(instructions);
+        if (llc_misses >= 0) close(llc_misses);
+        t->fd = -1;
+        return;
+    }
+    t->last_cycles = values[0];
+    t->last_instructions = values[1];
+    t->last_llc_misses = values[2];
+    t->fd = leader;
+}
+
+WEAK halide_profiler_thread_stats *find_or_create_counted_thread(halide_profiler_state *s) {
+    if (!s->threads) {
+        // Every thread writes the same values, so the race is benign.
+        s->threads = counted_threads;
+        s->num_threads = MAX_COUNTED_THREADS;
+    }
+
+    // Thread ids are used rather than pthread_self, because the
+    // latter are reused as soon as a thread exits, and the counters
+    // opened by a thread only count that thread.
+    int tid = syscall(SYS_GETTID);
+    uint32_t h = (uint32_t)tid * 2654435761U;
+    for (int i = 0; i < MAX_COUNTED_THREADS; i++) {
+        halide_profiler_thread_stats *t = counted_threads + (h + i) % MAX_COUNTED_THREADS;
+        int owner = t->thread;
+        if (owner == tid) {
+            return t;
+        }
+        if (owner == 0 && __sync_bool_compare_and_swap(&t->thread, 0, tid)) {
+            open_thread_counters(t);
+            return t;
+        }
+    }
+    return NULL;
+}
+
+}}}  // namespace Halide::Runtime::Internal
+
+extern "C" {
+
+WEAK int halide_profiler_counters_set_func(void *pipeline_state, int func_id) {
+    halide_profiler_thread_stats *t =
+        find_or_create_counted_thread(halide_profiler_get_state());
+    uint64_t values[3];
+    if (!t || t->fd < 0 || !read_counters(t->fd, values)) {
+        return 0;
+    }
+
+    // Only this thread writes to its own entry.
+    halide_profiler_pipeline_stats *p = t->pipeline;
+    if (p) {
+        uint64_t cycles = values[0] - t->last_cycles;
+        uint64_t instructions = values[1] - t->last_instructions;
+        uint64_t llc_misses = values[2] - t->last_llc_misses;
+        t->cycles += cycles;
+        t->instructions += instructions;
+        t->llc_misses += llc_misses;
+
+        // Other threads may be billing the same Func.
+        halide_profiler_func_stats *f = p->funcs + t->func;
+        __sync_add_and_fetch(&f->cycles, cycles);
+        __sync_add_and_fetch(&f->instructions, instructions);
+        __sync_add_and_fetch(&f->llc_misses, llc_misses);
+    }
+    t->last_cycles = values[0];
+    t->last_instructions = values[1];
+    t->last_llc_misses = values[2];
+
+    if (func_id >= 0) {
+        t->pipeline = (halide_profiler_pipeline_stats *)pipeline_state;
+        t->func = func_id;
+    } else {
+        t->pipeline = NULL;
+    }
+    return 0;
+}
+
+}  // extern "C"
@@ -184,6 +184,9 @@ extern int qurt_thread_create (qurt_thread_t *thread_id, qurt_thread_attr_t *att
  */
 extern int qurt_thread_join(unsigned int tid, int *status);
 
+/** Returns the id of the calling thread. */
+extern qurt_thread_t qurt_thread_get_id(void);
+
 /** QuRT mutex type.
 
    Both non-recursive mutex lock/unlock and recursive
@@ -1,27 +1,223 @@
 #include "HalideRuntime.h"
 #include "runtime_internal.h"
+#include "scoped_spin_lock.h"
 
 extern "C" {
 
 extern void *malloc(size_t);
 extern void free(void *);
 
-WEAK void *halide_default_malloc(void *user_context, size_t x) {
-    // Allocate enough space for aligning the pointer we return.
+}
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+// Freed blocks are kept in free lists, one per size class and shard, to
+// be handed out again by halide_default_malloc. The size classes go from
+// 64 bytes to 128 MB, with four classes per power of two so that
+// rounding a request up to its class wastes at most 25%.
+const int pool_min_class_bits = 6;
+const int pool_max_class_bits = 27;
+const int pool_num_classes = (pool_max_class_bits - pool_min_class_bits) * 4 + 1;
+const int pool_num_shards = 8;
+
+struct pool_free_list {
+    void *head;
+    volatile int lock;
+};
+
+WEAK pool_free_list pool_free_lists[pool_num_shards][pool_num_classes];
+WEAK intptr_t pool_limit = 64 * 1024 * 1024;
+
+// The counters are pointer-sized, as some 32-bit targets lack 64-bit
+// atomics.
+WEAK uintptr_t pool_hits, pool_misses, pool_releases;
+WEAK intptr_t pool_current_size, pool_peak_size;
+
+// Every block handed out starts two words after the start of its
+// header, which holds the pointer returned by malloc and the size class
+// of the block (or -1 if it isn't pooled).
+const size_t pool_header_size = 2 * sizeof(void *);
+
+// Return the size class of an allocation of 'size' bytes, and set
+// 'class_size' to the size of the blocks in that class. Returns -1 if
+// the allocation is too large to pool.
+WEAK int pool_size_class(size_t size, size_t *class_size) {
+    if (size <= ((size_t)1 << pool_min_class_bits)) {
+        *class_size = (size_t)1 << pool_min_class_bits;
+        return 0;
+    }
+    if (size > ((size_t)1 << pool_max_class_bits)) {
+        return -1;
+    }
+    // size - 1 is in [2^e, 2^(e + 1)); split that range into quarters.
+    int e = 63 - __builtin_clzll((uint64_t)(size - 1));
+    int m = (int)((size - 1) >> (e - 2)) & 3;
+    *class_size = (size_t)(5 + m) << (e - 2);
+    return (e - pool_min_class_bits) * 4 + m + 1;
+}
+
+WEAK size_t pool_class_size(int c) {
+    if (c == 0) {
+        return (size_t)1 << pool_min_class_bits;
+    }
+    int e = (c - 1) / 4 + pool_min_class_bits;
+    int m = (c - 1) % 4;
+    return (size_t)(5 + m) << (e - 2);
+}
+
+// Pick the shard of the calling thread from the address of its stack,
+// as the runtime has no portable thread-local storage. Thread stacks are
+// far enough apart that different threads rarely share a shard, and a
+// thread stays in the same 64k window of its stack for the duration of
+// a task.
+WEAK int pool_shard() {
+    int local;
+    uint32_t window = (uint32_t)(((uintptr_t)&local) >> 16);
+    return (int)((window * 2654435761u) >> 29) % pool_num_shards;
+}
+
+WEAK void *pool_pop(int c) {
+    int shard = pool_shard();
+    // Try this thread's shard first, then steal from the others.
+    for (int i = 0; i < pool_num_shards; i++) {
+        pool_free_list *list = &pool_free_lists[(shard + i) % pool_num_shards][c];
+        if (list->head == NULL) {
+            continue;
+        }
+        void *ptr;
+        {
+            ScopedSpinLock lock(&list->lock);
+            ptr = list->head;
+            if (ptr != NULL) {
+                list->head = ((void **)ptr)[0];
+            }
+        }
+        if (ptr != NULL) {
+            __sync_sub_and_fetch(&pool_current_size, (intptr_t)pool_class_size(c));
+            return ptr;
+        }
+    }
+    return NULL;
+}
+
+WEAK bool pool_push(int c, void *ptr) {
+    intptr_t size = (intptr_t)pool_class_size(c);
+    intptr_t new_size = __sync_add_and_fetch(&pool_current_size, size);
+    if (new_size > pool_limit) {
+        __sync_sub_and_fetch(&pool_current_size, size);
+        return false;
+    }
+    intptr_t peak = pool_peak_size;
+    while (new_size > peak) {
+        intptr_t old_peak = __sync_val_compare_and_swap(&pool_peak_size, peak, new_size);
+        if (old_peak == peak) {
+            break;
+        }
+        peak = old_peak;
+    }
+
+    pool_free_list *list = &pool_free_lists[pool_shard()][c];
+    ScopedSpinLock lock(&list->lock);
+    ((void **)ptr)[0] = list->head;
+    list->head = ptr;
+    return true;
+}
+
+WEAK void *pool_system_malloc(size_t size, int c) {
+    // Allocate enough space for the header and for aligning the pointer
+    // we return.
     const size_t alignment = halide_malloc_alignment();
-    void *orig = malloc(x + alignment);
+    void *orig = malloc(size + alignment + pool_header_size);
     if (orig == NULL) {
         // Will result in a failed assertion and a call to halide_error
         return NULL;
     }
-    // We want to store the original pointer prior to the pointer we return.
-    void *ptr = (void *)(((size_t)orig + alignment + sizeof(void*) - 1) & ~(alignment - 1));
+    void *ptr = (void *)(((size_t)orig + pool_header_size + alignment - 1) & ~(alignment - 1));
     ((void **)ptr)[-1] = orig;
+    ((void **)ptr)[-2] = (void *)(intptr_t)c;
     return ptr;
 }
 
+WEAK void pool_system_free(void *ptr) {
+    free(((void **)ptr)[-1]);
+}
+
+}}} // namespace Halide::Runtime::Internal
+
+extern "C" {
+
+WEAK void *halide_default_malloc(void *user_context, size_t x) {
+    size_t class_size;
+    int c = pool_size_class(x, &class_size);
+    if (c < 0 || pool_limit <= 0) {
+        return pool_system_malloc(x, -1);
+    }
+    void *ptr = pool_pop(c);
+    if (ptr != NULL) {
+        __sync_add_and_fetch(&pool_hits, 1);
+        return ptr;
+    }
+    __sync_add_and_fetch(&pool_misses, 1);
+    return pool_system_malloc(class_size, c);
+}
+
 WEAK void halide_default_free(void *user_context, void *ptr) {
-    free(((void**)ptr)[-1]);
+    int c = (int)(intptr_t)((void **)ptr)[-2];
+    if (c >= 0 && pool_push(c, ptr)) {
+        return;
+    }
+    if (c >= 0) {
+        __sync_add_and_fetch(&pool_releases, 1);
+    }
+    pool_system_free(ptr);
+}
+
+WEAK void halide_memory_pool_release(void *user_context) {
+    for (int s = 0; s < pool_num_shards; s++) {
+        for (int c = 0; c < pool_num_classes; c++) {
+            pool_free_list *list = &pool_free_lists[s][c];
+            void *ptr;
+            {
+                ScopedSpinLock lock(&list->lock);
+                ptr = list->head;
+                list->head = NULL;
+            }
+            while (ptr != NULL) {
+                void *next = ((void **)ptr)[0];
+                __sync_sub_and_fetch(&pool_current_size, (intptr_t)pool_class_size(c));
+                __sync_add_and_fetch(&pool_releases, 1);
+                pool_system_free(ptr);
+                ptr = next;
+            }
+        }
+    }
+}
+
+WEAK void halide_memory_pool_set_limit(int64_t limit) {
+    if (limit < 0) {
+        limit = 0;
+    }
+    // Clamp to what fits in a pointer-sized integer.
+    intptr_t max_limit = (intptr_t)(~(uintptr_t)0 >> 1);
+    intptr_t new_limit = limit > (int64_t)max_limit ? max_limit : (intptr_t)limit;
+    bool shrink = new_limit < pool_limit;
+    pool_limit = new_limit;
+    if (shrink) {
+        halide_memory_pool_release(NULL);
+    }
+}
+
+WEAK void halide_memory_pool_get_stats(halide_memory_pool_stats_t *stats) {
+    stats->hits = pool_hits;
+    stats->misses = pool_misses;
+    stats->releases = pool_releases;
+    stats->current_size = pool_current_size;
+    stats->peak_size = pool_peak_size;
+}
+
+__attribute__((destructor))
+WEAK void halide_memory_pool_cleanup() {
+    halide_memory_pool_release(NULL);
 }
 
 }
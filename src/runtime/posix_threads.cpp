@@ -128,3 +128,11 @@ struct thread_parker {
 #include "synchronization_common.h"
 
 #include "thread_pool_common.h"
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+WEAK uintptr_t current_thread_id() {
+    return (uintptr_t)pthread_self();
+}
+
+}}} // namespace Halide::Runtime::Internal
@@ -9,7 +9,7 @@
 extern "C" {
 // Returns the address of the global halide_profiler state
 WEAK halide_profiler_state *halide_profiler_get_state() {
-    static halide_profiler_state s = {{{0}}, 1, 0, 0, 0, 0, NULL, NULL};
+    static halide_profiler_state s = {{{0}}, 1, 0, 0, 0, 0, NULL, NULL, NULL, 0};
     return &s;
 }
 }
@@ -60,6 +60,9 @@ WEAK halide_profiler_pipeline_stats *find_or_create_pipeline(const char *pipelin
         p->funcs[i].stack_peak = 0;
         p->funcs[i].active_threads_numerator = 0;
         p->funcs[i].active_threads_denominator = 0;
+        p->funcs[i].cycles = 0;
+        p->funcs[i].instructions = 0;
+        p->funcs[i].llc_misses = 0;
     }
     s->first_free_id += num_funcs;
     s->pipelines = p;
@@ -133,6 +136,172 @@ WEAK void sampling_profiler_thread(void *) {
     halide_mutex_unlock(&s->lock);
 }
 
+// Print the instructions per cycle and the last-level cache misses
+// per thousand instructions implied by some hardware counts.
+template <typename PrinterType>
+WEAK void print_counter_rates(PrinterType &sstr, uint64_t cycles, uint64_t instructions, uint64_t llc_misses) {
+    float ipc = instructions / (cycles + 1e-10f);
+    sstr << "ipc: " << ipc;
+    sstr.erase(3);
+    float mpki = (1000.0f * llc_misses) / (instructions + 1e-10f);
+    sstr << "  llc misses/kinstr: " << mpki;
+    sstr.erase(3);
+}
+
+// The timeline recorded by pipelines compiled with the
+// -profile_timeline target flag. Each thread appends events to its
+// own list of chunks without taking any locks, and the whole timeline
+// is written out in the Chrome Trace Event format when the profiler
+// reports.
+
+enum {
+    timeline_func_begin,
+    timeline_func_end,
+    timeline_task_begin,
+    timeline_task_end,
+    timeline_wait_begin,
+    timeline_wait_end
+};
+
+struct timeline_event {
+    int64_t time;
+    // The name of the Func, a global constant string, or the index of
+    // the task.
+    const char *name;
+    int index;
+    int kind;
+};
+
+#define TIMELINE_CHUNK_EVENTS 4096
+
+struct timeline_chunk {
+    timeline_chunk *next;
+    // The number of events written so far. Stored with release
+    // semantics once the event is complete, so that the timeline can
+    // be written out while threads are still recording.
+    int count;
+    timeline_event events[TIMELINE_CHUNK_EVENTS];
+};
+
+// Stop recording on a thread after this many events.
+#define MAX_TIMELINE_EVENTS_PER_THREAD (1 << 22)
+
+struct timeline_thread {
+    // The current_thread_id of the thread recording into this entry,
+    // or zero if the entry is unused.
+    uintptr_t owner;
+    timeline_chunk *first, *last;
+    // The time of the last event recorded.
+    int64_t last_time;
+    int events, dropped;
+    // The total time spent waiting for jobs on the job stack.
+    int64_t wait_ns;
+    int jobs;
+};
+
+#define MAX_TIMELINE_THREADS 256
+WEAK timeline_thread timeline_threads[MAX_TIMELINE_THREADS];
+
+// The number of pipelines compiled with -profile_timeline that are
+// currently running. The thread pool hook is installed while this is
+// nonzero. Guarded by the profiler state lock.
+WEAK int running_timeline_pipelines = 0;
+
+WEAK timeline_thread *find_or_create_timeline_thread() {
+    uintptr_t me = current_thread_id();
+    uint32_t h = (uint32_t)me * 2654435761U;
+    for (int i = 0; i < MAX_TIMELINE_THREADS; i++) {
+        timeline_thread *t = timeline_threads + (h + i) % MAX_TIMELINE_THREADS;
+        uintptr_t owner = __atomic_load_n(&t->owner, __ATOMIC_ACQUIRE);
+        if (owner == me) {
+            return t;
+        }
+        if (owner == 0 && __sync_bool_compare_and_swap(&t->owner, (uintptr_t)0, me)) {
+            return t;
+        }
+    }
+    return NULL;
+}
+
+WEAK void record_timeline_event(timeline_thread *t, int kind, const char *name, int index, int64_t time) {
+    timeline_chunk *c = t->last;
+    if (!c || c->count == TIMELINE_CHUNK_EVENTS) {
+        if (t->events >= MAX_TIMELINE_EVENTS_PER_THREAD ||
+            !(c = (timeline_chunk *)malloc(sizeof(timeline_chunk)))) {
+            t->dropped++;
+            return;
+        }
+        c->next = NULL;
+        c->count = 0;
+        if (t->last) {
+            __atomic_store_n(&t->last->next, c, __ATOMIC_RELEASE);
+        } else {
+            __atomic_store_n(&t->first, c, __ATOMIC_RELEASE);
+        }
+        t->last = c;
+    }
+    timeline_event *e = c->events + c->count;
+    e->time = time;
+    e->name = name;
+    e->index = index;
+    e->kind = kind;
+    __atomic_store_n(&c->count, c->count + 1, __ATOMIC_RELEASE);
+    t->events++;
+    t->last_time = time;
+}
+
+WEAK void record_thread_pool_event(int event, int64_t arg) {
+    timeline_thread *t = find_or_create_timeline_thread();
+    if (!t) return;
+    int64_t now = halide_current_time_ns(NULL);
+    if (event == thread_pool_job_start) {
+        // The thread may have been busy with something else when the
+        // job was enqueued.
+        int64_t start = arg > t->last_time ? arg : t->last_time;
+        if (start < now) {
+            record_timeline_event(t, timeline_wait_begin, NULL, 0, start);
+            record_timeline_event(t, timeline_wait_end, NULL, 0, now);
+            t->wait_ns += now - start;
+        }
+        t->jobs++;
+    } else {
+        int kind = (event == thread_pool_task_begin) ? timeline_task_begin : timeline_task_end;
+        record_timeline_event(t, kind, NULL, (int)arg, now);
+    }
+}
+
+WEAK void record_func_event(void *pipeline_state, int func_id, int kind) {
+    timeline_thread *t = find_or_create_timeline_thread();
+    if (!t) return;
+    halide_profiler_pipeline_stats *p = (halide_profiler_pipeline_stats *)pipeline_state;
+    record_timeline_event(t, kind, p->funcs[func_id].name, func_id,
+                          halide_current_time_ns(NULL));
+}
+
+WEAK bool have_timeline() {
+    for (int i = 0; i < MAX_TIMELINE_THREADS; i++) {
+        if (timeline_threads[i].first) {
+            return true;
+        }
+    }
+    return false;
+}
+
+WEAK void reset_timeline() {
+    for (int i = 0; i < MAX_TIMELINE_THREADS; i++) {
+        timeline_thread *t = timeline_threads + i;
+        timeline_chunk *c = t->first;
+        while (c) {
+            timeline_chunk *next = c->next;
+            free(c);
+            c = next;
+        }
+        t->first = t->last = NULL;
+        t->events = t->dropped = t->jobs = 0;
+        t->wait_ns = 0;
+    }
+}
+
 }}}
 
 namespace {
@@ -173,7 +342,8 @@ WEAK halide_profiler_pipeline_stats *halide_profiler_get_pipeline_state(const ch
 WEAK int halide_profiler_pipeline_start(void *user_context,
                                         const char *pipeline_name,
                                         int num_funcs,
-                                        const uint64_t *func_names) {
+                                        const uint64_t *func_names,
+                                        int timeline) {
     halide_profiler_state *s = halide_profiler_get_state();
 
     ScopedMutexLock lock(&s->lock);
@@ -191,6 +361,10 @@ WEAK int halide_profiler_pipeline_start(void *user_context,
     }
     p->runs++;
 
+    if (timeline && running_timeline_pipelines++ == 0) {
+        thread_pool_timeline_hook = record_thread_pool_event;
+    }
+
     return p->first_func_id;
 }
 
@@ -280,6 +454,99 @@ WEAK void halide_profiler_memory_free(void *user_context,
     __sync_sub_and_fetch(&f_stats->memory_current, decr);
 }
 
+WEAK int halide_profiler_timeline_enter(void *pipeline_state, int func_id) {
+    record_func_event(pipeline_state, func_id, timeline_func_begin);
+    return 0;
+}
+
+WEAK int halide_profiler_timeline_exit(void *pipeline_state, int func_id) {
+    record_func_event(pipeline_state, func_id, timeline_func_end);
+    return 0;
+}
+
+WEAK int halide_profiler_write_timeline(void *user_context, const char *filename) {
+    void *f = fopen(filename, "w");
+    if (!f) {
+        halide_error(user_context, "Failed to open timeline file\n");
+        return halide_error_code_generic_error;
+    }
+
+    // Times are written relative to the first event, in microseconds.
+    int64_t t0 = 0;
+    bool have_t0 = false;
+    for (int i = 0; i < MAX_TIMELINE_THREADS; i++) {
+        timeline_chunk *c = __atomic_load_n(&timeline_threads[i].first, __ATOMIC_ACQUIRE);
+        if (c && __atomic_load_n(&c->count, __ATOMIC_ACQUIRE) &&
+            (!have_t0 || c->events[0].time < t0)) {
+            t0 = c->events[0].time;
+            have_t0 = true;
+        }
+    }
+
+    char buf[512];
+    Printer<StringStreamPrinter, sizeof(buf)> sstr(user_context, buf);
+    bool ok = true;
+    auto emit = [&]() {
+        ok = ok && fwrite(sstr.str(), sstr.size(), 1, f) == 1;
+        sstr.clear();
+    };
+
+    sstr << "{\"traceEvents\":[\n";
+    emit();
+    bool first = true;
+    for (int i = 0; i < MAX_TIMELINE_THREADS; i++) {
+        timeline_thread *t = timeline_threads + i;
+        timeline_chunk *c = __atomic_load_n(&t->first, __ATOMIC_ACQUIRE);
+        if (!c) continue;
+        sstr << (first ? "" : ",\n")
+             << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << i
+             << ",\"args\":{\"name\":\"thread " << i << "\"}}";
+        emit();
+        first = false;
+        for (; c; c = __atomic_load_n(&c->next, __ATOMIC_ACQUIRE)) {
+            int count = __atomic_load_n(&c->count, __ATOMIC_ACQUIRE);
+            for (int j = 0; j < count; j++) {
+                const timeline_event &e = c->events[j];
+                const char *name, *cat;
+                if (e.kind == timeline_func_begin || e.kind == timeline_func_end) {
+                    name = e.name;
+                    cat = "func";
+                } else if (e.kind == timeline_task_begin || e.kind == timeline_task_end) {
+                    name = "task";
+                    cat = "par_for";
+                } else {
+                    name = "queue wait";
+                    cat = "par_for";
+                }
+                // Even kinds begin a span, odd kinds end one.
+                bool begin = (e.kind & 1) == 0;
+                uint64_t ns = e.time - t0;
+                sstr << ",\n{\"name\":\"" << name << "\",\"cat\":\"" << cat
+                     << "\",\"ph\":\"" << (begin ? "B" : "E")
+                     << "\",\"pid\":0,\"tid\":" << i
+                     << ",\"ts\":" << ns / 1000 << ".";
+                uint64_t frac = ns % 1000;
+                if (frac < 100) sstr << "0";
+                if (frac < 10) sstr << "0";
+                sstr << frac;
+                if (begin && e.kind == timeline_task_begin) {
+                    sstr << ",\"args\":{\"index\":" << e.index << "}";
+                }
+                sstr << "}";
+                emit();
+            }
+        }
+    }
+    sstr << "\n]}\n";
+    emit();
+
+    if (fclose(f) != 0 || !ok) {
+        halide_error(user_context, "Failed to write timeline file\n");
+        return halide_error_code_generic_error;
+    }
+    return 0;
+}
+
 WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_state *s) {
 
     char line_buf[1024];
@@ -306,6 +573,20 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
         }
         sstr << " heap allocations: " << p->num_allocs
              << "  peak heap usage: " << p->memory_peak << " bytes\n";
+
+        uint64_t cycles = 0, instructions = 0, llc_misses = 0;
+        for (int i = 0; i < p->num_funcs; i++) {
+            cycles += p->funcs[i].cycles;
+            instructions += p->funcs[i].instructions;
+            llc_misses += p->funcs[i].llc_misses;
+        }
+        if (cycles) {
+            sstr << " cycles: " << cycles
+                 << "  instructions: " << instructions
+                 << "  llc misses: " << llc_misses << "\n ";
+            print_counter_rates(sstr, cycles, instructions, llc_misses);
+            sstr << "\n";
+        }
         halide_print(user_context, sstr.str());
 
         bool print_f_states = p->time || p->memory_total;
@@ -374,12 +655,84 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
                 if (fs->stack_peak > 0) {
                     sstr << " stack: " << fs->stack_peak;
                 }
+                if (fs->cycles) {
+                    sstr << " ";
+                    print_counter_rates(sstr, fs->cycles, fs->instructions, fs->llc_misses);
+                }
                 sstr << "\n";
 
                 halide_print(user_context, sstr.str());
             }
         }
     }
+
+    // Hardware counters are also gathered per thread, to show
+    // imbalances between the threads of the thread pool.
+    int unavailable = 0;
+    for (int i = 0; i < s->num_threads; i++) {
+        halide_profiler_thread_stats *ts = s->threads + i;
+        if (!ts->thread) continue;
+        if (ts->fd < 0) {
+            unavailable++;
+            continue;
+        }
+        if (!ts->cycles) continue;
+        sstr.clear();
+        sstr << "thread " << ts->thread << ": ";
+        while (sstr.size() < 20) sstr << " ";
+        sstr << "cycles: " << ts->cycles << "  ";
+        print_counter_rates(sstr, ts->cycles, ts->instructions, ts->llc_misses);
+        sstr << "\n";
+        halide_print(user_context, sstr.str());
+    }
+    if (unavailable) {
+        sstr.clear();
+        sstr << "hardware counters could not be opened on " << unavailable
+             << " thread(s). Check /proc/sys/kernel/perf_event_paranoid.\n";
+        halide_print(user_context, sstr.str());
+    }
+
+    // The timeline, if any, goes to a file. The time threads spent
+    // waiting for parallel jobs is summarized here.
+    if (have_timeline()) {
+        int64_t wait_ns = 0;
+        int jobs = 0, dropped = 0;
+        for (int i = 0; i < MAX_TIMELINE_THREADS; i++) {
+            wait_ns += timeline_threads[i].wait_ns;
+            jobs += timeline_threads[i].jobs;
+            dropped += timeline_threads[i].dropped;
+        }
+        const char *filename = getenv("HL_TIMELINE_FILE");
+        if (!filename) {
+            filename = "halide_timeline.json";
+        }
+        sstr.clear();
+        if (halide_profiler_write_timeline(user_context, filename) == 0) {
+            sstr << "timeline written to " << filename;
+        } else {
+            sstr << "timeline could not be written to " << filename;
+        }
+        if (dropped) {
+            sstr << " (" << dropped << " events dropped)";
+        }
+        sstr << "\nthread pool queue wait: " << wait_ns / 1000000.0f << " ms"
+             << " over " << jobs << " jobs\n";
+        halide_print(user_context, sstr.str());
+    }
+
+    // The heap allocations counted above are served by the memory pool
+    // of the default allocator when possible. It is shared by all
+    // pipelines, so its counters are reported once.
+    halide_memory_pool_stats_t pool;
+    halide_memory_pool_get_stats(&pool);
+    if (pool.hits + pool.misses != 0) {
+        sstr.clear();
+        sstr << "heap pool: " << pool.hits << " reused"
+             << "  " << pool.misses << " new"
+             << "  " << pool.releases << " released"
+             << "  peak pooled: " << pool.peak_size << " bytes\n";
+        halide_print(user_context, sstr.str());
+    }
 }
 
 WEAK void halide_profiler_report(void *user_context) {
@@ -397,6 +750,15 @@ WEAK void halide_profiler_reset_unlocked(halide_profiler_state *s) {
         free(p);
     }
     s->first_free_id = 0;
+    reset_timeline();
+    // Keep the counters of each thread open, but forget what they
+    // were billing to.
+    for (int i = 0; i < s->num_threads; i++) {
+        halide_profiler_thread_stats *ts = s->threads + i;
+        ts->cycles = ts->instructions = ts->llc_misses = 0;
+        ts->pipeline = NULL;
+        ts->func = 0;
+    }
 }
 
 WEAK void halide_profiler_reset() {
@@ -456,4 +818,15 @@ WEAK void halide_profiler_pipeline_end(void *user_context, void *state) {
     ((halide_profiler_state *)state)->current_func = halide_profiler_outside_of_halide;
 }
 
+// Called when a pipeline compiled with -profile_timeline returns, if
+// its call to halide_profiler_pipeline_start succeeded. Stops
+// recording thread pool events once no such pipeline is running.
+WEAK void halide_profiler_timeline_pipeline_end(void *user_context, void *state) {
+    halide_profiler_state *s = (halide_profiler_state *)state;
+    ScopedMutexLock lock(&s->lock);
+    if (--running_timeline_pipelines == 0) {
+        thread_pool_timeline_hook = NULL;
+    }
+}
+
 } // extern "C"
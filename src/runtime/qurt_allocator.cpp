@@ -45,6 +45,11 @@ static const int buffer_size = 1024 * 64;
 WEAK int buf_is_used[num_buffers];
 WEAK void *mem_buf[num_buffers] = { NULL, };
 
+// Set by halide_memory_pool_set_limit(0). Zero-initialized, as other
+// initializers of globals don't work with mmap_dlopen (see below).
+WEAK int pool_disabled;
+WEAK uintptr_t pool_hits, pool_misses, pool_releases;
+
 __attribute__((destructor))
 WEAK void halide_allocator_cleanup() {
     for (int i = 0; i < num_buffers; ++i) {
@@ -58,11 +63,14 @@ WEAK void *halide_default_malloc(void *user_context, size_t x) {
     // Hexagon needs up to 128 byte alignment.
     const size_t alignment = 128;
 
-    if (x <= buffer_size) {
+    if (x <= buffer_size && !pool_disabled) {
         for (int i = 0; i < num_buffers; ++i) {
             if (__sync_val_compare_and_swap(buf_is_used + i, 0, 1) == 0) {
                 if (mem_buf[i] == NULL) {
+                    __sync_add_and_fetch(&pool_misses, 1);
                     mem_buf[i] = aligned_malloc(alignment, buffer_size);
+                } else {
+                    __sync_add_and_fetch(&pool_hits, 1);
                 }
                 return mem_buf[i];
             }
@@ -83,6 +91,41 @@ WEAK void halide_default_free(void *user_context, void *ptr) {
     aligned_free(ptr);
 }
 
+// The pool on Hexagon is the fixed set of buffers above, so its limit
+// can only turn it off or on.
+WEAK void halide_memory_pool_release(void *user_context) {
+    for (int i = 0; i < num_buffers; ++i) {
+        if (__sync_val_compare_and_swap(buf_is_used + i, 0, 1) == 0) {
+            if (mem_buf[i] != NULL) {
+                aligned_free(mem_buf[i]);
+                mem_buf[i] = NULL;
+                __sync_add_and_fetch(&pool_releases, 1);
+            }
+            buf_is_used[i] = 0;
+        }
+    }
+}
+
+WEAK void halide_memory_pool_set_limit(int64_t limit) {
+    pool_disabled = (limit <= 0);
+    if (pool_disabled) {
+        halide_memory_pool_release(NULL);
+    }
+}
+
+WEAK void halide_memory_pool_get_stats(halide_memory_pool_stats_t *stats) {
+    stats->hits = pool_hits;
+    stats->misses = pool_misses;
+    stats->releases = pool_releases;
+    stats->current_size = 0;
+    for (int i = 0; i < num_buffers; ++i) {
+        if (mem_buf[i] != NULL && !buf_is_used[i]) {
+            stats->current_size += buffer_size;
+        }
+    }
+    stats->peak_size = num_buffers * buffer_size;
+}
+
 namespace Halide { namespace Runtime { namespace Internal {
 
 WEAK halide_malloc_t custom_malloc = halide_default_malloc;
@@ -114,3 +114,12 @@ struct thread_parker {
 #include "synchronization_common.h"
 
 #include "thread_pool_common.h"
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+WEAK uintptr_t current_thread_id() {
+    // Offset the id so that it is never zero.
+    return (uintptr_t)qurt_thread_get_id() + 1;
+}
+
+}}} // namespace Halide::Runtime::Internal
@@ -109,10 +109,16 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_malloc,
     (void *)&halide_matlab_call_pipeline,
     (void *)&halide_memoization_cache_cleanup,
+    (void *)&halide_memoization_cache_get_stats,
     (void *)&halide_memoization_cache_lookup,
     (void *)&halide_memoization_cache_release,
+    (void *)&halide_memoization_cache_reset_stats,
+    (void *)&halide_memoization_cache_set_eviction_policy,
     (void *)&halide_memoization_cache_set_size,
     (void *)&halide_memoization_cache_store,
+    (void *)&halide_memory_pool_get_stats,
+    (void *)&halide_memory_pool_release,
+    (void *)&halide_memory_pool_set_limit,
     (void *)&halide_metal_acquire_context,
     (void *)&halide_metal_detach_buffer,
     (void *)&halide_metal_device_interface,
@@ -153,6 +159,7 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_openglcompute_run,
     (void *)&halide_pointer_to_string,
     (void *)&halide_print,
+    (void *)&halide_profiler_counters_set_func,
     (void *)&halide_profiler_get_pipeline_state,
     (void *)&halide_profiler_get_state,
     (void *)&halide_profiler_memory_allocate,
@@ -161,10 +168,18 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_profiler_report,
     (void *)&halide_profiler_reset,
     (void *)&halide_profiler_stack_peak_update,
+    (void *)&halide_profiler_timeline_enter,
+    (void *)&halide_profiler_timeline_exit,
+    (void *)&halide_profiler_timeline_pipeline_end,
+    (void *)&halide_profiler_write_timeline,
     (void *)&halide_qurt_hvx_lock,
     (void *)&halide_qurt_hvx_unlock,
     (void *)&halide_qurt_hvx_unlock_as_destructor,
     (void *)&halide_release_jit_module,
+    (void *)&halide_semaphore_acquire,
+    (void *)&halide_semaphore_init,
+    (void *)&halide_semaphore_release,
+    (void *)&halide_semaphore_try_acquire,
     (void *)&halide_set_custom_can_use_target_features,
     (void *)&halide_set_custom_do_par_for,
     (void *)&halide_set_custom_do_task,
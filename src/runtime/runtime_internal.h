@@ -79,6 +79,7 @@ int fclose(void *);
 int close(int);
 size_t fwrite(const void *, size_t, size_t, void *);
 ssize_t write(int fd, const void *buf, size_t bytes);
+ssize_t read(int fd, void *buf, size_t bytes);
 int remove(const char *pathname);
 int ioctl(int fd, unsigned long request, ...);
 void exit(int);
@@ -133,7 +134,20 @@ WEAK void halide_profiler_memory_free(void *user_context,
 WEAK int halide_profiler_pipeline_start(void *user_context,
                                         const char *pipeline_name,
                                         int num_funcs,
-                                        const uint64_t *func_names);
+                                        const uint64_t *func_names,
+                                        int timeline);
+// Bill the hardware counts of the calling thread since its last call
+// to the Func it was computing, and note that it is now computing
+// func_id, or nothing if func_id is negative.
+WEAK int halide_profiler_counters_set_func(void *pipeline_state, int func_id);
+// Record on the timeline that the calling thread started or finished
+// computing func_id.
+WEAK int halide_profiler_timeline_enter(void *pipeline_state, int func_id);
+WEAK int halide_profiler_timeline_exit(void *pipeline_state, int func_id);
+// Registered as a destructor by pipelines compiled with
+// -profile_timeline, to stop recording thread pool events once none
+// of them is running.
+WEAK void halide_profiler_timeline_pipeline_end(void *user_context, void *state);
 WEAK int halide_host_cpu_count();
 
 WEAK int halide_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf,
@@ -184,6 +198,28 @@ namespace Halide { namespace Runtime { namespace Internal {
 extern WEAK void halide_use_jit_module();
 extern WEAK void halide_release_jit_module();
 
+// A nonzero value identifying the calling thread, which no other
+// running thread shares. Provided by the threading modules.
+extern WEAK uintptr_t current_thread_id();
+
+// Events passed to the thread pool timeline hook.
+enum {
+    // The argument is the index of the task.
+    thread_pool_task_begin,
+    thread_pool_task_end,
+    // A thread other than the owner started claiming tasks from a
+    // job. The argument is the time the job was enqueued, in the
+    // units of halide_current_time_ns.
+    thread_pool_job_start
+};
+
+// Set by the profiler while any pipeline compiled with
+// -profile_timeline is running. The thread pool
+// calls it on the thread that runs each task, so that the time threads
+// spend waiting for work can be told apart from the time spent in
+// tasks. Provided by the threading modules.
+extern WEAK void (*thread_pool_timeline_hook)(int event, int64_t arg);
+
 template <typename T>
 __attribute__((always_inline)) void swap(T &a, T &b) {
     T t = a;
@@ -1074,6 +1074,52 @@ class fast_cond {
     }
 };
 
+// A counting semaphore. The count is manipulated with atomics, so
+// acquiring and releasing are lock-free unless a thread actually has
+// to wait, in which case it sleeps on a condition variable.
+struct fast_semaphore {
+    int value;
+    int waiters;
+    fast_mutex mutex;
+    fast_cond cond;
+
+    __attribute__((always_inline)) bool try_acquire(int n) {
+        int old_value = __atomic_load_n(&value, __ATOMIC_SEQ_CST);
+        while (old_value >= n) {
+            if (__atomic_compare_exchange_n(&value, &old_value, old_value - n,
+                                            true, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    __attribute__((always_inline)) void release(int n) {
+        __atomic_add_fetch(&value, n, __ATOMIC_SEQ_CST);
+        // The waiter count is incremented with the mutex held, before
+        // the waiter checks the value one last time, so if we see no
+        // waiters here, any future waiter will see our increment.
+        if (__atomic_load_n(&waiters, __ATOMIC_SEQ_CST) > 0) {
+            mutex.lock();
+            cond.broadcast();
+            mutex.unlock();
+        }
+    }
+
+    __attribute__((always_inline)) void acquire(int n) {
+        if (try_acquire(n)) {
+            return;
+        }
+        mutex.lock();
+        __atomic_add_fetch(&waiters, 1, __ATOMIC_SEQ_CST);
+        while (!try_acquire(n)) {
+            cond.wait(&mutex);
+        }
+        __atomic_sub_fetch(&waiters, 1, __ATOMIC_SEQ_CST);
+        mutex.unlock();
+    }
+};
+
 }
 
 }}}
@@ -1112,4 +1158,27 @@ WEAK void halide_cond_wait(struct halide_cond *cond, struct halide_mutex *mutex)
    fast_cond->wait(fast_mutex);
 }
 
+WEAK int halide_semaphore_init(struct halide_semaphore_t *sema, int n) {
+    Halide::Runtime::Internal::Synchronization::fast_semaphore *fast_sema =
+        (Halide::Runtime::Internal::Synchronization::fast_semaphore *)sema;
+    // The semaphore may live in uninitialized memory, so reset the
+    // waiter count, mutex, and condition variable too.
+    memset(fast_sema, 0, sizeof(*fast_sema));
+    __atomic_store_n(&fast_sema->value, n, __ATOMIC_RELEASE);
+    return 0;
+}
+
+WEAK int halide_semaphore_release(struct halide_semaphore_t *sema, int n) {
+    Halide::Runtime::Internal::Synchronization::fast_semaphore *fast_sema =
+        (Halide::Runtime::Internal::Synchronization::fast_semaphore *)sema;
+    fast_sema->release(n);
+    return 0;
+}
+
+WEAK bool halide_semaphore_try_acquire(struct halide_semaphore_t *sema, int n) {
+    Halide::Runtime::Internal::Synchronization::fast_semaphore *fast_sema =
+        (Halide::Runtime::Internal::Synchronization::fast_semaphore *)sema;
+    return fast_sema->try_acquire(n);
+}
+
 }
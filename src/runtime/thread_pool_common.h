@@ -2,15 +2,179 @@ extern "C" void * pthread_self();
 
 namespace Halide { namespace Runtime { namespace Internal {
 
+// The maximum number of independent task ranges a single job is
+// split into. Threads beyond this many share ranges, which is still
+// correct, just more contended.
+#define MAX_WORK_SLOTS 64
+
+// A contiguous range of task indices [begin, end), packed into a
+// single 64-bit word so that both ends can be updated with one
+// compare-and-swap. The thread that considers a range its home pops
+// tasks off the front of it. Other threads steal the back half of it
+// when their own range runs dry. The range is padded to a cache line
+// so that threads popping from neighbouring ranges don't false share.
+struct work_range {
+#ifdef BITS_64
+    uint64_t bounds;
+    uint8_t padding[64 - sizeof(uint64_t)];
+
+    __attribute__((always_inline)) uint64_t load() {
+        return __atomic_load_n(&bounds, __ATOMIC_ACQUIRE);
+    }
+
+    __attribute__((always_inline)) bool compare_exchange(uint64_t *expected, uint64_t desired) {
+        return __atomic_compare_exchange_n(&bounds, expected, desired,
+                                           false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    }
+#else
+    // 64-bit atomics are not lock-free on all 32-bit targets, so
+    // guard the range with a spin lock instead.
+    uint64_t bounds;
+    volatile int lock;
+    uint8_t padding[64 - sizeof(uint64_t) - sizeof(int)];
+
+    __attribute__((always_inline)) uint64_t load() {
+        ScopedSpinLock l(&lock);
+        return bounds;
+    }
+
+    __attribute__((always_inline)) bool compare_exchange(uint64_t *expected, uint64_t desired) {
+        ScopedSpinLock l(&lock);
+        if (bounds == *expected) {
+            bounds = desired;
+            return true;
+        } else {
+            *expected = bounds;
+            return false;
+        }
+    }
+#endif
+};
+
+WEAK uint64_t pack_range(int begin, int end) {
+    return ((uint64_t)(uint32_t)end << 32) | (uint64_t)(uint32_t)begin;
+}
+
+WEAK void unpack_range(uint64_t r, int *begin, int *end) {
+    *begin = (int)(uint32_t)(r & 0xffffffff);
+    *end = (int)(uint32_t)(r >> 32);
+}
+
 struct work {
     work *next_job;
     int (*f)(void *, int, uint8_t *);
     void *user_context;
-    int next, max;
     uint8_t *closure;
+
+    // The number of tasks that have not yet completed. Decremented
+    // atomically without holding the work queue lock.
+    int remaining;
+
+    // The number of threads currently pulling tasks from this
+    // job. Protected by the work queue mutex.
     int active_workers;
+
+    // Set once every task has been claimed, at which point the job is
+    // removed from the job stack. Protected by the work queue mutex.
+    bool exhausted;
+
     int exit_status;
-    bool running() { return next < max || active_workers > 0; }
+
+    // When the job was pushed onto the job stack, if the thread pool
+    // timeline hook was set at the time.
+    int64_t enqueued_ns;
+
+    // The task ranges. Only the first num_slots are in use. Slot zero
+    // belongs to the thread that owns the job.
+    int num_slots;
+    work_range slots[MAX_WORK_SLOTS];
+
+    bool running() {
+        return __atomic_load_n(&remaining, __ATOMIC_ACQUIRE) > 0 || active_workers > 0;
+    }
+
+    // Claim a single task from the front of a range. Returns false if
+    // the range is empty.
+    bool pop_front(int slot, int *idx) {
+        uint64_t old_bounds = slots[slot].load();
+        while (true) {
+            int begin, end;
+            unpack_range(old_bounds, &begin, &end);
+            if (begin >= end) {
+                return false;
+            }
+            if (slots[slot].compare_exchange(&old_bounds, pack_range(begin + 1, end))) {
+                *idx = begin;
+                return true;
+            }
+        }
+    }
+
+    // Steal the back half of a range (rounded up, so a single
+    // remaining task can be stolen). Returns false if the range is
+    // empty.
+    bool steal_back(int slot, int *stolen_begin, int *stolen_end) {
+        uint64_t old_bounds = slots[slot].load();
+        while (true) {
+            int begin, end;
+            unpack_range(old_bounds, &begin, &end);
+            if (begin >= end) {
+                return false;
+            }
+            int mid = begin + (end - begin) / 2;
+            if (slots[slot].compare_exchange(&old_bounds, pack_range(begin, mid))) {
+                *stolen_begin = mid;
+                *stolen_end = end;
+                return true;
+            }
+        }
+    }
+
+    // Install a range of tasks into an empty slot. Fails if the slot
+    // has been refilled by some other thread sharing it.
+    bool install(int slot, int begin, int end) {
+        uint64_t old_bounds = slots[slot].load();
+        int old_begin, old_end;
+        unpack_range(old_bounds, &old_begin, &old_end);
+        if (old_begin < old_end) {
+            return false;
+        }
+        return slots[slot].compare_exchange(&old_bounds, pack_range(begin, end));
+    }
+
+    // Claim a range of tasks to run. First try to pop a single task
+    // from our home range. Failing that, steal half of some other
+    // range, keep the first task of it, and move the rest into our
+    // home range where other threads can in turn steal from it. If
+    // our home range has been refilled by someone else in the
+    // meantime, we just run the whole stolen range. Returns false if
+    // there are no unclaimed tasks left anywhere in the job.
+    bool claim(int home, int *begin, int *end) {
+        int idx;
+        if (pop_front(home, &idx)) {
+            *begin = idx;
+            *end = idx + 1;
+            return true;
+        }
+        for (int i = 1; i < num_slots; i++) {
+            int victim = home + i;
+            if (victim >= num_slots) {
+                victim -= num_slots;
+            }
+            int b, e;
+            if (steal_back(victim, &b, &e)) {
+                if (e - b == 1 || install(home, b + 1, e)) {
+                    *begin = b;
+                    *end = b + 1;
+                } else {
+                    *begin = b;
+                    *end = e;
+                }
+                return true;
+            }
+        }
+        return false;
+    }
 };
 
 // The work queue and thread pool is weak, so one big work queue is shared by all halide functions
@@ -36,6 +200,11 @@ struct work_queue_t {
     // a_team_size < target_a_team_size.
     int a_team_size, target_a_team_size;
 
+    // The number of worker threads asleep waiting for jobs, and the
+    // number of threads (workers or otherwise) blocked in
+    // halide_semaphore_acquire.
+    int idle_threads, blocked_threads;
+
     // Broadcast when a job completes.
     halide_cond wakeup_owners;
 
@@ -83,6 +252,8 @@ struct work_queue_t {
 };
  WEAK work_queue_t work_queue = {};
 
+WEAK void (*thread_pool_timeline_hook)(int event, int64_t arg) = NULL;
+
 WEAK int clamp_num_threads(int desired_num_threads) {
     if (desired_num_threads > MAX_THREADS) {
         desired_num_threads = MAX_THREADS;
@@ -107,7 +278,37 @@ WEAK int default_desired_num_threads() {
     return desired_num_threads;
 }
 
-WEAK void worker_thread_already_locked(work *owned_job) {
+// The home range for a thread within a job. The owner of a job
+// always uses slot zero. Threads in the pool spread themselves over
+// the remaining slots according to their index. Threads that aren't
+// in the pool (e.g. the owner of some other job) share slot zero.
+WEAK int home_slot(work *job, int thread_index) {
+    if (thread_index < 0 || job->num_slots <= 1) {
+        return 0;
+    }
+    return 1 + thread_index % (job->num_slots - 1);
+}
+
+// Remove an exhausted job from the job stack. Must be called with the
+// work queue locked. The job is usually at the top of the stack, but
+// may not be if some other thread has pushed a nested job since we
+// last looked.
+WEAK void remove_job_already_locked(work *job) {
+    if (job->exhausted) {
+        return;
+    }
+    job->exhausted = true;
+    work **ptr = &work_queue.jobs;
+    while (*ptr) {
+        if (*ptr == job) {
+            *ptr = job->next_job;
+            return;
+        }
+        ptr = &((*ptr)->next_job);
+    }
+}
+
+WEAK void worker_thread_already_locked(work *owned_job, int thread_index) {
     // If I'm a job owner, then I was the thread that called
     // do_par_for, and I should only stay in this function until my
     // job is complete. If I'm a lowly worker thread, I should stay in
@@ -122,45 +323,68 @@ WEAK void worker_thread_already_locked(work *owned_job) {
                 halide_cond_wait(&work_queue.wakeup_owners, &work_queue.mutex);
             } else if (work_queue.a_team_size <= work_queue.target_a_team_size) {
                 // There are no jobs pending. Wait until more jobs are enqueued.
+                work_queue.idle_threads++;
                 halide_cond_wait(&work_queue.wakeup_a_team, &work_queue.mutex);
+                work_queue.idle_threads--;
             } else {
                 // There are no jobs pending, and there are too many
                 // threads in the A team. Transition to the B team
                 // until the wakeup_b_team condition is fired.
                 work_queue.a_team_size--;
+                work_queue.idle_threads++;
                 halide_cond_wait(&work_queue.wakeup_b_team, &work_queue.mutex);
+                work_queue.idle_threads--;
                 work_queue.a_team_size++;
             }
         } else {
             // Grab the next job.
             work *job = work_queue.jobs;
 
-            // Claim a task from it.
-            work myjob = *job;
-            job->next++;
-
-            // If there were no more tasks pending for this job,
-            // remove it from the stack.
-            if (job->next == job->max) {
-                work_queue.jobs = job->next_job;
-            }
-
-            // Increment the active_worker count so that other threads
-            // are aware that this job is still in progress even
-            // though there are no outstanding tasks for it.
+            // Increment the active_worker count so that the owner
+            // knows not to return (and free the job) while we're
+            // still looking at its task ranges.
             job->active_workers++;
 
-            // Release the lock and do the task.
+            // Release the lock and claim tasks from the job until
+            // there are none left. Claiming a task is lock-free, so
+            // this thread only takes the work queue lock once per
+            // job, rather than once per task.
             halide_mutex_unlock(&work_queue.mutex);
-            int result = halide_do_task(myjob.user_context, myjob.f, myjob.next,
-                                        myjob.closure);
+            void (*hook)(int, int64_t) = thread_pool_timeline_hook;
+            if (hook && job != owned_job) {
+                hook(thread_pool_job_start, job->enqueued_ns);
+            }
+            int home = (job == owned_job) ? 0 : home_slot(job, thread_index);
+            int begin, end, completed = 0, exit_status = 0;
+            while (job->claim(home, &begin, &end)) {
+                for (int idx = begin; idx < end; idx++) {
+                    if (hook) {
+                        hook(thread_pool_task_begin, idx);
+                    }
+                    int result = halide_do_task(job->user_context, job->f, idx,
+                                                job->closure);
+                    if (hook) {
+                        hook(thread_pool_task_end, idx);
+                    }
+                    // If this task failed, remember the exit status
+                    // for the job.
+                    if (result) {
+                        exit_status = result;
+                    }
+                }
+                completed += end - begin;
+            }
+            __atomic_fetch_sub(&job->remaining, completed, __ATOMIC_ACQ_REL);
             halide_mutex_lock(&work_queue.mutex);
 
-            // If this task failed, set the exit status on the job.
-            if (result) {
-                job->exit_status = result;
+            if (exit_status) {
+                job->exit_status = exit_status;
             }
 
+            // There were no more unclaimed tasks, so take the job off
+            // the stack so that nobody else wastes time on it.
+            remove_job_already_locked(job);
+
             // We are no longer active on this job
             job->active_workers--;
 
@@ -173,9 +397,10 @@ WEAK void worker_thread_already_locked(work *owned_job) {
     }
 }
 
-WEAK void worker_thread(void *) {
+WEAK void worker_thread(void *arg) {
+    int thread_index = (int)(intptr_t)arg;
     halide_mutex_lock(&work_queue.mutex);
-    worker_thread_already_locked(NULL);
+    worker_thread_already_locked(NULL, thread_index);
     halide_mutex_unlock(&work_queue.mutex);
 }
 
@@ -231,20 +456,44 @@ WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
 
     while (work_queue.threads_created < work_queue.desired_num_threads - 1) {
         // We might need to make some new threads, if work_queue.desired_num_threads has
-        // increased.
+        // increased. Each thread is told its index so that it knows
+        // which task range to call home.
+        int thread_index = work_queue.threads_created;
         work_queue.threads[work_queue.threads_created++] =
-            halide_spawn_thread(worker_thread, NULL);
+            halide_spawn_thread(worker_thread, (void *)(intptr_t)thread_index);
     }
 
     // Make the job.
     work job;
     job.f = f;               // The job should call this function. It takes an index and a closure.
     job.user_context = user_context;
-    job.next = min;          // Start at this index.
-    job.max  = min + size;   // Keep going until one less than this index.
     job.closure = closure;   // Use this closure.
+    job.remaining = size;    // None of the tasks are done yet
     job.exit_status = 0;     // The job hasn't failed yet
     job.active_workers = 0;  // Nobody is working on this yet
+    job.exhausted = false;
+    job.enqueued_ns = thread_pool_timeline_hook ? halide_current_time_ns(user_context) : 0;
+
+    // Split the range into one chunk per thread that could work on
+    // it. Threads start on their own chunk and then steal from the
+    // others as they run out, so the chunks don't need to be well
+    // balanced.
+    int num_slots = work_queue.desired_num_threads;
+    if (num_slots > size) {
+        num_slots = size;
+    }
+    if (num_slots > MAX_WORK_SLOTS) {
+        num_slots = MAX_WORK_SLOTS;
+    }
+    job.num_slots = num_slots;
+    for (int i = 0; i < num_slots; i++) {
+        int begin = min + (int)(((int64_t)size * i) / num_slots);
+        int end = min + (int)(((int64_t)size * (i + 1)) / num_slots);
+        job.slots[i].bounds = pack_range(begin, end);
+#ifndef BITS_64
+        job.slots[i].lock = 0;
+#endif
+    }
 
     if (!work_queue.jobs && size < work_queue.desired_num_threads) {
         // If there's no nested parallelism happening and there are
@@ -274,7 +523,7 @@ WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
     }
 
     // Do some work myself.
-    worker_thread_already_locked(&job);
+    worker_thread_already_locked(&job, -1);
 
     halide_mutex_unlock(&work_queue.mutex);
 
@@ -321,6 +570,41 @@ WEAK void halide_shutdown_thread_pool() {
     }
 }
 
+WEAK int halide_semaphore_acquire(halide_semaphore_t *sema, int n) {
+    Synchronization::fast_semaphore *fast_sema = (Synchronization::fast_semaphore *)sema;
+    if (fast_sema->try_acquire(n)) {
+        return 0;
+    }
+
+    // We're about to block. The task that would release us may be
+    // sitting unclaimed in the job stack while every other thread is
+    // busy or blocked too, so if we're the last runnable thread,
+    // make sure someone is available to claim it.
+    halide_mutex_lock(&work_queue.mutex);
+    work_queue.blocked_threads++;
+    if (work_queue.initialized && work_queue.jobs != NULL) {
+        int runnable = work_queue.threads_created + 1 -
+            work_queue.blocked_threads - work_queue.idle_threads;
+        if (work_queue.idle_threads > 0) {
+            halide_cond_broadcast(&work_queue.wakeup_a_team);
+            halide_cond_broadcast(&work_queue.wakeup_b_team);
+        } else if (runnable < work_queue.desired_num_threads &&
+                   work_queue.threads_created < MAX_THREADS) {
+            int thread_index = work_queue.threads_created;
+            work_queue.threads[work_queue.threads_created++] =
+                halide_spawn_thread(worker_thread, (void *)(intptr_t)thread_index);
+        }
+    }
+    halide_mutex_unlock(&work_queue.mutex);
+
+    fast_sema->acquire(n);
+
+    halide_mutex_lock(&work_queue.mutex);
+    work_queue.blocked_threads--;
+    halide_mutex_unlock(&work_queue.mutex);
+    return 0;
+}
+
 WEAK halide_do_task_t halide_set_custom_do_task(halide_do_task_t f) {
     halide_do_task_t result = custom_do_task;
     custom_do_task = f;
@@ -1,5 +1,6 @@
 #include "HalideRuntime.h"
 #include "printer.h"
+#include "scoped_mutex_lock.h"
 #include "scoped_spin_lock.h"
 
 extern "C" {
@@ -10,192 +11,431 @@ typedef int32_t (*trace_fn)(void *, const halide_trace_event_t *);
 
 namespace Halide { namespace Runtime { namespace Internal {
 
-// A spinlock that allows for shared and exclusive access. It's
-// equivalent to a reader-writer lock, but in my case the "readers"
-// will actually be writing simultaneously to the trace buffer, so
-// that's a bad name. We use the __sync primitives used elsewhere in
-// the runtime for atomic work. They are well supported by clang.
-class SharedExclusiveSpinLock {
-    volatile uint32_t lock;
-
-    // Covers a single bit indicating one owner has exclusive
-    // access. The waiting bit can be set while the exclusive bit is
-    // set, but the bits masked by shared_mask must be zero while this
-    // bit is set.
-    const static uint32_t exclusive_held_mask = 0x80000000;
-
-    // Set to indicate a thread needs to acquire exclusive
-    // access. Other fields of the lock may be set, but no shared
-    // access request will proceed while this bit is set.
-    const static uint32_t exclusive_waiting_mask = 0x40000000;
-
-    // Count of threads currently holding shared access. Must be zero
-    // if the exclusive bit is set. Cannot increase if the waiting bit
-    // is set.
-    const static uint32_t shared_mask = 0x3fffffff;
-
-public:
-    __attribute__((always_inline)) void acquire_shared() {
-        while (1) {
-            uint32_t x = lock & shared_mask;
-            if (__sync_bool_compare_and_swap(&lock, x, x + 1)) {
-                return;
-            }
-        }
+// Binary traces are written in chunks (see halide_trace_chunk_t). Each
+// thread tracing to a file fills a chunk of its own slot, so threads
+// don't contend with each other, and full chunks are handed to a
+// background thread which writes them to the file.
+
+const static uint32_t chunk_bytes = 64 * 1024;
+
+// Threads beyond the number of slots share them.
+const static int num_slots = 64;
+
+// Every slot can hold a chunk while as many more are queued to be
+// written. Past this, threads wait for chunks to be written.
+const static int max_chunks = 2 * num_slots;
+
+// Coordinates are encoded relative to the previous packet's only up
+// to this many.
+const static int max_delta_coordinates = 64;
+
+// Each slot hands out ids from a block of this many.
+const static int32_t ids_per_block = 1024;
+
+struct TraceChunk {
+    TraceChunk *next;
+    uint32_t cursor;
+    uint32_t packets;
+    uint32_t first_epoch;
+
+    // The previous packet, relative to which the next one is encoded.
+    uint32_t epoch;
+    int32_t id, parent_id, value_index, dimensions;
+    halide_type_t type;
+    int32_t event;
+    const char *func, *trace_tag;
+    int32_t coordinates[max_delta_coordinates];
+
+    // Starts with a halide_trace_chunk_t.
+    uint8_t buf[chunk_bytes];
+
+    __attribute__((always_inline)) void reset() {
+        next = NULL;
+        cursor = sizeof(halide_trace_chunk_t);
+        packets = 0;
+        first_epoch = epoch = 0;
+        id = parent_id = value_index = dimensions = 0;
+        type = halide_type_t();
+        event = 0;
+        func = trace_tag = NULL;
     }
 
-     __attribute__((always_inline)) void release_shared() {
-        __sync_fetch_and_sub(&lock, 1);
+    __attribute__((always_inline)) halide_trace_chunk_t *header() {
+        return (halide_trace_chunk_t *)buf;
     }
+};
 
-    __attribute__((always_inline)) void acquire_exclusive() {
-        while (1) {
-            // If multiple threads are trying to acquire exclusive
-            // ownership, we may need to rerequest exclusive waiting
-            // while we spin, as it gets unset whenever a thread
-            // acquires exclusive ownership.
-            __sync_fetch_and_or(&lock, exclusive_waiting_mask);
-            if (__sync_bool_compare_and_swap(&lock, exclusive_waiting_mask, exclusive_held_mask)) {
-                return;
-            }
+struct TraceSlot {
+    // The id of the thread that uses this slot, or zero.
+    volatile uintptr_t owner;
+    // Held while a packet is added to the chunk, or the chunk is taken.
+    volatile int lock;
+    TraceChunk *chunk;
+    int32_t next_id, end_id;
+    // Keep slots on separate cache lines.
+    uint8_t padding[64 - sizeof(uintptr_t) - sizeof(int) - sizeof(TraceChunk *) - 2 * sizeof(int32_t)];
+};
+
+struct TraceWriter {
+    // Protects the fields below it.
+    halide_mutex mutex;
+    // Signaled when a chunk is queued, or the thread should stop.
+    halide_cond chunk_queued;
+    // Broadcast when a chunk has been written.
+    halide_cond chunk_written;
+    TraceChunk *queue_head, *queue_tail, *free_chunks;
+    int chunks_allocated, chunks_unwritten;
+    uint32_t horizon;
+    bool stop;
+
+    halide_thread *thread;
+    TraceSlot slots[num_slots];
+};
+
+WEAK TraceWriter *halide_trace_writer = NULL;
+WEAK int32_t halide_trace_next_id = 1;
+WEAK volatile uint32_t halide_trace_epoch = 0;
+WEAK int halide_trace_file = -1; // -1 indicates uninitialized
+WEAK int halide_trace_file_lock = 0;
+WEAK bool halide_trace_file_initialized = false;
+WEAK void *halide_trace_file_internally_opened = NULL;
+
+__attribute__((always_inline)) bool epoch_before(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) < 0;
+}
+
+__attribute__((always_inline)) uint8_t *put_varint(uint8_t *dst, uint32_t x) {
+    while (x >= 0x80) {
+        *dst++ = (uint8_t)(x | 0x80);
+        x >>= 7;
+    }
+    *dst++ = (uint8_t)x;
+    return dst;
+}
+
+// Zig-zag encode the difference between two values.
+__attribute__((always_inline)) uint8_t *put_delta(uint8_t *dst, uint32_t x, uint32_t prev) {
+    uint32_t d = x - prev;
+    return put_varint(dst, (d << 1) ^ (0 - (d >> 31)));
+}
+
+// An upper bound on the size of an encoded packet.
+__attribute__((always_inline)) uint32_t max_encoded_bytes(const halide_trace_event_t *e, uint32_t value_bytes,
+                                                          uint32_t name_bytes, uint32_t tag_bytes) {
+    return 3 + 5 * (7 + e->dimensions) + value_bytes + name_bytes + tag_bytes;
+}
+
+// Encode a packet at the end of a chunk, which must have room for it.
+WEAK void append_packet(TraceChunk *c, uint32_t epoch, int32_t id, const halide_trace_event_t *e,
+                        uint32_t value_bytes) {
+    const char *tag = e->trace_tag ? e->trace_tag : "";
+    uint8_t *flags = c->buf + c->cursor;
+    uint8_t *dst = flags + 1;
+    uint8_t f = 0;
+
+    if (c->packets == 0) {
+        c->first_epoch = epoch;
+    }
+    dst = put_delta(dst, epoch, c->epoch);
+    dst = put_delta(dst, id, c->id);
+    if (e->parent_id != c->parent_id) {
+        f |= halide_trace_chunk_new_parent;
+        dst = put_delta(dst, e->parent_id, c->parent_id);
+    }
+    if (c->packets == 0 ||
+        e->type != c->type ||
+        e->event != c->event ||
+        e->value_index != c->value_index ||
+        e->dimensions != c->dimensions) {
+        f |= halide_trace_chunk_new_header;
+        *dst++ = e->type.code;
+        *dst++ = e->type.bits;
+        dst = put_varint(dst, e->type.lanes);
+        dst = put_varint(dst, e->event);
+        dst = put_varint(dst, e->value_index);
+        dst = put_varint(dst, e->dimensions);
+    }
+
+    bool delta = (c->packets > 0 &&
+                  e->dimensions == c->dimensions &&
+                  e->dimensions <= max_delta_coordinates);
+    if (delta) {
+        f |= halide_trace_chunk_delta_coordinates;
+    }
+    for (int i = 0; i < e->dimensions; i++) {
+        int32_t x = e->coordinates ? e->coordinates[i] : 0;
+        dst = put_delta(dst, x, delta ? c->coordinates[i] : 0);
+        if (i < max_delta_coordinates) {
+            c->coordinates[i] = x;
         }
     }
 
-    __attribute__((always_inline)) void release_exclusive() {
-        __sync_fetch_and_and(&lock, ~exclusive_held_mask);
+    if (e->value) {
+        memcpy(dst, e->value, value_bytes);
+    } else {
+        memset(dst, 0, value_bytes);
+    }
+    dst += value_bytes;
+
+    // The names are constant strings of the pipeline, so they
+    // usually have the same address as the previous packet's.
+    if (c->packets == 0 || e->func != c->func || tag != c->trace_tag) {
+        f |= halide_trace_chunk_new_names;
+        size_t name_bytes = strlen(e->func) + 1;
+        memcpy(dst, e->func, name_bytes);
+        dst += name_bytes;
+        size_t tag_bytes = strlen(tag) + 1;
+        memcpy(dst, tag, tag_bytes);
+        dst += tag_bytes;
     }
 
-    SharedExclusiveSpinLock() : lock(0) {}
-};
+    *flags = f;
+    c->cursor = (uint32_t)(dst - c->buf);
+    c->packets++;
+    c->epoch = epoch;
+    c->id = id;
+    c->parent_id = e->parent_id;
+    c->type = e->type;
+    c->event = e->event;
+    c->value_index = e->value_index;
+    c->dimensions = e->dimensions;
+    c->func = e->func;
+    c->trace_tag = tag;
+}
 
-const static int buffer_size = 1024 * 1024;
-
-class TraceBuffer {
-    SharedExclusiveSpinLock lock;
-    uint32_t cursor, overage;
-    uint8_t buf[buffer_size];
-
-    // Attempt to atomically acquire space in the buffer to write a
-    // packet. Returns NULL if the buffer was full.
-    __attribute__((always_inline)) halide_trace_packet_t *try_acquire_packet(void *user_context, uint32_t size) {
-        lock.acquire_shared();
-        halide_assert(user_context, size <= buffer_size);
-        uint32_t my_cursor = __sync_fetch_and_add(&cursor, size);
-        if (my_cursor + size > sizeof(buf)) {
-            // Don't try to back it out: instead, just allow this request to fail
-            // (along with all subsequent requests) and record the 'overage'
-            // that was added and should be ignored; then, in the next flush,
-            // remove the overage.
-            __sync_fetch_and_add(&overage, size);
-            lock.release_shared();
-            return NULL;
-        } else {
-            return (halide_trace_packet_t *)(buf + my_cursor);
-        }
+WEAK void write_chunk(void *user_context, TraceChunk *c, uint32_t horizon) {
+    halide_trace_chunk_t *h = c->header();
+    h->magic = halide_trace_chunk_magic;
+    h->size = c->cursor - (uint32_t)sizeof(halide_trace_chunk_t);
+    h->packets = c->packets;
+    h->horizon = horizon;
+    bool success = (c->cursor == (uint32_t)write(halide_trace_file, c->buf, c->cursor));
+    halide_assert(user_context, success && "Could not write to trace file");
+}
+
+// Take a chunk to fill, waiting for one to be written if there are
+// too many. Must be called with the mutex held.
+WEAK TraceChunk *acquire_chunk(TraceWriter *w) {
+    while (!w->free_chunks && w->chunks_allocated >= max_chunks) {
+        halide_cond_wait(&w->chunk_written, &w->mutex);
+    }
+    TraceChunk *c = w->free_chunks;
+    if (c) {
+        w->free_chunks = c->next;
+    } else {
+        c = (TraceChunk *)malloc(sizeof(TraceChunk));
+        halide_assert(NULL, c && "Could not allocate trace buffer");
+        w->chunks_allocated++;
     }
+    c->reset();
+    return c;
+}
 
-public:
-
-    // Wait for all writers to finish with their packets, stall any
-    // new writers, and flush the buffer to the fd.
-    __attribute__((always_inline)) void flush(void *user_context, int fd) {
-        lock.acquire_exclusive();
-        bool success = true;
-        if (cursor) {
-            cursor -= overage;
-            success = (cursor == (uint32_t)write(fd, buf, cursor));
-            cursor = 0;
-            overage = 0;
+// Queue a chunk to be written. Must be called with the mutex held.
+WEAK void submit_chunk(TraceWriter *w, TraceChunk *c) {
+    if (!w->thread) {
+        // Without a thread to write chunks, nothing is known about
+        // the epochs of the chunks still to come.
+        write_chunk(NULL, c, w->horizon);
+        c->next = w->free_chunks;
+        w->free_chunks = c;
+        return;
+    }
+    c->next = NULL;
+    if (w->queue_tail) {
+        w->queue_tail->next = c;
+    } else {
+        w->queue_head = c;
+    }
+    w->queue_tail = c;
+    w->chunks_unwritten++;
+    halide_cond_signal(&w->chunk_queued);
+}
+
+// Queue the chunks of all slots that started before the given epoch,
+// and return the earliest epoch of any packet that might be written
+// after the chunks already queued. Must be called without the mutex
+// held, as threads hold their slot's lock while taking it.
+WEAK uint32_t flush_slots(TraceWriter *w, uint32_t before) {
+    uint32_t horizon = __sync_fetch_and_add(&halide_trace_epoch, 0);
+    for (int i = 0; i < num_slots; i++) {
+        TraceSlot *slot = w->slots + i;
+        ScopedSpinLock lock(&slot->lock);
+        TraceChunk *c = slot->chunk;
+        if (!c || !c->packets) {
+            continue;
+        }
+        if (epoch_before(c->first_epoch, before)) {
+            slot->chunk = NULL;
+            ScopedMutexLock mutex(&w->mutex);
+            submit_chunk(w, c);
+        } else if (epoch_before(c->first_epoch, horizon)) {
+            horizon = c->first_epoch;
         }
-        lock.release_exclusive();
-        halide_assert(user_context, success && "Could not write to trace file");
     }
+    return horizon;
+}
+
+WEAK void trace_writer_thread(void *arg) {
+    TraceWriter *w = (TraceWriter *)arg;
+    halide_mutex_lock(&w->mutex);
+    while (true) {
+        while (!w->queue_head && !w->stop) {
+            halide_cond_wait(&w->chunk_queued, &w->mutex);
+        }
+        TraceChunk *c = w->queue_head;
+        if (!c) {
+            break;
+        }
+        w->queue_head = c->next;
+        if (!w->queue_head) {
+            w->queue_tail = NULL;
+        }
+        halide_mutex_unlock(&w->mutex);
+
+        // A thread that traced a while ago and then went quiet would
+        // hold back the horizon, and make readers buffer everything
+        // traced since, so queue any chunks older than this one.
+        uint32_t horizon = flush_slots(w, c->first_epoch);
 
-    // Acquire and return a packet's worth of space in the trace
-    // buffer, flushing the trace buffer to the given fd to make space
-    // if necessary. The region acquired is protected from other
-    // threads writing or reading to it, so it must be released before
-    // a flush can occur.
-    __attribute__((always_inline)) halide_trace_packet_t *acquire_packet(void *user_context, int fd, uint32_t size) {
-        halide_trace_packet_t *packet = NULL;
-        while (!(packet = try_acquire_packet(user_context, size))) {
-            // Couldn't acquire space to write a packet. Flush and try again.
-            flush(user_context, fd);
+        halide_mutex_lock(&w->mutex);
+        for (TraceChunk *q = w->queue_head; q; q = q->next) {
+            if (epoch_before(q->first_epoch, horizon)) {
+                horizon = q->first_epoch;
+            }
+        }
+        if (epoch_before(w->horizon, horizon)) {
+            w->horizon = horizon;
         }
-        return packet;
+        horizon = w->horizon;
+        halide_mutex_unlock(&w->mutex);
+
+        write_chunk(NULL, c, horizon);
+
+        halide_mutex_lock(&w->mutex);
+        c->next = w->free_chunks;
+        w->free_chunks = c;
+        w->chunks_unwritten--;
+        halide_cond_broadcast(&w->chunk_written);
     }
+    halide_mutex_unlock(&w->mutex);
+}
 
-    // Release a packet, allowing it to be written out with flush
-    __attribute__((always_inline)) void release_packet(halide_trace_packet_t *) {
-        // Need a memory barrier to guarantee all the writes are done.
-        __sync_synchronize();
-        lock.release_shared();
+// Write out every packet traced so far.
+WEAK void flush_trace(TraceWriter *w) {
+    flush_slots(w, halide_trace_epoch + 1);
+    ScopedMutexLock lock(&w->mutex);
+    while (w->chunks_unwritten) {
+        halide_cond_wait(&w->chunk_written, &w->mutex);
     }
+}
 
-    TraceBuffer() : cursor(0), overage(0) {}
-};
+WEAK TraceWriter *get_trace_writer() {
+    if (!halide_trace_writer) {
+        ScopedSpinLock lock(&halide_trace_file_lock);
+        if (!halide_trace_writer) {
+            TraceWriter *w = (TraceWriter *)malloc(sizeof(TraceWriter));
+            halide_assert(NULL, w && "Could not allocate trace buffer");
+            memset(w, 0, sizeof(TraceWriter));
+            w->horizon = halide_trace_epoch;
+            w->thread = halide_spawn_thread(trace_writer_thread, w);
+            __sync_synchronize();
+            halide_trace_writer = w;
+        }
+    }
+    return halide_trace_writer;
+}
 
-WEAK TraceBuffer *halide_trace_buffer = NULL;
-WEAK int halide_trace_file = -1; // -1 indicates uninitialized
-WEAK int halide_trace_file_lock = 0;
-WEAK bool halide_trace_file_initialized = false;
-WEAK void *halide_trace_file_internally_opened = NULL;
+// Find the slot of the calling thread, claiming one if it has none.
+__attribute__((always_inline)) TraceSlot *get_trace_slot(TraceWriter *w) {
+    uintptr_t me = current_thread_id();
+    uint32_t hash = (uint32_t)(me ^ (me >> 16)) * 2654435761u;
+    int first = (int)(hash >> 8) % num_slots;
+    for (int i = 0; i < num_slots; i++) {
+        TraceSlot *slot = w->slots + (first + i) % num_slots;
+        if (slot->owner == me ||
+            (slot->owner == 0 && __sync_bool_compare_and_swap(&slot->owner, 0, me))) {
+            return slot;
+        }
+    }
+    return w->slots + first;
+}
 
 }}}
 
 extern "C" {
 
 WEAK int32_t halide_default_trace(void *user_context, const halide_trace_event_t *e) {
-    static int32_t ids = 1;
-
-    int32_t my_id = __sync_fetch_and_add(&ids, 1);
+    int32_t my_id;
 
     // If we're dumping to a file, use a binary format
     int fd = halide_get_trace_file(user_context);
     if (fd > 0) {
-        // Compute the total packet size
+        TraceWriter *w = get_trace_writer();
+        TraceSlot *slot = get_trace_slot(w);
+
         uint32_t value_bytes = (uint32_t)(e->type.lanes * e->type.bytes());
-        uint32_t header_bytes = (uint32_t)sizeof(halide_trace_packet_t);
-        uint32_t coords_bytes = e->dimensions * (uint32_t)sizeof(int32_t);
         uint32_t name_bytes = strlen(e->func) + 1;
         uint32_t trace_tag_bytes = e->trace_tag ? (strlen(e->trace_tag) + 1) : 1;
-        uint32_t total_size_without_padding = header_bytes + value_bytes + coords_bytes + name_bytes + trace_tag_bytes;
-        uint32_t total_size = (total_size_without_padding + 3) & ~3;
-
-        // Claim some space to write to in the trace buffer
-        halide_trace_packet_t *packet = halide_trace_buffer->acquire_packet(user_context, fd, total_size);
-
-        if (total_size > 4096) {
-            print(NULL) << total_size << "\n";
+        uint32_t max_bytes = max_encoded_bytes(e, value_bytes, name_bytes, trace_tag_bytes);
+        halide_assert(user_context, max_bytes <= chunk_bytes - sizeof(halide_trace_chunk_t));
+
+        bool is_load_or_store = (e->event == halide_trace_load || e->event == halide_trace_store);
+
+        TraceChunk *fresh = NULL;
+        while (true) {
+            {
+                ScopedSpinLock lock(&slot->lock);
+                TraceChunk *c = slot->chunk;
+                if (c && c->cursor + max_bytes > chunk_bytes) {
+                    // Queue the full chunk while still holding the
+                    // slot, so the writer thread never misses it.
+                    ScopedMutexLock mutex(&w->mutex);
+                    submit_chunk(w, c);
+                    c = slot->chunk = NULL;
+                }
+                if (!c && fresh) {
+                    c = slot->chunk = fresh;
+                    fresh = NULL;
+                }
+                if (c) {
+                    if (slot->next_id == slot->end_id) {
+                        slot->next_id = __sync_fetch_and_add(&halide_trace_next_id, ids_per_block);
+                        slot->end_id = slot->next_id + ids_per_block;
+                    }
+                    my_id = slot->next_id++;
+
+                    // The epoch must be read while holding the slot,
+                    // for the writer thread's horizon to be right.
+                    uint32_t epoch = (is_load_or_store ?
+                                      halide_trace_epoch :
+                                      __sync_add_and_fetch(&halide_trace_epoch, 1));
+                    append_packet(c, epoch, my_id, e, value_bytes);
+                    break;
+                }
+            }
+            // Get a new chunk without holding the slot, as it may
+            // need to wait for the writer thread.
+            ScopedMutexLock mutex(&w->mutex);
+            fresh = acquire_chunk(w);
         }
 
-        // Write a packet into it
-        packet->size = total_size;
-        packet->id = my_id;
-        packet->type = e->type;
-        packet->event = e->event;
-        packet->parent_id = e->parent_id;
-        packet->value_index = e->value_index;
-        packet->dimensions = e->dimensions;
-        if (e->coordinates) {
-            memcpy((void *)packet->coordinates(), e->coordinates, coords_bytes);
+        if (fresh) {
+            // Another thread sharing the slot gave it a chunk first.
+            ScopedMutexLock mutex(&w->mutex);
+            fresh->next = w->free_chunks;
+            w->free_chunks = fresh;
         }
-        if (e->value) {
-            memcpy((void *)packet->value(), e->value, value_bytes);
-        }
-        memcpy((void *)packet->func(), e->func, name_bytes);
-        memcpy((void *)packet->trace_tag(), e->trace_tag ? e->trace_tag : "", trace_tag_bytes);
-
-        // Release it
-        halide_trace_buffer->release_packet(packet);
 
         // We should also flush the trace buffer if we hit an event
         // that might be the end of the trace.
         if (e->event == halide_trace_end_pipeline) {
-            halide_trace_buffer->flush(user_context, fd);
+            flush_trace(w);
         }
 
     } else {
+        my_id = __sync_fetch_and_add(&halide_trace_next_id, 1);
+
         uint8_t buffer[4096];
         Printer<StringStreamPrinter, sizeof(buffer)> ss(user_context, (char *)buffer);
 
@@ -327,20 +567,25 @@ WEAK void halide_set_trace_file(int fd) {
 extern int errno;
 
 WEAK int halide_get_trace_file(void *user_context) {
+    // Every trace event asks for the file, so once it has been set
+    // up, return it without taking the lock.
+    if (__atomic_load_n(&halide_trace_file_initialized, __ATOMIC_ACQUIRE)) {
+        return halide_trace_file;
+    }
     ScopedSpinLock lock(&halide_trace_file_lock);
-    if (halide_trace_file < 0) {
-        const char *trace_file_name = getenv("HL_TRACE_FILE");
-        if (trace_file_name) {
-            void *file = fopen(trace_file_name, "ab");
-            halide_assert(user_context, file && "Failed to open trace file\n");
-            halide_set_trace_file(fileno(file));
-            halide_trace_file_internally_opened = file;
-            if (!halide_trace_buffer) {
-                halide_trace_buffer = (TraceBuffer *)malloc(sizeof(TraceBuffer));
+    if (!halide_trace_file_initialized) {
+        if (halide_trace_file < 0) {
+            const char *trace_file_name = getenv("HL_TRACE_FILE");
+            if (trace_file_name) {
+                void *file = fopen(trace_file_name, "ab");
+                halide_assert(user_context, file && "Failed to open trace file\n");
+                halide_set_trace_file(fileno(file));
+                halide_trace_file_internally_opened = file;
+            } else {
+                halide_set_trace_file(0);
             }
-        } else {
-            halide_set_trace_file(0);
         }
+        __atomic_store_n(&halide_trace_file_initialized, true, __ATOMIC_RELEASE);
     }
     return halide_trace_file;
 }
@@ -350,14 +595,37 @@ WEAK int32_t halide_trace(void *user_context, const halide_trace_event_t *e) {
 }
 
 WEAK int halide_shutdown_trace() {
+    TraceWriter *w = halide_trace_writer;
+    if (w) {
+        flush_trace(w);
+        if (w->thread) {
+            halide_mutex_lock(&w->mutex);
+            w->stop = true;
+            halide_cond_signal(&w->chunk_queued);
+            halide_mutex_unlock(&w->mutex);
+            halide_join_thread(w->thread);
+        }
+        for (int i = 0; i < num_slots; i++) {
+            // The slots are empty after the flush, but chunks
+            // claimed and never used may remain.
+            if (w->slots[i].chunk) {
+                free(w->slots[i].chunk);
+            }
+        }
+        while (w->free_chunks) {
+            TraceChunk *c = w->free_chunks;
+            w->free_chunks = c->next;
+            free(c);
+        }
+        free(w);
+        halide_trace_writer = NULL;
+    }
+
     if (halide_trace_file_internally_opened) {
         int ret = fclose(halide_trace_file_internally_opened);
         halide_trace_file = 0;
         halide_trace_file_initialized = false;
         halide_trace_file_internally_opened = NULL;
-        if (halide_trace_buffer) {
-            free(halide_trace_buffer);
-        }
         return ret;
     } else {
         return 0;
@@ -29,6 +29,7 @@ extern WIN32API void DeleteCriticalSection(CriticalSection *);
 extern WIN32API void EnterCriticalSection(CriticalSection *);
 extern WIN32API void LeaveCriticalSection(CriticalSection *);
 extern WIN32API int32_t WaitForSingleObject(Thread, int32_t timeout);
+extern WIN32API uint32_t GetCurrentThreadId();
 
 } // extern "C"
 
@@ -45,6 +46,10 @@ WEAK void *spawn_thread_helper(void *arg) {
     return NULL;
 }
 
+WEAK uintptr_t current_thread_id() {
+    return GetCurrentThreadId();
+}
+
 }}} // namespace Halide::Runtime::Internal
 
 extern "C" {
@@ -0,0 +1,67 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+int main(int argc, char **argv) {
+    ImageParam input(Float(32), 2);
+    Param<float> scale;
+
+    Var x("x"), y("y");
+    Func blur_x("blur_x"), blur_y("blur_y"), out("out");
+    blur_x(x, y) = (input(x, y) + input(x + 1, y) + input(x + 2, y)) / 3;
+    blur_y(x, y) = (blur_x(x, y) + blur_x(x, y + 1) + blur_x(x, y + 2)) / 3;
+    out(x, y) = blur_y(x, y) * scale;
+
+    // Autotuning benchmarks candidate schedules on inputs of the estimated
+    // sizes, so every input needs an estimate.
+    input.dim(0).set_bounds_estimate(0, 1026);
+    input.dim(1).set_bounds_estimate(0, 1026);
+    scale.set_estimate(2.0f);
+    out.estimate(x, 0, 1024).estimate(y, 0, 1024);
+
+    Buffer<float> in(1026, 1026);
+    for (int yy = 0; yy < in.height(); yy++) {
+        for (int xx = 0; xx < in.width(); xx++) {
+            in(xx, yy) = rand() & 0xff;
+        }
+    }
+    input.set(in);
+    scale.set(0.5f);
+
+    set_auto_schedule_autotune_width(4);
+    Target target = get_jit_target_from_environment();
+    Pipeline p(out);
+    std::string schedule = p.auto_schedule(target);
+    set_auto_schedule_autotune_width(0);
+
+    if (schedule.find("// Autotuned") == std::string::npos) {
+        printf("Expected an autotuned schedule:\n%s\n", schedule.c_str());
+        return -1;
+    }
+
+    // Autotuning must leave the inputs as they were.
+    if (input.get().data() != in.data()) {
+        printf("Autotuning changed the input buffer\n");
+        return -1;
+    }
+
+    Buffer<float> result = p.realize(1024, 1024);
+    for (int yy = 0; yy < result.height(); yy++) {
+        for (int xx = 0; xx < result.width(); xx++) {
+            float bx[3];
+            for (int i = 0; i < 3; i++) {
+                bx[i] = (in(xx, yy + i) + in(xx + 1, yy + i) + in(xx + 2, yy + i)) / 3;
+            }
+            float correct = (bx[0] + bx[1] + bx[2]) / 3 * 0.5f;
+            if (fabs(result(xx, yy) - correct) > 1e-3f) {
+                printf("result(%d, %d) = %f instead of %f\n", xx, yy, result(xx, yy), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
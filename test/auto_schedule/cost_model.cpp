@@ -0,0 +1,63 @@
+#include "Halide.h"
+#include <iostream>
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+int main(int argc, char **argv) {
+    Buffer<float> input(1024, 1024);
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = rand() & 0xff;
+        }
+    }
+
+    Target target = get_jit_target_from_environment();
+
+    Buffer<float> reference, out;
+    for (int i = 0; i < 2; i++) {
+        Var x("x"), y("y");
+        Func blur_x("blur_x"), blur_y("blur_y");
+        blur_x(x, y) = (input(x, y) + input(x + 1, y) + input(x + 2, y)) / 3;
+        blur_y(x, y) = (blur_x(x, y) + blur_x(x, y + 1) + blur_x(x, y + 2)) / 3;
+        blur_y.estimate(x, 0, input.width() - 2).estimate(y, 0, input.height() - 2);
+
+        // Schedule once with the hand-written model, and once with the
+        // hand-estimated linear model.
+        if (i == 1) {
+            set_auto_schedule_cost_model(LinearCostModel::avx2_estimate());
+        }
+
+        Pipeline p(blur_y);
+        p.auto_schedule(target);
+        blur_y.print_loop_nest();
+        (i == 0 ? reference : out) = p.realize(input.width() - 2, input.height() - 2);
+    }
+    set_auto_schedule_cost_model(nullptr);
+
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            if (out(x, y) != reference(x, y)) {
+                printf("out(%d, %d) = %f instead of %f\n", x, y, out(x, y), reference(x, y));
+                return -1;
+            }
+        }
+    }
+
+    // The linear model should cost a group in proportion to its features.
+    GroupFeatures features;
+    features[GroupFeatures::Ops + (int)OpKind::Mul] = 1000;
+    features[GroupFeatures::FootprintWeightedBytesLoaded] = 1000;
+    LinearCostModel model;
+    model.weights[GroupFeatures::Ops + (int)OpKind::Mul] = 2;
+    model.weights[GroupFeatures::FootprintWeightedBytesLoaded] = 3;
+    Cost cost = model.group_cost(features, Cost());
+    if (!can_prove(cost.arith == 2000 * 1000) || !can_prove(cost.memory == 3000 * 1000)) {
+        std::cout << "Unexpected linear model cost: " << cost << "\n";
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
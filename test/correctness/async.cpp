@@ -0,0 +1,86 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int check(const Buffer<int> &im, int offset) {
+    for (int y = 0; y < im.height(); y++) {
+        for (int x = 0; x < im.width(); x++) {
+            int correct = 2 * (x + y) + offset;
+            if (im(x, y) != correct) {
+                printf("im(%d, %d) = %d instead of %d\n", x, y, im(x, y), correct);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Var x, y;
+
+    // An async producer computed at root.
+    {
+        Func producer, consumer;
+        producer(x, y) = x + y;
+        consumer(x, y) = producer(x, y) + producer(x, y);
+        producer.compute_root().async();
+
+        Buffer<int> out = consumer.realize(64, 64);
+        if (check(out, 0)) return -1;
+    }
+
+    // An async producer computed per scanline of its consumer, with
+    // storage hoisted outside the loop so that the producer can run
+    // ahead.
+    {
+        Func producer, consumer;
+        producer(x, y) = x + y;
+        consumer(x, y) = producer(x, y - 1) + producer(x, y + 1);
+        producer.store_root().compute_at(consumer, y).async();
+
+        Buffer<int> out = consumer.realize(64, 64);
+        if (check(out, 0)) return -1;
+    }
+
+    // The same thing, but with the storage folded into a ring
+    // buffer, so the producer must wait for the consumer.
+    {
+        Func producer, consumer;
+        producer(x, y) = x + y;
+        consumer(x, y) = producer(x, y - 1) + producer(x, y + 1);
+        producer.store_root().compute_at(consumer, y).fold_storage(y, 4).async();
+
+        Buffer<int> out = consumer.realize(64, 64);
+        if (check(out, 0)) return -1;
+    }
+
+    // Async producers nested inside the consumer of another async
+    // producer, with folded storage, inside a parallel loop over
+    // strips of the output.
+    {
+        Func f, g, h;
+        f(x, y) = x + y;
+        g(x, y) = f(x, y - 1) + f(x, y + 1);
+        h(x, y) = g(x, y - 1) + g(x, y + 1);
+
+        Var yo, yi;
+        h.split(y, yo, yi, 16).parallel(yo);
+        g.store_at(h, yo).compute_at(h, yi).async();
+        f.compute_root().async();
+
+        Buffer<int> out = h.realize(64, 64);
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                int correct = 4 * (x + y);
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// Check a histogram-like update scheduled with atomic() against one
+// computed serially.
+template<typename T>
+int check(const std::string &name, Func f, Func reference, int size) {
+    Buffer<T> result = f.realize(size);
+    Buffer<T> correct = reference.realize(size);
+    for (int x = 0; x < size; x++) {
+        if (result(x) != correct(x)) {
+            printf("%s: result(%d) = %f instead of %f\n",
+                   name.c_str(), x, (double)result(x), (double)correct(x));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.has_gpu_feature()) {
+        printf("Atomic updates are not supported inside GPU kernels. Skipping test.\n");
+        return 0;
+    }
+
+    const int W = 256, H = 256, bins = 64;
+    Buffer<int> in(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            in(x, y) = rand() & 0xfff;
+        }
+    }
+
+    Var x;
+    RDom r(in);
+    Expr bin = clamp(in(r.x, r.y) % bins, 0, bins - 1);
+
+    // Integer addition becomes an atomic add.
+    {
+        Func f("parallel_hist"), ref("serial_hist");
+        f(x) = 0;
+        f(bin) += 1;
+        ref(x) = 0;
+        ref(bin) += 1;
+
+        f.update().atomic().parallel(r.y);
+        if (check<int>("parallel histogram", f, ref, bins)) return -1;
+    }
+
+    // Vectorizing over the RVar too, where lanes often update the
+    // same bin.
+    {
+        Func f("vector_hist"), ref("serial_hist");
+        f(x) = 0;
+        f(bin) += 1;
+        ref(x) = 0;
+        ref(bin) += 1;
+
+        RVar rxo, rxi;
+        f.update().atomic().split(r.x, rxo, rxi, 8).vectorize(rxi).parallel(r.y);
+        if (check<int>("vectorized histogram", f, ref, bins)) return -1;
+    }
+
+    // Integer max becomes an atomic max.
+    {
+        Func f("parallel_max"), ref("serial_max");
+        f(x) = -1;
+        f(bin) = max(f(bin), in(r.x, r.y));
+        ref(x) = -1;
+        ref(bin) = max(ref(bin), in(r.x, r.y));
+
+        f.update().atomic().parallel(r.y);
+        if (check<int>("parallel max", f, ref, bins)) return -1;
+    }
+
+    // Floating-point updates use a compare-and-swap loop. The sums of
+    // small integers are exact, so any order gives the same result.
+    {
+        Func f("parallel_sum"), ref("serial_sum");
+        f(x) = 0.0f;
+        f(bin) += cast<float>(in(r.x, r.y) & 0xf);
+        ref(x) = 0.0f;
+        ref(bin) += cast<float>(in(r.x, r.y) & 0xf);
+
+        f.update().atomic().parallel(r.y).vectorize(r.x, 4);
+        if (check<float>("parallel float sum", f, ref, bins)) return -1;
+    }
+
+    // An update which doesn't map to a single instruction.
+    {
+        Func f("parallel_mul"), ref("serial_mul");
+        f(x) = cast<uint32_t>(1);
+        f(bin) *= cast<uint32_t>(in(r.x, r.y) | 1);
+        ref(x) = cast<uint32_t>(1);
+        ref(bin) *= cast<uint32_t>(in(r.x, r.y) | 1);
+
+        f.update().atomic().parallel(r.y);
+        if (check<uint32_t>("parallel product", f, ref, bins)) return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
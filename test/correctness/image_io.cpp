@@ -40,6 +40,37 @@ void test_round_trip(Buffer<T> buf, std::string format) {
     }
 }
 
+// .tmp and .mat payloads may be memory-mapped when loaded. Writing to
+// the loaded image must not change the file, and it must be safe to
+// overwrite the file while the image is still alive.
+template<typename T>
+void test_mapped_reload(Buffer<T> buf, std::string format) {
+    std::string filename = Internal::get_test_tmp_dir() + "test_mapped." + format;
+    Tools::save_image(buf, filename);
+
+    Buffer<T> first = Tools::load_image(filename);
+    first.fill(1);
+
+    Buffer<T> second = Tools::load_image(filename);
+    Tools::save_image(second, filename);
+    Buffer<T> third = Tools::load_image(filename);
+
+    for (int d = 0; d < buf.dimensions(); ++d) {
+        third.translate(d, buf.dim(d).min() - third.dim(d).min());
+    }
+    bool ok = true;
+    third.for_each_element([&](const int *pos) {
+        ok &= (third(pos) == buf(pos));
+    });
+    first.for_each_value([&](T v) {
+        ok &= (v == 1);
+    });
+    if (!ok) {
+        printf("test_mapped_reload: Image changed when reloaded as %s\n", format.c_str());
+        abort();
+    }
+}
+
 // static -> static conversion test
 template<typename T>
 void test_convert_image_s2s(Buffer<T> buf) {
@@ -205,6 +236,7 @@ void do_test() {
 
             std::cout << "Testing format: " << format << " for " << halide_type_of<T>() << "x4\n";
             test_round_trip(funky_buf, format);
+            test_mapped_reload(cb4, format);
 
             continue;
         }
@@ -212,6 +244,9 @@ void do_test() {
             std::cout << "Testing format: " << format << " for " << halide_type_of<T>() << "x3\n";
             // pgm really only supports gray images.
             test_round_trip(color_buf, format);
+            if (format == "mat") {
+                test_mapped_reload(color_buf, format);
+            }
         }
         if (format != "ppm") {
             std::cout << "Testing format: " << format << " for " << halide_type_of<T>() << "x1\n";
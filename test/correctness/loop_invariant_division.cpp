@@ -0,0 +1,153 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <limits>
+#include <random>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count divisions and mods by a given variable that are left inside
+// loops at the end of lowering.
+int divisions_in_loops = 0;
+
+class CountDivisionsInLoops : public IRMutator2 {
+    using IRMutator2::visit;
+
+    std::string divisor;
+    int loop_depth = 0;
+
+    void check(const Expr &e, const Expr &b) {
+        if (loop_depth > 0 && expr_uses_var(b, divisor)) {
+            std::cerr << "Found division by " << divisor << " in a loop: " << e << "\n";
+            divisions_in_loops++;
+        }
+    }
+
+    Stmt visit(const For *op) override {
+        loop_depth++;
+        Stmt s = IRMutator2::visit(op);
+        loop_depth--;
+        return s;
+    }
+
+    Expr visit(const Div *op) override {
+        check(op, op->b);
+        return IRMutator2::visit(op);
+    }
+
+    Expr visit(const Mod *op) override {
+        check(op, op->b);
+        return IRMutator2::visit(op);
+    }
+
+public:
+    CountDivisionsInLoops(const std::string &divisor) : divisor(divisor) {}
+};
+
+// Euclidean division and modulo, computed with native division.
+template<typename T>
+void reference_div_mod(T a, T b, T *q, T *r) {
+    int64_t big_a = a, big_b = b;
+    int64_t big_q = big_a / big_b;
+    int64_t big_r = big_a % big_b;
+    if (big_r < 0) {
+        big_r += big_b < 0 ? -big_b : big_b;
+        big_q = (big_a - big_r) / big_b;
+    }
+    *q = (T)big_q;
+    *r = (T)big_r;
+}
+
+// Divide random numerators by a Param, which lowering turns into a
+// multiply and shifts using values computed once outside the loop.
+template<typename T>
+bool test(int vector_width) {
+    const int W = 1024;
+    const T t_min = std::numeric_limits<T>::min();
+    const T t_max = std::numeric_limits<T>::max();
+
+    std::mt19937 rng(0);
+    Buffer<T> in(W);
+    for (int i = 0; i < W; i++) {
+        in(i) = (T)rng();
+    }
+    // Make sure the extremes are covered.
+    in(0) = t_min;
+    in(1) = t_max;
+    in(2) = 0;
+    in(3) = 1;
+
+    Param<T> divisor;
+    Var x;
+    Func div, mod;
+    div(x) = in(x) / divisor;
+    mod(x) = in(x) % divisor;
+    if (vector_width > 1) {
+        div.vectorize(x, vector_width);
+        mod.vectorize(x, vector_width);
+    }
+    div.add_custom_lowering_pass(new CountDivisionsInLoops(divisor.name()));
+    mod.add_custom_lowering_pass(new CountDivisionsInLoops(divisor.name()));
+
+    std::vector<T> divisors = {1, 2, 3, 7, 10, 100, (T)255, t_max, (T)(t_max - 1), (T)(t_max / 2 + 1)};
+    for (int i = 0; i < 20; i++) {
+        divisors.push_back((T)rng());
+    }
+    if (t_min < 0) {
+        std::vector<T> negative = {(T)-1, (T)-2, (T)-3, (T)-7, (T)-100, t_min, (T)(t_min + 1)};
+        divisors.insert(divisors.end(), negative.begin(), negative.end());
+    }
+
+    for (T d : divisors) {
+        if (d == 0) continue;
+        divisor.set(d);
+        Buffer<T> q = div.realize(W);
+        Buffer<T> r = mod.realize(W);
+        for (int i = 0; i < W; i++) {
+            T a = in(i);
+            if (t_min < 0 && a == t_min && d == (T)-1) {
+                // Overflows
+                continue;
+            }
+            T correct_q, correct_r;
+            reference_div_mod(a, d, &correct_q, &correct_r);
+            if (q(i) != correct_q || r(i) != correct_r) {
+                printf("%lld / %lld = %lld, %lld %% %lld = %lld, instead of %lld and %lld (vector width %d)\n",
+                       (long long)a, (long long)d, (long long)q(i),
+                       (long long)a, (long long)d, (long long)r(i),
+                       (long long)correct_q, (long long)correct_r, vector_width);
+                return false;
+            }
+        }
+    }
+
+    // Only the values used to divide by the divisor, which are
+    // computed before the loop, should divide by it.
+    if (divisions_in_loops > 0) {
+        printf("Division by a loop invariant was not lowered (vector width %d)\n", vector_width);
+        return false;
+    }
+    return true;
+}
+
+template<typename T>
+bool test_all(const Target &target) {
+    return (test<T>(1) &&
+            test<T>(target.natural_vector_size<T>()));
+}
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+
+    if (!test_all<uint8_t>(target) ||
+        !test_all<int8_t>(target) ||
+        !test_all<uint16_t>(target) ||
+        !test_all<int16_t>(target) ||
+        !test_all<uint32_t>(target) ||
+        !test_all<int32_t>(target)) {
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,168 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Get the number of runs and cache hits of each lowering pass since
+// the last call, keyed by pass name.
+std::map<std::string, LoweringPassStats> pass_stats() {
+    std::map<std::string, LoweringPassStats> result;
+    for (const LoweringPassStats &s : lowering_pass_stats()) {
+        result[s.name] = s;
+    }
+    reset_lowering_pass_stats();
+    return result;
+}
+
+int check(const Buffer<int> &im) {
+    for (int y = 0; y < im.height(); y++) {
+        for (int x = 0; x < im.width(); x++) {
+            int correct = 2 * x * y + 6;
+            if (im(x, y) != correct) {
+                printf("im(%d, %d) = %d instead of %d\n", x, y, im(x, y), correct);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Build the same pipeline from scratch, with new Param and ImageParam
+// objects that have the same names each time. Funcs constructed by
+// name are given unique names, so make the Functions directly to get
+// a pipeline that lowers to the same Stmt as the last one.
+Func build_pipeline(Param<int> &scale, ImageParam &in) {
+    Var x("x"), y("y");
+    Func f(Function("rebuilt_f")), g(Function("rebuilt_g"));
+    f(x, y) = Call::make(in.parameter(), {x, y}) * scale;
+    g(x, y) = f(x, y) + 1;
+    f.compute_root();
+    return g;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+
+    Var x, y;
+    Param<int> p;
+    Func f, g;
+    f(x, y) = x * y + p;
+    g(x, y) = f(x - 1, y) + f(x + 1, y);
+    f.compute_root();
+    p.set(3);
+
+    set_lowering_cache_size(0);
+    clear_lowering_cache();
+    g.compile_to_module({p}, "g", t);
+    pass_stats();
+
+    // With the cache disabled, nothing is reused.
+    {
+        g.compile_to_module({p}, "g", t);
+        for (const auto &it : pass_stats()) {
+            if (it.second.runs && it.second.hits) {
+                printf("Pass %s hit the cache while it was disabled\n", it.first.c_str());
+                return -1;
+            }
+        }
+    }
+
+    set_lowering_cache_size(16);
+
+    Stmt first;
+    {
+        Module m = g.compile_to_module({p}, "g", t);
+        first = m.functions()[0].body;
+        pass_stats();
+    }
+
+    // Lowering again, or after changing only an estimate, should
+    // reuse the result of every pass, and produce the same code.
+    for (int i = 0; i < 2; i++) {
+        if (i == 1) {
+            p.set_estimate(100);
+        }
+        Module m = g.compile_to_module({p}, "g", t);
+        for (const auto &it : pass_stats()) {
+            if (it.second.runs != it.second.hits) {
+                printf("Pass %s ran %d times, but only hit the cache %d times\n",
+                       it.first.c_str(), (int)it.second.runs, (int)it.second.hits);
+                return -1;
+            }
+        }
+        if (!equal(m.functions()[0].body, first)) {
+            printf("Lowering from the cache produced different code\n");
+            return -1;
+        }
+    }
+
+    // Changing a schedule directive that only a late pass cares about
+    // still lets the earlier passes that only look at the Stmt reuse
+    // their results.
+    {
+        f.async();
+        Buffer<int> out = g.realize(32, 32, t);
+        if (check(out)) return -1;
+        auto stats = pass_stats();
+        if (stats["schedule_functions"].hits != 0) {
+            printf("schedule_functions should have missed after a schedule change\n");
+            return -1;
+        }
+        if (stats["canonicalize_gpu_vars"].hits == 0) {
+            printf("canonicalize_gpu_vars should have been reused after a schedule change\n");
+            return -1;
+        }
+    }
+
+    // Changing the range of a Param changes the generated checks, so
+    // the passes that only look at the Stmt must miss.
+    {
+        p.set_range(0, 10);
+        Buffer<int> out = g.realize(32, 32, t);
+        if (check(out)) return -1;
+        auto stats = pass_stats();
+        if (stats["add_parameter_checks"].hits != 0) {
+            printf("add_parameter_checks should have missed after changing a Param's range\n");
+            return -1;
+        }
+    }
+
+    // Rebuilding the pipeline with new Params of the same names reuses
+    // the results of earlier passes, but the code must use the values
+    // bound to the new Params.
+    for (int i = 0; i < 3; i++) {
+        Param<int> scale("scale");
+        ImageParam in(Int(32), 2, "in");
+        Func g = build_pipeline(scale, in);
+
+        Buffer<int> input(16, 16);
+        input.for_each_element([&](int x, int y) {
+            input(x, y) = x + y + i;
+        });
+        in.set(input);
+        scale.set(i + 2);
+
+        Buffer<int> out = g.realize(16, 16, t);
+        auto stats = pass_stats();
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                int correct = (x + y + i) * (i + 2) + 1;
+                if (out(x, y) != correct) {
+                    printf("Rebuilt pipeline %d: out(%d, %d) = %d instead of %d\n",
+                           i, x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+        if (i > 0 && stats["schedule_functions"].hits == 0) {
+            printf("schedule_functions should have been reused after rebuilding the pipeline\n");
+            return -1;
+        }
+    }
+
+    set_lowering_cache_size(0);
+
+    printf("Success!\n");
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <chrono>
 #include <stdio.h>
 #include <stdlib.h>
 #include "Halide.h"
@@ -34,6 +35,22 @@ extern "C" DLLEXPORT int count_calls_with_arg(uint8_t val, halide_buffer_t *out)
     return 0;
 }
 
+int expensive_call_count = 0;
+
+extern "C" DLLEXPORT int count_calls_with_cost(int32_t val, int32_t cost_ms, halide_buffer_t *out) {
+    if (!out->is_bounds_query()) {
+        if (cost_ms > 0) {
+            expensive_call_count++;
+            // Spin, so that the result is expensive to recompute.
+            auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(cost_ms);
+            while (std::chrono::steady_clock::now() < end) {
+            }
+        }
+        Halide::Runtime::Buffer<uint8_t>(*out).fill((uint8_t)val);
+    }
+    return 0;
+}
+
 int call_count_with_arg_parallel[8];
 
 extern "C" DLLEXPORT int count_calls_with_arg_parallel(uint8_t val, halide_buffer_t *out) {
@@ -393,10 +410,79 @@ int main(int argc, char **argv) {
         // TODO work out an assertion on call count here.
         fprintf(stderr, "Call count is %d.\n", call_count_with_arg);
 
+        // Every realization either hit or missed the cache, and the
+        // misses must have caused evictions to stay within budget.
+        halide_memoization_cache_stats_t stats = {};
+        Internal::JITSharedRuntime::memoization_cache_get_stats(&stats);
+        fprintf(stderr, "Cache hits %d, misses %d, evictions %d.\n",
+                (int)stats.hits, (int)stats.misses, (int)stats.evictions);
+        assert(stats.hits > 0 && stats.misses > 0 && stats.evictions > 0);
+        assert(stats.current_size <= stats.max_size);
+
         // Return cache size to default.
         Internal::JITSharedRuntime::memoization_cache_set_size(0);
     }
 
+    {
+        // Test that the cost-aware eviction policy evicts results
+        // that are cheap to recompute before expensive ones, whereas
+        // the LRU policy evicts the oldest results.
+        Param<int> key, cost_ms;
+
+        Func costly;
+        costly.define_extern("count_calls_with_cost", {key, cost_ms}, UInt(8), 2);
+        costly.compute_root().memoize();
+
+        Func g;
+        Var x, y;
+        g(x, y) = costly(x, y);
+
+        // Room for 128 of the 16x16 results.
+        Internal::JITSharedRuntime::memoization_cache_set_size(128 * 16 * 16);
+
+        int expensive_recomputed[2];
+        for (int cost_aware = 0; cost_aware < 2; cost_aware++) {
+            Internal::JITSharedRuntime::memoization_cache_set_eviction_policy(
+                cost_aware ? halide_memoization_cache_evict_cost_aware : halide_memoization_cache_evict_lru);
+
+            // Use different keys for each policy, so that nothing
+            // stored with the first policy is reused.
+            int first_key = cost_aware * 10000;
+
+            // Store a few expensive results, and then enough cheap
+            // ones to fill the cache several times over.
+            cost_ms.set(2);
+            for (int i = 0; i < 4; i++) {
+                key.set(first_key + i);
+                g.realize(16, 16);
+            }
+            cost_ms.set(0);
+            for (int i = 0; i < 1000; i++) {
+                key.set(first_key + 100 + i);
+                g.realize(16, 16);
+            }
+
+            // Count how many of the expensive results were evicted.
+            expensive_call_count = 0;
+            cost_ms.set(2);
+            for (int i = 0; i < 4; i++) {
+                key.set(first_key + i);
+                Buffer<uint8_t> out = g.realize(16, 16);
+                assert(out(0, 0) == (uint8_t)(first_key + i));
+            }
+            expensive_recomputed[cost_aware] = expensive_call_count;
+        }
+
+        fprintf(stderr, "Expensive results recomputed with LRU eviction %d, with cost-aware eviction %d.\n",
+                expensive_recomputed[0], expensive_recomputed[1]);
+        assert(expensive_recomputed[0] == 4);
+        assert(expensive_recomputed[1] == 0);
+
+        // Return the policy and cache size to the defaults.
+        Internal::JITSharedRuntime::memoization_cache_set_eviction_policy(halide_memoization_cache_evict_lru);
+        Internal::JITSharedRuntime::memoization_cache_set_size(0);
+    }
+
     {
         // Test flushing entire cache with a single element larger than the cache
         Param<float> val;
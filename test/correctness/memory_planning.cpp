@@ -0,0 +1,91 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int mallocs = 0;
+
+void *my_malloc(void *user_context, size_t x) {
+    mallocs++;
+    void *orig = malloc(x + 128);
+    void *ptr = (void *)((((size_t)orig + 128) >> 7) << 7);
+    ((void **)ptr)[-1] = orig;
+    return ptr;
+}
+
+void my_free(void *user_context, void *ptr) {
+    free(((void **)ptr)[-1]);
+}
+
+int main(int argc, char **argv) {
+    const int W = 1024, H = 256;
+    const int buffer_size = W * H * sizeof(int);
+
+    Func f1, f2, f3, g;
+    Var x, y;
+
+    f1(x, y) = x + y;
+    f2(x, y) = f1(x, y) * 2;
+    f3(x, y) = f2(x, y) + 1;
+    g(x, y) = f3(x, y) + f2(x, y);
+
+    // f1 is dead by the time f3 is computed, so they can share memory.
+    f1.compute_root();
+    f2.compute_root();
+    f3.compute_root();
+    g.bound(x, 0, W).bound(y, 0, H);
+
+    ImageParam scratch(UInt(8), 1);
+    Pipeline p(g);
+    p.set_memory_planning_scratch(scratch);
+    p.set_custom_allocator(my_malloc, my_free);
+
+    // A scratch buffer with no memory gets its extent set to the
+    // size required. The pipeline still runs, using the heap.
+    Buffer<uint8_t> query(nullptr, 0);
+    scratch.set(query);
+    p.realize(W, H);
+    int slab_size = query.dim(0).extent();
+    if (slab_size < 2 * buffer_size || slab_size >= 3 * buffer_size) {
+        printf("Unexpected slab size %d for three buffers of %d bytes\n", slab_size, buffer_size);
+        return -1;
+    }
+    if (mallocs != 1) {
+        printf("Expected a single heap allocation, but there were %d\n", mallocs);
+        return -1;
+    }
+
+    // With a large enough scratch buffer, there are no heap
+    // allocations at all.
+    Buffer<uint8_t> buf(slab_size);
+    scratch.set(buf);
+    mallocs = 0;
+    Buffer<int> out = p.realize(W, H);
+    if (mallocs != 0) {
+        printf("Expected no heap allocations, but there were %d\n", mallocs);
+        return -1;
+    }
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            int correct = 4 * (x + y) + 1;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    // A scratch buffer that is too small is ignored.
+    Buffer<uint8_t> small(slab_size / 2);
+    scratch.set(small);
+    mallocs = 0;
+    p.realize(W, H);
+    if (mallocs != 1) {
+        printf("Expected a single heap allocation with a small scratch buffer, but there were %d\n", mallocs);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+int main(int argc, char **argv) {
+    Func f, g;
+    Var x, y;
+
+    f(x, y) = x + y;
+    g(x, y) = f(x - 1, y) + f(x + 1, y);
+
+    // Compute f per row of g, in parallel, so that every task allocates
+    // and frees a buffer on the heap.
+    Var yo, yi;
+    g.split(y, yo, yi, 8).parallel(yo);
+    f.compute_at(g, yi);
+
+    g.realize(1024, 256);
+
+    halide_memory_pool_stats_t before;
+    JITSharedRuntime::memory_pool_get_stats(&before);
+
+    Buffer<int> out = g.realize(1024, 256);
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            int correct = 2 * (x + y);
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    halide_memory_pool_stats_t after;
+    JITSharedRuntime::memory_pool_get_stats(&after);
+
+    // The second run should reuse the blocks freed by the first.
+    if (after.hits <= before.hits) {
+        printf("The memory pool was not used: %llu hits before, %llu after\n",
+               (unsigned long long)before.hits, (unsigned long long)after.hits);
+        return -1;
+    }
+    if (after.peak_size <= 0) {
+        printf("Peak pool size should be positive\n");
+        return -1;
+    }
+
+    JITSharedRuntime::memory_pool_release();
+    JITSharedRuntime::memory_pool_get_stats(&after);
+    if (after.current_size != 0) {
+        printf("Pool still holds %lld bytes after release\n", (long long)after.current_size);
+        return -1;
+    }
+
+    // With pooling disabled, nothing should be reused.
+    JITSharedRuntime::memory_pool_set_limit(0);
+    JITSharedRuntime::memory_pool_get_stats(&before);
+    g.realize(1024, 256);
+    JITSharedRuntime::memory_pool_get_stats(&after);
+    if (after.hits != before.hits || after.current_size != 0) {
+        printf("The memory pool was used while disabled\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include "Halide.h"
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <thread>
+
+#include "test/common/halide_test_dirs.h"
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Make a fresh pipeline for each target, the way a Generator does,
+// so that the targets can be lowered at the same time.
+Module make_module(const std::string &name, const Target &target) {
+    ImageParam input(Float(32), 2, "input");
+    Func blur_x("blur_x"), blur_y("blur_y");
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+    blur_x(x, y) = (input(x, y) + input(x + 1, y) + input(x + 2, y)) / 3;
+    blur_y(x, y) = (blur_x(x, y) + blur_x(x, y + 1) + blur_x(x, y + 2)) / 3;
+    blur_y.tile(x, y, xi, yi, 32, 8).vectorize(xi, 8).parallel(y);
+    blur_x.compute_at(blur_y, x).vectorize(x, 8);
+    return Pipeline(blur_y).compile_to_module({input}, name, target);
+}
+
+std::string read_file(const std::string &name) {
+    std::ifstream f(name);
+    std::stringstream s;
+    s << f.rdbuf();
+    return s.str();
+}
+
+// Compile for several targets that lower identically, and return
+// the Stmt of each one with the target-specific names removed.
+std::vector<std::string> compile(int threads) {
+    set_compile_threads(threads);
+
+    std::string prefix = get_test_tmp_dir() + "parallel_compile_" + std::to_string(threads);
+    std::vector<Target> targets = {
+        get_host_target().with_feature(Target::CUDACapability30),
+        get_host_target().with_feature(Target::CUDACapability32),
+        get_host_target(),
+    };
+    Outputs outputs = Outputs().static_library(prefix + ".a").stmt(prefix + ".stmt");
+    compile_multitarget("parallel_compile", outputs, targets, make_module, {}, true);
+
+    std::vector<std::string> stmts;
+    for (const Target &t : targets) {
+        std::string suffix = "_" + replace_all(t.to_string(), "-", "_");
+        std::string stmt = read_file(prefix + suffix + ".stmt");
+        // Drop the module header, which names the target.
+        stmt = stmt.substr(stmt.find('\n') + 1);
+        stmts.push_back(replace_all(stmt, "parallel_compile" + suffix, "parallel_compile"));
+    }
+    return stmts;
+}
+
+int main(int argc, char **argv) {
+    // The names made by each task depend only on the counters when
+    // the tasks started.
+    {
+        std::vector<std::string> serial(8), parallel(8);
+        set_compile_threads(1);
+        run_compile_tasks(8, [&](size_t i) {
+            serial[i] = unique_name('t');
+        });
+        set_compile_threads(4);
+        run_compile_tasks(8, [&](size_t i) {
+            parallel[i] = unique_name('t');
+        });
+        std::string after = unique_name('t');
+        for (size_t i = 1; i < 8; i++) {
+            if (serial[i] != serial[0] || parallel[i] != parallel[0]) {
+                printf("Tasks made different names: %s vs %s, %s vs %s\n",
+                       serial[i].c_str(), serial[0].c_str(),
+                       parallel[i].c_str(), parallel[0].c_str());
+                return -1;
+            }
+        }
+        // The names are still unique relative to the names made
+        // before and after the tasks.
+        if (parallel[0] == serial[0] || after == parallel[0]) {
+            printf("Names were reused: %s %s %s\n",
+                   serial[0].c_str(), parallel[0].c_str(), after.c_str());
+            return -1;
+        }
+    }
+
+    // The simplifier can be used from several threads at once.
+    {
+        Var x("x"), y("y");
+        std::vector<Expr> exprs;
+        for (int i = 0; i < 64; i++) {
+            exprs.push_back(min(x * i + y, (x * i + y) + 3) - max(y - i, y + x) + (x + i) / 4);
+        }
+        std::vector<Expr> serial(exprs.size()), parallel(exprs.size());
+        for (size_t i = 0; i < exprs.size(); i++) {
+            serial[i] = simplify(exprs[i]);
+        }
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 8; t++) {
+            threads.emplace_back([&, t]() {
+                for (size_t i = t; i < exprs.size(); i += 8) {
+                    parallel[i] = simplify(exprs[i]);
+                }
+            });
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+        for (size_t i = 0; i < exprs.size(); i++) {
+            if (!equal(serial[i], parallel[i])) {
+                std::cout << "Simplifying " << exprs[i] << " on another thread gave "
+                          << parallel[i] << " instead of " << serial[i] << "\n";
+                return -1;
+            }
+        }
+    }
+
+    // Targets that lower identically give the same Stmt, whether
+    // they are lowered one at a time or in parallel, as the names
+    // generated for each one don't depend on the others.
+    for (int threads : {1, 4}) {
+        std::vector<std::string> stmts = compile(threads);
+        for (size_t i = 1; i < stmts.size(); i++) {
+            if (stmts[0].empty() || stmts[i] != stmts[0]) {
+                printf("Target %d lowered differently with %d threads:\n%s\nvs\n%s\n",
+                       (int)i, threads, stmts[i].c_str(), stmts[0].c_str());
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
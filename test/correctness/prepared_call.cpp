@@ -0,0 +1,70 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+bool error_occurred = false;
+void my_error_handler(void *user_context, const char *msg) {
+    error_occurred = true;
+}
+
+int main(int argc, char **argv) {
+    Func f;
+    Var x, y;
+    Param<int> offset;
+    ImageParam in(Int(32), 2);
+
+    f(x, y) = in(x, y) + offset;
+
+    Buffer<int> input(16, 16);
+    input.for_each_element([&](int x, int y) { input(x, y) = x + y * 16; });
+    in.set(input);
+    offset.set(1);
+
+    Pipeline p(f);
+    p.set_error_handler(my_error_handler);
+
+    Buffer<int> out(16, 16);
+    PreparedCall call = p.prepare(out);
+
+    // The Param is read at each call, so new values are used.
+    for (int i = 0; i < 3; i++) {
+        offset.set(i);
+        call.run();
+        if (error_occurred) {
+            printf("Unexpected error\n");
+            return -1;
+        }
+        for (int y = 0; y < 16; y++) {
+            for (int x = 0; x < 16; x++) {
+                int correct = x + y * 16 + i;
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // The prepared call is still bound to the original input.
+    in.set(Buffer<int>(8, 8));
+    call.run();
+    if (error_occurred) {
+        printf("Unexpected error after rebinding the ImageParam\n");
+        return -1;
+    }
+
+    // Errors are reported on each call. The output is larger than the
+    // input it was prepared with.
+    in.set(input);
+    Buffer<int> big(32, 32);
+    PreparedCall bad_call = p.prepare(big);
+    bad_call.run();
+    if (!error_occurred) {
+        printf("There should have been an error\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+using namespace Halide;
+
+std::string timeline_file;
+
+void my_print(void *, const char *msg) {
+    printf("%s", msg);
+    const char *prefix = "timeline written to ";
+    if (strncmp(msg, prefix, strlen(prefix)) == 0) {
+        timeline_file = msg + strlen(prefix);
+        timeline_file = timeline_file.substr(0, timeline_file.find('\n'));
+    }
+}
+
+int count(const std::string &str, const std::string &pattern) {
+    int n = 0;
+    for (size_t pos = str.find(pattern); pos != std::string::npos; pos = str.find(pattern, pos + 1)) {
+        n++;
+    }
+    return n;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.arch == Target::MIPS || t.os == Target::NoOS || t.os == Target::QuRT) {
+        printf("The profiler is not supported on this target. Skipping test.\n");
+        return 0;
+    }
+
+    Func f("f"), g("g");
+    Var x, y;
+    f(x, y) = x + y;
+    g(x, y) = f(x, y) + f(x + 1, y);
+
+    const int tasks = 16;
+    f.compute_root().parallel(y);
+    g.parallel(y);
+
+    g.set_custom_print(&my_print);
+    g.realize(100, tasks, t.with_feature(Target::ProfileTimeline));
+
+    if (timeline_file.empty()) {
+        printf("The timeline was not written\n");
+        return -1;
+    }
+
+    FILE *file = fopen(timeline_file.c_str(), "r");
+    if (!file) {
+        printf("Could not open %s\n", timeline_file.c_str());
+        return -1;
+    }
+    std::string json;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), file)) > 0) {
+        json.append(buf, n);
+    }
+    fclose(file);
+    remove(timeline_file.c_str());
+
+    if (json.find("{\"traceEvents\":[") != 0) {
+        printf("The timeline is not in the Chrome trace format:\n%s\n", json.c_str());
+        return -1;
+    }
+
+    int begins = count(json, "\"ph\":\"B\""), ends = count(json, "\"ph\":\"E\"");
+    if (begins != ends) {
+        printf("Spans were not closed: %d begins, %d ends\n", begins, ends);
+        return -1;
+    }
+
+    // Each row of f and g is computed by a task.
+    int task_spans = count(json, "\"name\":\"task\"") / 2;
+    if (task_spans != 2 * tasks) {
+        printf("Expected %d parallel tasks on the timeline, but there were %d\n",
+               2 * tasks, task_spans);
+        return -1;
+    }
+
+    // Each Func is on the timeline once for the thread that
+    // launched it, and once for each of its tasks.
+    int f_spans = count(json, "\"name\":\"f\"") / 2;
+    int g_spans = count(json, "\"name\":\"g\"") / 2;
+    if (f_spans != tasks + 1 || g_spans != tasks + 1) {
+        printf("Expected %d spans for f and g, but there were %d and %d\n",
+               tasks + 1, f_spans, g_spans);
+        return -1;
+    }
+
+    // A pipeline profiled without a timeline doesn't record or write
+    // one, even after a timeline pipeline has run.
+    Func h("h");
+    h(x, y) = x * y;
+    h.parallel(y);
+    h.set_custom_print(&my_print);
+    timeline_file.clear();
+    h.realize(100, tasks, t.with_feature(Target::Profile));
+    if (!timeline_file.empty()) {
+        remove(timeline_file.c_str());
+        printf("A pipeline compiled without profile_timeline wrote a timeline\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int input_value(int x, int y) {
+    return (x * 17 + y * 31) % 251;
+}
+
+void load_input(Buffer<> &region) {
+    Buffer<int> b(region);
+    b.for_each_element([&](int x, int y) {
+        b(x, y) = input_value(x, y);
+    });
+}
+
+int main(int argc, char **argv) {
+    ImageParam input(Int(32), 2, "input");
+    Func blur_x("blur_x"), blur_y("blur_y");
+    Var x("x"), y("y");
+    blur_x(x, y) = input(x, y) + input(x + 1, y) + input(x + 2, y);
+    blur_y(x, y) = blur_x(x, y) + blur_x(x, y + 1) + blur_x(x, y + 2);
+    blur_x.compute_root();
+
+    Pipeline p(blur_y);
+
+    const int W = 100, H = 97;
+    Buffer<int> full_input(W + 2, H + 2);
+    full_input.for_each_element([&](int x, int y) {
+        full_input(x, y) = input_value(x, y);
+    });
+    input.set(full_input);
+    Buffer<int> correct = p.realize(W, H);
+    input.reset();
+
+    // Compute the same output in strips, with heights that divide
+    // the output evenly, that don't, and that cover it in one strip.
+    for (int strip_height : {1, 8, 10, 200}) {
+        Buffer<int> output(W, H);
+        int rows_stored = 0;
+        StripStats stats =
+            p.realize_in_strips({W, H}, strip_height, {StreamedInput(input, load_input)},
+                                [&](const Realization &r) {
+                                    Buffer<int> strip = r[0];
+                                    if (strip.dim(1).min() != rows_stored) {
+                                        printf("Strip starts at row %d instead of %d\n",
+                                               strip.dim(1).min(), rows_stored);
+                                        exit(-1);
+                                    }
+                                    rows_stored += strip.height();
+                                    output.copy_from(strip);
+                                });
+
+        if (rows_stored != H) {
+            printf("Stored %d rows instead of %d\n", rows_stored, H);
+            return -1;
+        }
+
+        int expected_strips = (H + strip_height - 1) / strip_height;
+        if (stats.strips != expected_strips) {
+            printf("%d strips instead of %d\n", stats.strips, expected_strips);
+            return -1;
+        }
+
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                if (output(x, y) != correct(x, y)) {
+                    printf("output(%d, %d) = %d instead of %d with strips %d high\n",
+                           x, y, output(x, y), correct(x, y), strip_height);
+                    return -1;
+                }
+            }
+        }
+
+        // Each row of the input should be loaded exactly once, and
+        // rows shared by consecutive strips should be reused.
+        uint64_t input_values = (uint64_t)(W + 2) * (H + 2);
+        if (stats.values_loaded != input_values) {
+            printf("Loaded %d values of the input instead of %d with strips %d high\n",
+                   (int)stats.values_loaded, (int)input_values, strip_height);
+            return -1;
+        }
+        uint64_t reused = expected_strips > 1 ? (uint64_t)(W + 2) * 2 * (expected_strips - 1) : 0;
+        if (stats.values_reused != reused) {
+            printf("Reused %d values of the input instead of %d with strips %d high\n",
+                   (int)stats.values_reused, (int)reused, strip_height);
+            return -1;
+        }
+
+        if (stats.peak_bytes == 0 ||
+            (strip_height < H && stats.peak_bytes >= full_input.size_in_bytes())) {
+            printf("Unexpected peak memory use of %d bytes with strips %d high\n",
+                   (int)stats.peak_bytes, strip_height);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -41,6 +41,7 @@ struct Task {
     string name;
     int vector_width;
     Expr expr;
+    bool reduce;
 };
 
 size_t num_threads = Halide::Internal::ThreadPool<void>::num_processors_online();
@@ -190,25 +191,44 @@ struct Test {
         return wildcard_match("*" + p + "*", str);
     }
 
-    TestResult check_one(const string &op, const string &name, int vector_width, Expr e) const {
+    TestResult check_one(const string &op, const string &name, int vector_width, Expr e, bool reduce) const {
         std::ostringstream error_msg;
 
-        // Define a vectorized Func that uses the pattern.
         Func f(name);
-        f(x, y) = e;
-        f.bound(x, 0, W).vectorize(x, vector_width);
-        f.compute_root();
-
-        // Include a scalar version
         Func f_scalar("scalar_" + name);
-        f_scalar(x, y) = e;
-        f_scalar.bound(x, 0, W);
-        f_scalar.compute_root();
-
-        // The output to the pipeline is the maximum absolute difference as a double.
-        RDom r(0, W, 0, H);
         Func error("error_" + name);
-        error() = cast<double>(maximum(absd(f(r.x, r.y), f_scalar(r.x, r.y))));
+        if (reduce) {
+            // Define a sum of the pattern over x, with the reduction
+            // vectorized across the lanes.
+            RDom rx(0, W);
+            Expr summand = Internal::substitute(x.name(), rx.x, e);
+            f() = cast(e.type(), 0);
+            f() += summand;
+            f.update().atomic().vectorize(rx, vector_width);
+            f.compute_root();
+
+            // Include a scalar version
+            f_scalar() = cast(e.type(), 0);
+            f_scalar() += summand;
+            f_scalar.compute_root();
+
+            // The output to the pipeline is the absolute difference as a double.
+            error() = cast<double>(absd(f(), f_scalar()));
+        } else {
+            // Define a vectorized Func that uses the pattern.
+            f(x, y) = e;
+            f.bound(x, 0, W).vectorize(x, vector_width);
+            f.compute_root();
+
+            // Include a scalar version
+            f_scalar(x, y) = e;
+            f_scalar.bound(x, 0, W);
+            f_scalar.compute_root();
+
+            // The output to the pipeline is the maximum absolute difference as a double.
+            RDom r(0, W, 0, H);
+            error() = cast<double>(maximum(absd(f(r.x, r.y), f_scalar(r.x, r.y))));
+        }
 
         {
             // Compile just the vector Func to assembly.
@@ -258,7 +278,7 @@ struct Test {
         return { op, error_msg.str() };
     }
 
-    void check(string op, int vector_width, Expr e) {
+    void check(string op, int vector_width, Expr e, bool reduce = false) {
         // Make a name for the test by uniquing then sanitizing the op name
         string name = "op_" + op;
         for (size_t i = 0; i < name.size(); i++) {
@@ -272,7 +292,13 @@ struct Test {
         // settings.
         if (!wildcard_match(filter, op)) return;
 
-        tasks.emplace_back(Task {op, name, vector_width, e});
+        tasks.emplace_back(Task {op, name, vector_width, e, reduce});
+    }
+
+    // Check that the op is used to sum the pattern over x, when the
+    // reduction is vectorized with atomic().
+    void check_reduce(string op, int vector_width, Expr e) {
+        check(op, vector_width, e, true);
     }
 
     void check_sse_all() {
@@ -646,6 +672,18 @@ struct Test {
             check("vpmaxsq", 8, max(i64_1, i64_2));
             check("vpminsq", 8, min(i64_1, i64_2));
         }
+
+        // Sums vectorized with atomic() reduce across the lanes with
+        // instructions that sum groups of adjacent lanes.
+        check_reduce("psadbw", 16, i32(absd(u8_1, u8_2)));
+        check_reduce("psadbw", 32, u16(absd(u8_1, u8_2)));
+        check_reduce("pmaddwd", 8, i32(i16_1) * 3);
+        check_reduce("pmaddwd", 16, i32(u8_1) * i32(u8_2));
+        check_reduce("pmaddwd", 16, i32(u8_1));
+        if (target.has_feature(Target::AVX512_Cascadelake)) {
+            check_reduce("vpdpbusd", 16, i32(u8_1) * i32(i8_2));
+            check_reduce("vpdpbusd", 64, i32(i8_1) * i32(u8_2));
+        }
     }
 
     void check_neon_all() {
@@ -1069,7 +1107,7 @@ struct Test {
             // VPADDL   I       -       Pairwise Add Long
             // VPMAX    I, F    -       Pairwise Maximum
             // VPMIN    I, F    -       Pairwise Minimum
-            // We don't do horizontal ops
+            // We only do horizontal ops in vectorized reductions (see below)
 
             // VPOP     X       F, D    Pop from Stack
             // VPUSH    X       F, D    Push to Stack
@@ -1416,6 +1454,18 @@ struct Test {
         // Interleave or deinterleave two vectors. Given that we use
         // interleaving loads and stores, it's hard to hit this op with
         // halide.
+
+        // Sums vectorized with atomic() reduce across the lanes with
+        // widening pairwise adds, or with dot products if available.
+        check_reduce(arm32 ? "vpaddl.u8"  : "uaddlp", 16, u16(u8_1));
+        check_reduce(arm32 ? "vpaddl.s8"  : "saddlp", 16, i16(i8_1));
+        check_reduce(arm32 ? "vpaddl.u16" : "uaddlp", 8, u32(u16_1));
+        check_reduce(arm32 ? "vpaddl.s16" : "saddlp", 8, i32(i16_1));
+        if (target.has_feature(Target::ARMDotProd)) {
+            check_reduce("udot", 16, u32(u8_1) * u32(u8_2));
+            check_reduce("sdot", 16, i32(i8_1) * i32(i8_2));
+            check_reduce("udot", 32, u32(u8_1) * u32(u8_2));
+        }
     }
 
     void check_hvx_all() {
@@ -2114,7 +2164,7 @@ check("v*.w += vrmpy(v*.b,v*.b)", hvx_width, i32_1 + i32(i8_1)*i8_1 + i32(i8_2)*
         std::vector<std::future<TestResult>> futures;
         for (const Task &task : tasks) {
             futures.push_back(pool.async([this, task]() {
-                return check_one(task.op, task.name, task.vector_width, task.expr);
+                return check_one(task.op, task.name, task.vector_width, task.expr, task.reduce);
             }));
         }
 
@@ -0,0 +1,108 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+bool check(const Buffer<float> &out, float scale, const char *when) {
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            float correct = scale * (x * 0.5f + y) + 3.0f;
+            if (out(x, y) != correct) {
+                printf("%s: out(%d, %d) = %f instead of %f\n", when, x, y, out(x, y), correct);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Func f, g;
+    Var x, y;
+    Param<float> scale;
+
+    f(x, y) = x * 0.5f + y;
+    g(x, y) = scale * f(x, y) + 3.0f;
+    f.compute_root().vectorize(x, 8);
+    g.vectorize(x, 8).parallel(y);
+
+    scale.set(2.0f);
+
+    Pipeline p(g);
+    if (p.tiered_jit()) {
+        printf("Tiered jit should be off by default\n");
+        return -1;
+    }
+    p.set_tiered_jit(true);
+
+    // The first compilation makes the quickly compiled code.
+    void *first_tier = p.compile_jit();
+    Buffer<float> out = p.realize(64, 64);
+    if (!check(out, 2.0f, "First tier")) {
+        return -1;
+    }
+
+    // Waiting switches to the optimized code.
+    p.wait_for_optimized_jit();
+    void *second_tier = p.compile_jit();
+    if (first_tier == second_tier) {
+        printf("Waiting for the optimized code didn't switch to it\n");
+        return -1;
+    }
+    scale.set(3.0f);
+    p.realize(out);
+    if (!check(out, 3.0f, "Second tier")) {
+        return -1;
+    }
+
+    // Once the optimized code is in use, there's nothing more to switch to.
+    p.wait_for_optimized_jit();
+    if (p.compile_jit() != second_tier) {
+        printf("The optimized code was replaced\n");
+        return -1;
+    }
+
+    // Changing the schedule recompiles in tiers, even if the previous
+    // optimized compilation is still running.
+    g.unroll(y, 2);
+    p.realize(out);
+    if (!check(out, 3.0f, "After rescheduling")) {
+        return -1;
+    }
+
+    // Prepared calls switch to the optimized code too.
+    g.unroll(x, 2);
+    PreparedCall call = p.prepare(out);
+    scale.set(4.0f);
+    call.run();
+    if (!check(out, 4.0f, "Prepared call, first tier")) {
+        return -1;
+    }
+    p.wait_for_optimized_jit();
+    scale.set(5.0f);
+    call.run();
+    if (!check(out, 5.0f, "Prepared call, second tier")) {
+        return -1;
+    }
+
+    // Turning tiering off switches to the optimized code, and then
+    // compiles without tiers.
+    g.unroll(y, 2);
+    first_tier = p.compile_jit();
+    p.set_tiered_jit(false);
+    if (p.compile_jit() == first_tier) {
+        printf("Turning tiering off didn't switch to the optimized code\n");
+        return -1;
+    }
+    g.unroll(x, 2);
+    scale.set(6.0f);
+    p.realize(out);
+    p.wait_for_optimized_jit();
+    p.realize(out);
+    if (!check(out, 6.0f, "Without tiering")) {
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
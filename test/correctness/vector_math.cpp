@@ -558,6 +558,79 @@ bool test(int lanes, int seed) {
         */
     }
 
+    // Vectorized sin, cos, and atan2 use polynomial approximations
+    // instead of the math library.
+    if (type_of<A>() == Float(32)) {
+        if (verbose) printf("Vectorized sin, cos, and atan2\n");
+        Func f_sin, f_cos, f_atan2;
+        Expr a = input(x, y) * 0.5f;
+        Expr b = input((x+1)%W, y) * 0.5f;
+        f_sin(x, y) = sin(a);
+        f_cos(x, y) = cos(a);
+        f_atan2(x, y) = atan2(a, b);
+        f_sin.vectorize(x, lanes);
+        f_cos.vectorize(x, lanes);
+        f_atan2.vectorize(x, lanes);
+        Buffer<float> im_sin = f_sin.realize(W, H);
+        Buffer<float> im_cos = f_cos.realize(W, H);
+        Buffer<float> im_atan2 = f_atan2.realize(W, H);
+
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                float a = input(x, y) * 0.5f;
+                float b = input((x+1)%W, y) * 0.5f;
+                float correct_sin = sinf(a);
+                float correct_cos = cosf(a);
+                float correct_atan2 = atan2f(a, b);
+                if (!close_enough(im_sin(x, y), correct_sin)) {
+                    printf("sin(%f) = %1.10f instead of %1.10f\n",
+                           a, im_sin(x, y), correct_sin);
+                    return false;
+                }
+                if (!close_enough(im_cos(x, y), correct_cos)) {
+                    printf("cos(%f) = %1.10f instead of %1.10f\n",
+                           a, im_cos(x, y), correct_cos);
+                    return false;
+                }
+                if (!close_enough(im_atan2(x, y), correct_atan2)) {
+                    printf("atan2(%f, %f) = %1.10f instead of %1.10f\n",
+                           a, b, im_atan2(x, y), correct_atan2);
+                    return false;
+                }
+            }
+        }
+
+        // Beyond |x| = 8192 the polynomials lose precision, so vectors
+        // with any lane that large go to the math library. These
+        // arguments are a mix of lanes on both sides of that.
+        Func f_sin_large, f_cos_large;
+        Expr c = input(x, y) * 1024.0f;
+        f_sin_large(x, y) = sin(c);
+        f_cos_large(x, y) = cos(c);
+        f_sin_large.vectorize(x, lanes);
+        f_cos_large.vectorize(x, lanes);
+        Buffer<float> im_sin_large = f_sin_large.realize(W, H);
+        Buffer<float> im_cos_large = f_cos_large.realize(W, H);
+
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                float c = input(x, y) * 1024.0f;
+                float correct_sin = sinf(c);
+                float correct_cos = cosf(c);
+                if (!close_enough(im_sin_large(x, y), correct_sin)) {
+                    printf("sin(%f) = %1.10f instead of %1.10f\n",
+                           c, im_sin_large(x, y), correct_sin);
+                    return false;
+                }
+                if (!close_enough(im_cos_large(x, y), correct_cos)) {
+                    printf("cos(%f) = %1.10f instead of %1.10f\n",
+                           c, im_cos_large(x, y), correct_cos);
+                    return false;
+                }
+            }
+        }
+    }
+
     // Lerp (where the weight is the same type as the values)
     if (verbose) printf("Lerp\n");
     Func f21;
@@ -0,0 +1,92 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// Check a total reduction vectorized with atomic() against one
+// computed serially.
+template<typename T>
+int check(const std::string &name, Func f, Func reference) {
+    Buffer<T> result = f.realize();
+    Buffer<T> correct = reference.realize();
+    if (result() != correct()) {
+        printf("%s: result = %f instead of %f\n",
+               name.c_str(), (double)result(), (double)correct());
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.has_gpu_feature()) {
+        printf("Atomic updates are not supported inside GPU kernels. Skipping test.\n");
+        return 0;
+    }
+
+    const int size = 1024;
+    Buffer<uint8_t> a(size), b(size);
+    Buffer<int> c(size);
+    for (int i = 0; i < size; i++) {
+        a(i) = rand() & 0xff;
+        b(i) = rand() & 0xff;
+        c(i) = (rand() & 0xffff) - 0x8000;
+    }
+
+    RDom r(0, size);
+
+    // A dot product of 8-bit values with a 32-bit result.
+    {
+        Func f("dot"), ref("serial_dot");
+        f() = 0;
+        f() += cast<int>(a(r)) * cast<int>(b(r));
+        ref() = 0;
+        ref() += cast<int>(a(r)) * cast<int>(b(r));
+
+        f.update().atomic().vectorize(r, 16);
+        if (check<int>("dot product", f, ref)) return -1;
+    }
+
+    // A sum of absolute differences.
+    {
+        Func f("sad"), ref("serial_sad");
+        f() = 0;
+        f() += cast<int>(absd(a(r), b(r)));
+        ref() = 0;
+        ref() += cast<int>(absd(a(r), b(r)));
+
+        f.update().atomic().vectorize(r, 32);
+        if (check<int>("sum of absolute differences", f, ref)) return -1;
+    }
+
+    // A conditional max. Lanes for which the condition is false must
+    // not contribute.
+    {
+        RDom rw(0, size);
+        rw.where(c(rw) % 3 == 0);
+        Func f("where_max"), ref("serial_where_max");
+        f() = c(0);
+        f() = max(f(), c(rw));
+        ref() = c(0);
+        ref() = max(ref(), c(rw));
+
+        f.update().atomic().vectorize(rw, 8);
+        if (check<int>("conditional max", f, ref)) return -1;
+    }
+
+    // A float sum. The sums of small integers are exact, so any
+    // order gives the same result.
+    {
+        Func f("float_sum"), ref("serial_float_sum");
+        f() = 0.0f;
+        f() += cast<float>(a(r));
+        ref() = 0.0f;
+        ref() += cast<float>(a(r));
+
+        f.update().atomic().vectorize(r, 8);
+        if (check<float>("float sum", f, ref)) return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,24 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+
+    Func f;
+    Var x;
+
+    f(x) = 0;
+
+    RDom r(0, 100);
+    f(r % 10) = f(r % 10) * 2 + r;
+
+    // This update gives a different result depending on the order it
+    // is applied in, so it can't be made atomic.
+    f.update().atomic().parallel(r);
+
+    // We shouldn't reach here, because there should have been a compile error.
+    printf("There should have been an error\n");
+
+    return 0;
+}
@@ -0,0 +1,25 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+
+    Func f;
+    Var x;
+
+    f(x) = x;
+
+    RDom r(1, 100);
+    f(r) = f(r) + f(r - 1);
+
+    // Each update reads a neighbouring site as well as the one it
+    // updates, so it can't be made atomic, even when the associativity
+    // test is overridden.
+    f.update().atomic(true).parallel(r);
+
+    // We shouldn't reach here, because there should have been a compile error.
+    printf("There should have been an error\n");
+
+    return 0;
+}
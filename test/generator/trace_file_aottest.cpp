@@ -0,0 +1,97 @@
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+#include "halide_trace_reader.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <set>
+#include <string>
+
+#include "trace_file.h"
+
+using namespace Halide::Runtime;
+
+struct Packet : public halide_trace_packet_t {
+    uint8_t payload[4096];
+};
+
+int main(int argc, char **argv) {
+    FILE *file = tmpfile();
+    if (!file) {
+        printf("Could not create a temporary file\n");
+        return -1;
+    }
+    halide_set_trace_file(fileno(file));
+
+    const int W = 64, H = 64, runs = 3;
+    for (int i = 0; i < runs; i++) {
+        Buffer<int32_t> output(W, H);
+        if (trace_file(output) != 0) {
+            printf("Pipeline failed\n");
+            return -1;
+        }
+    }
+    halide_shutdown_trace();
+
+    // Read the trace back, and check that the events of all the
+    // threads were put back in an order consistent with when they
+    // happened.
+    rewind(file);
+    Halide::Trace::PacketReader reader([file](void *dst, size_t count) {
+        return fread(dst, 1, count, file);
+    });
+
+    Packet p;
+    std::set<int32_t> ids, productions;
+    std::map<std::string, int> stores;
+    int pipelines = 0;
+    while (reader.next(&p, sizeof(p))) {
+        if (!ids.insert(p.id).second) {
+            printf("Id %d used more than once\n", p.id);
+            return -1;
+        }
+        std::string func = p.func();
+        if (p.event == halide_trace_begin_pipeline) {
+            pipelines++;
+        } else if (p.event == halide_trace_produce) {
+            productions.insert(p.id);
+        } else if (p.event == halide_trace_end_produce) {
+            if (!productions.erase(p.parent_id)) {
+                printf("end_produce of %s before its produce\n", func.c_str());
+                return -1;
+            }
+        } else if (p.event == halide_trace_store) {
+            const int lanes = p.type.lanes;
+            for (int i = 0; i < lanes; i++) {
+                int x = p.coordinates()[i], y = p.coordinates()[lanes + i];
+                int32_t value;
+                memcpy(&value, (const uint8_t *)p.value() + i * sizeof(value), sizeof(value));
+                int32_t correct = func == "f" ? x * 3 + y : x * 6 + 3 + y * 2;
+                if (value != correct) {
+                    printf("Stored %d to %s(%d, %d) instead of %d\n", value, func.c_str(), x, y, correct);
+                    return -1;
+                }
+            }
+            if (func == "f" && !productions.count(p.parent_id)) {
+                printf("Store to f(%d, %d) outside of its production\n",
+                       p.coordinates()[0], p.coordinates()[1]);
+                return -1;
+            }
+            stores[func] += lanes;
+        }
+    }
+    fclose(file);
+
+    if (pipelines != runs) {
+        printf("Saw %d pipelines instead of %d\n", pipelines, runs);
+        return -1;
+    }
+    if (stores["f"] != runs * (W + 1) * H || stores["output"] != runs * W * H) {
+        printf("Saw %d stores to f and %d to output\n", stores["f"], stores["output"]);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
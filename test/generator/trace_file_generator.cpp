@@ -0,0 +1,24 @@
+#include "Halide.h"
+
+namespace {
+
+class TraceFile : public Halide::Generator<TraceFile> {
+public:
+    Output<Buffer<int32_t>> output{"output", 2};
+
+    void generate() {
+        Var x("x"), y("y");
+        Func f("f");
+        f(x, y) = x * 3 + y;
+        output(x, y) = f(x, y) + f(x + 1, y);
+
+        // Trace from many threads at once, with scalar and vector
+        // stores.
+        f.compute_root().parallel(y).trace_stores().trace_realizations();
+        output.parallel(y).vectorize(x, 4).trace_stores();
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(TraceFile, trace_file)
@@ -10,6 +10,7 @@
 #include "ModulusRemainder.h"
 #include "CSE.h"
 #include "IREquality.h"
+#include "ExprInterner.h"
 #include "Solve.h"
 #include "Monotonic.h"
 #include "Reduction.h"
@@ -25,6 +26,7 @@ int main(int argc, const char **argv) {
     IRPrinter::test();
     CodeGen_C::test();
     ir_equality_test();
+    expr_interner_test();
     bounds_test();
     expr_match_test();
     deinterleave_vector_test();
@@ -0,0 +1,100 @@
+#include "Halide.h"
+
+#include <cstdio>
+#include "halide_benchmark.h"
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+Buffer<float> run(const Internal::JITModule &module) {
+    Buffer<float> out(256, 256);
+    Internal::JITUserContext context;
+    Internal::JITSharedRuntime::init_jit_user_context(context, nullptr, Internal::JITHandlers());
+    void *user_context = &context;
+    const void *args[] = {&user_context, out.raw_buffer()};
+    int result = module.argv_function()(args);
+    if (result != 0) {
+        printf("Pipeline returned %d\n", result);
+        exit(-1);
+    }
+    return out;
+}
+
+int main(int argc, char **argv) {
+    if (!Internal::JITModule::object_cache_supported()) {
+        printf("This build of Halide can't use the JIT object cache. Skipping test.\n");
+        return 0;
+    }
+
+    // A moderately complex pipeline.
+    Buffer<float> input(256, 256);
+    input.for_each_element([&](int x, int y) { input(x, y) = (float)((x * 17 + y * 31) % 256); });
+
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+    Func clamped = BoundaryConditions::repeat_edge(input);
+    Func blur_x("blur_x"), blur_y("blur_y"), sharpen("sharpen");
+    blur_x(x, y) = (clamped(x - 2, y) + clamped(x - 1, y) + clamped(x, y) +
+                    clamped(x + 1, y) + clamped(x + 2, y)) / 5;
+    blur_y(x, y) = (blur_x(x, y - 2) + blur_x(x, y - 1) + blur_x(x, y) +
+                    blur_x(x, y + 1) + blur_x(x, y + 2)) / 5;
+    sharpen(x, y) = 2 * clamped(x, y) - blur_y(x, y);
+
+    sharpen.tile(x, y, xi, yi, 64, 32).vectorize(xi, 8).parallel(y);
+    blur_y.compute_at(sharpen, x).vectorize(x, 8);
+    blur_x.compute_at(sharpen, x).vectorize(x, 8);
+
+    // Lower once. Lowering generates unique names, so it's only
+    // repeatable across processes, which is what the object cache is
+    // for. Here we just measure the cost of turning the same lowered
+    // module into machine code, which is what the cache skips.
+    Target target = get_jit_target_from_environment()
+        .with_feature(Target::JIT)
+        .with_feature(Target::UserContext);
+    Module module = sharpen.compile_to_module({}, "jit_cold_start", target);
+    Internal::LoweredFunc fn = module.get_function_by_name("jit_cold_start");
+
+    // Compile the runtime, which isn't cached.
+    Internal::JITModule::set_object_cache_dir("");
+    Buffer<float> expected = run(Internal::JITModule(module, fn));
+
+    double t_uncached = benchmark(3, 1, [&]() {
+        Internal::JITModule jit(module, fn);
+    });
+
+    // Populate the cache.
+    std::string cache_dir = Internal::dir_make_temp();
+    Internal::JITModule::set_object_cache_dir(cache_dir);
+    {
+        Internal::JITModule populate(module, fn);
+    }
+
+    double t_cached = benchmark(3, 1, [&]() {
+        Internal::JITModule jit(module, fn);
+    });
+
+    Buffer<float> actual = run(Internal::JITModule(module, fn));
+    Internal::JITModule::set_object_cache_dir("");
+
+    int errors = 0;
+    actual.for_each_element([&](int x, int y) {
+        if (actual(x, y) != expected(x, y) && errors++ < 10) {
+            printf("actual(%d, %d) = %f instead of %f\n", x, y, actual(x, y), expected(x, y));
+        }
+    });
+    if (errors) {
+        return -1;
+    }
+
+    printf("JIT compilation without object cache: %g ms\n"
+           "JIT compilation with object cache:    %g ms\n"
+           "Speedup: %gx\n",
+           t_uncached * 1e3, t_cached * 1e3, t_uncached / t_cached);
+
+    if (t_cached > t_uncached) {
+        printf("Loading from the object cache was slower than compiling\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "Halide.h"
+#include <stdio.h>
+
+#include "halide_benchmark.h"
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+Var x, y;
+
+Func downsample(Func f) {
+    Func downx, downy;
+    downx(x, y) = (f(2*x-1, y) + 3.0f * (f(2*x, y) + f(2*x+1, y)) + f(2*x+2, y)) / 8.0f;
+    downy(x, y) = (downx(x, 2*y-1) + 3.0f * (downx(x, 2*y) + downx(x, 2*y+1)) + downx(x, 2*y+2)) / 8.0f;
+    return downy;
+}
+
+Func upsample(Func f) {
+    Func upx, upy;
+    upx(x, y) = 0.25f * f((x/2) - 1 + 2*(x % 2), y) + 0.75f * f(x/2, y);
+    upy(x, y) = 0.25f * upx(x, (y/2) - 1 + 2*(y % 2)) + 0.75f * upx(x, y/2);
+    return upy;
+}
+
+int main(int argc, char **argv) {
+    // A laplacian pyramid, like the one in apps/local_laplacian,
+    // which makes lots of similar bounds expressions.
+    const int J = 8;
+    ImageParam input(Float(32), 2);
+    Func clamped = BoundaryConditions::repeat_edge(input);
+
+    Func g[J], l[J], out[J];
+    g[0](x, y) = clamped(x, y);
+    for (int j = 1; j < J; j++) {
+        g[j] = downsample(g[j-1]);
+    }
+    l[J-1] = g[J-1];
+    for (int j = J-2; j >= 0; j--) {
+        l[j](x, y) = g[j](x, y) - upsample(g[j+1])(x, y);
+    }
+    out[J-1](x, y) = l[J-1](x, y) * 2.0f;
+    for (int j = J-2; j >= 0; j--) {
+        out[j](x, y) = upsample(out[j+1])(x, y) + l[j](x, y) * 2.0f;
+    }
+    for (int j = 0; j < J; j++) {
+        g[j].compute_root().vectorize(x, 8);
+        l[j].compute_root().vectorize(x, 8);
+        if (j > 0) out[j].compute_root().vectorize(x, 8);
+    }
+
+    Target t = get_host_target();
+    double times[2];
+    for (int intern = 0; intern < 2; intern++) {
+        Internal::set_expr_interning(intern != 0);
+        times[intern] = benchmark(3, 1, [&]() {
+            Pipeline p(out[0]);
+            p.compile_to_module(p.infer_arguments(), "pyramid", t);
+        });
+    }
+    Internal::set_expr_interning(false);
+
+    printf("Lowering time without interning: %f ms\n", times[0] * 1e3);
+    printf("Lowering time with interning: %f ms\n", times[1] * 1e3);
+
+    printf("Success!\n");
+    return 0;
+}
@@ -1,5 +1,7 @@
 #include "Halide.h"
 #include <cstdio>
+#include <cstring>
+#include <sstream>
 #include "halide_benchmark.h"
 
 using namespace Halide;
@@ -39,6 +41,37 @@ int main(int argc, char **argv) {
         }
     }
 
+    // Now measure the per-task overhead of the thread pool as the
+    // number of threads grows. Each task does a trivial amount of
+    // work, so the time is dominated by handing out tasks.
+    {
+        const int tasks = 16384;
+        Func h;
+        h(x, y) = x + y;
+        h.parallel(y);
+        Pipeline p(h);
+        Buffer<int> imh(1, tasks);
+
+        printf("Task overhead:\n");
+        for (int t = 1; t <= 128; t *= 2) {
+            std::ostringstream ss;
+            ss << "HL_NUM_THREADS=" << t;
+            std::string str = ss.str();
+            // putenv keeps the pointer, so the string must outlive the loop.
+            static char buf[32];
+            memset(buf, 0, sizeof(buf));
+            memcpy(buf, str.c_str(), str.size());
+            putenv(buf);
+            p.invalidate_cache();
+            Halide::Internal::JITSharedRuntime::release_all();
+
+            p.compile_jit();
+            p.realize(imh);
+            double t_task = benchmark([&]() { p.realize(imh); }) / tasks;
+            printf("%3d threads: %f ns per task\n", t, t_task * 1e9);
+        }
+    }
+
     printf("Times: %f %f\n", serialTime, parallelTime);
     double speedup = serialTime / parallelTime;
     printf("Speedup: %f\n", speedup);
@@ -0,0 +1,86 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <string.h>
+
+using namespace Halide;
+
+float compute_ipc = -1, compute_mpki = -1;
+float gather_ipc = -1, gather_mpki = -1;
+bool counters_unavailable = false;
+
+void my_print(void *, const char *msg) {
+    printf("%s", msg);
+    if (strstr(msg, "hardware counters could not be opened")) {
+        counters_unavailable = true;
+    }
+    const char *rates = strstr(msg, "ipc: ");
+    if (!rates) return;
+    float ipc, mpki;
+    if (sscanf(rates, "ipc: %f  llc misses/kinstr: %f", &ipc, &mpki) != 2) return;
+    if (strstr(msg, "  compute:") == msg) {
+        compute_ipc = ipc;
+        compute_mpki = mpki;
+    } else if (strstr(msg, "  gather:") == msg) {
+        gather_ipc = ipc;
+        gather_mpki = mpki;
+    }
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.os != Target::Linux || t.arch != Target::X86) {
+        printf("Hardware counters are only read on x86 Linux. Skipping test.\n");
+        return 0;
+    }
+
+    // A table much larger than the last-level cache.
+    const int table_size = 1 << 24;
+    Buffer<int> table(table_size);
+    table.for_each_element([&](int x) { table(x) = x; });
+
+    Var x;
+
+    // A stage which does a lot of arithmetic on values in registers.
+    Func compute("compute");
+    Expr e = cast<uint32_t>(x);
+    for (int i = 0; i < 50; i++) {
+        e = e * 1664525 + 1013904223;
+    }
+    compute(x) = cast<int>(e);
+
+    // A stage which reads the table at pseudo-random locations.
+    Func gather("gather");
+    gather(x) = table(cast<int>((cast<uint32_t>(x) * 1664525 + 1013904223) % table_size));
+
+    Func out("out");
+    out(x) = compute(x) + gather(x);
+
+    compute.compute_root().parallel(x, 1 << 16);
+    gather.compute_root().parallel(x, 1 << 16);
+    out.parallel(x, 1 << 16);
+
+    out.set_custom_print(&my_print);
+    out.realize(1 << 22, t.with_feature(Target::ProfileCounters));
+
+    if (counters_unavailable) {
+        printf("Hardware counters are not available on this machine. Skipping test.\n");
+        return 0;
+    }
+
+    printf("compute: ipc %f, llc misses/kinstr %f\n"
+           "gather: ipc %f, llc misses/kinstr %f\n",
+           compute_ipc, compute_mpki, gather_ipc, gather_mpki);
+
+    if (compute_ipc < 0 || gather_ipc < 0) {
+        printf("Hardware counters were not reported for each Func\n");
+        return -1;
+    }
+
+    if (gather_mpki <= compute_mpki) {
+        printf("The stage that reads memory at random should miss the cache more often\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include "Halide.h"
+#include "halide_benchmark.h"
+#include <cstdio>
+#include <cstdlib>
+#include <sys/resource.h>
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+// Peak resident set size of this process, in bytes.
+size_t peak_rss() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return (size_t)usage.ru_maxrss * 1024;
+#endif
+}
+
+// Fill in a region of a synthetic image that is too large to keep
+// in memory, as if reading it from a file.
+void load_input(Buffer<> &region) {
+    Buffer<uint16_t> b(region);
+    b.for_each_element([&](int x, int y) {
+        b(x, y) = (uint16_t)(((uint32_t)x * 7 + (uint32_t)y * 13) ^ ((uint32_t)x * y));
+    });
+}
+
+int main(int argc, char **argv) {
+    // The size of the output. Pass a larger size on the command line
+    // to process images larger than memory.
+    const int W = argc > 1 ? atoi(argv[1]) : 16384;
+    const int H = argc > 2 ? atoi(argv[2]) : W;
+    const int strip_height = 64;
+
+    // A few stencils, like the levels of a pyramid.
+    ImageParam input(UInt(16), 2, "input");
+    Var x("x"), y("y"), xi("xi");
+    Func blur_x("blur_x"), blur_y("blur_y"), sharpen("sharpen");
+    blur_x(x, y) = (cast<float>(input(x, y)) + input(x + 1, y) * 2.0f + input(x + 2, y)) / 4;
+    blur_y(x, y) = (blur_x(x, y) + blur_x(x, y + 1) * 2 + blur_x(x, y + 2)) / 4;
+    sharpen(x, y) = cast<uint16_t>(clamp(2 * input(x + 1, y + 1) - blur_y(x, y), 0, 65535));
+
+    sharpen.split(x, x, xi, 16).vectorize(xi).parallel(y, 8);
+    blur_y.compute_at(sharpen, y).vectorize(x, 16);
+    blur_x.store_at(sharpen, y).compute_at(sharpen, y).vectorize(x, 16);
+
+    Pipeline p(sharpen);
+    p.compile_jit();
+
+    size_t rss_before = peak_rss();
+
+    uint64_t checksum = 0;
+    StripStats stats;
+    double t = benchmark(1, 1, [&]() {
+        stats = p.realize_in_strips({W, H}, strip_height, {StreamedInput(input, load_input)},
+                                    [&](const Realization &r) {
+                                        // Stand in for writing the strip out.
+                                        Buffer<uint16_t> strip = r[0];
+                                        checksum += strip(strip.dim(0).min(), strip.dim(1).min());
+                                    });
+    });
+
+    size_t full_bytes = (size_t)(W + 2) * (H + 2) * sizeof(uint16_t) + (size_t)W * H * sizeof(uint16_t);
+    size_t rss_growth = peak_rss() - rss_before;
+
+    printf("Processed %dx%d in %d strips: %.3g megapixels/s (checksum %llu)\n",
+           W, H, stats.strips, (double)W * H / t / 1e6, (unsigned long long)checksum);
+    printf("Input values loaded: %llu, reused from the previous strip: %llu\n",
+           (unsigned long long)stats.values_loaded, (unsigned long long)stats.values_reused);
+    printf("Peak bytes in windows and strips: %zu, growth in peak RSS: %zu, whole input and output: %zu\n",
+           stats.peak_bytes, rss_growth, full_bytes);
+
+    if (stats.values_loaded != (uint64_t)(W + 2) * (H + 2)) {
+        printf("Each value of the input should have been loaded exactly once\n");
+        return -1;
+    }
+
+    if (stats.peak_bytes * 16 > full_bytes) {
+        printf("Processing in strips should use a small fraction of the memory\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
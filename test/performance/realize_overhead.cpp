@@ -129,6 +129,22 @@ int main(int argc, char **argv) {
         std::cout << "One argument Pipeline realize reusing Realization/Target/ParamMap time " << t * 1e6 << "us.\n";
     }
 
+    {
+        Func f;
+        Param<int> in;
+
+        f() = in + 42;
+
+        in.set(0);
+
+        Pipeline p(f);
+
+        auto buf = Buffer<int32_t>::make_scalar();
+        PreparedCall call = p.prepare(buf);
+        double t = benchmark([&]() { call.run(); });
+        std::cout << "One argument Pipeline prepared call time " << t * 1e6 << "us.\n";
+    }
+
     for (int i = 10; i < 100; i += 10) {
         Func f;
         std::vector<Param<int>> params(i);
@@ -0,0 +1,88 @@
+#include "Halide.h"
+#include <cmath>
+#include <cstdio>
+#include "halide_benchmark.h"
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+// A chain of blurs and pointwise math, big enough that llvm
+// optimization is most of the cost of compiling it.
+Func make_pipeline(ImageParam input) {
+    Var x, y;
+    Func clamped = BoundaryConditions::repeat_edge(input);
+    Func f = clamped;
+    for (int i = 0; i < 6; i++) {
+        Func blur_x, blur_y, sharpened;
+        blur_x(x, y) = (f(x - 1, y) + 2 * f(x, y) + f(x + 1, y)) / 4;
+        blur_y(x, y) = (blur_x(x, y - 1) + 2 * blur_x(x, y) + blur_x(x, y + 1)) / 4;
+        sharpened(x, y) = clamp(2 * f(x, y) - blur_y(x, y), 0.0f, 1.0f) * (0.9f + 0.01f * i);
+        blur_x.compute_at(sharpened, y).vectorize(x, 8);
+        sharpened.compute_root().vectorize(x, 8).parallel(y);
+        f = sharpened;
+    }
+    return f;
+}
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    const int W = 1536, H = 1024;
+
+    ImageParam input(Float(32), 2);
+    Buffer<float> in(W, H);
+    in.for_each_element([&](int x, int y) { in(x, y) = ((x * 17 + y * 31) % 256) / 255.0f; });
+    input.set(in);
+    Buffer<float> out(W, H), correct(W, H);
+
+    // Compile the shared runtime first, so that it isn't counted in
+    // the first compile time below.
+    {
+        Func warm_up;
+        warm_up() = 0;
+        warm_up.realize(target);
+    }
+
+    // Without tiers, the first result waits for fully optimized code.
+    Pipeline optimized(make_pipeline(input));
+    double optimized_compile = benchmark(1, 1, [&]() { optimized.compile_jit(target); });
+    double optimized_run = benchmark([&]() { optimized.realize(correct); });
+
+    // The first tier on its own.
+    Pipeline fast(make_pipeline(input));
+    double fast_compile = benchmark(1, 1, [&]() { fast.compile_jit(target.with_feature(Target::FastCompile)); });
+    double fast_run = benchmark([&]() { fast.realize(out); });
+
+    // With tiers, the first result only waits for the first tier.
+    Pipeline tiered(make_pipeline(input));
+    tiered.set_tiered_jit(true);
+    double first_result = benchmark(1, 1, [&]() {
+        tiered.compile_jit(target);
+        tiered.realize(out);
+    });
+    double optimized_ready = first_result + benchmark(1, 1, [&]() { tiered.wait_for_optimized_jit(); });
+    double tiered_run = benchmark([&]() { tiered.realize(out); });
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            if (std::abs(out(x, y) - correct(x, y)) > 1e-5f) {
+                printf("out(%d, %d) = %f instead of %f\n", x, y, out(x, y), correct(x, y));
+                return -1;
+            }
+        }
+    }
+
+    printf("Compile time: optimized %f ms, first tier %f ms\n",
+           optimized_compile * 1e3, fast_compile * 1e3);
+    printf("Run time: optimized %f ms, first tier %f ms\n",
+           optimized_run * 1e3, fast_run * 1e3);
+    printf("Tiered: first result after %f ms, optimized code after %f ms, then %f ms per run\n",
+           first_result * 1e3, optimized_ready * 1e3, tiered_run * 1e3);
+
+    if (fast_compile > optimized_compile) {
+        printf("The first tier took longer to compile than optimized code\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include "Halide.h"
+#include <cstdio>
+#include <cmath>
+#include <random>
+#include "halide_benchmark.h"
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+// Calling these from a vectorized Func does one math library call
+// per lane, which is what vectorized transcendentals used to do.
+extern "C" DLLEXPORT float sin_ref(float x) {
+    return sinf(x);
+}
+HalideExtern_1(float, sin_ref, float);
+
+extern "C" DLLEXPORT float cos_ref(float x) {
+    return cosf(x);
+}
+HalideExtern_1(float, cos_ref, float);
+
+extern "C" DLLEXPORT float atan2_ref(float y, float x) {
+    return atan2f(y, x);
+}
+HalideExtern_2(float, atan2_ref, float, float);
+
+extern "C" DLLEXPORT float exp_ref(float x) {
+    return expf(x);
+}
+HalideExtern_1(float, exp_ref, float);
+
+extern "C" DLLEXPORT float log_ref(float x) {
+    return logf(x);
+}
+HalideExtern_1(float, log_ref, float);
+
+// powf() is a macro in some environments, so always wrap it
+extern "C" DLLEXPORT float pow_ref(float x, float y) {
+    return powf(x, y);
+}
+HalideExtern_2(float, pow_ref, float, float);
+
+// The largest error relative to max(1, |correct|).
+double max_error(const Buffer<float> &result, const Buffer<float> &correct) {
+    double worst = 0;
+    for (int i = 0; i < result.width(); i++) {
+        double c = correct(i);
+        double err = std::abs(result(i) - c) / std::max(1.0, std::abs(c));
+        worst = std::max(worst, err);
+    }
+    return worst;
+}
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    Target fast_target = target.with_feature(Target::FastTranscendentals);
+
+    const int N = 1 << 16;
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> dis(-10.0f, 10.0f);
+    Buffer<float> in_a(N), in_b(N);
+    for (int i = 0; i < N; i++) {
+        in_a(i) = dis(rng);
+        in_b(i) = dis(rng);
+    }
+
+    Var x;
+    Expr a = in_a(x), b = in_b(x);
+    Expr positive_a = abs(a) + 0.01f;
+
+    struct Case {
+        const char *name;
+        Expr ref, halide;
+    } cases[] = {
+        {"sin", sin_ref(a), sin(a)},
+        {"cos", cos_ref(a), cos(a)},
+        {"atan2", atan2_ref(a, b), atan2(a, b)},
+        {"exp", exp_ref(a), exp(a)},
+        {"log", log_ref(positive_a), log(positive_a)},
+        {"pow", pow_ref(positive_a, b * 0.25f), pow(positive_a, b * 0.25f)},
+    };
+
+    printf("%8s %16s %16s %16s %14s %14s\n",
+           "", "libm (ns/lane)", "Halide (ns/lane)", "fast (ns/lane)", "Halide error", "fast error");
+
+    bool ok = true;
+    for (const Case &c : cases) {
+        Func ref, f, g;
+        ref(x) = c.ref;
+        f(x) = c.halide;
+        g(x) = c.halide;
+        ref.vectorize(x, 8);
+        f.vectorize(x, 8);
+        g.vectorize(x, 8);
+        ref.compile_jit(target);
+        f.compile_jit(target);
+        g.compile_jit(fast_target);
+
+        Buffer<float> correct(N), result(N), fast_result(N);
+        double t_ref = benchmark([&]() { ref.realize(correct, target); });
+        double t_f = benchmark([&]() { f.realize(result, target); });
+        double t_g = benchmark([&]() { g.realize(fast_result, fast_target); });
+
+        double err = max_error(result, correct);
+        double fast_err = max_error(fast_result, correct);
+
+        printf("%8s %16f %16f %16f %14g %14g\n", c.name,
+               1e9 * t_ref / N, 1e9 * t_f / N, 1e9 * t_g / N, err, fast_err);
+
+        if (err > 1e-5) {
+            printf("Error for %s too large\n", c.name);
+            ok = false;
+        }
+
+        if (fast_err > 1e-3) {
+            printf("Error for fast %s too large\n", c.name);
+            ok = false;
+        }
+
+        if (t_ref < t_f) {
+            printf("libm is faster than Halide's %s\n", c.name);
+            ok = false;
+        }
+    }
+
+    if (!ok) {
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -3,6 +3,7 @@
 #include "halide_benchmark.h"
 #include "halide_image_io.h"
 
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include <iomanip>
@@ -155,6 +156,30 @@ bool IOCheckFail(bool condition, const char* msg) {
     return condition;
 }
 
+// Bytes of images loaded or saved and the time taken to do so,
+// reported along with the benchmarks.
+struct ImageIOStats {
+    uint64_t bytes = 0;
+    double seconds = 0;
+
+    template<typename Fn>
+    void time(Fn &&f) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        auto end = std::chrono::steady_clock::now();
+        seconds += std::chrono::duration<double>(end - start).count();
+    }
+
+    void report(const std::string &what) const {
+        if (bytes == 0) {
+            return;
+        }
+        double megabytes = (double) bytes / (1024.0 * 1024.0);
+        std::cout << what << " " << megabytes << " MB of images in " << seconds
+            << " sec (" << (megabytes / seconds) << " MB/sec).\n";
+    }
+};
+
 // Replace the standard Halide runtime function to capture print output to stdout
 void rungen_halide_print(void *user_context, const char *message) {
     if (!quiet) {
@@ -493,7 +518,7 @@ void fix_chunky_strides(const Shape &constrained_shape, Shape *new_shape) {
 // the input Buffer to meet those constraints, allocating and copying into
 // a new Buffer if necessary.
 bool adapt_input_buffer_layout(const Shape &constrained_shape, Buffer<> *buf) {
-    bool shape_changed = false;
+    bool shape_changed = false, strides_changed = false;
     Shape new_shape = get_shape(*buf);
     if (new_shape.size() != constrained_shape.size()) {
         fail() << "Dimension mismatch";
@@ -512,7 +537,23 @@ bool adapt_input_buffer_layout(const Shape &constrained_shape, Buffer<> *buf) {
         // stride of nonzero means "required stride", stride of zero means "no constraints"
         if (constrained_shape[i].stride != 0 && new_shape[i].stride != constrained_shape[i].stride) {
             new_shape[i].stride = constrained_shape[i].stride;
-            shape_changed = true;
+            shape_changed = strides_changed = true;
+        }
+    }
+    if (shape_changed && !strides_changed) {
+        // If the new shape is just a crop of the buffer, use it in
+        // place rather than copying it (it may be a large
+        // memory-mapped file).
+        bool is_crop = true;
+        for (size_t i = 0; i < new_shape.size(); ++i) {
+            is_crop &= (new_shape[i].min >= buf->dim(i).min() &&
+                        new_shape[i].min + new_shape[i].extent <= buf->dim(i).min() + buf->dim(i).extent());
+        }
+        if (is_crop) {
+            for (size_t i = 0; i < new_shape.size(); ++i) {
+                buf->crop(i, new_shape[i].min, new_shape[i].extent);
+            }
+            return true;
         }
     }
     if (shape_changed) {
@@ -794,7 +835,8 @@ Flags:
         Run the filter with the given arguments many times to
         produce an estimate of average execution time; this currently
         runs "samples" sets of "iterations" each, and chooses the fastest
-        sample set.
+        sample set. Also reports the time spent loading inputs and saving
+        outputs.
 
     --benchmark_min_time=DURATION_SECONDS [default = 0.1]:
         Override the default minimum desired benchmarking time; ignored if
@@ -1032,6 +1074,8 @@ int main(int argc, char **argv) {
         }
     }
 
+    ImageIOStats input_io, output_io;
+
     // Parse all the input arguments, loading images as necessary.
     // (Don't handle outputs yet.)
     for (auto &arg_pair : args) {
@@ -1047,7 +1091,10 @@ int main(int argc, char **argv) {
             break;
         }
         case halide_argument_kind_input_buffer: {
-            arg.buffer_value = load_input(arg.raw_string, *arg.metadata);
+            input_io.time([&]() {
+                arg.buffer_value = load_input(arg.raw_string, *arg.metadata);
+            });
+            input_io.bytes += arg.buffer_value.size_in_bytes();
             info() << "Input " << arg_name << ": Shape is " << get_shape(arg.buffer_value);
             // If there was no default_output_shape specified, use the shape of
             // the first input buffer (if any).
@@ -1173,29 +1220,37 @@ int main(int argc, char **argv) {
             if (!arg.raw_string.empty()) {
                 info() << "Saving output " << arg_name << " to " << arg.raw_string << " ...";
                 Buffer<> &b = arg.buffer_value;
+                output_io.bytes += b.size_in_bytes();
 
-                std::set<FormatInfo> savable_types;
-                if (!Halide::Tools::save_query<Buffer<>, IOCheckFail>(arg.raw_string, &savable_types)) {
-                    fail() << "Unable to save output: " << arg.raw_string;
-                }
-                const FormatInfo best = best_save_format(b, savable_types);
-                if (best.dimensions != b.dimensions()) {
-                    b = adjust_buffer_dims("Output", arg_name, best.dimensions, b);
-                }
-                if (best.type != b.type()) {
-                    warn() << "Image for argument \"" << arg_name << "\" is of type "
-                         << b.type() << " but is being saved as type "
-                         << best.type << "; data loss may have occurred.";
-                    b = Halide::Tools::ImageTypeConversion::convert_image(b, best.type);
-                }
-                if (!Halide::Tools::save<Buffer<>, IOCheckFail>(b, arg.raw_string)) {
-                    fail() << "Unable to save output: " << arg.raw_string;
-                }
+                output_io.time([&]() {
+                    std::set<FormatInfo> savable_types;
+                    if (!Halide::Tools::save_query<Buffer<>, IOCheckFail>(arg.raw_string, &savable_types)) {
+                        fail() << "Unable to save output: " << arg.raw_string;
+                    }
+                    const FormatInfo best = best_save_format(b, savable_types);
+                    if (best.dimensions != b.dimensions()) {
+                        b = adjust_buffer_dims("Output", arg_name, best.dimensions, b);
+                    }
+                    if (best.type != b.type()) {
+                        warn() << "Image for argument \"" << arg_name << "\" is of type "
+                             << b.type() << " but is being saved as type "
+                             << best.type << "; data loss may have occurred.";
+                        b = Halide::Tools::ImageTypeConversion::convert_image(b, best.type);
+                    }
+                    if (!Halide::Tools::save<Buffer<>, IOCheckFail>(b, arg.raw_string)) {
+                        fail() << "Unable to save output: " << arg.raw_string;
+                    }
+                });
             } else {
                 info() << "(Output " << arg_name << " was not saved.)";
             }
         }
     }
 
+    if (benchmark) {
+        input_io.report("Loaded");
+        output_io.report("Saved");
+    }
+
     return 0;
 }
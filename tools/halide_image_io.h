@@ -10,11 +10,26 @@
 #include <cstdlib>
 #include <functional>
 #include <map>
+#include <new>
 #include <set>
 #include <string>
+#include <thread>
 #include <vector>
 #include <cctype>
 
+// Large .tmp and .mat payloads are memory-mapped rather than read, where
+// possible. Define HALIDE_NO_MMAP to always read them instead.
+#if defined(_WIN32) && !defined(HALIDE_NO_MMAP)
+#define HALIDE_NO_MMAP
+#endif
+
+#ifndef HALIDE_NO_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #ifndef HALIDE_NO_PNG
 #include "png.h"
 #endif
@@ -23,6 +38,7 @@
 #include "jpeglib.h"
 #endif
 
+#include "HalideBuffer.h"   // for Runtime::Buffer views of images
 #include "HalideRuntime.h"  // for halide_type_t
 
 namespace Halide {
@@ -68,6 +84,32 @@ inline bool CheckReturn(bool condition, const char* msg) {
     return condition;
 }
 
+// Call f(begin, end) on subranges that together cover [min, min +
+// extent), using several threads if there is enough work to be worth
+// it. 'values_per_step' is roughly how many values f processes for each
+// value in the range (e.g. the number of values in a row).
+template<typename Fn>
+void parallel_for(int min, int extent, size_t values_per_step, Fn &&f) {
+    const size_t min_values_per_task = 1 << 16;
+    size_t tasks = std::min<size_t>(std::thread::hardware_concurrency(), extent);
+    tasks = std::min(tasks, (size_t)extent * values_per_step / min_values_per_task);
+    if (tasks <= 1) {
+        f(min, min + extent);
+        return;
+    }
+    auto task_begin = [&](size_t i) {
+        return min + (int)((int64_t)extent * i / tasks);
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < tasks; i++) {
+        threads.emplace_back(f, task_begin(i), task_begin(i + 1));
+    }
+    f(task_begin(0), task_begin(1));
+    for (auto &t : threads) {
+        t.join();
+    }
+}
+
 template<typename To, typename From>
 To convert(const From &from);
 
@@ -260,6 +302,26 @@ inline void write_big_endian(const uint16_t &src, uint8_t *dst) {
     dst[1] = src & 0xff;
 }
 
+#ifndef HALIDE_NO_MMAP
+// A mapping of part of a file. A Runtime::Buffer can share ownership
+// of it, in which case it is unmapped when the last Buffer referring
+// to it is destroyed.
+struct MappedFileAllocation {
+    // Must come first, as the Buffer calls release() with its address.
+    Runtime::AllocationHeader header;
+    void *addr;
+    size_t length;
+
+    MappedFileAllocation(void *addr, size_t length) : header(release), addr(addr), length(length) {}
+
+    static void release(void *p) {
+        MappedFileAllocation *m = (MappedFileAllocation *)p;
+        munmap(m->addr, m->length);
+        free(m);
+    }
+};
+#endif
+
 struct FileOpener {
     FileOpener(const std::string &filename, const char* mode) : f(fopen(filename.c_str(), mode)) {
         // nothing
@@ -321,6 +383,44 @@ struct FileOpener {
         return write_bytes(&data[0], sizeof(T) * N);
     }
 
+#ifndef HALIDE_NO_MMAP
+    // Map the next 'count' bytes of the file into memory, and advance
+    // past them. If 'writable', the file is extended to hold them if
+    // necessary, and writes to the mapping go to the file (which must
+    // be open for reading and writing); otherwise writes to the mapping
+    // are private to this process. Returns nullptr on failure, leaving
+    // the position in the file unchanged.
+    MappedFileAllocation *map_bytes(size_t count, bool writable, uint8_t **data) {
+        const off_t offset = ftello(f);
+        if (count == 0 || offset < 0 || fflush(f) != 0) {
+            return nullptr;
+        }
+        const int fd = fileno(f);
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            return nullptr;
+        }
+        const off_t end = offset + (off_t)count;
+        if (st.st_size < end && (!writable || ftruncate(fd, end) != 0)) {
+            return nullptr;
+        }
+        // Mappings must start on a page boundary.
+        const off_t start = offset - offset % sysconf(_SC_PAGESIZE);
+        const size_t length = (size_t)(end - start);
+        void *addr = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                          writable ? MAP_SHARED : MAP_PRIVATE, fd, start);
+        if (addr == MAP_FAILED) {
+            return nullptr;
+        }
+        if (fseeko(f, end, SEEK_SET) != 0) {
+            munmap(addr, length);
+            return nullptr;
+        }
+        *data = (uint8_t *)addr + (offset - start);
+        return new (malloc(sizeof(MappedFileAllocation))) MappedFileAllocation(addr, length);
+    }
+#endif
+
     FILE * const f;
 };
 
@@ -330,20 +430,18 @@ template<typename ElemType, typename ImageType>
 void read_big_endian_row(const uint8_t *src, int y, ImageType *im) {
     auto im_typed = im->template as<ElemType>();
     const int xmin = im_typed.dim(0).min();
-    const int xmax = im_typed.dim(0).max();
-    if (im_typed.dimensions() > 2) {
-        const int cmin = im_typed.dim(2).min();
-        const int cmax = im_typed.dim(2).max();
-        for (int x = xmin; x <= xmax; x++) {
-            for (int c = cmin; c <= cmax; c++) {
-                im_typed(x, y, c+cmin) = read_big_endian<ElemType>(src);
-                src += sizeof(ElemType);
-            }
-        }
-    } else {
-        for (int x = xmin; x <= xmax; x++) {
-            im_typed(x, y) = read_big_endian<ElemType>(src);
-            src += sizeof(ElemType);
+    const int width = im_typed.dim(0).extent();
+    const int x_stride = im_typed.dim(0).stride();
+    const bool has_channels = im_typed.dimensions() > 2;
+    const int cmin = has_channels ? im_typed.dim(2).min() : 0;
+    const int channels = has_channels ? im_typed.dim(2).extent() : 1;
+    // Deinterleave one channel at a time, so that the stores are
+    // dense when the image is planar.
+    for (int c = 0; c < channels; c++) {
+        ElemType *dst = has_channels ? &im_typed(xmin, y, cmin + c) : &im_typed(xmin, y);
+        const uint8_t *s = src + c * sizeof(ElemType);
+        for (int x = 0; x < width; x++) {
+            dst[x * x_stride] = read_big_endian<ElemType>(s + x * channels * sizeof(ElemType));
         }
     }
 }
@@ -354,22 +452,44 @@ template<typename ElemType, typename ImageType>
 void write_big_endian_row(const ImageType &im, int y, uint8_t *dst) {
     auto im_typed = im.template as<ElemType>();
     const int xmin = im_typed.dim(0).min();
-    const int xmax = im_typed.dim(0).max();
-    if (im_typed.dimensions() > 2) {
-        const int cmin = im_typed.dim(2).min();
-        const int cmax = im_typed.dim(2).max();
-        for (int x = xmin; x <= xmax; x++) {
-            for (int c = cmin; c <= cmax; c++) {
-                write_big_endian<ElemType>(im_typed(x, y, c), dst);
-                dst += sizeof(ElemType);
-            }
+    const int width = im_typed.dim(0).extent();
+    const int x_stride = im_typed.dim(0).stride();
+    const bool has_channels = im_typed.dimensions() > 2;
+    const int cmin = has_channels ? im_typed.dim(2).min() : 0;
+    const int channels = has_channels ? im_typed.dim(2).extent() : 1;
+    for (int c = 0; c < channels; c++) {
+        const ElemType *src = has_channels ? &im_typed(xmin, y, cmin + c) : &im_typed(xmin, y);
+        uint8_t *d = dst + c * sizeof(ElemType);
+        for (int x = 0; x < width; x++) {
+            write_big_endian<ElemType>(src[x * x_stride], d + x * channels * sizeof(ElemType));
         }
-    } else {
-        for (int x = xmin; x <= xmax; x++) {
-            write_big_endian<ElemType>(im_typed(x, y), dst);
-            dst += sizeof(ElemType);
+    }
+}
+
+// Read or write the rows of an image in bands, converting the rows
+// of each band in parallel. 'transfer' reads or writes a band of
+// bytes, and 'convert' converts one row of it.
+template<typename Transfer, typename Convert>
+bool for_each_band_of_rows(int ymin, int height, size_t row_bytes, bool transfer_first,
+                           Transfer &&transfer, Convert &&convert) {
+    const size_t band_bytes = 16 << 20;
+    const int band_rows = std::max(1, std::min(height, (int)(band_bytes / std::max<size_t>(row_bytes, 1))));
+    std::vector<uint8_t> band((size_t)band_rows * row_bytes);
+    for (int y = ymin; y < ymin + height; y += band_rows) {
+        const int rows = std::min(band_rows, ymin + height - y);
+        if (transfer_first && !transfer(band.data(), (size_t)rows * row_bytes)) {
+            return false;
+        }
+        parallel_for(y, rows, row_bytes, [&](int begin, int end) {
+            for (int r = begin; r < end; r++) {
+                convert(band.data() + (size_t)(r - y) * row_bytes, r);
+            }
+        });
+        if (!transfer_first && !transfer(band.data(), (size_t)rows * row_bytes)) {
+            return false;
         }
     }
+    return true;
 }
 
 #ifndef HALIDE_NO_PNG
@@ -430,13 +550,17 @@ bool load_png(const std::string &filename, ImageType *im) {
         Internal::read_big_endian_row<uint8_t, ImageType> :
         Internal::read_big_endian_row<uint16_t, ImageType>;
 
-    std::vector<uint8_t> row(png_get_rowbytes(png_ptr, info_ptr));
-    const int ymin = im->dim(1).min();
-    const int ymax = im->dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        png_read_row(png_ptr, row.data(), nullptr);
-        copy_to_image(row.data(), y, im);
-    }
+    const size_t row_bytes = png_get_rowbytes(png_ptr, info_ptr);
+    Internal::for_each_band_of_rows(im->dim(1).min(), height, row_bytes, true,
+        [&](uint8_t *band, size_t bytes) {
+            for (size_t offset = 0; offset < bytes; offset += row_bytes) {
+                png_read_row(png_ptr, band + offset, nullptr);
+            }
+            return true;
+        },
+        [&](const uint8_t *row, int y) {
+            copy_to_image(row, y, im);
+        });
 
     png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
 
@@ -513,13 +637,17 @@ bool save_png(ImageType &im, const std::string &filename) {
         Internal::write_big_endian_row<uint8_t, ImageType> :
         Internal::write_big_endian_row<uint16_t, ImageType>;
 
-    std::vector<uint8_t> row(png_get_rowbytes(png_ptr, info_ptr));
-    const int ymin = im.dim(1).min();
-    const int ymax = im.dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        copy_from_image(im, y, row.data());
-        png_write_row(png_ptr, row.data());
-    }
+    const size_t row_bytes = png_get_rowbytes(png_ptr, info_ptr);
+    Internal::for_each_band_of_rows(im.dim(1).min(), height, row_bytes, false,
+        [&](uint8_t *band, size_t bytes) {
+            for (size_t offset = 0; offset < bytes; offset += row_bytes) {
+                png_write_row(png_ptr, band + offset);
+            }
+            return true;
+        },
+        [&](uint8_t *row, int y) {
+            copy_from_image(im, y, row);
+        });
     png_write_end(png_ptr, NULL);
     png_destroy_write_struct(&png_ptr, &info_ptr);
 
@@ -586,17 +714,14 @@ bool load_pnm(const std::string &filename, int channels, ImageType *im) {
         Internal::read_big_endian_row<uint8_t, ImageType> :
         Internal::read_big_endian_row<uint16_t, ImageType>;
 
-    std::vector<uint8_t> row(width * channels * (bit_depth / 8));
-    const int ymin = im->dim(1).min();
-    const int ymax = im->dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        if (!check(f.read_vector(&row), "Could not read data")) {
-            return false;
-        }
-        copy_to_image(row.data(), y, im);
-    }
-
-    return true;
+    const size_t row_bytes = (size_t)width * channels * (bit_depth / 8);
+    return Internal::for_each_band_of_rows(im->dim(1).min(), height, row_bytes, true,
+        [&](uint8_t *band, size_t bytes) {
+            return check(f.read_bytes(band, bytes), "Could not read data");
+        },
+        [&](const uint8_t *row, int y) {
+            copy_to_image(row, y, im);
+        });
 }
 
 template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
@@ -625,17 +750,14 @@ bool save_pnm(ImageType &im, const int channels, const std::string &filename) {
         Internal::write_big_endian_row<uint8_t, ImageType> :
         Internal::write_big_endian_row<uint16_t, ImageType>;
 
-    std::vector<uint8_t> row(width * channels * (bit_depth / 8));
-    const int ymin = im.dim(1).min();
-    const int ymax = im.dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        copy_from_image(im, y, row.data());
-        if (!check(f.write_vector(row), "Could not write data")) {
-            return false;
-        }
-    }
-
-    return true;
+    const size_t row_bytes = (size_t)width * channels * (bit_depth / 8);
+    return Internal::for_each_band_of_rows(im.dim(1).min(), height, row_bytes, false,
+        [&](uint8_t *band, size_t bytes) {
+            return check(f.write_bytes(band, bytes), "Could not write data");
+        },
+        [&](uint8_t *row, int y) {
+            copy_from_image(im, y, row);
+        });
 }
 
 template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
@@ -708,14 +830,18 @@ bool load_jpg(const std::string &filename, ImageType *im) {
 
     auto copy_to_image = Internal::read_big_endian_row<uint8_t, ImageType>;
 
-    std::vector<uint8_t> row(width * channels);
-    const int ymin = im->dim(1).min();
-    const int ymax = im->dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        uint8_t *src = row.data();
-        jpeg_read_scanlines(&cinfo, &src, 1);
-        copy_to_image(row.data(), y, im);
-    }
+    const size_t row_bytes = (size_t)width * channels;
+    Internal::for_each_band_of_rows(im->dim(1).min(), height, row_bytes, true,
+        [&](uint8_t *band, size_t bytes) {
+            for (size_t offset = 0; offset < bytes; offset += row_bytes) {
+                uint8_t *src = band + offset;
+                jpeg_read_scanlines(&cinfo, &src, 1);
+            }
+            return true;
+        },
+        [&](const uint8_t *row, int y) {
+            copy_to_image(row, y, im);
+        });
 
     jpeg_finish_decompress(&cinfo);
     jpeg_destroy_decompress(&cinfo);
@@ -767,14 +893,18 @@ bool save_jpg(ImageType &im, const std::string &filename) {
 
     auto copy_from_image = Internal::write_big_endian_row<uint8_t, ImageType>;
 
-    std::vector<uint8_t> row(width * channels);
-    const int ymin = im.dim(1).min();
-    const int ymax = im.dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        uint8_t *dst = row.data();
-        copy_from_image(im, y, dst);
-        jpeg_write_scanlines(&cinfo, &dst, 1);
-    }
+    const size_t row_bytes = (size_t)width * channels;
+    Internal::for_each_band_of_rows(im.dim(1).min(), height, row_bytes, false,
+        [&](uint8_t *band, size_t bytes) {
+            for (size_t offset = 0; offset < bytes; offset += row_bytes) {
+                uint8_t *dst = band + offset;
+                jpeg_write_scanlines(&cinfo, &dst, 1);
+            }
+            return true;
+        },
+        [&](uint8_t *row, int y) {
+            copy_from_image(im, y, row);
+        });
 
     jpeg_finish_compress(&cinfo);
     jpeg_destroy_compress(&cinfo);
@@ -825,6 +955,57 @@ bool buffer_is_compact_planar(ImageType &im) {
     return true;
 }
 
+#ifndef HALIDE_NO_MMAP
+// Wrap a compact planar payload with the given type and extents,
+// starting at the current position in the file, as an image without
+// copying it. Fails if the payload can't be mapped, or isn't aligned
+// to its element size, in which case the caller should read it
+// instead. Writes to the image are not written back to the file.
+template<typename ImageType>
+bool map_planar_payload(FileOpener &f, halide_type_t type, const std::vector<int> &extents, ImageType *im) {
+    const off_t offset = ftello(f.f);
+    if (offset < 0 || offset % type.bytes() != 0) {
+        return false;
+    }
+    size_t count = type.bytes();
+    for (int e : extents) {
+        count *= e;
+    }
+    uint8_t *data = nullptr;
+    MappedFileAllocation *mapping = f.map_bytes(count, false, &data);
+    if (!mapping) {
+        return false;
+    }
+    *im = ImageType(Runtime::Buffer<>(type, data, extents, &mapping->header));
+    im->set_host_dirty();
+    return true;
+}
+
+// Write the payload of an image in compact planar order, by mapping
+// the next part of the file and copying the image straight into
+// it. Fails if the file can't be mapped, in which case the caller
+// should write it instead.
+template<typename ImageType>
+bool write_mapped_planar_payload(ImageType &im, FileOpener &f) {
+    const halide_type_t type = im.type();
+    std::vector<halide_dimension_t> shape(im.dimensions());
+    size_t count = type.bytes();
+    for (int d = 0; d < im.dimensions(); d++) {
+        shape[d] = halide_dimension_t(im.dim(d).min(), im.dim(d).extent(), (int32_t)(count / type.bytes()));
+        count *= im.dim(d).extent();
+    }
+    uint8_t *data = nullptr;
+    MappedFileAllocation *mapping = f.map_bytes(count, true, &data);
+    if (!mapping) {
+        return false;
+    }
+    Runtime::Buffer<> dst(type, data, shape);
+    dst.copy_from(Runtime::Buffer<>(*im.raw_buffer()));
+    MappedFileAllocation::release(mapping);
+    return true;
+}
+#endif
+
 // ".tmp" is a file format used by the ImageStack tool (see https://github.com/abadams/ImageStack)
 template<typename ImageType, CheckFunc check = CheckReturn>
 bool load_tmp(const std::string &filename, ImageType *im) {
@@ -847,6 +1028,11 @@ bool load_tmp(const std::string &filename, ImageType *im) {
 
     const halide_type_t im_type = tmp_code_to_halide_type()[header[4]];
     std::vector<int> im_dimensions = { header[0], header[1], header[2], header[3] };
+#ifndef HALIDE_NO_MMAP
+    if (map_planar_payload(f, im_type, im_dimensions, im)) {
+        return true;
+    }
+#endif
     *im = ImageType(im_type, im_dimensions);
 
     // This should never fail unless the default Buffer<> constructor behavior changes.
@@ -921,7 +1107,13 @@ bool save_tmp(ImageType &im, const std::string &filename) {
         return false;
     }
 
-    FileOpener f(filename, "wb");
+#ifndef HALIDE_NO_MMAP
+    // Replace the file rather than truncating it, as an image loaded
+    // from it may still be mapped.
+    remove(filename.c_str());
+#endif
+    // Opened for reading too, so that the payload can be mapped.
+    FileOpener f(filename, "w+b");
     if (!check(f.f != nullptr, "File could not be opened for writing")) {
         return false;
     }
@@ -929,6 +1121,11 @@ bool save_tmp(ImageType &im, const std::string &filename) {
         return false;
     }
 
+#ifndef HALIDE_NO_MMAP
+    if (write_mapped_planar_payload(im, f)) {
+        return true;
+    }
+#endif
     if (!write_planar_payload<ImageType, check>(im, f)) {
         return false;
     }
@@ -1083,6 +1280,16 @@ bool load_mat(const std::string &filename, ImageType *im) {
         break;
     }
 
+#ifndef HALIDE_NO_MMAP
+    size_t payload_bytes = type.bytes();
+    for (int e : extents) {
+        payload_bytes *= e;
+    }
+    if (payload_header[1] == payload_bytes && map_planar_payload(f, type, extents, im)) {
+        return true;
+    }
+#endif
+
     *im = ImageType(type, extents);
 
     // This should never fail unless the default Buffer<> constructor behavior changes.
@@ -1190,7 +1397,13 @@ bool save_mat(ImageType &im, const std::string &filename) {
         check(false, "unreachable");
     }
 
-    FileOpener f(filename, "wb");
+#ifndef HALIDE_NO_MMAP
+    // Replace the file rather than truncating it, as an image loaded
+    // from it may still be mapped.
+    remove(filename.c_str());
+#endif
+    // Opened for reading too, so that the payload can be mapped.
+    FileOpener f(filename, "w+b");
     if (!check(f.f != nullptr, "File could not be opened for writing")) {
         return false;
     }
@@ -1227,7 +1440,9 @@ bool save_mat(ImageType &im, const std::string &filename) {
     header[126] = 'I';
     header[127] = 'M';
 
-    uint64_t payload_bytes = im.size_in_bytes();
+    // The payload is written compactly, so this may be less than
+    // size_in_bytes() for a cropped image.
+    uint64_t payload_bytes = (uint64_t)im.number_of_elements() * im.type().bytes();
 
     if (!check((payload_bytes >> 32) == 0, "Buffer too large to save as .mat")) {
         return false;
@@ -1290,7 +1505,12 @@ bool save_mat(ImageType &im, const std::string &filename) {
         return false;
     }
 
-    if (!write_planar_payload<ImageType, check>(im, f)) {
+#ifndef HALIDE_NO_MMAP
+    const bool mapped = write_mapped_planar_payload(im, f);
+#else
+    const bool mapped = false;
+#endif
+    if (!mapped && !write_planar_payload<ImageType, check>(im, f)) {
         return false;
     }
 
@@ -1416,7 +1636,20 @@ struct ImageTypeConversion {
             dst_elem = Internal::convert<DstElemType>(src_elem);
         };
         // TODO: do we need src.copy_to_host() here?
-        dst.for_each_value(converter, src);
+        if (src.dimensions() == 0) {
+            dst.for_each_value(converter, src);
+        } else {
+            // Convert slabs of the outermost dimension in parallel.
+            const int d = src.dimensions() - 1;
+            const size_t slab_size = src.number_of_elements() / std::max(src.dim(d).extent(), 1);
+            Internal::parallel_for(src.dim(d).min(), src.dim(d).extent(), slab_size, [&](int begin, int end) {
+                Runtime::Buffer<DstElemType> dst_slab(*dst.raw_buffer());
+                Runtime::Buffer<const SrcElemType> src_slab(*src.raw_buffer());
+                dst_slab.crop(d, begin, end - begin);
+                src_slab.crop(d, begin, end - begin);
+                dst_slab.for_each_value(converter, src_slab);
+            });
+        }
         dst.set_host_dirty();
 
         return dst;
@@ -0,0 +1,288 @@
+#ifndef HALIDE_TRACE_READER_H
+#define HALIDE_TRACE_READER_H
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "HalideRuntime.h"
+#include "halide_trace_config.h"
+
+namespace Halide {
+namespace Trace {
+
+// Reads the packets of a binary trace, either written by
+// halide_default_trace as a sequence of chunks (see
+// halide_trace_chunk_t), or as plain halide_trace_packet_t structs.
+// The packets of chunks are returned in an order consistent with the
+// order in which they were traced.
+class PacketReader {
+public:
+    // Reads up to 'count' bytes of the trace into 'dst', and returns
+    // the number of bytes read, which is less than 'count' only at
+    // the end of the trace.
+    using ReadFunc = std::function<size_t(void *dst, size_t count)>;
+
+    explicit PacketReader(ReadFunc read, ErrorFunc error = default_error)
+        : read(std::move(read)), error(std::move(error)) {
+    }
+
+    // Read the next packet into 'dst', which has room for 'capacity'
+    // bytes. Returns false at the end of the trace.
+    bool next(halide_trace_packet_t *dst, size_t capacity) {
+        while (ready.empty()) {
+            if (at_end) {
+                return false;
+            }
+            if (!read_more()) {
+                at_end = true;
+            }
+            release();
+        }
+        const std::vector<uint8_t> &p = ready.front();
+        if (p.size() > capacity) {
+            error("Packet of " + std::to_string(p.size()) + " bytes is too large to read");
+            return false;
+        }
+        memcpy((void *)dst, p.data(), p.size());
+        ready.pop_front();
+        return true;
+    }
+
+private:
+    ReadFunc read;
+    ErrorFunc error;
+    bool at_end = false;
+
+    // Packets that can be returned, in order.
+    std::deque<std::vector<uint8_t>> ready;
+
+    // Packets which might be preceded by ones not yet read, keyed by
+    // twice their epoch, plus one for loads and stores, and then by
+    // the order in which they were read.
+    std::map<std::pair<uint64_t, uint64_t>, std::vector<uint8_t>> pending;
+    uint64_t packets_read = 0;
+
+    // No packet yet to be read has an epoch before the horizon.
+    uint64_t horizon = 0;
+
+    // The epoch of the last event other than a load or a store
+    // returned. Loads and stores at this epoch can be returned as
+    // soon as they are read.
+    uint64_t current_epoch = 0;
+
+    // The previous packet of the chunk being decoded.
+    struct {
+        uint64_t epoch;
+        int32_t id, parent_id, value_index, dimensions;
+        halide_type_t type;
+        uint32_t event;
+        std::string func, trace_tag;
+        std::vector<int32_t> coordinates;
+    } prev;
+
+    bool read_bytes(void *dst, size_t count, bool eof_ok) {
+        size_t n = read(dst, count);
+        if (n == count) {
+            return true;
+        }
+        if (n > 0 || !eof_ok) {
+            error("Unexpected end of trace");
+        }
+        return false;
+    }
+
+    // Read a packet or a chunk from the trace. Returns false at the end.
+    bool read_more() {
+        uint32_t word;
+        if (!read_bytes(&word, sizeof(word), true)) {
+            return false;
+        }
+        if (word != halide_trace_chunk_magic) {
+            // A plain packet, for which word is the size.
+            if (word < sizeof(halide_trace_packet_t)) {
+                error("Bad packet size in trace: " + std::to_string(word));
+                return false;
+            }
+            std::vector<uint8_t> p(word);
+            memcpy(p.data(), &word, sizeof(word));
+            if (!read_bytes(p.data() + sizeof(word), word - sizeof(word), false)) {
+                return false;
+            }
+            ready.push_back(std::move(p));
+            return true;
+        }
+
+        halide_trace_chunk_t header;
+        header.magic = word;
+        if (!read_bytes(&header.size, sizeof(header) - sizeof(word), false)) {
+            return false;
+        }
+        std::vector<uint8_t> chunk(header.size);
+        if (!read_bytes(chunk.data(), chunk.size(), false)) {
+            return false;
+        }
+        decode_chunk(chunk, header.packets);
+        uint64_t h = unwrap(header.horizon);
+        if (h > horizon) {
+            horizon = h;
+        }
+        return true;
+    }
+
+    // Epochs are written modulo 2^32. Recover the full epoch from the
+    // nearby horizon.
+    uint64_t unwrap(uint32_t epoch) const {
+        return horizon + (int64_t)(int32_t)(epoch - (uint32_t)horizon);
+    }
+
+    void decode_chunk(const std::vector<uint8_t> &chunk, uint32_t packets) {
+        const uint8_t *src = chunk.data(), *end = src + chunk.size();
+        bool corrupt = false;
+
+        auto get_byte = [&]() -> uint8_t {
+            if (src == end) {
+                corrupt = true;
+                return 0;
+            }
+            return *src++;
+        };
+        auto get_varint = [&]() -> uint32_t {
+            uint32_t x = 0;
+            for (int shift = 0; shift < 35; shift += 7) {
+                uint8_t b = get_byte();
+                x |= (uint32_t)(b & 0x7f) << shift;
+                if (!(b & 0x80)) {
+                    return x;
+                }
+            }
+            corrupt = true;
+            return x;
+        };
+        auto get_delta = [&](uint32_t prev) -> uint32_t {
+            uint32_t z = get_varint();
+            return prev + ((z >> 1) ^ (0 - (z & 1)));
+        };
+        auto get_string = [&]() -> std::string {
+            const uint8_t *s = src;
+            while (src < end && *src) {
+                src++;
+            }
+            if (src == end) {
+                corrupt = true;
+                return std::string();
+            }
+            return std::string((const char *)s, (const char *)src++);
+        };
+
+        prev.epoch = 0;
+        prev.id = prev.parent_id = prev.value_index = prev.dimensions = 0;
+        prev.type = halide_type_t();
+        prev.event = 0;
+        prev.func.clear();
+        prev.trace_tag.clear();
+        prev.coordinates.clear();
+
+        for (uint32_t i = 0; i < packets && !corrupt; i++) {
+            uint8_t flags = get_byte();
+            uint32_t epoch = get_delta((uint32_t)prev.epoch);
+            prev.epoch = unwrap(epoch);
+            prev.id = (int32_t)get_delta(prev.id);
+            if (flags & halide_trace_chunk_new_parent) {
+                prev.parent_id = (int32_t)get_delta(prev.parent_id);
+            }
+            if (flags & halide_trace_chunk_new_header) {
+                prev.type.code = (halide_type_code_t)get_byte();
+                prev.type.bits = get_byte();
+                prev.type.lanes = (uint16_t)get_varint();
+                prev.event = get_varint();
+                prev.value_index = (int32_t)get_varint();
+                prev.dimensions = (int32_t)get_varint();
+            }
+            bool delta = (flags & halide_trace_chunk_delta_coordinates) != 0;
+            if (delta && prev.coordinates.size() < (size_t)prev.dimensions) {
+                corrupt = true;
+                break;
+            }
+            prev.coordinates.resize(prev.dimensions);
+            for (int32_t d = 0; d < prev.dimensions; d++) {
+                prev.coordinates[d] = (int32_t)get_delta(delta ? prev.coordinates[d] : 0);
+            }
+            size_t value_bytes = prev.type.lanes * prev.type.bytes();
+            if ((size_t)(end - src) < value_bytes) {
+                corrupt = true;
+                break;
+            }
+            const uint8_t *value = src;
+            src += value_bytes;
+            if (flags & halide_trace_chunk_new_names) {
+                prev.func = get_string();
+                prev.trace_tag = get_string();
+            }
+            if (corrupt) {
+                break;
+            }
+
+            // Lay the packet out as halide_default_trace used to write it.
+            size_t coords_bytes = prev.dimensions * sizeof(int32_t);
+            size_t size = (sizeof(halide_trace_packet_t) + coords_bytes + value_bytes +
+                           prev.func.size() + 1 + prev.trace_tag.size() + 1 + 3) & ~3;
+            std::vector<uint8_t> bytes(size, 0);
+            halide_trace_packet_t *p = (halide_trace_packet_t *)bytes.data();
+            p->size = (uint32_t)size;
+            p->id = prev.id;
+            p->type = prev.type;
+            p->event = (halide_trace_event_code_t)prev.event;
+            p->parent_id = prev.parent_id;
+            p->value_index = prev.value_index;
+            p->dimensions = prev.dimensions;
+            memcpy(p->coordinates(), prev.coordinates.data(), coords_bytes);
+            memcpy(p->value(), value, value_bytes);
+            memcpy(p->func(), prev.func.c_str(), prev.func.size() + 1);
+            memcpy(p->trace_tag(), prev.trace_tag.c_str(), prev.trace_tag.size() + 1);
+
+            bool is_load_or_store = (prev.event == halide_trace_load ||
+                                     prev.event == halide_trace_store);
+            if (is_load_or_store && prev.epoch == current_epoch) {
+                ready.push_back(std::move(bytes));
+            } else {
+                pending[{prev.epoch * 2 + (is_load_or_store ? 1 : 0), packets_read}] = std::move(bytes);
+            }
+            packets_read++;
+        }
+
+        if (corrupt || src != end) {
+            error("Corrupt chunk in trace");
+        }
+    }
+
+    // Move the pending packets which can't be preceded by packets yet
+    // to be read to the ready queue.
+    void release() {
+        while (!pending.empty()) {
+            auto it = pending.begin();
+            uint64_t epoch = it->first.first / 2;
+            bool is_load_or_store = (it->first.first & 1) != 0;
+            if (!at_end &&
+                epoch >= horizon &&
+                (epoch > horizon || (is_load_or_store && epoch != current_epoch))) {
+                break;
+            }
+            if (!is_load_or_store) {
+                current_epoch = epoch;
+            }
+            ready.push_back(std::move(it->second));
+            pending.erase(it);
+        }
+    }
+};
+
+}  // namespace Trace
+}  // namespace Halide
+
+#endif  // HALIDE_TRACE_READER_H
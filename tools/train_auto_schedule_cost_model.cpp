@@ -0,0 +1,146 @@
+// Fit the weights of a linear auto-scheduler cost model to samples
+// collected by running the auto-scheduler with
+// HL_AUTO_SCHEDULE_COLLECT=samples.txt. Build with
+//
+//   c++ -O2 -std=c++11 train_auto_schedule_cost_model.cpp -o train_auto_schedule_cost_model
+//
+// and run as
+//
+//   ./train_auto_schedule_cost_model samples.txt [more_samples.txt ...] > weights.txt
+//
+// then use the model with HL_AUTO_SCHEDULE_COST_MODEL=weights.txt.
+//
+// Each sample is the runtime of a pipeline in nanoseconds followed by
+// the features of its groups, summed. The cost model is linear in the
+// features, so the sum of the costs of the groups is the weights
+// dotted with the summed features. This fits non-negative weights
+// minimizing the squared relative error of the predicted runtimes,
+// with a little ridge regularization, by coordinate descent.
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " samples.txt [more_samples.txt ...] > weights.txt\n";
+        return 1;
+    }
+
+    std::vector<std::string> names;
+    std::vector<double> runtimes;
+    std::vector<std::vector<double>> features;
+
+    for (int i = 1; i < argc; i++) {
+        std::ifstream in(argv[i]);
+        if (!in) {
+            std::cerr << "Can't open " << argv[i] << "\n";
+            return 1;
+        }
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream tokens(line);
+            if (line[0] == '#') {
+                // A header naming the features.
+                std::string token;
+                std::vector<std::string> header;
+                tokens >> token >> token;  // "#" and "runtime_ns"
+                while (tokens >> token) {
+                    header.push_back(token);
+                }
+                if (!names.empty() && header != names) {
+                    std::cerr << argv[i] << " has different features than the files before it\n";
+                    return 1;
+                }
+                names = header;
+                continue;
+            }
+            double runtime;
+            if (!(tokens >> runtime)) {
+                continue;
+            }
+            std::vector<double> f;
+            double v;
+            while (tokens >> v) {
+                f.push_back(v);
+            }
+            if (f.size() != names.size()) {
+                std::cerr << "Malformed sample in " << argv[i] << ": " << line << "\n";
+                return 1;
+            }
+            runtimes.push_back(runtime);
+            features.push_back(f);
+        }
+    }
+
+    const size_t n = runtimes.size(), m = names.size();
+    if (n == 0) {
+        std::cerr << "No samples found\n";
+        return 1;
+    }
+
+    // Weight each sample by its inverse runtime, so that fast and slow
+    // pipelines count equally, and scale each feature to unit norm so
+    // that one regularization constant suits them all.
+    std::vector<std::vector<double>> a(n, std::vector<double>(m));
+    std::vector<double> b(n), scale(m, 0.0);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < m; j++) {
+            a[i][j] = features[i][j] / runtimes[i];
+            scale[j] += a[i][j] * a[i][j];
+        }
+        b[i] = 1.0;
+    }
+    for (size_t j = 0; j < m; j++) {
+        scale[j] = std::sqrt(scale[j]);
+        for (size_t i = 0; i < n; i++) {
+            a[i][j] = scale[j] > 0 ? a[i][j] / scale[j] : 0;
+        }
+    }
+
+    const double lambda = 1e-3;
+    std::vector<double> w(m, 0.0), residual(b);
+    for (int iter = 0; iter < 10000; iter++) {
+        double max_change = 0;
+        for (size_t j = 0; j < m; j++) {
+            if (scale[j] == 0) {
+                continue;
+            }
+            // Minimize over w[j] with the others fixed; the column
+            // has unit norm.
+            double dot = 0;
+            for (size_t i = 0; i < n; i++) {
+                dot += a[i][j] * residual[i];
+            }
+            double new_w = std::max(0.0, (dot + w[j]) / (1 + lambda));
+            double delta = new_w - w[j];
+            if (delta != 0) {
+                for (size_t i = 0; i < n; i++) {
+                    residual[i] -= delta * a[i][j];
+                }
+                w[j] = new_w;
+            }
+            max_change = std::max(max_change, std::abs(delta));
+        }
+        if (max_change < 1e-9) {
+            break;
+        }
+    }
+
+    double error = 0;
+    for (size_t i = 0; i < n; i++) {
+        error += residual[i] * residual[i];
+    }
+
+    std::cout << "# Fit to " << n << " samples, RMS relative error "
+              << std::sqrt(error / n) << "\n";
+    std::cout.precision(9);
+    for (size_t j = 0; j < m; j++) {
+        std::cout << names[j] << " " << (scale[j] > 0 ? w[j] / scale[j] : 0.0) << "\n";
+    }
+    return 0;
+}
@@ -332,9 +332,10 @@ int main(int argc, char * const *argv) {
 
     printf("[INFO] First pass...\n");
 
+    Trace::PacketReader first_pass = trace_reader(file_desc);
     for (;;) {
         Packet p;
-        if (!p.read_from_filedesc(file_desc)) {
+        if (!p.read_from(first_pass)) {
             printf("[INFO] Finished pass 1 after %d packets.\n", packet_count);
             break;
         }
@@ -366,9 +367,10 @@ int main(int argc, char * const *argv) {
         pair.second.allocate();
     }
 
+    Trace::PacketReader second_pass = trace_reader(file_desc);
     for (;;) {
         Packet p;
-        if (!p.read_from_filedesc(file_desc)) {
+        if (!p.read_from(second_pass)) {
             printf("[INFO] Finished pass 2 after %d packets.\n", packet_count);
             if (file_desc != nullptr) {
                 fclose(file_desc);
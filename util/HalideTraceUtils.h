@@ -2,6 +2,7 @@
 #define HALIDE_TRACE_UTILS_H
 
 #include "HalideRuntime.h"
+#include "halide_trace_reader.h"
 #include <stdio.h>
 #include <cstring>
 
@@ -83,17 +84,15 @@ struct Packet : public halide_trace_packet_t {
         return value_as<T>(type, aligned_value);
     }
 
-    // Grab a packet from stdin. Returns false when stdin closes.
-    bool read_from_stdin();
-
-    // Grab a packet from a particular fctl file descriptor. Returns false when end is reached.
-    bool read_from_filedesc(FILE *fdesc);
-
-private:
-    // Do a blocking read of some number of bytes from a unistd file descriptor.
-    bool read(void *d, size_t size, FILE *fdesc);
+    // Grab the next packet of a trace. Returns false when the end is reached.
+    bool read_from(Trace::PacketReader &reader) {
+        return reader.next(this, sizeof(*this));
+    }
 };
 
+// Make a reader for the trace in a file, which exits on errors.
+Trace::PacketReader trace_reader(FILE *fdesc);
+
 }
 }
 
@@ -26,6 +26,7 @@
 #include "HalideRuntime.h"
 
 #include "halide_trace_config.h"
+#include "halide_trace_reader.h"
 
 using namespace Halide;
 using namespace Halide::Trace;
@@ -145,34 +146,23 @@ T get_value_as(const halide_trace_packet_t &p, int idx) {
 struct PacketAndPayload : public halide_trace_packet_t {
     uint8_t payload[4096];
 
-    static bool read_or_die(void *buf, size_t count) {
+    static size_t read_or_die(void *buf, size_t count) {
         char *p = (char *)buf;
         char *p_end = p + count;
         while (p < p_end) {
             int64_t bytes_read = ::read(STDIN_FILENO, p, p_end - p);
             if (bytes_read == 0) {
-                return false;  // EOF
+                break;  // EOF
             } else if (bytes_read < 0) {
                 fail() << "Unable to read packet";
             }
             p += bytes_read;
         }
-        assert(p == p_end);
-        return true;
+        return p - (char *)buf;
     }
 
-    bool read() {
-        constexpr size_t header_size = sizeof(halide_trace_packet_t);
-        if (!read_or_die(this, header_size)) {
-            return false;  // EOF
-        }
-
-        const size_t payload_size = this->size - header_size;
-        if (payload_size > sizeof(this->payload) || !read_or_die(this->payload, payload_size)) {
-            // Shouldn't ever get EOF here
-            fail() << "Unable to read packet payload of size " << payload_size;
-        }
-        return true;
+    bool read(PacketReader &reader) {
+        return reader.next(this, sizeof(*this));
     }
 };
 
@@ -1090,6 +1080,9 @@ int run(bool ignore_trace_tags, FlagProcessor flag_processor) {
     std::list<std::pair<Label, int>> labels_being_drawn;
     size_t end_counter = 0;
     size_t packet_clock = 0;
+    PacketReader reader(PacketAndPayload::read_or_die, [](const std::string &msg) {
+        fail() << msg;
+    });
     for (;;) {
         // Hold for some number of frames once the trace has finished.
         if (end_counter) {
@@ -1144,7 +1137,7 @@ int run(bool ignore_trace_tags, FlagProcessor flag_processor) {
 
         // Read a tracing packet
         PacketAndPayload p;
-        if (!p.read()) {
+        if (!p.read(reader)) {
             end_counter++;
             continue;
         }